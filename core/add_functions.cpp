@@ -29,6 +29,7 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <type_traits>
 #include <stdio.h>
 
 #include "model_object.h"
@@ -114,6 +115,39 @@ public:
 factory::~factory() {};
 
 
+// Statically dispatched evaluation kernels, one per FunctionObject class.
+// The factory below attaches the kernel for function_object_type to each object
+// it creates, so the object's actual class is known at compile time and
+// ModelObject can compute image rows (via FunctionObject::ComputeValues) with
+// direct (qualified, non-virtual) calls: one call to the class's own GetValues,
+// if it has one, otherwise one call to its GetValue per pixel, in a loop which
+// the compiler can optimize for that class. (Objects created some other way
+// keep using the virtual GetValues.)
+
+// true if function_object_type (or an intermediate base class) overrides
+// FunctionObject::GetValues
+template <class function_object_type>
+struct has_own_GetValues
+{
+  static const bool value = ! is_same<decltype(&function_object_type::GetValues),
+  			void (FunctionObject::*)(const double *, const double *, double *, long)>::value;
+};
+
+template <class function_object_type>
+void StaticValuesKernel( FunctionObject *funcObj, const double *xVals, const double *yVals, 
+						double *outVals, long nVals )
+{
+  function_object_type  *theFunction = static_cast<function_object_type *>(funcObj);
+
+  if (has_own_GetValues<function_object_type>::value)
+    theFunction->function_object_type::GetValues(xVals, yVals, outVals, nVals);
+  else {
+    for (long i = 0; i < nVals; i++)
+      outVals[i] = theFunction->function_object_type::GetValue(xVals[i], yVals[i]);
+  }
+}
+
+
 // Template for derived FunctionObject factory classes
 // (this implicitly sets up a whole set of derived classes, one for each
 // FunctionOjbect class we substitute for the "function_object_type" placeholder)
@@ -121,7 +155,12 @@ template <class function_object_type>
 class funcobj_factory : public factory
 {
 public:
-   FunctionObject* create() { return new function_object_type(); }
+   FunctionObject* create()
+   {
+     function_object_type  *newFunction = new function_object_type();
+     newFunction->SetValuesKernel(StaticValuesKernel<function_object_type>);
+     return newFunction;
+   }
 };
 
 
@@ -0,0 +1,201 @@
+/* FILE: aligned_arena.cpp ----------------------------------------- */
+
+// Code for the AlignedArena class, which allocates (and eventually frees) the
+// per-fit buffers of ModelObject, Convolver, and OversampledRegion objects
+// as zeroed, 64-byte-aligned memory.
+
+// Copyright 2014-2018 by Peter Erwin.
+//
+// This file is part of Imfit.
+//
+// Imfit is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Imfit is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with Imfit.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#include "aligned_arena.h"
+
+using namespace std;
+
+
+// Buffers smaller than this are zeroed by a single thread
+const size_t  PARALLEL_FIRST_TOUCH_SIZE = 4*ARENA_BLOCK_SIZE;
+const size_t  PAGE_SIZE_BYTES = 4096;
+
+
+/* ------------------- Function Prototypes ----------------------------- */
+
+static void FirstTouch( char *buffer, size_t nBytes );
+
+
+
+/* ---------------- FUNCTION: FirstTouch ------------------------------- */
+/// Zeroes the buffer; for large buffers, this is done page by page by all the
+/// OpenMP threads, each taking one contiguous chunk (static schedule), so that
+/// the pages are placed on the NUMA nodes of the threads that touch them first.
+static void FirstTouch( char *buffer, size_t nBytes )
+{
+  if (nBytes < PARALLEL_FIRST_TOUCH_SIZE) {
+    memset(buffer, 0, nBytes);
+    return;
+  }
+  long  nPages = (long)((nBytes + PAGE_SIZE_BYTES - 1) / PAGE_SIZE_BYTES);
+#pragma omp parallel for schedule(static)
+  for (long k = 0; k < nPages; k++) {
+    size_t  offset = (size_t)k * PAGE_SIZE_BYTES;
+    size_t  nBytesThisPage = PAGE_SIZE_BYTES;
+    if (offset + nBytesThisPage > nBytes)
+      nBytesThisPage = nBytes - offset;
+    memset(buffer + offset, 0, nBytesThisPage);
+  }
+}
+
+
+
+/* ---------------- CONSTRUCTOR ---------------------------------------- */
+
+AlignedArena::AlignedArena( )
+{
+  currentSharedBlock = NULL;
+  currentOffset = 0;
+  nBytesAllocated = 0;
+  nBytesReserved = 0;
+}
+
+
+/* ---------------- DESTRUCTOR ----------------------------------------- */
+
+AlignedArena::~AlignedArena( )
+{
+  FreeAll();
+}
+
+
+/* ---------------- PUBLIC METHOD: Allocate ---------------------------- */
+/// Returns a pointer to nBytes of zeroed memory, aligned on an ARENA_ALIGNMENT
+/// boundary; returns NULL if memory allocation failed.
+void * AlignedArena::Allocate( size_t nBytes )
+{
+  char  *buffer;
+
+  // round up, so that the next buffer in a shared block is also aligned
+  size_t  nBytesAligned = ((nBytes + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT) * ARENA_ALIGNMENT;
+  if (nBytesAligned == 0)
+    nBytesAligned = ARENA_ALIGNMENT;
+
+  if (nBytesAligned > ARENA_BLOCK_SIZE/4) {
+    // large buffer: gets its own block
+    buffer = AllocateBlock(nBytesAligned);
+    if (buffer == NULL)
+      return NULL;
+    blockIsShared.push_back(false);
+  }
+  else {
+    if ((currentSharedBlock == NULL) || (currentOffset + nBytesAligned > ARENA_BLOCK_SIZE)) {
+      currentSharedBlock = AllocateBlock(ARENA_BLOCK_SIZE);
+      if (currentSharedBlock == NULL)
+        return NULL;
+      blockIsShared.push_back(true);
+      currentOffset = 0;
+    }
+    buffer = currentSharedBlock + currentOffset;
+    currentOffset += nBytesAligned;
+  }
+  nBytesAllocated += (long)nBytesAligned;
+  return (void *)buffer;
+}
+
+
+/* ---------------- PUBLIC METHOD: Free -------------------------------- */
+/// Frees a (large) buffer which has its own block; buffers in shared blocks
+/// (and NULL pointers) are ignored.
+void AlignedArena::Free( void *buffer )
+{
+  if (buffer == NULL)
+    return;
+  for (int n = 0; n < (int)blocks.size(); n++) {
+    if ((blocks[n] == (char *)buffer) && (! blockIsShared[n])) {
+      nBytesAllocated -= (long)blockSizes[n];
+      nBytesReserved -= (long)blockSizes[n];
+      free(blocks[n]);
+      blocks.erase(blocks.begin() + n);
+      blockSizes.erase(blockSizes.begin() + n);
+      blockIsShared.erase(blockIsShared.begin() + n);
+      return;
+    }
+  }
+}
+
+
+/* ---------------- PUBLIC METHOD: FreeAll ----------------------------- */
+
+void AlignedArena::FreeAll( )
+{
+  for (int n = 0; n < (int)blocks.size(); n++)
+    free(blocks[n]);
+  blocks.clear();
+  blockSizes.clear();
+  blockIsShared.clear();
+  currentSharedBlock = NULL;
+  currentOffset = 0;
+  nBytesAllocated = 0;
+  nBytesReserved = 0;
+}
+
+
+/* ---------------- PUBLIC METHOD: GetBytesAllocated ------------------- */
+
+long AlignedArena::GetBytesAllocated( )
+{
+  return nBytesAllocated;
+}
+
+
+/* ---------------- PUBLIC METHOD: GetBytesReserved ------------------- */
+
+long AlignedArena::GetBytesReserved( )
+{
+  return nBytesReserved;
+}
+
+
+/* ---------------- PRIVATE METHOD: AllocateBlock ---------------------- */
+/// Allocates and zeroes a new aligned block of memory and adds it to the list
+/// of blocks (caller must then add the corresponding blockIsShared entry).
+char * AlignedArena::AllocateBlock( size_t nBytes )
+{
+  void  *newBlock = NULL;
+
+  if (posix_memalign(&newBlock, ARENA_ALIGNMENT, nBytes) != 0) {
+    fprintf(stderr, "*** ERROR: AlignedArena: unable to allocate %ld bytes of memory!\n",
+    		(long)nBytes);
+    return NULL;
+  }
+  FirstTouch((char *)newBlock, nBytes);
+  blocks.push_back((char *)newBlock);
+  blockSizes.push_back(nBytes);
+  nBytesReserved += (long)nBytes;
+  return (char *)newBlock;
+}
+
+
+
+/* END OF FILE: aligned_arena.cpp ---------------------------------- */
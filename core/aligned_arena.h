@@ -0,0 +1,78 @@
+/*! \file
+   \brief  Class declaration for AlignedArena (owns the per-fit buffers of a
+           ModelObject and its Convolver and OversampledRegion objects).
+ */
+/*    All buffers are aligned on ARENA_ALIGNMENT (= 64-byte, cache-line) boundaries
+ * and are returned zeroed. Large buffers get their own block of memory, which is
+ * zeroed ("first-touched") by the OpenMP threads in parallel, each thread taking
+ * a contiguous chunk, so that on NUMA systems the pages are spread over the nodes
+ * of the threads which will work on them. Small buffers are packed into shared
+ * blocks.
+ *
+ * Everything is freed when the arena is destroyed; large buffers can also be
+ * freed individually (e.g., if a model image is set up a second time with a
+ * different size).
+ */
+
+#ifndef _ALIGNED_ARENA_H_
+#define _ALIGNED_ARENA_H_
+
+#include <stddef.h>
+#include <vector>
+
+using namespace std;
+
+
+const size_t  ARENA_ALIGNMENT = 64;
+// size of the shared blocks used for small buffers; buffers larger than
+// ARENA_BLOCK_SIZE/4 get their own block
+const size_t  ARENA_BLOCK_SIZE = 1048576;
+
+
+/// \brief Owner of a set of zeroed, 64-byte-aligned buffers, which are all freed
+///        when the arena is destroyed
+class AlignedArena
+{
+  public:
+    AlignedArena( );
+    ~AlignedArena( );
+
+    /// Returns pointer to nBytes of zeroed, aligned memory (NULL on failure)
+    void * Allocate( size_t nBytes );
+
+    template <typename T> T * AllocateArray( size_t nElements )
+    {
+      return (T *)Allocate(nElements * sizeof(T));
+    };
+
+    /// Frees a buffer from Allocate() if it has its own block; otherwise, its
+    /// memory is only reclaimed when the arena is destroyed
+    void Free( void *buffer );
+
+    /// Frees all memory held by the arena
+    void FreeAll( );
+
+    /// Returns the total size in bytes of all buffers currently allocated
+    /// (including alignment padding)
+    long GetBytesAllocated( );
+
+    /// Returns the total size in bytes of all memory blocks held by the arena
+    long GetBytesReserved( );
+
+  private:
+    // arenas are never copied (the copy would free the same blocks)
+    AlignedArena( const AlignedArena& );
+    AlignedArena& operator=( const AlignedArena& );
+
+    char * AllocateBlock( size_t nBytes );
+
+    vector<char *>  blocks;
+    vector<size_t>  blockSizes;
+    vector<bool>  blockIsShared;
+    char  *currentSharedBlock;
+    size_t  currentOffset;
+    long  nBytesAllocated, nBytesReserved;
+};
+
+
+#endif  // _ALIGNED_ARENA_H_
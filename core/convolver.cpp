@@ -110,6 +110,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <algorithm>
 
 #include "fftw3.h"
 
@@ -117,10 +118,38 @@
 #include <unistd.h>
 #endif  // FFTW_THREADING
 
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
 #include "convolver.h"
+#include "fftw_wisdom.h"
 
 #define DEFAULT_OPENMP_CHUNK_SIZE  10
 
+// Cost model for choosing padded FFT sizes: relative costs per point of one
+// FFTW pass with radix 2, 3, 5, or 7 (roughly log2(radix), with a penalty for the
+// less efficient odd radices), plus a fixed cost per point for the work done
+// outside the FFTs (zeroing and copying the padded image, multiplying transforms)
+const int  N_FFT_RADICES = 4;
+const int  FFT_RADICES[N_FFT_RADICES] = {2, 3, 5, 7};
+const double  FFT_RADIX_COSTS[N_FFT_RADICES] = {1.0, 1.75, 2.8, 3.65};
+const double  FFT_POINT_OVERHEAD = 2.0;
+
+// Number of complex values of the PSF transform applied to all images of a batch
+// at a time (small enough that the block stays in L1/L2 cache)
+const long  BATCH_BLOCK_SIZE = 1024;
+
+// Tiled convolution: default minimum tile (FFT) size, and the minimum tile size
+// as a multiple of the PSF size (so that most of each tile is usable output)
+const int  DEFAULT_FFT_TILE_SIZE = 512;
+const int  DEFAULT_TILE_PSF_MULTIPLE = 4;
+
+
+/* ------------------- Function Prototypes ----------------------------- */
+
+static vector<int> SmoothFFTSizes( int minimumSize );
+
 
 			
 /* ---------------- CONSTRUCTOR ---------------------------------------- */
@@ -132,30 +161,55 @@ Convolver::Convolver( )
   imageInfoSet = false;
   fftVectorsAllocated = false;
   fftPlansCreated = false;
+  outputRegionSet = false;
   normalizePSF = true;   // default is to normalize the PSF
+  singlePrecision = false;
   maxRequestedThreads = 0;   // default value --> use all available processors/cores
+  requestedConvolutionMethod = CONVOLUTION_AUTO;
+  convolutionMethod = CONVOLUTION_AUTO;
+  directBuffersAllocated = false;
+  directKernel = directOutput = NULL;
+  separableTolerance = 0.0;
+  separableError = 0.0;
+  separableRank = 0;
+  separableRowKernels = separableColumnKernels = separableWorkspace = NULL;
+  fftwPlanFlags = FFTW_ESTIMATE;
+  psfTransform = NULL;
+  batchSize = 0;
+  batchPlansCreated = false;
+  batch_in_padded = batch_out = NULL;
+  batch_fft_cmplx = NULL;
+  requestedTileSize = 0;
+  nTileWorkers = 1;
+  tileStepX = tileStepY = tileMarginX = tileMarginY = 0;
+  workStride_real = workStride_complex = 0;
+  tileBandOutput = tileHaloRows = NULL;
+  arena = &ownArena;
 }
 
 
 /* ---------------- DESTRUCTOR ----------------------------------------- */
 
-/// Destructor for Convolver class
+/// Destructor for Convolver class. (The FFT buffers belong to the arena, and are
+/// freed when it is destroyed.)
 Convolver::~Convolver( )
 {
 
-  if (fftPlansCreated) {
-    fftw_destroy_plan(plan_inputImage);
-    fftw_destroy_plan(plan_psf);
-    fftw_destroy_plan(plan_inverse);
-  }
-  if (fftVectorsAllocated) {
-    fftw_free(image_in_padded);
-    fftw_free(image_fft_cmplx);
-    fftw_free(psf_in_padded);
-    fftw_free(psf_fft_cmplx);
-    fftw_free(multiplied_cmplx);
-    fftw_free(convolvedImage_out);
-  }
+  FreeBatchConvolution();
+  DestroyPlans();
+}
+
+
+/* ---------------- DestroyPlans --------------------------------------- */
+/// Releases the PSF transform and the image and inverse FFTW plans, which belong
+/// to the PSF-transform cache (the PSF plan is destroyed at the end of DoFullSetup).
+void Convolver::DestroyPlans( )
+{
+  if (! fftPlansCreated)
+    return;
+  ReleasePsfTransform(psfTransform);
+  psfTransform = NULL;
+  fftPlansCreated = false;
 }
 
 
@@ -168,11 +222,110 @@ void Convolver::SetMaxThreads( int maximumThreadNumber )
 }
 
 
+/* ---------------- SetArena ------------------------------------------- */
+/// Tells the Convolver to allocate its FFT buffers from externalArena (which
+/// must outlive the Convolver) instead of its own arena.
+void Convolver::SetArena( AlignedArena *externalArena )
+{
+  if (externalArena == arena)
+    return;
+  if (fftVectorsAllocated) {
+    fprintf(stderr, "*** WARNING: Convolver::SetArena must be called before DoFullSetup!\n");
+    return;
+  }
+  arena = externalArena;
+}
+
+
+/* ---------------- UseSinglePrecision --------------------------------- */
+/// Tells the Convolver to do the image FFTs, the multiplication by the PSF
+/// transform, and the inverse FFT in single precision (using fftwf_* plans and
+/// float arrays, which halves the memory and bandwidth needed). The PSF transform
+/// is computed in double precision and then converted. Must be called before
+/// DoFullSetup(). Returns -1 (and leaves the Convolver in double-precision mode)
+/// if we were compiled without the single-precision FFTW library.
+int Convolver::UseSinglePrecision( )
+{
+#ifdef NO_FFTW_FLOAT
+  return -1;
+#else
+  if (fftVectorsAllocated) {
+    fprintf(stderr, "*** WARNING: Convolver::UseSinglePrecision must be called before DoFullSetup!\n");
+    return -1;
+  }
+  singlePrecision = true;
+  return 0;
+#endif
+}
+
+
+/* ---------------- SetFFTWWisdomFile ---------------------------------- */
+/// Tells the Convolver to import FFTW wisdom from the specified file before
+/// creating its FFTW plans, and to add any new wisdom to the file afterwards
+/// (see fftw_wisdom.h; single-precision wisdom goes in a separate file). Since
+/// plans which are already in the wisdom file cost almost nothing to create,
+/// the plans are then always created with FFTW_MEASURE.
+void Convolver::SetFFTWWisdomFile( const string& wisdomFileName )
+{
+  if (fftPlansCreated)
+    fprintf(stderr, "*** WARNING: Convolver::SetFFTWWisdomFile must be called before DoFullSetup!\n");
+  fftwWisdomFile = wisdomFileName;
+}
+
+
+/* ---------------- SetConvolutionMethod ------------------------------- */
+/// Specifies whether convolution is done with FFTs (CONVOLUTION_FFT), directly
+/// in the spatial domain (CONVOLUTION_DIRECT), or with whichever of the two is
+/// estimated to be faster for the PSF and image sizes (CONVOLUTION_AUTO, the
+/// default); CONVOLUTION_TILED uses FFTs of fixed-size tiles (see SetTileSize).
+/// Must be called before DoFullSetup().
+void Convolver::SetConvolutionMethod( int method )
+{
+  if ((fftVectorsAllocated) || (directBuffersAllocated))
+    fprintf(stderr, "*** WARNING: Convolver::SetConvolutionMethod must be called before DoFullSetup!\n");
+  requestedConvolutionMethod = method;
+  convolutionMethod = method;
+}
+
+
+/* ---------------- GetConvolutionMethod ------------------------------- */
+
+int Convolver::GetConvolutionMethod( )
+{
+  return convolutionMethod;
+}
+
+
+/* ---------------- SetTileSize ---------------------------------------- */
+/// Tells the Convolver to use overlap-save convolution (CONVOLUTION_TILED): the
+/// image is divided into tiles, each of which is convolved using FFTs of a block
+/// of tileSize x tileSize pixels (rounded up to an FFT-friendly size, and to at
+/// least twice the PSF size) containing the tile plus the surrounding pixels
+/// which contribute to it. The FFT plans and buffers are then the same for any
+/// image size, and the memory used for FFTs is (number of threads) x (block
+/// size), instead of growing with the image; tiles in the same row are convolved
+/// in parallel (with OpenMP). tileSize = 0 gives the default size (the larger of
+/// 512 and 4 times the PSF size). Must be called before DoFullSetup().
+void Convolver::SetTileSize( int tileSize )
+{
+  if ((fftVectorsAllocated) || (directBuffersAllocated))
+    fprintf(stderr, "*** WARNING: Convolver::SetTileSize must be called before DoFullSetup!\n");
+  requestedTileSize = (tileSize > 0) ? tileSize : 0;
+  requestedConvolutionMethod = CONVOLUTION_TILED;
+  convolutionMethod = CONVOLUTION_TILED;
+}
+
+
 /* ---------------- SetupPSF ------------------------------------------- */
 /// Pass in a pointer to the pixel vector for the input PSF image, as well as
 /// the image dimensions and whether PSF needs to be normalized.
+/// If separableTolerance > 0 (and the convolution method is CONVOLUTION_AUTO),
+/// DoFullSetup() looks for the lowest-rank sum of separable (column x row) kernels
+/// which matches the (normalized) PSF to within a relative RMS error of
+/// separableTolerance; if convolving with this is estimated to be faster than
+/// direct or FFT convolution with the exact PSF, it is used instead.
 void Convolver::SetupPSF( double *psfPixels_input, int nColumns, int nRows,
-							bool normalize )
+							bool normalize, double separableTolerance_input )
 {
 
   psfPixels = psfPixels_input;
@@ -180,10 +333,27 @@ void Convolver::SetupPSF( double *psfPixels_input, int nColumns, int nRows,
   nRows_psf = nRows;
   nPixels_psf = (long)nColumns_psf * (long)nRows_psf;
   normalizePSF = normalize;
+  separableTolerance = separableTolerance_input;
   psfInfoSet = true;
 }
 
 
+/* ---------------- GetSeparableRank ----------------------------------- */
+
+int Convolver::GetSeparableRank( )
+{
+  return separableRank;
+}
+
+
+/* ---------------- GetSeparableApproximationError --------------------- */
+
+double Convolver::GetSeparableApproximationError( )
+{
+  return separableError;
+}
+
+
 /* ---------------- SetupImage ----------------------------------------- */
 /// Pass in the dimensions of the image we'll be convolving with the PSF.
 void Convolver::SetupImage( int nColumns, int nRows )
@@ -193,6 +363,48 @@ void Convolver::SetupImage( int nColumns, int nRows )
   nRows_image = nRows;
   nPixels_image = (long)nColumns_image * (long)nRows_image;
   imageInfoSet = true;
+  outputRegionSet = false;
+}
+
+
+/* ---------------- SetOutputRegion ------------------------------------ */
+/// Specifies that only the convolved pixels within the given region of the image
+/// (x0,y0 = 0-based column and row of its first pixel) are needed -- e.g., the
+/// data-image part of a ModelObject's model image. DoFullSetup() then chooses the
+/// padded size needed for correct values in this region only (see MinimumPaddedLength),
+/// which is smaller than the size needed for the whole image, and ConvolveImage()
+/// only copies this region back into the image. Pixels outside the region are *not*
+/// valid convolved values afterwards (with direct convolution, they happen to be).
+/// Must be called after SetupImage() and before DoFullSetup().
+void Convolver::SetOutputRegion( int x0, int y0, int nColumns, int nRows )
+{
+  if (! imageInfoSet) {
+    fprintf(stderr, "*** WARNING: Convolver::SetOutputRegion must be called after SetupImage!\n");
+    return;
+  }
+  if ((x0 < 0) || (y0 < 0) || (nColumns < 1) || (nRows < 1) || (x0 + nColumns > nColumns_image)
+  		|| (y0 + nRows > nRows_image)) {
+    fprintf(stderr, "*** WARNING: Convolver::SetOutputRegion: region is not within the image;\n");
+    fprintf(stderr, "    the whole image will be convolved.\n");
+    return;
+  }
+  outputX0 = x0;
+  outputY0 = y0;
+  nColumns_output = nColumns;
+  nRows_output = nRows;
+  outputRegionSet = true;
+}
+
+
+/* ---------------- GetPaddedImageSize --------------------------------- */
+
+void Convolver::GetPaddedImageSize( int& nColumns, int& nRows )
+{
+  if (fftVectorsAllocated) {
+    nColumns = nColumns_padded;
+    nRows = nRows_padded;
+  } else
+    nColumns = nRows = 0;
 }
 
 
@@ -203,8 +415,6 @@ void Convolver::SetupImage( int nColumns, int nRows )
 int Convolver::DoFullSetup( int debugLevel, bool doFFTWMeasure )
 {
   long  k;
-  unsigned  fftwFlags;
-  double  psfSum;
   
   debugStatus = debugLevel;
   
@@ -213,10 +423,86 @@ int Convolver::DoFullSetup( int debugLevel, bool doFFTWMeasure )
     fprintf(stderr, "*** WARNING: Convolver::DoFullSetup: PSF and/or image parameters not set!\n");
     return -1;
   }
-  nColumns_padded = nColumns_image + nColumns_psf - 1;
-  nRows_padded = nRows_image + nRows_psf - 1;
+  // the padded image must be at least (image + PSF - 1) in size to avoid wrap-around,
+  // unless only part of the convolved image is needed; we round this up to the
+  // cheapest size with only small prime factors (since FFTW can be many times slower
+  // for sizes with large prime factors)
+  if (outputRegionSet) {
+    GetFFTFriendlyPaddedSizes(MinimumPaddedLength(nColumns_image, nColumns_psf, outputX0, 
+    							nColumns_output), MinimumPaddedLength(nRows_image, nRows_psf,
+    							outputY0, nRows_output), nColumns_padded, nRows_padded);
+    if (debugStatus >= 1)
+      printf("Convolving only the %d x %d region starting at (%d,%d)\n", nColumns_output,
+      		nRows_output, outputX0, outputY0);
+  } else {
+    GetFFTFriendlyPaddedSizes(nColumns_image + nColumns_psf - 1, nRows_image + nRows_psf - 1,
+  							nColumns_padded, nRows_padded);
+    outputX0 = outputY0 = 0;
+    nColumns_output = nColumns_image;
+    nRows_output = nRows_image;
+  }
   nPixels_padded = (long)nColumns_padded * (long)nRows_padded;
   rescaleFactor = 1.0 / nPixels_padded;
+
+  // If this is a second call (e.g., with a new image size), start over
+  FreeBatchConvolution();
+  if (fftVectorsAllocated) {
+    DestroyPlans();
+    FreeBuffers();
+  }
+  if (directBuffersAllocated) {
+    arena->Free(directKernel);
+    arena->Free(directOutput);
+    arena->Free(separableRowKernels);
+    arena->Free(separableColumnKernels);
+    arena->Free(separableWorkspace);
+    directKernel = directOutput = NULL;
+    separableRowKernels = separableColumnKernels = separableWorkspace = NULL;
+    separableRank = 0;
+    directBuffersAllocated = false;
+  }
+
+  NormalizePSF();
+
+  // Small PSFs: direct convolution may be faster than FFT convolution
+  convolutionMethod = requestedConvolutionMethod;
+  if (convolutionMethod == CONVOLUTION_AUTO) {
+    double  directCost = EstimateDirectConvolutionCost(nPixels_image, nPixels_psf);
+    double  fftCost = EstimateFFTConvolutionCost(nColumns_padded, nRows_padded);
+    convolutionMethod = ChooseConvolutionMethod(directCost, fftCost);
+    // Separable PSFs (approximately): sum of 1D convolutions may be faster still
+    if (separableTolerance > 0.0) {
+      int  separableStatus = SetupSeparableConvolution(fmin(directCost, fftCost));
+      if (separableStatus != 0)
+        return (separableStatus > 0) ? 0 : -2;
+    }
+  }
+  if (convolutionMethod == CONVOLUTION_DIRECT) {
+    if (debugStatus >= 1)
+      printf("Using direct convolution\n");
+    directKernel = arena->AllocateArray<double>(nPixels_psf);
+    directOutput = arena->AllocateArray<double>(nPixels_image);
+    if ((directKernel == NULL) || (directOutput == NULL)) {
+      fprintf(stderr, "*** WARNING: Convolver::DoFullSetup: memory allocation failure!\n");
+      return -2;
+    }
+    directBuffersAllocated = true;
+    for (k = 0; k < nPixels_psf; k++)
+      directKernel[k] = psfPixels[k];
+    return 0;
+  }
+
+  // Tiled convolution: the padded arrays hold one tile (plus the pixels around it)
+  nTileWorkers = 1;
+  if (convolutionMethod == CONVOLUTION_TILED) {
+    if (singlePrecision) {
+      fprintf(stderr, "*** WARNING: Convolver: tiled convolution is only done in double precision;\n");
+      fprintf(stderr, "    the whole image will be convolved at once.\n");
+      convolutionMethod = CONVOLUTION_FFT;
+    } else
+      SetupTiles();
+  }
+
   if (debugStatus >= 1)
     printf("Images will be padded to %d x %d pixels in size\n", nColumns_padded, nRows_padded);
   // compute size of complex arrays, which are smaller due to use of r2c/c2r FFTW functions
@@ -225,88 +511,177 @@ int Convolver::DoFullSetup( int debugLevel, bool doFFTWMeasure )
   if (debugStatus >= 1)
     printf("Complex images will have dimensions %d x %d pixels in size\n", nCols_trimmed, 
     		nRows_padded);
+  workStride_real = nPixels_padded;
+  workStride_complex = nPixels_padded_complex;
+  if (convolutionMethod == CONVOLUTION_TILED) {
+    // per-thread arrays start on ARENA_ALIGNMENT boundaries, like the arrays
+    // used to create the plans
+    long  realsPerBlock = ARENA_ALIGNMENT / sizeof(double);
+    long  complexesPerBlock = ARENA_ALIGNMENT / sizeof(fftw_complex);
+    workStride_real = ((nPixels_padded + realsPerBlock - 1) / realsPerBlock) * realsPerBlock;
+    workStride_complex = ((nPixels_padded_complex + complexesPerBlock - 1) / complexesPerBlock)
+    						* complexesPerBlock;
+  }
 
 
 #ifdef FFTW_THREADING
   int  threadStatus;
   threadStatus = fftw_init_threads();
+#ifndef NO_FFTW_FLOAT
+  if (singlePrecision)
+    threadStatus = fftwf_init_threads();
+#endif
 #endif  // FFTW_THREADING
 
-  // allocate memory for double and fftw_complex arrays
-  image_in_padded = (double*) fftw_malloc(sizeof(double) * nPixels_padded);
-  image_fft_cmplx = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * nPixels_padded_complex);
-  psf_in_padded = (double*) fftw_malloc(sizeof(double) * nPixels_padded);
-  psf_fft_cmplx = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * nPixels_padded_complex);
-  multiplied_cmplx = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * nPixels_padded_complex);
-  convolvedImage_out = (double*) fftw_malloc(sizeof(double) * nPixels_padded);
-  if ( (image_in_padded == NULL) || (image_fft_cmplx == NULL) || (psf_in_padded == NULL)
-  		|| (psf_fft_cmplx == NULL) || (multiplied_cmplx == NULL) 
-  		|| (convolvedImage_out == NULL) ) {
-    fprintf(stderr, "*** WARNING: Convolver::DoFullSetup: memory allocation failure!\n");
-	return -2;
+  // allocate memory for double and fftw_complex work arrays, from the arena
+  // (64-byte alignment satisfies FFTW's SIMD alignment requirements).
+  if (singlePrecision) {
+#ifndef NO_FFTW_FLOAT
+    image_in_padded_sp = arena->AllocateArray<float>(nPixels_padded);
+    image_fft_cmplx_sp = arena->AllocateArray<fftwf_complex>(nPixels_padded_complex);
+    multiplied_cmplx_sp = arena->AllocateArray<fftwf_complex>(nPixels_padded_complex);
+    convolvedImage_out_sp = arena->AllocateArray<float>(nPixels_padded);
+    if ( (image_in_padded_sp == NULL) || (image_fft_cmplx_sp == NULL) 
+    		|| (multiplied_cmplx_sp == NULL) || (convolvedImage_out_sp == NULL) ) {
+      fprintf(stderr, "*** WARNING: Convolver::DoFullSetup: memory allocation failure!\n");
+      return -2;
+    }
+#endif
+  } else {
+    // (one set of arrays per thread for tiled convolution)
+    image_in_padded = arena->AllocateArray<double>(nTileWorkers*workStride_real);
+    image_fft_cmplx = arena->AllocateArray<fftw_complex>(nTileWorkers*workStride_complex);
+    multiplied_cmplx = arena->AllocateArray<fftw_complex>(nTileWorkers*workStride_complex);
+    convolvedImage_out = arena->AllocateArray<double>(nTileWorkers*workStride_real);
+    if ( (image_in_padded == NULL) || (image_fft_cmplx == NULL)
+    		|| (multiplied_cmplx == NULL) || (convolvedImage_out == NULL) 
+    		|| (AllocateTileBuffers(arena) < 0) ) {
+      fprintf(stderr, "*** WARNING: Convolver::DoFullSetup: memory allocation failure!\n");
+      return -2;
+    }
   }
   fftVectorsAllocated = true;
 
-
-  // set up FFTW plans
-  if (doFFTWMeasure)
-    fftwFlags = FFTW_MEASURE;
+  if ((doFFTWMeasure) || (fftwWisdomFile.size() > 0))
+    fftwPlanFlags = FFTW_MEASURE;
   else
-    fftwFlags = FFTW_ESTIMATE;
+    fftwPlanFlags = FFTW_ESTIMATE;
+
+  // Tiles are convolved in parallel, so their plans are single-threaded
+  int  planThreads = maxRequestedThreads;
+  if (convolutionMethod == CONVOLUTION_TILED)
+    planThreads = 1;
+
+  // If another Convolver has already transformed the same (normalized) PSF for
+  // the same padded size and FFT settings, use its PSF transform and plans
+  psfTransform = FindPsfTransform(psfPixels, nColumns_psf, nRows_psf, nColumns_padded,
+  								nRows_padded, normalizePSF, singlePrecision, fftwPlanFlags,
+  								planThreads);
+  if (psfTransform != NULL) {
+    if (debugStatus >= 1)
+      printf("Using cached PSF transform and FFTW plans\n");
+#ifndef NO_FFTW_FLOAT
+    psf_fft_cmplx_sp = psfTransform->psf_fft_cmplx_sp;
+    plan_inputImage_sp = psfTransform->plan_inputImage_sp;
+    plan_inverse_sp = psfTransform->plan_inverse_sp;
+#endif
+    psf_fft_cmplx = psfTransform->psf_fft_cmplx;
+    plan_inputImage = psfTransform->plan_inputImage;
+    plan_inverse = psfTransform->plan_inverse;
+    fftPlansCreated = true;
+    return 0;
+  }
+
+  // Otherwise, add a new cache entry (which owns the PSF transform and the plans).
+  // The padded PSF image is only needed for computing the PSF transform, so it
+  // is allocated separately and freed at the end of setup; in single-precision
+  // mode, the same is true for the double-precision PSF transform.
+  psfTransform = AddPsfTransform(psfPixels, nColumns_psf, nRows_psf, nColumns_padded,
+  								nRows_padded, normalizePSF, singlePrecision, fftwPlanFlags,
+  								planThreads);
+  psf_in_padded = (double*) fftw_malloc(sizeof(double) * nPixels_padded);
+  psf_fft_cmplx = NULL;
+  if (psfTransform != NULL) {
+#ifndef NO_FFTW_FLOAT
+    psf_fft_cmplx_sp = psfTransform->psf_fft_cmplx_sp;
+    if (singlePrecision)
+      psf_fft_cmplx = (fftw_complex*) fftw_malloc(sizeof(fftw_complex) * nPixels_padded_complex);
+    else
+#endif
+      psf_fft_cmplx = psfTransform->psf_fft_cmplx;
+  }
+  if ((psfTransform == NULL) || (psf_in_padded == NULL) || (psf_fft_cmplx == NULL)) {
+    fprintf(stderr, "*** WARNING: Convolver::DoFullSetup: memory allocation failure!\n");
+    if (singlePrecision)
+      fftw_free(psf_fft_cmplx);
+    fftw_free(psf_in_padded);
+    ReleasePsfTransform(psfTransform);
+    psfTransform = NULL;
+    return -2;
+  }
+
+  // set up FFTW plans (starting with any previously saved wisdom)
+  if (fftwWisdomFile.size() > 0) {
+    ImportFFTWWisdom(fftwWisdomFile);
+#ifndef NO_FFTW_FLOAT
+    if (singlePrecision)
+      ImportFFTWWisdom(fftwWisdomFile, true);
+#endif
+  }
   // Note that there's not much purpose in multi-threading plan_psf, since we only do
   // the FFT of the PSF once
   plan_psf = fftw_plan_dft_r2c_2d(nRows_padded, nColumns_padded, psf_in_padded, 
-  									psf_fft_cmplx, fftwFlags);
+  									psf_fft_cmplx, fftwPlanFlags);
 
 #ifdef FFTW_THREADING
   int  nThreads, nCores;
   nCores = sysconf(_SC_NPROCESSORS_ONLN);
-  if (maxRequestedThreads == 0) {
+  if (planThreads == 0) {
     // Default: 1 thread per available core
     nThreads = nCores;
   } else
-    nThreads = maxRequestedThreads;
+    nThreads = planThreads;
   if (nThreads < 1)
     nThreads = 1;
   fftw_plan_with_nthreads(nThreads);
+#ifndef NO_FFTW_FLOAT
+  if (singlePrecision)
+    fftwf_plan_with_nthreads(nThreads);
+#endif
 #endif  // FFTW_THREADING
 
-  plan_inputImage = fftw_plan_dft_r2c_2d(nRows_padded, nColumns_padded, image_in_padded, 
-  										image_fft_cmplx, fftwFlags);
-
-  plan_inverse = fftw_plan_dft_c2r_2d(nRows_padded, nColumns_padded, multiplied_cmplx, 
-  									convolvedImage_out, fftwFlags);
-  fftPlansCreated = true;
-
-
-  // Generate the Fourier transform of the PSF:
-  // 1. Normalize the PSF
-  if ((debugStatus >= 1) && (normalizePSF)) {
-    printf("Normalizing the PSF ...\n");
-    if (debugStatus >= 2) {
-      printf("The whole input PSF image, row by row:\n");
-      PrintRealImage(psfPixels, nColumns_psf, nRows_psf);
-    }
+  if (singlePrecision) {
+#ifndef NO_FFTW_FLOAT
+    plan_inputImage_sp = fftwf_plan_dft_r2c_2d(nRows_padded, nColumns_padded, image_in_padded_sp, 
+    										image_fft_cmplx_sp, fftwPlanFlags);
+    plan_inverse_sp = fftwf_plan_dft_c2r_2d(nRows_padded, nColumns_padded, multiplied_cmplx_sp, 
+    										convolvedImage_out_sp, fftwPlanFlags);
+#endif
+  } else {
+    plan_inputImage = fftw_plan_dft_r2c_2d(nRows_padded, nColumns_padded, image_in_padded, 
+    										image_fft_cmplx, fftwPlanFlags);
+    plan_inverse = fftw_plan_dft_c2r_2d(nRows_padded, nColumns_padded, multiplied_cmplx, 
+    									convolvedImage_out, fftwPlanFlags);
   }
-  // Use Kahan summation to avoid underflow
-  if (normalizePSF) {
-    psfSum = 0.0;
-    double  storedError = 0.0, adjustedVal = 0.0, tempSum = 0.0;
-    for (k = 0; k < nPixels_psf; k++) {
-      adjustedVal = psfPixels[k] - storedError;
-      tempSum = psfSum + adjustedVal;
-      storedError = (tempSum - psfSum) - adjustedVal;
-      psfSum = tempSum;
-    }
-    for (k = 0; k < nPixels_psf; k++)
-      psfPixels[k] = psfPixels[k] / psfSum;
-    if (debugStatus >= 2) {
-      printf("The whole *normalized* PSF image, row by row:\n");
-      PrintRealImage(psfPixels, nColumns_psf, nRows_psf);
-    }
+#ifndef NO_FFTW_FLOAT
+  psfTransform->plan_inputImage_sp = plan_inputImage_sp;
+  psfTransform->plan_inverse_sp = plan_inverse_sp;
+#endif
+  psfTransform->plan_inputImage = plan_inputImage;
+  psfTransform->plan_inverse = plan_inverse;
+  psfTransform->plansCreated = true;
+  fftPlansCreated = true;
+  if (fftwWisdomFile.size() > 0) {
+    ExportFFTWWisdom(fftwWisdomFile);
+#ifndef NO_FFTW_FLOAT
+    if (singlePrecision)
+      ExportFFTWWisdom(fftwWisdomFile, true);
+#endif
   }
 
-  // 2. Prepare padded psf array for FFT, and then copy input PSF into
+
+  // Generate the Fourier transform of the (already normalized) PSF:
+  // 1. Prepare padded psf array for FFT, and then copy input PSF into
   // it with appropriate shift/wrap:
   for (k = 0; k < nPixels_padded; k++)
     psf_in_padded[k] = 0.0;
@@ -318,15 +693,303 @@ int Convolver::DoFullSetup( int debugLevel, bool doFFTWMeasure )
     PrintRealImage(psf_in_padded, nColumns_padded, nRows_padded);
   }
   
-  // 3. Do forward FFT on PSF image
+  // 2. Do forward FFT on PSF image
   if (debugStatus >= 1)
     printf("Performing FFT of PSF image ...\n");
   fftw_execute(plan_psf);
   
+#ifndef NO_FFTW_FLOAT
+  // 3. [Single-precision mode only] Convert PSF transform to single precision, then
+  // discard the double-precision transform
+  if (singlePrecision) {
+    for (k = 0; k < nPixels_padded_complex; k++) {
+      psf_fft_cmplx_sp[k][0] = (float)psf_fft_cmplx[k][0];
+      psf_fft_cmplx_sp[k][1] = (float)psf_fft_cmplx[k][1];
+    }
+    fftw_free(psf_fft_cmplx);
+    psf_fft_cmplx = NULL;
+  }
+#endif
+  // 4. We no longer need the padded PSF image or its plan
+  fftw_destroy_plan(plan_psf);
+  fftw_free(psf_in_padded);
+
   return 0;
 }
 
 
+/* ---------------- SetupSeparableConvolution -------------------------- */
+/// Looks for a separable approximation of the PSF (with relative error <=
+/// separableTolerance) whose rank is low enough that convolving with it costs
+/// less than exactCost; if there is one, allocates the buffers for separable
+/// convolution and returns 1. The achieved error is reported either way.
+/// Returns 0 if the exact PSF should be used, -2 if memory allocation fails.
+int Convolver::SetupSeparableConvolution( double exactCost )
+{
+  int  maxRank = 0;
+  int  maxPossibleRank = (nColumns_psf < nRows_psf) ? nColumns_psf : nRows_psf;
+  
+  // highest rank which is still faster than the exact PSF
+  while ((maxRank < maxPossibleRank) && (EstimateSeparableConvolutionCost(nPixels_image, 
+  			maxRank + 1, nColumns_psf, nRows_psf) < exactCost))
+    maxRank++;
+  if (maxRank == 0) {
+    if (debugStatus >= 1)
+      printf("Separable PSF approximation would be slower than exact convolution\n");
+    return 0;
+  }
+
+  separableRowKernels = arena->AllocateArray<double>((long)maxRank*nColumns_psf);
+  separableColumnKernels = arena->AllocateArray<double>((long)maxRank*nRows_psf);
+  if ((separableRowKernels == NULL) || (separableColumnKernels == NULL)) {
+    fprintf(stderr, "*** WARNING: Convolver::DoFullSetup: memory allocation failure!\n");
+    directBuffersAllocated = true;
+    return -2;
+  }
+  separableRank = SeparableKernelApproximation(psfPixels, nColumns_psf, nRows_psf, 
+  						separableTolerance, maxRank, separableRowKernels, separableColumnKernels,
+  						&separableError);
+  if (separableRank == 0) {
+    if (debugStatus >= 1) {
+      printf("   Separable PSF approximation: relative error with %d term(s) = %.2e > %g;\n",
+      		maxRank, separableError, separableTolerance);
+      printf("   using exact PSF.\n");
+    }
+    arena->Free(separableRowKernels);
+    arena->Free(separableColumnKernels);
+    separableRowKernels = separableColumnKernels = NULL;
+    return 0;
+  }
+  if (debugStatus >= 1)
+    printf("   Separable PSF approximation: %d term(s), relative error = %.2e\n",
+    		separableRank, separableError);
+
+  directOutput = arena->AllocateArray<double>(nPixels_image);
+  separableWorkspace = arena->AllocateArray<double>(nPixels_image);
+  directBuffersAllocated = true;
+  if ((directOutput == NULL) || (separableWorkspace == NULL)) {
+    fprintf(stderr, "*** WARNING: Convolver::DoFullSetup: memory allocation failure!\n");
+    return -2;
+  }
+  convolutionMethod = CONVOLUTION_SEPARABLE;
+  return 1;
+}
+
+
+/* ---------------- SetupTiles ----------------------------------------- */
+/// Sets the padded (FFT) size to the tile-block size, and determines the step
+/// between tiles, the margins of input pixels around each tile, and the number of
+/// tiles convolved at the same time. For overlap-save convolution, output pixel i
+/// of a tile uses block pixels i, ..., i + nPSF - 1 (offset by the margin nPSF - 1 -
+/// center to the left of the tile), so a block of length L gives L - nPSF + 1
+/// correct output pixels; see GetTileFFTSize for the choice of L.
+void Convolver::SetupTiles( )
+{
+  nColumns_padded = GetTileFFTSize(requestedTileSize, nColumns_psf, nColumns_output);
+  nRows_padded = GetTileFFTSize(requestedTileSize, nRows_psf, nRows_output);
+  nPixels_padded = (long)nColumns_padded * (long)nRows_padded;
+  rescaleFactor = 1.0 / nPixels_padded;
+  tileStepX = nColumns_padded - nColumns_psf + 1;
+  tileStepY = nRows_padded - nRows_psf + 1;
+  tileMarginX = nColumns_psf - 1 - nColumns_psf/2;
+  tileMarginY = nRows_psf - 1 - nRows_psf/2;
+
+  // one thread (and one set of tile arrays) per tile in a row of tiles, up to the
+  // number of OpenMP threads
+  int  nTilesX = (nColumns_output + tileStepX - 1) / tileStepX;
+  nTileWorkers = 1;
+#ifdef USE_OPENMP
+  nTileWorkers = omp_get_max_threads();
+#endif
+  if ((maxRequestedThreads > 0) && (nTileWorkers > maxRequestedThreads))
+    nTileWorkers = maxRequestedThreads;
+  if (nTileWorkers > nTilesX)
+    nTileWorkers = nTilesX;
+  if (nTileWorkers < 1)
+    nTileWorkers = 1;
+  if (debugStatus >= 1)
+    printf("Convolving in tiles of %d x %d pixels (FFT size %d x %d), %d at a time\n",
+    		tileStepX, tileStepY, nColumns_padded, nRows_padded, nTileWorkers);
+}
+
+
+/* ---------------- AllocateTileBuffers -------------------------------- */
+/// Allocates the band-output and halo-row buffers for tiled convolution (does
+/// nothing for other methods). Returns -2 if memory allocation fails.
+int Convolver::AllocateTileBuffers( AlignedArena *bufferArena )
+{
+  tileBandOutput = tileHaloRows = NULL;
+  if (convolutionMethod != CONVOLUTION_TILED)
+    return 0;
+  int  nBandRows = (tileStepY < nRows_output) ? tileStepY : nRows_output;
+  tileBandOutput = bufferArena->AllocateArray<double>((long)nBandRows*nColumns_output);
+  tileHaloRows = bufferArena->AllocateArray<double>((long)tileMarginY*nColumns_image);
+  if ((tileBandOutput == NULL) || (tileHaloRows == NULL))
+    return -2;
+  return 0;
+}
+
+
+/* ---------------- NormalizePSF --------------------------------------- */
+/// Normalizes the input PSF image in place (if normalizePSF is true).
+void Convolver::NormalizePSF( )
+{
+  long  k;
+  double  psfSum;
+
+  if (! normalizePSF)
+    return;
+  if (debugStatus >= 1) {
+    printf("Normalizing the PSF ...\n");
+    if (debugStatus >= 2) {
+      printf("The whole input PSF image, row by row:\n");
+      PrintRealImage(psfPixels, nColumns_psf, nRows_psf);
+    }
+  }
+  // Use Kahan summation to avoid underflow
+  psfSum = 0.0;
+  double  storedError = 0.0, adjustedVal = 0.0, tempSum = 0.0;
+  for (k = 0; k < nPixels_psf; k++) {
+    adjustedVal = psfPixels[k] - storedError;
+    tempSum = psfSum + adjustedVal;
+    storedError = (tempSum - psfSum) - adjustedVal;
+    psfSum = tempSum;
+  }
+  for (k = 0; k < nPixels_psf; k++)
+    psfPixels[k] = psfPixels[k] / psfSum;
+  if (debugStatus >= 2) {
+    printf("The whole *normalized* PSF image, row by row:\n");
+    PrintRealImage(psfPixels, nColumns_psf, nRows_psf);
+  }
+}
+
+
+/* ---------------- Clone ---------------------------------------------- */
+/// Returns a new Convolver for the same PSF and image size, which can be used
+/// at the same time as this one (e.g., in a different thread). The PSF transform
+/// and the FFTW plans are shared with this Convolver, which must outlive the copy;
+/// the copy has its own work arrays, allocated from cloneArena. (FFTW's "new-array"
+/// execute functions are thread-safe, and all arena buffers have the same alignment,
+/// so the plans can be used with the copy's arrays.)
+/// Returns NULL if DoFullSetup() hasn't been called or memory allocation failed.
+Convolver * Convolver::Clone( AlignedArena *cloneArena )
+{
+  Convolver  *theCopy;
+  
+  if ((! fftPlansCreated) && (! directBuffersAllocated)) {
+    fprintf(stderr, "*** ERROR: Convolver::Clone called before DoFullSetup!\n");
+    return NULL;
+  }
+  
+  theCopy = new Convolver();
+  theCopy->SetArena(cloneArena);
+  theCopy->nPixels_image = nPixels_image;
+  theCopy->nPixels_psf = nPixels_psf;
+  theCopy->nPixels_padded = nPixels_padded;
+  theCopy->nPixels_padded_complex = nPixels_padded_complex;
+  theCopy->nRows_psf = nRows_psf;
+  theCopy->nColumns_psf = nColumns_psf;
+  theCopy->nRows_image = nRows_image;
+  theCopy->nColumns_image = nColumns_image;
+  theCopy->nRows_padded = nRows_padded;
+  theCopy->nColumns_padded = nColumns_padded;
+  theCopy->outputX0 = outputX0;
+  theCopy->outputY0 = outputY0;
+  theCopy->nColumns_output = nColumns_output;
+  theCopy->nRows_output = nRows_output;
+  theCopy->outputRegionSet = outputRegionSet;
+  theCopy->maxRequestedThreads = maxRequestedThreads;
+  theCopy->rescaleFactor = rescaleFactor;
+  theCopy->psfPixels = psfPixels;
+  theCopy->normalizePSF = normalizePSF;
+  theCopy->singlePrecision = singlePrecision;
+  theCopy->debugStatus = debugStatus;
+  theCopy->psfInfoSet = psfInfoSet;
+  theCopy->imageInfoSet = imageInfoSet;
+  theCopy->requestedConvolutionMethod = requestedConvolutionMethod;
+  theCopy->convolutionMethod = convolutionMethod;
+  theCopy->fftwWisdomFile = fftwWisdomFile;
+  theCopy->fftwPlanFlags = fftwPlanFlags;
+  theCopy->requestedTileSize = requestedTileSize;
+  theCopy->nTileWorkers = nTileWorkers;
+  theCopy->tileStepX = tileStepX;
+  theCopy->tileStepY = tileStepY;
+  theCopy->tileMarginX = tileMarginX;
+  theCopy->tileMarginY = tileMarginY;
+  theCopy->workStride_real = workStride_real;
+  theCopy->workStride_complex = workStride_complex;
+
+  if (convolutionMethod == CONVOLUTION_DIRECT) {
+    // shared (normalized) PSF, separate output array (if the copy is set up
+    // again, its arena will ignore the shared PSF buffer, which it didn't allocate)
+    theCopy->directKernel = directKernel;
+    theCopy->directOutput = cloneArena->AllocateArray<double>(nPixels_image);
+    if (theCopy->directOutput == NULL) {
+      fprintf(stderr, "*** WARNING: Convolver::Clone: memory allocation failure!\n");
+      delete theCopy;
+      return NULL;
+    }
+    theCopy->directBuffersAllocated = true;
+    return theCopy;
+  }
+  if (convolutionMethod == CONVOLUTION_SEPARABLE) {
+    // shared kernels, separate work and output arrays
+    theCopy->separableTolerance = separableTolerance;
+    theCopy->separableError = separableError;
+    theCopy->separableRank = separableRank;
+    theCopy->separableRowKernels = separableRowKernels;
+    theCopy->separableColumnKernels = separableColumnKernels;
+    theCopy->directOutput = cloneArena->AllocateArray<double>(nPixels_image);
+    theCopy->separableWorkspace = cloneArena->AllocateArray<double>(nPixels_image);
+    if ((theCopy->directOutput == NULL) || (theCopy->separableWorkspace == NULL)) {
+      fprintf(stderr, "*** WARNING: Convolver::Clone: memory allocation failure!\n");
+      delete theCopy;
+      return NULL;
+    }
+    theCopy->directBuffersAllocated = true;
+    return theCopy;
+  }
+
+  // shared PSF transform and plans (the copy's fftPlansCreated flag stays false,
+  // so it won't destroy the plans); separate work arrays
+  if (singlePrecision) {
+#ifndef NO_FFTW_FLOAT
+    theCopy->psf_fft_cmplx_sp = psf_fft_cmplx_sp;
+    theCopy->plan_inputImage_sp = plan_inputImage_sp;
+    theCopy->plan_inverse_sp = plan_inverse_sp;
+    theCopy->image_in_padded_sp = cloneArena->AllocateArray<float>(nPixels_padded);
+    theCopy->image_fft_cmplx_sp = cloneArena->AllocateArray<fftwf_complex>(nPixels_padded_complex);
+    theCopy->multiplied_cmplx_sp = cloneArena->AllocateArray<fftwf_complex>(nPixels_padded_complex);
+    theCopy->convolvedImage_out_sp = cloneArena->AllocateArray<float>(nPixels_padded);
+    if ( (theCopy->image_in_padded_sp == NULL) || (theCopy->image_fft_cmplx_sp == NULL)
+    		|| (theCopy->multiplied_cmplx_sp == NULL) || (theCopy->convolvedImage_out_sp == NULL) ) {
+      fprintf(stderr, "*** WARNING: Convolver::Clone: memory allocation failure!\n");
+      delete theCopy;
+      return NULL;
+    }
+#endif
+  } else {
+    theCopy->psf_fft_cmplx = psf_fft_cmplx;
+    theCopy->plan_inputImage = plan_inputImage;
+    theCopy->plan_inverse = plan_inverse;
+    theCopy->image_in_padded = cloneArena->AllocateArray<double>(nTileWorkers*workStride_real);
+    theCopy->image_fft_cmplx = cloneArena->AllocateArray<fftw_complex>(nTileWorkers*workStride_complex);
+    theCopy->multiplied_cmplx = cloneArena->AllocateArray<fftw_complex>(nTileWorkers*workStride_complex);
+    theCopy->convolvedImage_out = cloneArena->AllocateArray<double>(nTileWorkers*workStride_real);
+    if ( (theCopy->image_in_padded == NULL) || (theCopy->image_fft_cmplx == NULL)
+    		|| (theCopy->multiplied_cmplx == NULL) || (theCopy->convolvedImage_out == NULL)
+    		|| (theCopy->AllocateTileBuffers(cloneArena) < 0) ) {
+      fprintf(stderr, "*** WARNING: Convolver::Clone: memory allocation failure!\n");
+      delete theCopy;
+      return NULL;
+    }
+  }
+  theCopy->fftVectorsAllocated = true;
+  
+  return theCopy;
+}
+
+
 /* ---------------- ConvolveImage -------------------------------------- */
 /// Given an input image (pointer to its pixel vector), convolve it with the PSF
 /// by: 1) Copying image to image_in_padded array (with zero-padding); 
@@ -339,6 +1002,19 @@ void Convolver::ConvolveImage( double *pixelVector )
   long  z;
   double  a, b, c, d, rawValue;
   
+  if ((convolutionMethod == CONVOLUTION_DIRECT) || (convolutionMethod == CONVOLUTION_SEPARABLE)) {
+    ConvolveImage_Direct(pixelVector);
+    return;
+  }
+  if (convolutionMethod == CONVOLUTION_TILED) {
+    ConvolveImage_Tiled(pixelVector);
+    return;
+  }
+  if (singlePrecision) {
+    ConvolveImage_SinglePrecision(pixelVector);
+    return;
+  }
+
   // Populate padded input image array for FFT
   //   First, zero the array to ensure zero-padding *is* zero
   for (z = 0; z < nPixels_padded; z++)
@@ -358,7 +1034,9 @@ void Convolver::ConvolveImage( double *pixelVector )
   // Do FFT of input image:
   if (debugStatus >= 2)
     printf("Performing FFT of input image ...\n");
-  fftw_execute(plan_inputImage);
+  // (the "new-array" execute functions are used so that copies made by Clone()
+  // can share the plans)
+  fftw_execute_dft_r2c(plan_inputImage, image_in_padded, image_fft_cmplx);
   if (debugStatus >= 3) {
     printf("The (modulus of the) transform of the input image [image_fft_cmplx], row by row:\n");
     PrintComplexImage_Absolute(image_fft_cmplx, nColumns_padded, nRows_padded);
@@ -388,7 +1066,7 @@ void Convolver::ConvolveImage( double *pixelVector )
   // Do the inverse FFT on the product array:
   if (debugStatus >= 2)
     printf("Performing inverse FFT of multiplied image ...\n");
-  fftw_execute(plan_inverse);
+  fftw_execute_dft_c2r(plan_inverse, multiplied_cmplx, convolvedImage_out);
 
   if (debugStatus >= 3) {
     printf("The whole (padded) convolved image [convolvedImage_out, rescaled], row by row:\n");
@@ -400,9 +1078,10 @@ void Convolver::ConvolveImage( double *pixelVector )
     printf("\n");
   }
 
-  // Extract & rescale the convolved image and copy into input pixel vector:
-  for (ii = 0; ii < nRows_image; ii++) {   // step by row number = y
-    for (jj = 0; jj < nColumns_image; jj++) {  // step by column number = x
+  // Extract & rescale the convolved image (or the requested region of it) and copy
+  // into input pixel vector:
+  for (ii = outputY0; ii < outputY0 + nRows_output; ii++) {   // step by row number = y
+    for (jj = outputX0; jj < outputX0 + nColumns_output; jj++) {  // step by column number = x
       rawValue = convolvedImage_out[(long)ii*nColumns_padded + jj];
       pixelVector[(long)ii*nColumns_image + jj] = rescaleFactor * rawValue;
     }
@@ -410,6 +1089,338 @@ void Convolver::ConvolveImage( double *pixelVector )
 }
 
 
+/// Single-precision version of ConvolveImage; requires that UseSinglePrecision()
+/// was called before DoFullSetup().
+void Convolver::ConvolveImage( float *pixelVector )
+{
+  if (! singlePrecision) {
+    fprintf(stderr, "*** ERROR: Convolver::ConvolveImage called with float image, but Convolver\n");
+    fprintf(stderr, "    was not set up for single-precision convolution!\n");
+    return;
+  }
+  if ((convolutionMethod == CONVOLUTION_DIRECT) || (convolutionMethod == CONVOLUTION_SEPARABLE))
+    ConvolveImage_Direct(pixelVector);
+  else
+    ConvolveImage_SinglePrecision(pixelVector);
+}
+
+
+/* ---------------- SetupBatchConvolution ------------------------------ */
+/// Allocates buffers for maxImages padded images and their transforms, and creates
+/// "many" FFTW plans which transform all of them at once, for use by ConvolveImages.
+/// Batching is only used for (double-precision) FFT convolution; otherwise, this
+/// does nothing and ConvolveImages convolves the images one at a time. Like
+/// DoFullSetup, this is not thread-safe (FFTW planning).
+/// Returns 0 on success, -1 if called before DoFullSetup, -2 if memory allocation
+/// fails.
+int Convolver::SetupBatchConvolution( int maxImages )
+{
+  int  n[2] = {nRows_padded, nColumns_padded};
+  
+  if ((! fftVectorsAllocated) && (! directBuffersAllocated)) {
+    fprintf(stderr, "*** ERROR: Convolver::SetupBatchConvolution called before DoFullSetup!\n");
+    return -1;
+  }
+  FreeBatchConvolution();
+  if ((convolutionMethod != CONVOLUTION_FFT) || (singlePrecision) || (maxImages < 2))
+    return 0;
+  
+  batch_in_padded = arena->AllocateArray<double>(maxImages*nPixels_padded);
+  batch_fft_cmplx = arena->AllocateArray<fftw_complex>(maxImages*nPixels_padded_complex);
+  batch_out = arena->AllocateArray<double>(maxImages*nPixels_padded);
+  if ((batch_in_padded == NULL) || (batch_fft_cmplx == NULL) || (batch_out == NULL)) {
+    fprintf(stderr, "*** WARNING: Convolver::SetupBatchConvolution: memory allocation failure!\n");
+    FreeBatchConvolution();
+    return -2;
+  }
+  batchSize = maxImages;
+  
+  // (FFTW_MEASURE overwrites the arrays, but they don't hold anything yet)
+  plan_batchForward = fftw_plan_many_dft_r2c(2, n, batchSize, batch_in_padded, NULL, 1,
+  								nPixels_padded, batch_fft_cmplx, NULL, 1, nPixels_padded_complex,
+  								fftwPlanFlags);
+  plan_batchInverse = fftw_plan_many_dft_c2r(2, n, batchSize, batch_fft_cmplx, NULL, 1,
+  								nPixels_padded_complex, batch_out, NULL, 1, nPixels_padded,
+  								fftwPlanFlags);
+  batchPlansCreated = true;
+  if (debugStatus >= 1)
+    printf("Batched convolution set up for %d images\n", batchSize);
+  return 0;
+}
+
+
+/* ---------------- FreeBatchConvolution ------------------------------- */
+
+void Convolver::FreeBatchConvolution( )
+{
+  if (batchPlansCreated) {
+    fftw_destroy_plan(plan_batchForward);
+    fftw_destroy_plan(plan_batchInverse);
+    batchPlansCreated = false;
+  }
+  arena->Free(batch_in_padded);
+  arena->Free(batch_fft_cmplx);
+  arena->Free(batch_out);
+  batch_in_padded = batch_out = NULL;
+  batch_fft_cmplx = NULL;
+  batchSize = 0;
+}
+
+
+/* ---------------- ConvolveImages ------------------------------------- */
+/// Convolves each of the nImages images (e.g., model images for different
+/// parameter values) with the PSF. If SetupBatchConvolution has been called,
+/// the images are processed in batches of (up to) batchSize, with each batch
+/// transformed by one multi-image FFTW plan and multiplied by the PSF transform
+/// in a single pass; leftover images are convolved one at a time. The results
+/// are the same as for calling ConvolveImage on each image.
+void Convolver::ConvolveImages( double **images, int nImages )
+{
+  int  nDone = 0;
+  
+  if (batchPlansCreated) {
+    for (nDone = 0; nDone + batchSize <= nImages; nDone += batchSize)
+      ConvolveBatch(images + nDone);
+  }
+  for (int n = nDone; n < nImages; n++)
+    ConvolveImage(images[n]);
+}
+
+
+/// Convolves batchSize images using the batch plans and buffers.
+void Convolver::ConvolveBatch( double **images )
+{
+  // copy images into (zero-padded) batch input array
+#pragma omp parallel for schedule (static)
+  for (int n = 0; n < batchSize; n++) {
+    double  *paddedImage = batch_in_padded + n*nPixels_padded;
+    for (long z = 0; z < nPixels_padded; z++)
+      paddedImage[z] = 0.0;
+    for (int ii = 0; ii < nRows_image; ii++)
+      for (int jj = 0; jj < nColumns_image; jj++)
+        paddedImage[(long)ii*nColumns_padded + jj] = images[n][(long)ii*nColumns_image + jj];
+  }
+
+  fftw_execute(plan_batchForward);
+
+  // multiply all transforms by the PSF transform (in place), one cache-sized block
+  // of the PSF transform at a time
+  long  nBlocks = (nPixels_padded_complex + BATCH_BLOCK_SIZE - 1) / BATCH_BLOCK_SIZE;
+#pragma omp parallel for schedule (static)
+  for (long m = 0; m < nBlocks; m++) {
+    long  zStart = m*BATCH_BLOCK_SIZE;
+    long  zEnd = (zStart + BATCH_BLOCK_SIZE < nPixels_padded_complex) ? zStart + BATCH_BLOCK_SIZE 
+    				: nPixels_padded_complex;
+    for (int n = 0; n < batchSize; n++) {
+      fftw_complex  *imageTransform = batch_fft_cmplx + n*nPixels_padded_complex;
+      for (long z = zStart; z < zEnd; z++) {
+        double  a = imageTransform[z][0];   // real part
+        double  b = imageTransform[z][1];   // imaginary part
+        double  c = psf_fft_cmplx[z][0];
+        double  d = psf_fft_cmplx[z][1];
+        imageTransform[z][0] = a*c - b*d;
+        imageTransform[z][1] = b*c + a*d;
+      }
+    }
+  }
+
+  fftw_execute(plan_batchInverse);
+
+  // extract & rescale the convolved images
+#pragma omp parallel for schedule (static)
+  for (int n = 0; n < batchSize; n++) {
+    double  *convolvedImage = batch_out + n*nPixels_padded;
+    for (int ii = outputY0; ii < outputY0 + nRows_output; ii++)
+      for (int jj = outputX0; jj < outputX0 + nColumns_output; jj++)
+        images[n][(long)ii*nColumns_image + jj] = rescaleFactor 
+        							* convolvedImage[(long)ii*nColumns_padded + jj];
+  }
+}
+
+
+/// Does the convolution directly in the spatial domain (see spatial_convolution.cpp),
+/// using the normalized copy of the PSF or its separable approximation; pixelVector
+/// can be either double or float.
+template <typename T>
+void Convolver::ConvolveImage_Direct( T *pixelVector )
+{
+  if (convolutionMethod == CONVOLUTION_SEPARABLE)
+    ConvolveSeparable2D(pixelVector, nColumns_image, nRows_image, separableRank,
+    					separableRowKernels, nColumns_psf, separableColumnKernels, nRows_psf,
+    					separableWorkspace, directOutput);
+  else
+    ConvolveDirect2D(pixelVector, nColumns_image, nRows_image, directKernel, nColumns_psf,
+  					nRows_psf, directOutput);
+  for (long z = 0; z < nPixels_image; z++)
+    pixelVector[z] = (T)directOutput[z];
+}
+
+
+/// Overlap-save convolution (see SetTileSize): the output region is covered by
+/// bands (rows) of tiles, tileStepX x tileStepY pixels in size. The tiles of each
+/// band are convolved in parallel and their output stored in tileBandOutput, which
+/// is then copied into the image; since the tiles of the next band need the
+/// original (unconvolved) values of the last tileMarginY rows of this band, these
+/// are saved in tileHaloRows first.
+void Convolver::ConvolveImage_Tiled( double *pixelVector )
+{
+  int  nTilesX = (nColumns_output + tileStepX - 1) / tileStepX;
+  int  yEnd = outputY0 + nRows_output;
+  int  haloStart = 0, nHaloRows = 0;
+  
+  for (int bandY0 = outputY0; bandY0 < yEnd; bandY0 += tileStepY) {
+    int  nBandRows = std::min(tileStepY, yEnd - bandY0);
+    
+#pragma omp parallel for schedule (dynamic, 1) num_threads (nTileWorkers) if (nTileWorkers > 1)
+    for (int m = 0; m < nTilesX; m++) {
+      int  worker = 0;
+#ifdef USE_OPENMP
+      worker = omp_get_thread_num();
+#endif
+      int  x0 = outputX0 + m*tileStepX;
+      ConvolveTile(pixelVector, worker, x0, bandY0, std::min(tileStepX, outputX0 
+      				+ nColumns_output - x0), nBandRows, haloStart, nHaloRows);
+    }
+    
+    int  nextBandY0 = bandY0 + nBandRows;
+    if (nextBandY0 < yEnd) {
+      // (tileStepY >= nRows_psf > tileMarginY, so these rows are all in this band)
+      haloStart = nextBandY0 - tileMarginY;
+      nHaloRows = tileMarginY;
+      for (long z = 0; z < (long)nHaloRows*nColumns_image; z++)
+        tileHaloRows[z] = pixelVector[(long)haloStart*nColumns_image + z];
+    }
+    for (int ii = 0; ii < nBandRows; ii++) {
+      double  *outputRow = pixelVector + (long)(bandY0 + ii)*nColumns_image + outputX0;
+      double  *bandRow = tileBandOutput + (long)ii*nColumns_output;
+      for (int jj = 0; jj < nColumns_output; jj++)
+        outputRow[jj] = bandRow[jj];
+    }
+  }
+}
+
+
+/// Convolves the nColumns x nRows tile starting at (x0,y0), using worker's set of
+/// tile arrays, and stores the result in tileBandOutput. Input rows haloStart, ...,
+/// haloStart + nHaloRows - 1 are taken from tileHaloRows; pixels outside the image
+/// are zero.
+void Convolver::ConvolveTile( const double *pixelVector, int worker, int x0, int y0,
+								int nColumns, int nRows, int haloStart, int nHaloRows )
+{
+  double  *blockIn = image_in_padded + worker*workStride_real;
+  fftw_complex  *blockTransform = image_fft_cmplx + worker*workStride_complex;
+  fftw_complex  *product = multiplied_cmplx + worker*workStride_complex;
+  double  *blockOut = convolvedImage_out + worker*workStride_real;
+  int  blockX0 = x0 - tileMarginX;
+  int  blockY0 = y0 - tileMarginY;
+  int  jStart = std::max(0, -blockX0);
+  int  jEnd = std::min(nColumns_padded, nColumns_image - blockX0);
+  double  a, b, c, d;
+  
+  // copy the block of input pixels (zero outside the image)
+  for (int i = 0; i < nRows_padded; i++) {
+    int  y = blockY0 + i;
+    double  *blockRow = blockIn + (long)i*nColumns_padded;
+    const double  *inputRow = NULL;
+    if ((y >= haloStart) && (y < haloStart + nHaloRows))
+      inputRow = tileHaloRows + (long)(y - haloStart)*nColumns_image;
+    else if ((y >= 0) && (y < nRows_image))
+      inputRow = pixelVector + (long)y*nColumns_image;
+    for (int j = 0; j < nColumns_padded; j++)
+      blockRow[j] = 0.0;
+    if (inputRow != NULL) {
+      for (int j = jStart; j < jEnd; j++)
+        blockRow[j] = inputRow[blockX0 + j];
+    }
+  }
+
+  fftw_execute_dft_r2c(plan_inputImage, blockIn, blockTransform);
+  for (long z = 0; z < nPixels_padded_complex; z++) {
+    a = blockTransform[z][0];   // real part
+    b = blockTransform[z][1];   // imaginary part
+    c = psf_fft_cmplx[z][0];
+    d = psf_fft_cmplx[z][1];
+    product[z][0] = a*c - b*d;
+    product[z][1] = b*c + a*d;
+  }
+  fftw_execute_dft_c2r(plan_inverse, product, blockOut);
+
+  // the tile's output starts at (tileMarginX, tileMarginY) in the block
+  for (int i = 0; i < nRows; i++) {
+    double  *blockRow = blockOut + (long)(tileMarginY + i)*nColumns_padded + tileMarginX;
+    double  *bandRow = tileBandOutput + (long)i*nColumns_output + (x0 - outputX0);
+    for (int j = 0; j < nColumns; j++)
+      bandRow[j] = rescaleFactor * blockRow[j];
+  }
+}
+
+
+/// Does the convolution using the single-precision arrays and plans; pixelVector
+/// can be either double or float. The steps are the same as in the double-precision
+/// version of ConvolveImage (without the debugging printouts).
+template <typename T>
+void Convolver::ConvolveImage_SinglePrecision( T *pixelVector )
+{
+#ifndef NO_FFTW_FLOAT
+  int  ii, jj;
+  long  z;
+  float  a, b, c, d;
+  float  rescale_sp = (float)rescaleFactor;
+  
+  for (z = 0; z < nPixels_padded; z++)
+    image_in_padded_sp[z] = 0.0f;
+  for (ii = 0; ii < nRows_image; ii++) {   // step by row number = y
+    for (jj = 0; jj < nColumns_image; jj++) {  // step by column number = x
+      image_in_padded_sp[(long)ii*nColumns_padded + jj] = (float)pixelVector[(long)ii*nColumns_image + jj];
+    }
+  }
+
+  fftwf_execute_dft_r2c(plan_inputImage_sp, image_in_padded_sp, image_fft_cmplx_sp);
+  for (z = 0; z < nPixels_padded_complex; z++) {
+    a = image_fft_cmplx_sp[z][0];   // real part
+    b = image_fft_cmplx_sp[z][1];   // imaginary part
+    c = psf_fft_cmplx_sp[z][0];
+    d = psf_fft_cmplx_sp[z][1];
+    multiplied_cmplx_sp[z][0] = a*c - b*d;
+    multiplied_cmplx_sp[z][1] = b*c + a*d;
+  }
+  fftwf_execute_dft_c2r(plan_inverse_sp, multiplied_cmplx_sp, convolvedImage_out_sp);
+
+  for (ii = outputY0; ii < outputY0 + nRows_output; ii++) {   // step by row number = y
+    for (jj = outputX0; jj < outputX0 + nColumns_output; jj++) {  // step by column number = x
+      pixelVector[(long)ii*nColumns_image + jj] = rescale_sp * convolvedImage_out_sp[(long)ii*nColumns_padded + jj];
+    }
+  }
+#endif
+}
+
+
+
+/// Returns the FFT buffers to the arena (only buffers with their own blocks are
+/// actually freed before the arena itself is destroyed).
+void Convolver::FreeBuffers( )
+{
+#ifndef NO_FFTW_FLOAT
+  if (singlePrecision) {
+    arena->Free(image_in_padded_sp);
+    arena->Free(image_fft_cmplx_sp);
+    arena->Free(multiplied_cmplx_sp);
+    arena->Free(convolvedImage_out_sp);
+    fftVectorsAllocated = false;
+    return;
+  }
+#endif
+  arena->Free(image_in_padded);
+  arena->Free(image_fft_cmplx);
+  arena->Free(multiplied_cmplx);
+  arena->Free(convolvedImage_out);
+  arena->Free(tileBandOutput);
+  arena->Free(tileHaloRows);
+  tileBandOutput = tileHaloRows = NULL;
+  fftVectorsAllocated = false;
+}
+
+
 
 /// Takes the input PSF (assumed to be centered in the central pixel
 /// of the image) and copy it into the (padded) image, with the
@@ -438,6 +1449,174 @@ void Convolver::ShiftAndWrapPSF( )
 
 
 
+/* ---------------- FUNCTION: FFTCostPerPoint -------------------------- */
+/// Returns the (relative) cost per point of a 1D FFT of length n, as the sum of
+/// the costs of its radix-2, 3, 5, and 7 passes; returns -1 if n has any larger
+/// prime factors.
+double FFTCostPerPoint( int n )
+{
+  double  cost = 0.0;
+  
+  if (n < 1)
+    return -1.0;
+  for (int i = 0; i < N_FFT_RADICES; i++) {
+    while ((n % FFT_RADICES[i]) == 0) {
+      n = n / FFT_RADICES[i];
+      cost += FFT_RADIX_COSTS[i];
+    }
+  }
+  if (n != 1)
+    return -1.0;
+  return cost;
+}
+
+
+/* ---------------- FUNCTION: SmoothFFTSizes --------------------------- */
+/// Returns all lengths n with minimumSize <= n <= 2*minimumSize which have only
+/// prime factors 2, 3, 5, and 7 (this always includes a power of 2).
+static vector<int> SmoothFFTSizes( int minimumSize )
+{
+  vector<int>  sizes;
+  long  maxSize = 2*(long)minimumSize;
+  
+  for (long p2 = 1; p2 <= maxSize; p2 *= 2)
+    for (long p3 = p2; p3 <= maxSize; p3 *= 3)
+      for (long p5 = p3; p5 <= maxSize; p5 *= 5)
+        for (long p7 = p5; p7 <= maxSize; p7 *= 7)
+          if (p7 >= minimumSize)
+            sizes.push_back((int)p7);
+  return sizes;
+}
+
+
+/* ---------------- FUNCTION: GetFFTFriendlySize ----------------------- */
+/// Returns the length n >= minimumSize (with only prime factors 2, 3, 5, 7) with
+/// the lowest total cost n*(FFTCostPerPoint(n) + FFT_POINT_OVERHEAD); ties go to
+/// the smaller length.
+int GetFFTFriendlySize( int minimumSize )
+{
+  int  bestSize;
+  double  cost, bestCost;
+  
+  if (minimumSize <= 1)
+    return 1;
+  vector<int>  sizes = SmoothFFTSizes(minimumSize);
+  bestSize = 0;
+  bestCost = 0.0;
+  for (int i = 0; i < (int)sizes.size(); i++) {
+    cost = sizes[i] * (FFTCostPerPoint(sizes[i]) + FFT_POINT_OVERHEAD);
+    if ((bestSize == 0) || (cost < bestCost) || ((cost == bestCost) && (sizes[i] < bestSize))) {
+      bestSize = sizes[i];
+      bestCost = cost;
+    }
+  }
+  return bestSize;
+}
+
+
+/* ---------------- FUNCTION: GetFFTFriendlyPaddedSizes --------------- */
+/// Chooses the padded image size for a 2D FFT (each dimension at least as large as
+/// the minimum and with only prime factors 2, 3, 5, 7) with the lowest total cost
+/// nColumns*nRows*(FFTCostPerPoint(nColumns) + FFTCostPerPoint(nRows) + 
+/// FFT_POINT_OVERHEAD). (The two dimensions are chosen together, since the cost of
+/// each dimension's passes scales with the total number of points.)
+void GetFFTFriendlyPaddedSizes( int nColumns_min, int nRows_min, int& nColumns_padded,
+								int& nRows_padded )
+{
+  double  cost, bestCost;
+  
+  if (nColumns_min < 1)
+    nColumns_min = 1;
+  if (nRows_min < 1)
+    nRows_min = 1;
+  vector<int>  columnSizes = SmoothFFTSizes(nColumns_min);
+  vector<int>  rowSizes = SmoothFFTSizes(nRows_min);
+  nColumns_padded = 0;
+  nRows_padded = 0;
+  bestCost = 0.0;
+  for (int i = 0; i < (int)columnSizes.size(); i++) {
+    for (int j = 0; j < (int)rowSizes.size(); j++) {
+      cost = (double)columnSizes[i] * (double)rowSizes[j] * (FFTCostPerPoint(columnSizes[i])
+      			+ FFTCostPerPoint(rowSizes[j]) + FFT_POINT_OVERHEAD);
+      if ((nColumns_padded == 0) || (cost < bestCost) || ((cost == bestCost) && 
+      		((long)columnSizes[i]*rowSizes[j] < (long)nColumns_padded*nRows_padded))) {
+        nColumns_padded = columnSizes[i];
+        nRows_padded = rowSizes[j];
+        bestCost = cost;
+      }
+    }
+  }
+}
+
+
+
+/* ---------------- FUNCTION: EstimateFFTConvolutionCost --------------- */
+/// Returns the estimated cost (in the same units as FFTCostPerPoint) of one FFT
+/// convolution with the given padded size: forward and inverse real-to-complex
+/// transforms (each about half the cost of a complex transform), plus the
+/// per-point overhead. Lengths with prime factors > 7 (e.g., the unpadded lengths
+/// used by Convolver1D) are assumed to cost about three transforms of length
+/// >= 2n, which is what FFTW's algorithms for large prime factors need.
+double EstimateFFTConvolutionCost( int nColumns_padded, int nRows_padded )
+{
+  int  sizes[2] = {nColumns_padded, nRows_padded};
+  double  costPerPoint = FFT_POINT_OVERHEAD;
+  
+  for (int i = 0; i < 2; i++) {
+    double  passCost = FFTCostPerPoint(sizes[i]);
+    if (passCost < 0) {
+      int  n2 = GetFFTFriendlySize(2*sizes[i] - 1);
+      passCost = 3.0 * FFTCostPerPoint(n2) * n2 / sizes[i];
+    }
+    costPerPoint += passCost;
+  }
+  return costPerPoint * (double)nColumns_padded * (double)nRows_padded;
+}
+
+
+/* ---------------- FUNCTION: MinimumPaddedLength ---------------------- */
+/// Output pixel i of the convolution is the sum of psf[k]*image[i + center - k],
+/// for k = 0, ..., nPSF - 1 (center = nPSF/2). With FFT convolution, image indices
+/// are taken modulo the padded length, so the padded image must extend past the
+/// highest index needed (i + center for the last output pixel), and negative
+/// indices (down to i + center - nPSF + 1 for the first output pixel) must wrap
+/// around into the zero padding beyond the image. For the full image, this is
+/// less than the usual nImage + nPSF - 1; if the output region stays more than
+/// half a PSF width away from the image edges, no extra padding is needed at all.
+int MinimumPaddedLength( int nImage, int nPSF, int outputStart, int nOutput )
+{
+  int  center = nPSF / 2;
+  int  nPadded = nImage;
+  
+  if (outputStart + nOutput + center > nPadded)
+    nPadded = outputStart + nOutput + center;
+  if (nImage - outputStart + nPSF - 1 - center > nPadded)
+    nPadded = nImage - outputStart + nPSF - 1 - center;
+  return nPadded;
+}
+
+
+/* ---------------- FUNCTION: GetTileFFTSize --------------------------- */
+/// Returns the FFT length of tiled-convolution blocks for a PSF of length nPSF:
+/// the requested size (or the default), but at least 2*nPSF - 1, so that each
+/// tile is at least as long as the PSF (and the halo rows needed by the next
+/// band of tiles are all in the current band); a single tile covering all
+/// nOutput pixels is used if that's smaller. Rounded up to an FFT-friendly size.
+int GetTileFFTSize( int requestedSize, int nPSF, int nOutput )
+{
+  int  length = requestedSize;
+  
+  if (length <= 0)
+    length = std::max(DEFAULT_FFT_TILE_SIZE, DEFAULT_TILE_PSF_MULTIPLE*nPSF);
+  if (length < 2*nPSF - 1)
+    length = 2*nPSF - 1;
+  if (length > nOutput + nPSF - 1)
+    length = nOutput + nPSF - 1;
+  return GetFFTFriendlySize(length);
+}
+
+
+
 /// For debugging purposes: prints the a real-valued image to the console.
 void PrintRealImage( double *image, int nColumns, int nRows )
 {
@@ -11,9 +11,39 @@
 
 #include "fftw3.h"
 
+#include "aligned_arena.h"
+#include "spatial_convolution.h"
+#include "psf_transform_cache.h"
+
 using namespace std;
 
 
+/// Returns the relative cost per point of a 1D FFT of length n (-1 if n has
+/// prime factors > 7)
+double FFTCostPerPoint( int n );
+
+/// Returns the cheapest FFT length >= minimumSize (only prime factors 2, 3, 5, 7)
+int GetFFTFriendlySize( int minimumSize );
+
+/// Chooses the cheapest padded 2D FFT size with nColumns_padded >= nColumns_min,
+/// nRows_padded >= nRows_min (only prime factors 2, 3, 5, 7)
+void GetFFTFriendlyPaddedSizes( int nColumns_min, int nRows_min, int& nColumns_padded,
+								int& nRows_padded );
+
+/// Estimated relative cost of one FFT convolution with the given padded size
+double EstimateFFTConvolutionCost( int nColumns_padded, int nRows_padded );
+
+/// Returns the smallest padded length (before rounding up to an FFT-friendly size)
+/// for which FFT convolution of an image of length nImage with a PSF of length
+/// nPSF gives correct values for output pixels outputStart, ..., outputStart +
+/// nOutput - 1
+int MinimumPaddedLength( int nImage, int nPSF, int outputStart, int nOutput );
+
+/// Returns the FFT length used for tiled convolution of nOutput pixels with a PSF
+/// of length nPSF, given the requested tile size (0 = default)
+int GetTileFFTSize( int requestedSize, int nPSF, int nOutput );
+
+
 /// For debugging use: print a real-valued image to stdout
 void PrintRealImage( double *image, int nColumns, int nRows );
 
@@ -37,28 +67,111 @@ class Convolver
     /// Set maximum number of FFTW threads
     void SetMaxThreads( int maximumThreadNumber );
     
-    /// Supply PSF image to Convolver object
+    /// Allocate FFT buffers from an external AlignedArena (e.g., the one owned
+    /// by a ModelObject); must be called before DoFullSetup
+    void SetArena( AlignedArena *externalArena );
+    
+    /// Use single-precision (fftwf) transforms and buffers; must be called
+    /// before DoFullSetup. Returns -1 if single-precision FFTW is not available
+    int UseSinglePrecision( );
+    
+    /// Use (and update) the FFTW wisdom stored in wisdomFileName, and create
+    /// FFTW_MEASURE plans; must be called before DoFullSetup
+    void SetFFTWWisdomFile( const string& wisdomFileName );
+    
+    /// Specify convolution method (CONVOLUTION_AUTO [default], CONVOLUTION_FFT,
+    /// CONVOLUTION_DIRECT, or CONVOLUTION_TILED); must be called before DoFullSetup
+    void SetConvolutionMethod( int method );
+    
+    /// Returns the convolution method (after DoFullSetup, the one actually used)
+    int GetConvolutionMethod( );
+    
+    /// Use overlap-save FFT convolution in tiles of (about) tileSize x tileSize
+    /// pixels (0 = default size); must be called before DoFullSetup
+    void SetTileSize( int tileSize );
+    
+    /// Supply PSF image to Convolver object; if separableTolerance > 0, a
+    /// low-rank separable approximation of the PSF with that relative error
+    /// is used when it's faster than exact convolution
     void SetupPSF( double *psfPixels_input, int nColumns, int nRows,
-    				bool normalize=true );
+    				bool normalize=true, double separableTolerance=0.0 );
+    
+    /// Returns the rank of the separable PSF approximation (0 if not used)
+    int GetSeparableRank( );
+    
+    /// Returns the relative error of the separable PSF approximation
+    double GetSeparableApproximationError( );
     
     void SetupImage( int nColumns, int nRows );
     
+    /// Only compute the convolved image within the specified region (x0,y0 =
+    /// 0-based first column and row); must be called after SetupImage and before
+    /// DoFullSetup. Pixels outside the region are not valid after convolution
+    void SetOutputRegion( int x0, int y0, int nColumns, int nRows );
+    
+    /// Returns the size of the padded FFT arrays (0 x 0 for direct convolution;
+    /// the size of one tile's FFT for tiled convolution)
+    void GetPaddedImageSize( int& nColumns, int& nRows );
+    
     /// Do final setup work (allocate things, generate FT of PSF image, etc.)
     int DoFullSetup( int debugLevel=0, bool doFFTWMeasure=false );
 
+    /// Returns a new Convolver which shares this one's PSF transform and FFTW
+    /// plans (read-only), but has its own work arrays (allocated from cloneArena)
+    Convolver * Clone( AlignedArena *cloneArena );
+
     /// Replace input model image (pixelVector) with convolution using stored PSF
     void ConvolveImage( double *pixelVector );
 
+    /// Same, for single-precision model image (requires UseSinglePrecision)
+    void ConvolveImage( float *pixelVector );
+
+    /// Allocate buffers and FFTW plans for convolving up to maxImages images at
+    /// once with ConvolveImages (call after DoFullSetup)
+    int SetupBatchConvolution( int maxImages );
+
+    /// Replace each of nImages input model images with its convolution
+    void ConvolveImages( double **images, int nImages );
+
+    /// Frees the buffers and FFTW plans allocated by SetupBatchConvolution
+    void FreeBatchConvolution( );
+
 
   private:
   // Private member functions:
   void ShiftAndWrapPSF( );
   
+  void DestroyPlans( );
+  
+  void FreeBuffers( );
+  
+  template <typename T> void ConvolveImage_SinglePrecision( T *pixelVector );
+  
+  template <typename T> void ConvolveImage_Direct( T *pixelVector );
+  
+  void SetupTiles( );
+  
+  int AllocateTileBuffers( AlignedArena *bufferArena );
+  
+  void ConvolveImage_Tiled( double *pixelVector );
+  
+  void ConvolveTile( const double *pixelVector, int worker, int x0, int y0, int nColumns,
+  					int nRows, int haloStart, int nHaloRows );
+  
+  void ConvolveBatch( double **images );
+  
+  void NormalizePSF( );
+  
+  int SetupSeparableConvolution( double exactCost );
+  
   // Data members:
   long  nPixels_image, nPixels_psf, nPixels_padded;
   int  nRows_psf, nColumns_psf;
   int  nRows_image, nColumns_image;
   int  nRows_padded, nColumns_padded;
+  // region of the image which is copied back after FFT convolution
+  int  outputX0, outputY0, nColumns_output, nRows_output;
+  bool  outputRegionSet;
   int  maxRequestedThreads;
   double  rescaleFactor;
   double  *psfPixels;
@@ -68,6 +181,42 @@ class Convolver
   fftw_complex  *psf_fft_cmplx;
   fftw_complex  *multiplied_cmplx;
   fftw_plan  plan_inputImage, plan_psf, plan_inverse;
+  // tiled (overlap-save) convolution: each of nTileWorkers threads has its own
+  // padded arrays (= tiles), workStride_real/complex values apart; the output of
+  // one band (row of tiles) and the unconvolved rows above the next band are
+  // stored in tileBandOutput and tileHaloRows
+  int  requestedTileSize, nTileWorkers;
+  int  tileStepX, tileStepY, tileMarginX, tileMarginY;
+  long  workStride_real, workStride_complex;
+  double  *tileBandOutput, *tileHaloRows;
+#ifndef NO_FFTW_FLOAT
+  // single-precision versions (PSF transform is computed in double precision)
+  float  *image_in_padded_sp, *convolvedImage_out_sp;
+  fftwf_complex  *image_fft_cmplx_sp;
+  fftwf_complex  *psf_fft_cmplx_sp;
+  fftwf_complex  *multiplied_cmplx_sp;
+  fftwf_plan  plan_inputImage_sp, plan_inverse_sp;
+#endif
+  PsfTransform  *psfTransform;   // shared PSF transform and plans (NULL for copies)
+  AlignedArena  ownArena;   // used unless SetArena() is called
+  AlignedArena  *arena;
+  bool  singlePrecision;
+  string  fftwWisdomFile;   // empty = no wisdom file
+  unsigned  fftwPlanFlags;
+  // batched convolution: batchSize padded images and transforms, stored contiguously
+  int  batchSize;
+  bool  batchPlansCreated;
+  double  *batch_in_padded, *batch_out;
+  fftw_complex  *batch_fft_cmplx;
+  fftw_plan  plan_batchForward, plan_batchInverse;
+  // direct (spatial) convolution: normalized copy of PSF and output buffer
+  int  requestedConvolutionMethod, convolutionMethod;
+  bool  directBuffersAllocated;
+  double  *directKernel, *directOutput;
+  // separable convolution: row and column kernels, and row-pass output
+  double  separableTolerance, separableError;
+  int  separableRank;
+  double  *separableRowKernels, *separableColumnKernels, *separableWorkspace;
   bool  psfInfoSet, imageInfoSet, fftVectorsAllocated, fftPlansCreated;
   bool  normalizePSF;
   int  debugStatus;
@@ -2,6 +2,13 @@
 
 // Code for downsampling an oversampled image and copying the downsampled version
 // into a larger, standard-sampled image.
+//
+// Each output row is computed in two passes: first the oversampleScale input rows
+// of its blocks are added together (with their row weights) into a single row,
+// which is a loop over contiguous pixels and so is vectorized by the compiler
+// ("omp simd" as a hint); then each group of oversampleScale pixels in that row
+// is added up (with the column weights). Output rows are divided among OpenMP
+// threads when the image is large enough for this to pay off.
 
 // Copyright 2014-2018 by Peter Erwin.
 // 
@@ -22,14 +29,155 @@
 
 
 #include <stdio.h>
-#include <string>
-
-//using namespace std;
+#include <vector>
 
 #include "downsample.h"
 
-/* ------------------- Function Prototypes ----------------------------- */
-/* Local Functions: */
+using namespace std;
+
+
+// minimum number of input pixels for dividing output rows among threads
+const long  MIN_PARALLEL_PIXELS = 100000;
+
+
+
+/* ---------------- FUNCTION: MakeDownsampleWeights() ------------------ */
+/// Stores the 1D weights for downsampling with the specified kernel in weights
+/// (which must have room for oversampleScale values); the weights don't need
+/// to be normalized. DOWNSAMPLE_TRIANGLE weights are proportional to the
+/// distance of each subpixel center from the nearer block edge, e.g. 1,3,1
+/// for oversampleScale = 3 and 1,3,3,1 for oversampleScale = 4.
+/// Returns 0, or -1 if kernelType isn't recognized.
+int MakeDownsampleWeights( int kernelType, int oversampleScale, double *weights )
+{
+  for (int k = 0; k < oversampleScale; k++) {
+    switch (kernelType) {
+      case DOWNSAMPLE_BOX:
+        weights[k] = 1.0;
+        break;
+      case DOWNSAMPLE_TRIANGLE: {
+        // distance (in subpixels) from subpixel center to the nearer block edge
+        double  edgeDistance = (k < oversampleScale - k) ? k + 0.5 : oversampleScale - k - 0.5;
+        weights[k] = 2.0*edgeDistance;
+        break;
+      }
+      default:
+        fprintf(stderr, "** ERROR: unknown downsampling kernel type (%d)!\n", kernelType);
+        return -1;
+    }
+  }
+  return 0;
+}
+
+
+
+/* ---------------- FUNCTION: SumRowBlocks() --------------------------- */
+/// Stores the weighted sum of each group of scale values in rowSum (divided by
+/// normalization) in outputRow, for nBlocks groups.
+static void SumRowBlocks( const double *rowSum, int nBlocks, int scale, const double *weights,
+						double normalization, double *outputRow )
+{
+#pragma omp simd
+  for (int j = 0; j < nBlocks; j++) {
+    const double  *blockSum = rowSum + j*scale;
+    double  sum = 0.0;
+    for (int l = 0; l < scale; l++)
+      sum += weights[l]*blockSum[l];
+    outputRow[j] = sum/normalization;
+  }
+}
+
+/// Same, for fixed (small) scale, so that the inner loop can be unrolled and the
+/// outer loop vectorized
+template <int SCALE>
+static void SumRowBlocks_fixed( const double *rowSum, int nBlocks, const double *weights,
+						double normalization, double *outputRow )
+{
+  double  w[SCALE];
+  for (int l = 0; l < SCALE; l++)
+    w[l] = weights[l];
+#pragma omp simd
+  for (int j = 0; j < nBlocks; j++) {
+    double  sum = 0.0;
+    for (int l = 0; l < SCALE; l++)
+      sum += w[l]*rowSum[j*SCALE + l];
+    outputRow[j] = sum/normalization;
+  }
+}
+
+
+
+/* ---------------- FUNCTION: DownsampleImage() ------------------------ */
+/// Downsamples part of inputImage (nColumns_in pixels per row) and stores the
+/// result in part of outputImage (nColumns_out pixels per row): each of the
+/// nBlockColumns x nBlockRows blocks of oversampleScale x oversampleScale input
+/// pixels, starting at column x0_in and row y0_in, becomes one output pixel,
+/// starting at column x0_out and row y0_out (all 0-based). Output pixels are
+/// weighted averages of their input pixels, using the separable weights (see
+/// downsample.h); weights = NULL means equal weights (box filter).
+void DownsampleImage( const double *inputImage, int nColumns_in, int x0_in, int y0_in,
+						double *outputImage, int nColumns_out, int x0_out, int y0_out,
+						int nBlockColumns, int nBlockRows, int oversampleScale,
+						const double *weights )
+{
+  int  scale = oversampleScale;
+  int  nRowPixels = nBlockColumns*scale;
+  long  nInputPixels = (long)nRowPixels * nBlockRows * scale;
+  vector<double>  boxWeights;
+  double  weightSum, normalization;
+  
+  if ((nBlockColumns <= 0) || (nBlockRows <= 0))
+    return;
+  if (weights == NULL) {
+    boxWeights.assign(scale, 1.0);
+    weights = &boxWeights[0];
+  }
+  weightSum = 0.0;
+  for (int k = 0; k < scale; k++)
+    weightSum += weights[k];
+  normalization = weightSum*weightSum;
+
+#pragma omp parallel if (nInputPixels >= MIN_PARALLEL_PIXELS)
+  {
+  vector<double>  rowSums(nRowPixels);
+  double  *rowSum = &rowSums[0];
+
+#pragma omp for schedule (static)
+  for (int i = 0; i < nBlockRows; i++) {
+    // 1. weighted sum of the block's input rows
+    const double  *inputRow = inputImage + (long)(y0_in + i*scale)*nColumns_in + x0_in;
+    double  rowWeight = weights[0];
+#pragma omp simd
+    for (int j = 0; j < nRowPixels; j++)
+      rowSum[j] = rowWeight*inputRow[j];
+    for (int k = 1; k < scale; k++) {
+      inputRow += nColumns_in;
+      rowWeight = weights[k];
+#pragma omp simd
+      for (int j = 0; j < nRowPixels; j++)
+        rowSum[j] += rowWeight*inputRow[j];
+    }
+    // 2. weighted sum over each block's columns
+    double  *outputRow = outputImage + (long)(y0_out + i)*nColumns_out + x0_out;
+    switch (scale) {
+      case 2:
+        SumRowBlocks_fixed<2>(rowSum, nBlockColumns, weights, normalization, outputRow);
+        break;
+      case 3:
+        SumRowBlocks_fixed<3>(rowSum, nBlockColumns, weights, normalization, outputRow);
+        break;
+      case 4:
+        SumRowBlocks_fixed<4>(rowSum, nBlockColumns, weights, normalization, outputRow);
+        break;
+      case 5:
+        SumRowBlocks_fixed<5>(rowSum, nBlockColumns, weights, normalization, outputRow);
+        break;
+      default:
+        SumRowBlocks(rowSum, nBlockColumns, scale, weights, normalization, outputRow);
+    }
+  }
+  } // end omp parallel section
+}
 
 
 
@@ -50,23 +198,21 @@
 ///    Oversampling scale (oversampleScale) specifies the 1D oversampling, so that
 /// each main-size pixel in the sub-region corresponds to oversampleScale x oversampleScale
 /// subpixels (i.e., pixels in oversampledImage)
+///    Optional weights (oversampleScale values) are passed on to DownsampleImage;
+/// the default (NULL) is a plain block average.
 
 void DownsampleAndReplace( const double *oversampledImage, int nOversampCols, 
 						int nOversampRows, int nOversampPSFCols, int nOversampPSFRows,	
 						double *mainImage, int nMainCols, int nMainRows, int nMainPSFCols, 
 						int nMainPSFRows, int startX, int startY, int oversampleScale, 
-						int debugLevel )
+						int debugLevel, const double *weights )
 {
-  int  i, j, i_sub, j_sub, ii, jj;
-  int  i1, j1, ii1, jj1;
+  int  i1, j1;
   int  nCols_subregion, nRows_subregion;
-  double  binnedFlux, oversampleArea, oversampPixFlux;
   
   // Coordinate coding:
   //    i,j = 0-based row,column within mainImage (including any PSF padding);
   //          base pixel size
-  //    i_sub,j_sub = 0-based row,column within the sub-region of mainImage;
-  //          base pixel size
   //    ii,jj = 0-based row,column within oversampledImage (including any PSF padding);
   //          oversampled pixel size
   
@@ -76,36 +222,15 @@ void DownsampleAndReplace( const double *oversampledImage, int nOversampCols,
   i1 = startY - 1 + nMainPSFRows;
   // get number of columns and rows in sub-region of main image
   nCols_subregion = (int)((nOversampCols - 2*nOversampPSFCols)/oversampleScale);
-  nRows_subregion = (int)((nOversampCols - 2*nOversampPSFRows)/oversampleScale);
-  oversampleArea = oversampleScale*oversampleScale;
-
-  // iterate over sub-region within main image [i,j = indices for main image]
-  if (debugLevel > 1) printf("Starting main loop (with target j1,i1 = %d,%d)...\n", j1,i1);
-  for (i = i1; i < i1 + nRows_subregion; i++) {
-    if (debugLevel > 1) printf("target row i = %d:\n", i);
-    for (j = j1; j < j1 + nCols_subregion; j++) {
-      j_sub = j - j1;  // native j (column) index for sub-region
-      i_sub = i - i1;  // native i (row) index for sub-region
-      if (debugLevel > 1) printf("\ttarget column j = %d: j_sub,i_sub = %d,%d\n", j,j_sub,i_sub);
-      // integrate over the oversampleScale x oversampleScale subpixels within this
-      // sub-region pixel
-      jj1 = j_sub*oversampleScale + nOversampPSFCols;   // starting j-index (columns) within oversampled subimage
-      ii1 = i_sub*oversampleScale + nOversampPSFRows;   // starting i-index (rows) within oversampled subimage
-      if (debugLevel > 1) printf("\tStarting loop on oversampled image (with osampImage jj1,ii1 = %d,%d):\n", jj1,ii1);
-      binnedFlux = 0.0;
-      for (ii = ii1; ii < ii1 + oversampleScale; ii++) {
-        for (jj = jj1; jj < jj1 + oversampleScale; jj++) {
-          oversampPixFlux = oversampledImage[ii*nOversampCols + jj];
-          if (debugLevel > 1) printf("\t\toversample pixel at jj,ii = %d,%d: %f\n", jj,ii,oversampPixFlux);
-          binnedFlux += oversampledImage[ii*nOversampCols + jj];
-        }
-      }
-      // normalize flux to surface-brightness value for main-image pixels & store in main image
-      mainImage[i*nMainCols + j] = binnedFlux/oversampleArea;
-    }
-  }
-  if (debugLevel > 1) printf("Done.\n");
-
+  nRows_subregion = (int)((nOversampRows - 2*nOversampPSFRows)/oversampleScale);
+
+  if (debugLevel > 1)
+    printf("Downsampling %d x %d oversampled pixels (starting at jj,ii = %d,%d) into %d x %d pixels of main image (starting at j,i = %d,%d)\n",
+    		nCols_subregion*oversampleScale, nRows_subregion*oversampleScale, nOversampPSFCols,
+    		nOversampPSFRows, nCols_subregion, nRows_subregion, j1, i1);
+  DownsampleImage(oversampledImage, nOversampCols, nOversampPSFCols, nOversampPSFRows,
+  				mainImage, nMainCols, j1, i1, nCols_subregion, nRows_subregion, oversampleScale,
+  				weights);
 }   
 
 
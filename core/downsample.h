@@ -1,23 +1,47 @@
 /** @file
-    \brief Utility function taking an oversampled sub-region, downsampling it to
-           parent image's pixel scale, and copying it into parent image.
+    \brief Utility functions for downsampling oversampled images via (weighted)
+           block-averaging, including taking an oversampled sub-region, downsampling
+           it to parent image's pixel scale, and copying it into parent image.
  *
  */
 /*    Utility functions taking an oversampled sub-region, downsampling it to
  * parent image's pixel scale, and copying it into parent image.
  *
+ *    Downsampling replaces each block of oversampleScale x oversampleScale input
+ * pixels with the weighted average of those pixels. The weights are separable:
+ * the same oversampleScale weights are used along rows and columns, so the weight
+ * of input pixel (k,l) within the block is weights[k]*weights[l] (normalized by
+ * the sum of all the weights). NULL weights means a plain (box-filter) average.
  */
 
 #ifndef _DOWNSAMPLE_H_
 #define _DOWNSAMPLE_H_
 
 
+// Weighting kernels for MakeDownsampleWeights
+const int  DOWNSAMPLE_BOX = 0;        // equal weights (plain block average)
+const int  DOWNSAMPLE_TRIANGLE = 1;   // weights falling linearly from block center to edges
+
+
+/// \brief Stores the oversampleScale (1D) weights for the specified kernel type in
+///        weights; returns -1 if kernelType isn't recognized
+int MakeDownsampleWeights( int kernelType, int oversampleScale, double *weights );
+
+/// \brief Downsamples the nBlockColumns x nBlockRows blocks of input pixels starting
+///        at (x0_in,y0_in) in inputImage and stores the results starting at
+///        (x0_out,y0_out) in outputImage (0-based coordinates; nColumns_in and
+///        nColumns_out are the row lengths of the two images)
+void DownsampleImage( const double *inputImage, int nColumns_in, int x0_in, int y0_in,
+						double *outputImage, int nColumns_out, int x0_out, int y0_out,
+						int nBlockColumns, int nBlockRows, int oversampleScale,
+						const double *weights=NULL );
+
 /// \brief Replaces subsection of main region with oversampled version of subsection,
 ///        downsampled to match main image scale
 void DownsampleAndReplace( const double *oversampledImage, int nOversampCols, 
 						int nOversampRows, int nOversampPSFCols, int nOversampPSFRows,	
 						double *mainImage, int nMainCols, int nMainRows, int nMainPSFCols, 
 						int nMainPSFRows, int startX, int startY, int oversampleScale, 
-						int debugLevel );
+						int debugLevel, const double *weights=NULL );
 
 #endif /* _DOWNSAMPLE_H_ */
@@ -36,22 +36,32 @@
 using namespace std;
 
 #include "psf_oversampling_info.h"
+#include "convolver.h"
 
 
 const int  FFTW_SIZE = 16;
 const int  DOUBLE_SIZE = 8;
+const int  MASK_PIXEL_SIZE = 1;   // ModelObject stores mask as unsigned char
 
 
 /* ------------------- Function Prototypes ----------------------------- */
 long EstimateConvolverMemoryUse( const int nModel_cols, const int nModel_rows, 
-								const int nPSF_cols, const int nPSF_rows );
+								const int nPSF_cols, const int nPSF_rows, const int nPadding_cols,
+								const int nPadding_rows );
+long EstimateTiledConvolverMemoryUse( const int nModel_cols, const int nModel_rows, 
+								const int nPSF_cols, const int nPSF_rows, const int nPadding_cols,
+								const int nPadding_rows, const int tileSize, const int nThreads );
+long EstimateFitMemoryUse( int nData_cols, int nData_rows, int nFreeParams, bool levMarFit,
+						bool outputResidual, bool outputModel );
 
 
 
 /// Returns an estimate of the number of bytes needed by a Convolver object due
-/// to arrays allocated within the object.
+/// to arrays allocated within the object, when only the central part of the
+/// model image (excluding nPadding_cols and nPadding_rows on each side) is convolved.
 long EstimateConvolverMemoryUse( const int nModel_cols, const int nModel_rows, 
-								const int nPSF_cols, const int nPSF_rows )
+								const int nPSF_cols, const int nPSF_rows, const int nPadding_cols,
+								const int nPadding_rows )
 {
   long  nPaddedPixels = 0;
   long  nPaddedPixels_cmplx = 0;
@@ -60,8 +70,11 @@ long EstimateConvolverMemoryUse( const int nModel_cols, const int nModel_rows,
 
   nBytesNeeded += (long)nPSF_cols * (long)nPSF_rows;   // allocated outside
   // Convolver stuff
-  nCols_padded = nModel_cols + nPSF_cols - 1;
-  nRows_padded = nModel_rows + nPSF_rows - 1;
+  // (padded dimensions are rounded up to FFT-friendly sizes, as in Convolver::DoFullSetup)
+  GetFFTFriendlyPaddedSizes(MinimumPaddedLength(nModel_cols, nPSF_cols, nPadding_cols,
+  							nModel_cols - 2*nPadding_cols), MinimumPaddedLength(nModel_rows,
+  							nPSF_rows, nPadding_rows, nModel_rows - 2*nPadding_rows),
+  							nCols_padded, nRows_padded);
   nCols_padded_trimmed = (int)(floor(nCols_padded/2)) + 1;   // reduced size of r2c/c2r complex array
   nPaddedPixels = (long)nCols_padded * (long)nRows_padded;
   nPaddedPixels_cmplx = (long)nCols_padded_trimmed * (long)nRows_padded;
@@ -74,6 +87,39 @@ long EstimateConvolverMemoryUse( const int nModel_cols, const int nModel_rows,
 }
 
 
+/// Same, for tiled convolution with tiles of size tileSize (0 = default) and nThreads
+/// threads: each thread has its own tile-sized FFT arrays, and the other buffers
+/// hold a band (row) of output tiles and the input rows above the next band.
+long EstimateTiledConvolverMemoryUse( const int nModel_cols, const int nModel_rows, 
+								const int nPSF_cols, const int nPSF_rows, const int nPadding_cols,
+								const int nPadding_rows, const int tileSize, const int nThreads )
+{
+  long  nBytesNeeded = 0;
+  int  nOutput_cols = nModel_cols - 2*nPadding_cols;
+  int  nOutput_rows = nModel_rows - 2*nPadding_rows;
+  int  nCols_tile, nRows_tile, nCols_tile_trimmed;
+
+  nBytesNeeded += (long)nPSF_cols * (long)nPSF_rows;   // allocated outside
+  // (tile sizes are computed as in Convolver::SetupTiles)
+  nCols_tile = GetTileFFTSize(tileSize, nPSF_cols, nOutput_cols);
+  nRows_tile = GetTileFFTSize(tileSize, nPSF_rows, nOutput_rows);
+  nCols_tile_trimmed = (int)(floor(nCols_tile/2)) + 1;
+  long  nTilePixels = (long)nCols_tile * (long)nRows_tile;
+  long  nTilePixels_cmplx = (long)nCols_tile_trimmed * (long)nRows_tile;
+  // 2 double-precision and 2 fftw_complex arrays per thread, plus the PSF transform
+  nBytesNeeded += nThreads * (2 * nTilePixels * DOUBLE_SIZE + 2 * nTilePixels_cmplx * FFTW_SIZE);
+  nBytesNeeded += nTilePixels_cmplx * FFTW_SIZE;
+  // band output and halo rows
+  int  nBandRows = nRows_tile - nPSF_rows + 1;
+  if (nBandRows > nOutput_rows)
+    nBandRows = nOutput_rows;
+  nBytesNeeded += (long)nBandRows * (long)nOutput_cols * DOUBLE_SIZE;
+  nBytesNeeded += (long)(nPSF_rows - 1 - nPSF_rows/2) * (long)nModel_cols * DOUBLE_SIZE;
+  
+  return nBytesNeeded;
+}
+
+
 /// Returns an estimate of the total number of bytes needed due to array allocations
 /// for oversampled-PSF convolution within ModelObject (and associated Convolver objects). 
 long EstimatePsfOversamplingMemoryUse( vector<PsfOversamplingInfo *> oversamplingInfoVect )
@@ -91,25 +137,52 @@ long EstimatePsfOversamplingMemoryUse( vector<PsfOversamplingInfo *> oversamplin
     int  deltaX = x2 - x1 + 1;
     int  deltaY = y2 - y1 + 1;
 
-    int  nOversampModel_cols = deltaX*oversampleScale + 2*nPSF_osamp_cols;
-    int  nOversampModel_rows = deltaY*oversampleScale + 2*nPSF_osamp_rows;
+    // (oversampled model images are padded by half the PSF size on each side)
+    int  nOversampModel_cols = deltaX*oversampleScale + 2*(nPSF_osamp_cols/2);
+    int  nOversampModel_rows = deltaY*oversampleScale + 2*(nPSF_osamp_rows/2);
     long  nOversampModelPixels = (long)nOversampModel_cols * (long)nOversampModel_rows;
     // memory for oversampled model image
     nBytesNeeded += nOversampModelPixels * DOUBLE_SIZE;
     // memory used by Convolver object for oversampled convolution
     nBytesNeeded += EstimateConvolverMemoryUse(nOversampModel_cols, nOversampModel_rows, 
-   												nPSF_osamp_cols, nPSF_osamp_rows);
+   												nPSF_osamp_cols, nPSF_osamp_rows, nPSF_osamp_cols/2,
+   												nPSF_osamp_rows/2);
   }
   
   return nBytesNeeded;
 }
 
 
+/// Returns an estimate of the number of bytes needed for arrays which are *not*
+/// allocated until the fit starts (or finishes) -- or are allocated outside of
+/// ModelObject: the data image, mpfit's internal arrays and ModelObject's
+/// deviatesVector (L-M fits), and output residual and model images. (Adding
+/// this to ModelObject::GetMemoryUse() after FinalSetupForFitting() gives the
+/// total for a fit.)
+long EstimateFitMemoryUse( int nData_cols, int nData_rows, int nFreeParams, bool levMarFit,
+						bool outputResidual, bool outputModel )
+{
+  long  dataSize = (long)nData_cols * (long)nData_rows * DOUBLE_SIZE;
+  int  nDataSizeAllocs = 1;   // data image, allocated outside
+
+  if (levMarFit) {
+    nDataSizeAllocs += 3;   // ModelObject's deviatesVector + 2 allocations [fvec, wa4] w/in mpfit.cpp
+    nDataSizeAllocs += nFreeParams;   // jacobian array fjac allocated w/in mpfit.cpp
+  }
+  if (outputResidual)
+    nDataSizeAllocs += 1;
+  if (outputModel)
+    nDataSizeAllocs += 1;
+  return nDataSizeAllocs * dataSize;
+}
+
+
 /// Returns an estimate of the total number of bytes needed due to array allocations
-/// within ModelObject (and associated Convolver objects), mpfit, and main.
+/// within ModelObject (and associated Convolver objects), mpfit, and main. If
+/// fftTileSize > 0, the estimate is for tiled convolution with nTileThreads threads.
 long EstimateMemoryUse( int nData_cols, int nData_rows, int nPSF_cols, int nPSF_rows,
 						int nFreeParams, bool levMarFit, bool cashTerms, bool outputResidual,
-						bool outputModel )
+						bool outputModel, int nComponentImages, int fftTileSize, int nTileThreads )
 {
   long  nBytesNeeded = 0.0;
   long  nDataPixels = (long)nData_cols * (long)nData_rows;
@@ -117,33 +190,35 @@ long EstimateMemoryUse( int nData_cols, int nData_rows, int nPSF_cols, int nPSF_
   int  nModel_rows, nModel_cols;
   long  nModelPixels = 0;
   
-  nBytesNeeded += dataSize;   // allocated outside
+  // data image, fit-time and output arrays
+  nBytesNeeded += EstimateFitMemoryUse(nData_cols, nData_rows, nFreeParams, levMarFit,
+  										outputResidual, outputModel);
   
   if (nPSF_cols > 0) {
-    // we're doing PSF convolution, so model image will be larger
-    nModel_cols = nData_cols + 2*nPSF_cols;
-    nModel_rows = nData_rows + 2*nPSF_rows;
+    // we're doing PSF convolution, so model image will be larger (by half the PSF
+    // size on each side, with ModelObject's default cropped convolution)
+    nModel_cols = nData_cols + 2*(nPSF_cols/2);
+    nModel_rows = nData_rows + 2*(nPSF_rows/2);
     nModelPixels = (long)nModel_cols * (long)nModel_rows;
     // memory used by Convolver object
-    nBytesNeeded += EstimateConvolverMemoryUse(nModel_cols, nModel_rows, nPSF_cols, nPSF_rows);
+    if (fftTileSize > 0)
+      nBytesNeeded += EstimateTiledConvolverMemoryUse(nModel_cols, nModel_rows, nPSF_cols,
+      										nPSF_rows, nPSF_cols/2, nPSF_rows/2, fftTileSize,
+      										nTileThreads);
+    else
+      nBytesNeeded += EstimateConvolverMemoryUse(nModel_cols, nModel_rows, nPSF_cols, nPSF_rows,
+    											nPSF_cols/2, nPSF_rows/2);
   }
   else
     nModelPixels = nDataPixels;
   long  modelSize = nModelPixels * DOUBLE_SIZE; 
   // the following are always allocated
-  nBytesNeeded += 3*modelSize;   // modelVector, weightVector, maskVector
-  // possible allocations, depending on type of fit and/or outputs requested
-  int  nDataSizeAllocs = 0;
-  if (levMarFit) {
-    nDataSizeAllocs += 3;   // ModelObject's deviatesVector + 2 allocations [fvec, wa4] w/in mpfit.cpp
-    nDataSizeAllocs += nFreeParams;   // jacobian array fjac allocated w/in mpfit.cpp
-  }
+  nBytesNeeded += modelSize;   // modelVector
+  nBytesNeeded += dataSize;   // weightVector
+  nBytesNeeded += nDataPixels * MASK_PIXEL_SIZE;   // maskVector
+  // optional per-component image cache in ModelObject
+  nBytesNeeded += nComponentImages*modelSize;
   if (cashTerms)
-    nDataSizeAllocs += 1;
-  if (outputResidual)
-    nDataSizeAllocs += 1;
-  if (outputModel)
-    nDataSizeAllocs += 1;
-  nBytesNeeded += nDataSizeAllocs * dataSize;
+    nBytesNeeded += dataSize;   // extraCashTermsVector
   return nBytesNeeded;
 }
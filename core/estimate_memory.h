@@ -15,8 +15,12 @@ using namespace std;
 
 long EstimatePsfOversamplingMemoryUse( vector<PsfOversamplingInfo *> oversamplingInfoVect );
 
+long EstimateFitMemoryUse( int nData_cols, int nData_rows, int nFreeParams, bool levMarFit,
+						bool outputResidual, bool outputModel );
+
 long EstimateMemoryUse( int nData_cols, int nData_rows, int nPSF_cols, int nPSF_rows,
 						int nFreeParams, bool levMarFit, bool cashTerms, bool outputResidual,
-						bool outputModel );
+						bool outputModel, int nComponentImages=0, int fftTileSize=0,
+						int nTileThreads=1 );
 
 #endif  // _ESTIMATE_MEMORY_H_
@@ -0,0 +1,230 @@
+/* FILE: fftw_wisdom.cpp ----------------------------------------------- */
+/*
+ *   Functions for importing FFTW wisdom from, and exporting it to, a wisdom file
+ * which may be shared by many concurrently running imfit/makeimage processes.
+ *
+ *   Reading: a shared lock is held on "<wisdom-file>.lock" while the wisdom file
+ * is read.
+ *   Writing: an exclusive lock is held on the lock file; the current contents of
+ * the wisdom file are merged with the in-memory wisdom, which is then written to a
+ * temporary file in the same directory, and the temporary file is rename()d to the
+ * wisdom file (if its contents differ). Since rename() is atomic, a process which
+ * reads the wisdom file without locking it still sees either the old or the new
+ * version.
+ *
+ *   Like all FFTW planner functions, these are *not* thread-safe; they should only
+ * be called from the (serial) setup code.
+ */
+
+// Copyright 2018 by Peter Erwin.
+//
+// This file is part of Imfit.
+//
+// Imfit is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Imfit is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with Imfit.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <stdio.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <string>
+
+#include "fftw3.h"
+
+#include "fftw_wisdom.h"
+
+using namespace std;
+
+
+/* ------------------- Function Prototypes ----------------------------- */
+
+static int LockWisdomFile( const string& fileName, int lockType );
+static void UnlockWisdomFile( int lockFD );
+static int ImportWisdomFromFile( const string& fileName, bool singlePrecision );
+static bool ReadWholeFile( const string& fileName, string& contents );
+
+
+
+/* ---------------- FUNCTION: FFTWWisdomFileName ----------------------- */
+
+string FFTWWisdomFileName( const string& wisdomFileName, bool singlePrecision )
+{
+  if (singlePrecision)
+    return wisdomFileName + ".f32";
+  return wisdomFileName;
+}
+
+
+/* ---------------- FUNCTION: ImportFFTWWisdom ------------------------- */
+/// Adds the wisdom stored in the wisdom file (if it exists) to FFTW's in-memory
+/// wisdom. Returns 1 if wisdom was imported, 0 if the file doesn't exist (yet),
+/// and -1 if the file exists but could not be read or parsed.
+int ImportFFTWWisdom( const string& wisdomFileName, bool singlePrecision )
+{
+  string  fileName = FFTWWisdomFileName(wisdomFileName, singlePrecision);
+  int  lockFD, status;
+
+  // if the lock file can't be created (e.g., read-only directory), we read the
+  // file anyway, since it's only ever replaced atomically
+  lockFD = LockWisdomFile(fileName, LOCK_SH);
+  status = ImportWisdomFromFile(fileName, singlePrecision);
+  UnlockWisdomFile(lockFD);
+  if (status < 0)
+    fprintf(stderr, "** WARNING: unable to read FFTW wisdom from \"%s\"!\n", fileName.c_str());
+  return status;
+}
+
+
+/* ---------------- FUNCTION: ExportFFTWWisdom ------------------------- */
+/// Merges FFTW's in-memory wisdom with the current contents of the wisdom file
+/// (which may have been updated by other processes since we imported it) and
+/// replaces the file with the result, unless nothing has changed. Returns 1 if
+/// the file was updated, 0 if it was already up to date, -1 on error.
+int ExportFFTWWisdom( const string& wisdomFileName, bool singlePrecision )
+{
+  string  fileName = FFTWWisdomFileName(wisdomFileName, singlePrecision);
+  string  tempFileName, oldContents, newContents;
+  FILE  *outputFile_ptr;
+  int  lockFD;
+  char  pidString[32];
+
+  lockFD = LockWisdomFile(fileName, LOCK_EX);
+  if (lockFD < 0) {
+    fprintf(stderr, "** WARNING: unable to lock FFTW wisdom file \"%s\"; wisdom not saved!\n",
+    		fileName.c_str());
+    return -1;
+  }
+
+  ImportWisdomFromFile(fileName, singlePrecision);
+
+  snprintf(pidString, 32, ".tmp.%ld", (long)getpid());
+  tempFileName = fileName + pidString;
+  outputFile_ptr = fopen(tempFileName.c_str(), "w");
+  if (outputFile_ptr == NULL) {
+    fprintf(stderr, "** WARNING: unable to write FFTW wisdom file \"%s\"!\n", tempFileName.c_str());
+    UnlockWisdomFile(lockFD);
+    return -1;
+  }
+#ifndef NO_FFTW_FLOAT
+  if (singlePrecision)
+    fftwf_export_wisdom_to_file(outputFile_ptr);
+  else
+#endif
+    fftw_export_wisdom_to_file(outputFile_ptr);
+  if (fclose(outputFile_ptr) != 0) {
+    fprintf(stderr, "** WARNING: unable to write FFTW wisdom file \"%s\"!\n", tempFileName.c_str());
+    unlink(tempFileName.c_str());
+    UnlockWisdomFile(lockFD);
+    return -1;
+  }
+
+  // don't rewrite the file (and change its timestamp) if we didn't learn anything new
+  if (ReadWholeFile(fileName, oldContents) && ReadWholeFile(tempFileName, newContents)
+  		&& (oldContents == newContents)) {
+    unlink(tempFileName.c_str());
+    UnlockWisdomFile(lockFD);
+    return 0;
+  }
+  if (rename(tempFileName.c_str(), fileName.c_str()) != 0) {
+    fprintf(stderr, "** WARNING: unable to replace FFTW wisdom file \"%s\"!\n", fileName.c_str());
+    unlink(tempFileName.c_str());
+    UnlockWisdomFile(lockFD);
+    return -1;
+  }
+  UnlockWisdomFile(lockFD);
+  return 1;
+}
+
+
+/* ---------------- FUNCTION: LockWisdomFile --------------------------- */
+/// Opens (creating if necessary) "<fileName>.lock" and locks it with flock();
+/// lockType = LOCK_SH or LOCK_EX. Returns the file descriptor of the lock file,
+/// or -1 if it couldn't be opened or locked.
+static int LockWisdomFile( const string& fileName, int lockType )
+{
+  string  lockFileName = fileName + ".lock";
+  int  lockFD;
+
+  lockFD = open(lockFileName.c_str(), O_RDWR | O_CREAT, 0644);
+  if (lockFD < 0)
+    return -1;
+  while (flock(lockFD, lockType) != 0) {
+    if (errno != EINTR) {
+      close(lockFD);
+      return -1;
+    }
+  }
+  return lockFD;
+}
+
+
+/* ---------------- FUNCTION: UnlockWisdomFile ------------------------- */
+
+static void UnlockWisdomFile( int lockFD )
+{
+  if (lockFD < 0)
+    return;
+  flock(lockFD, LOCK_UN);
+  close(lockFD);
+}
+
+
+/* ---------------- FUNCTION: ImportWisdomFromFile --------------------- */
+/// Returns 1 if wisdom was imported, 0 if the file doesn't exist, -1 on error.
+static int ImportWisdomFromFile( const string& fileName, bool singlePrecision )
+{
+  FILE  *inputFile_ptr;
+  int  importStatus;
+
+  inputFile_ptr = fopen(fileName.c_str(), "r");
+  if (inputFile_ptr == NULL) {
+    if (errno == ENOENT)
+      return 0;
+    return -1;
+  }
+#ifndef NO_FFTW_FLOAT
+  if (singlePrecision)
+    importStatus = fftwf_import_wisdom_from_file(inputFile_ptr);
+  else
+#endif
+    importStatus = fftw_import_wisdom_from_file(inputFile_ptr);
+  fclose(inputFile_ptr);
+  if (importStatus == 0)
+    return -1;
+  return 1;
+}
+
+
+/* ---------------- FUNCTION: ReadWholeFile ---------------------------- */
+
+static bool ReadWholeFile( const string& fileName, string& contents )
+{
+  FILE  *inputFile_ptr;
+  char  buffer[4096];
+  size_t  nRead;
+
+  contents.clear();
+  inputFile_ptr = fopen(fileName.c_str(), "r");
+  if (inputFile_ptr == NULL)
+    return false;
+  while ((nRead = fread(buffer, 1, 4096, inputFile_ptr)) > 0)
+    contents.append(buffer, nRead);
+  fclose(inputFile_ptr);
+  return true;
+}
+
+
+
+/* END OF FILE: fftw_wisdom.cpp ---------------------------------------- */
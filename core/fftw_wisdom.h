@@ -0,0 +1,34 @@
+/** @file
+ * \brief Functions for reading and writing an FFTW wisdom file, so that
+ *        high-quality (FFTW_MEASURE) plans only have to be computed once
+ *
+ */
+/*    The wisdom file can be shared by any number of concurrently running
+ * processes: reads are done under a shared lock and updates under an exclusive
+ * lock (on a separate "<wisdom-file>.lock" file), and the wisdom file itself is
+ * only ever replaced by rename(), so readers never see a partially written file.
+ *    Single-precision (fftwf) wisdom is stored in a separate file, whose name is
+ * the wisdom-file name plus ".f32".
+ */
+
+#ifndef _FFTW_WISDOM_H_
+#define _FFTW_WISDOM_H_
+
+#include <string>
+
+using namespace std;
+
+
+/// Returns the name of the file used for the wisdom of the given precision
+string FFTWWisdomFileName( const string& wisdomFileName, bool singlePrecision=false );
+
+/// Imports wisdom from the file into FFTW; returns 1 if wisdom was imported,
+/// 0 if there is no wisdom file yet, -1 if the file could not be read
+int ImportFFTWWisdom( const string& wisdomFileName, bool singlePrecision=false );
+
+/// Merges FFTW's current wisdom with the file's and (if anything is new) writes
+/// it back; returns 1 if the file was updated, 0 if not, -1 on error
+int ExportFFTWWisdom( const string& wisdomFileName, bool singlePrecision=false );
+
+
+#endif  // _FFTW_WISDOM_H_
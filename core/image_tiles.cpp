@@ -0,0 +1,344 @@
+/* FILE: image_tiles.cpp ------------------------------------------- */
+
+// Code for dividing a model image into rectangular, cache-sized tiles and for
+// computing sums of image functions tile by tile, with the tiles distributed
+// among OpenMP threads in order of decreasing (estimated) cost.
+
+// Copyright 2014-2018 by Peter Erwin.
+//
+// This file is part of Imfit.
+//
+// Imfit is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Imfit is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with Imfit.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <stdio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+
+#ifdef USE_OPENMP
+#include <omp.h>
+#endif
+
+#include "image_tiles.h"
+
+using namespace std;
+
+
+// Maximum tile width (= SIMD_CHUNK_SIZE in simd_kernels.h, so that a row of
+// a tile can be handled by a single call to the vectorized kernels)
+const int  MAX_TILE_COLUMNS = 256;
+// Number of tiles we want for each thread (for load balancing)
+const int  TILES_PER_THREAD = 4;
+// Assumed L2 cache size, if we can't determine it
+const long  DEFAULT_L2_CACHE_BYTES = 256*1024;
+// Bytes needed per tile pixel: image pixel, pixel sum, Kahan error, function value, x value
+const long  BYTES_PER_TILE_PIXEL = 5*sizeof(double);
+
+
+/* ------------------- Function Prototypes ----------------------------- */
+/* Local Functions: */
+static long GetTargetTilePixels( );
+template <typename T>
+static void ComputeTiledImage_T( T *image, int nColumns, const vector<ImageTile>& tiles,
+							const vector<int>& tileOrder, const double *xVals, const double *yVals,
+							vector<FunctionObject *>& functionObjects, int nFunctions,
+							const long *spanRowIndex, const int *spanStartCols,
+							const int *spanEndCols );
+
+
+
+/* ---------------- FUNCTION: GetTargetTilePixels() -------------------- */
+/// Returns the number of pixels for a tile whose working set fills about half
+/// of the L2 cache (the other half is left for function-object data, etc.)
+static long GetTargetTilePixels( )
+{
+  long  l2Bytes = 0;
+
+#ifdef _SC_LEVEL2_CACHE_SIZE
+  l2Bytes = sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+  if (l2Bytes <= 0)
+    l2Bytes = DEFAULT_L2_CACHE_BYTES;
+  return max(l2Bytes / (2*BYTES_PER_TILE_PIXEL), (long)MAX_TILE_COLUMNS);
+}
+
+
+/* ---------------- FUNCTION: MakeImageTiles() ------------------------- */
+/// Divides an nColumns x nRows image into tiles. Tiles are up to MAX_TILE_COLUMNS
+/// wide and are made as tall as the L2-cache size allows, unless that would give
+/// fewer than TILES_PER_THREAD tiles per OpenMP thread, in which case they are
+/// made shorter (down to a single row).
+void MakeImageTiles( int nColumns, int nRows, vector<ImageTile>& tiles )
+{
+  int  nThreads = 1;
+  int  tileColumns, tileRows, nTileColumns, nTileRows;
+  ImageTile  newTile;
+
+#ifdef USE_OPENMP
+  nThreads = omp_get_max_threads();
+#endif
+
+  tiles.clear();
+  if ((nColumns < 1) || (nRows < 1))
+    return;
+
+  tileColumns = min(nColumns, MAX_TILE_COLUMNS);
+  nTileColumns = (nColumns + tileColumns - 1) / tileColumns;
+  tileRows = (int)min((long)nRows, max(GetTargetTilePixels() / tileColumns, 1L));
+  nTileRows = (nRows + tileRows - 1) / tileRows;
+  while ((nThreads > 1) && (tileRows > 1) && (nTileColumns*nTileRows < TILES_PER_THREAD*nThreads)) {
+    tileRows = (tileRows + 1) / 2;
+    nTileRows = (nRows + tileRows - 1) / tileRows;
+  }
+
+  for (int i = 0; i < nRows; i += tileRows) {
+    for (int j = 0; j < nColumns; j += tileColumns) {
+      newTile.col1 = j;
+      newTile.col2 = min(j + tileColumns, nColumns);
+      newTile.row1 = i;
+      newTile.row2 = min(i + tileRows, nRows);
+      tiles.push_back(newTile);
+    }
+  }
+}
+
+
+/* ---------------- FUNCTION: OrderTilesByCost() ----------------------- */
+/// Estimates the cost of each tile by summing the EstimateCost() values of the
+/// non-PointSource functions, and stores the tile indices in tileOrder, sorted
+/// by decreasing cost (ties keep their original order). Handing out the most
+/// expensive tiles first lets dynamic scheduling balance the load among threads.
+void OrderTilesByCost( const vector<ImageTile>& tiles, const double *xVals,
+						const double *yVals, vector<FunctionObject *>& functionObjects,
+						int nFunctions, vector<int>& tileOrder )
+{
+  int  nTiles = (int)tiles.size();
+  long  nPixels;
+  double  xMin, xMax, yMin, yMax;
+  vector< pair<double, int> >  costs(nTiles);
+  vector<FunctionObject *>  imageFunctions;
+
+  for (int n = 0; n < nFunctions; n++)
+    if (! functionObjects[n]->IsPointSource())
+      imageFunctions.push_back(functionObjects[n]);
+  for (int k = 0; k < nTiles; k++) {
+    nPixels = (long)(tiles[k].col2 - tiles[k].col1) * (long)(tiles[k].row2 - tiles[k].row1);
+    xMin = min(xVals[tiles[k].col1], xVals[tiles[k].col2 - 1]);
+    xMax = max(xVals[tiles[k].col1], xVals[tiles[k].col2 - 1]);
+    yMin = min(yVals[tiles[k].row1], yVals[tiles[k].row2 - 1]);
+    yMax = max(yVals[tiles[k].row1], yVals[tiles[k].row2 - 1]);
+    costs[k].first = 0.0;
+    costs[k].second = k;
+    for (int n = 0; n < (int)imageFunctions.size(); n++)
+      costs[k].first -= imageFunctions[n]->EstimateCost(xMin, xMax, yMin, yMax, nPixels);
+  }
+  // sorting by negative cost (and then by index) = decreasing cost, stable
+  sort(costs.begin(), costs.end());
+  tileOrder.resize(nTiles);
+  for (int k = 0; k < nTiles; k++)
+    tileOrder[k] = costs[k].second;
+}
+
+
+/* ---------------- FUNCTION: ComputeTiledImage_T() -------------------- */
+/// Computes the sum of all non-PointSource functions for each pixel of image
+/// (nColumns wide), tile by tile. Within a tile, each function is computed for all
+/// of the tile's pixels (with one ComputeValues() call per row of the tile, or per
+/// run of unmasked pixels) before moving on to the next function, so the tile stays
+/// in cache. Values are added (in double precision) with the Kahan summation
+/// algorithm, and then copied into image; since each pixel's value depends only on
+/// its own coordinates, the results are identical to computing entire rows at once.
+/// (PointSource functions are filtered out once, before the tiles are computed.)
+template <typename T>
+static void ComputeTiledImage_T( T *image, int nColumns, const vector<ImageTile>& tiles,
+							const vector<int>& tileOrder, const double *xVals, const double *yVals,
+							vector<FunctionObject *>& functionObjects, int nFunctions,
+							const long *spanRowIndex, const int *spanStartCols,
+							const int *spanEndCols )
+{
+  int  nTiles = (int)tileOrder.size();
+  int  k, i, j, n, jStart, jEnd, tileColumns, nImageFunctions;
+  long  s, sFirst, sLast, maxTilePixels = 0;
+  double  tempSum, adjVal;
+  double  *sumRow, *errorRow;
+  T  *imageRow;
+  vector<FunctionObject *>  imageFunctions;
+
+  for (n = 0; n < nFunctions; n++)
+    if (! functionObjects[n]->IsPointSource())
+      imageFunctions.push_back(functionObjects[n]);
+  nImageFunctions = (int)imageFunctions.size();
+  for (k = 0; k < nTiles; k++)
+    maxTilePixels = max(maxTilePixels, (long)(tiles[k].col2 - tiles[k].col1) *
+    									(long)(tiles[k].row2 - tiles[k].row1));
+
+#pragma omp parallel private(k,i,j,n,jStart,jEnd,tileColumns,s,sFirst,sLast,tempSum,adjVal,imageRow,sumRow,errorRow)
+  {
+  // per-thread buffers
+  vector<double>  yRow(MAX_TILE_COLUMNS), newVals(MAX_TILE_COLUMNS);
+  vector<double>  tileSums(maxTilePixels), storedErrors(maxTilePixels);
+
+  #pragma omp for schedule (dynamic, 1)
+  for (k = 0; k < nTiles; k++) {
+    const ImageTile&  tile = tiles[tileOrder[k]];
+    tileColumns = tile.col2 - tile.col1;
+    for (j = 0; j < (tile.row2 - tile.row1)*tileColumns; j++) {
+      tileSums[j] = 0.0;
+      storedErrors[j] = 0.0;
+    }
+    for (n = 0; n < nImageFunctions; n++) {
+      for (i = tile.row1; i < tile.row2; i++) {
+        sumRow = &tileSums[(long)(i - tile.row1)*tileColumns];
+        errorRow = &storedErrors[(long)(i - tile.row1)*tileColumns];
+        for (j = 0; j < tileColumns; j++)
+          yRow[j] = yVals[i];
+        if (spanRowIndex != NULL) {
+          sFirst = spanRowIndex[i];
+          sLast = spanRowIndex[i + 1];
+        } else {
+          sFirst = 0;   // one "span" = the whole row of the tile
+          sLast = 1;
+        }
+        for (s = sFirst; s < sLast; s++) {
+          if (spanRowIndex != NULL) {
+            jStart = max(spanStartCols[s], tile.col1);
+            jEnd = min(spanEndCols[s], tile.col2);
+            if (jStart >= jEnd)
+              continue;
+          } else {
+            jStart = tile.col1;
+            jEnd = tile.col2;
+          }
+          imageFunctions[n]->ComputeValues(xVals + jStart, &yRow[0], &newVals[0], jEnd - jStart);
+          for (j = jStart; j < jEnd; j++) {
+            // Kahan summation algorithm
+            adjVal = newVals[j - jStart] - errorRow[j - tile.col1];
+            tempSum = sumRow[j - tile.col1] + adjVal;
+            errorRow[j - tile.col1] = (tempSum - sumRow[j - tile.col1]) - adjVal;
+            sumRow[j - tile.col1] = tempSum;
+          }
+        }
+      }
+    }
+    for (i = tile.row1; i < tile.row2; i++) {
+      imageRow = image + (long)i*nColumns;
+      sumRow = &tileSums[(long)(i - tile.row1)*tileColumns];
+      for (j = tile.col1; j < tile.col2; j++)
+        imageRow[j] = (T)sumRow[j - tile.col1];
+    }
+  }
+
+  } // end omp parallel section
+}
+
+
+/* ---------------- FUNCTION: ComputeTiledImage() ---------------------- */
+/// Computes the model image (see ComputeTiledImage_T above).
+void ComputeTiledImage( double *image, int nColumns, const vector<ImageTile>& tiles,
+						const vector<int>& tileOrder, const double *xVals, const double *yVals,
+						vector<FunctionObject *>& functionObjects, int nFunctions,
+						const long *spanRowIndex, const int *spanStartCols,
+						const int *spanEndCols )
+{
+  ComputeTiledImage_T(image, nColumns, tiles, tileOrder, xVals, yVals, functionObjects,
+  					nFunctions, spanRowIndex, spanStartCols, spanEndCols);
+}
+
+
+/* ---------------- FUNCTION: ComputeTiledImage() ---------------------- */
+/// Single-precision version: pixel values are still computed and summed in
+/// double precision; only the final per-pixel sums are rounded to float.
+void ComputeTiledImage( float *image, int nColumns, const vector<ImageTile>& tiles,
+						const vector<int>& tileOrder, const double *xVals, const double *yVals,
+						vector<FunctionObject *>& functionObjects, int nFunctions,
+						const long *spanRowIndex, const int *spanStartCols,
+						const int *spanEndCols )
+{
+  ComputeTiledImage_T(image, nColumns, tiles, tileOrder, xVals, yVals, functionObjects,
+  					nFunctions, spanRowIndex, spanStartCols, spanEndCols);
+}
+
+
+/* ---------------- FUNCTION: SumTiledFunction() ----------------------- */
+/// Returns the sum of a single function's values over all the pixels in the tiles
+/// (e.g., for estimating total fluxes); Setup() must already have been called.
+double SumTiledFunction( const vector<ImageTile>& tiles, const vector<int>& tileOrder,
+						const double *xVals, const double *yVals, FunctionObject *functionObject )
+{
+  int  nTiles = (int)tileOrder.size();
+  int  k, i, j, tileColumns;
+  double  totalSum = 0.0;
+
+#pragma omp parallel private(k,i,j,tileColumns) reduction(+:totalSum)
+  {
+  vector<double>  yRow(MAX_TILE_COLUMNS), newVals(MAX_TILE_COLUMNS);
+
+  #pragma omp for schedule (dynamic, 1)
+  for (k = 0; k < nTiles; k++) {
+    const ImageTile&  tile = tiles[tileOrder[k]];
+    tileColumns = tile.col2 - tile.col1;
+    for (i = tile.row1; i < tile.row2; i++) {
+      for (j = 0; j < tileColumns; j++)
+        yRow[j] = yVals[i];
+      functionObject->ComputeValues(xVals + tile.col1, &yRow[0], &newVals[0], tileColumns);
+      for (j = 0; j < tileColumns; j++)
+        totalSum += newVals[j];
+    }
+  }
+
+  } // end omp parallel section
+
+  return totalSum;
+}
+
+
+/* ---------------- FUNCTION: ScheduleWorkItems() ---------------------- */
+/// Items which cost at least 1/nThreads of the total can keep all the threads
+/// busy on their own (with parallel loops inside them), so they go into largeItems
+/// (in their original order). The others are handed out whole to threads; sorting
+/// them by decreasing cost (ties keep their original order) makes dynamic scheduling
+/// a longest-processing-time-first schedule, which keeps the threads evenly loaded
+/// even when the items differ greatly in size. With one thread, all items are large.
+void ScheduleWorkItems( const vector<double>& costs, int nThreads, vector<int>& largeItems,
+						vector<int>& smallItems )
+{
+  int  nItems = (int)costs.size();
+  double  totalCost = 0.0;
+  vector< pair<double, int> >  smallCosts;
+
+  largeItems.clear();
+  smallItems.clear();
+  for (int k = 0; k < nItems; k++)
+    totalCost += costs[k];
+  for (int k = 0; k < nItems; k++) {
+    if ((nThreads <= 1) || (costs[k]*nThreads >= totalCost))
+      largeItems.push_back(k);
+    else
+      smallCosts.push_back(make_pair(-costs[k], k));
+  }
+  // a single small item doesn't need a parallel loop
+  if (smallCosts.size() == 1) {
+    largeItems.push_back(smallCosts[0].second);
+    sort(largeItems.begin(), largeItems.end());
+    return;
+  }
+  sort(smallCosts.begin(), smallCosts.end());
+  for (int k = 0; k < (int)smallCosts.size(); k++)
+    smallItems.push_back(smallCosts[k].second);
+}
+
+
+
+/* END OF FILE: image_tiles.cpp ------------------------------------ */
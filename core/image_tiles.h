@@ -0,0 +1,70 @@
+/** @file
+    \brief Utility functions for dividing a model image into rectangular tiles
+           and computing image functions tile by tile (OpenMP-parallel).
+ *
+ */
+/*    Each tile is small enough that its pixels (plus per-pixel Kahan-summation
+ * errors and function-value buffers) fit in a single core's L2 cache, so all
+ * the functions can be added into a tile while it stays in cache. Tiles are
+ * handed out to threads dynamically, most expensive (as estimated by the
+ * FunctionObjects) first.
+ */
+
+#ifndef _IMAGE_TILES_H_
+#define _IMAGE_TILES_H_
+
+#include <vector>
+
+#include "function_objects/function_object.h"
+
+using namespace std;
+
+
+/// Rectangular block of pixels: columns col1 to col2 - 1, rows row1 to row2 - 1
+/// (0-based indices into the image)
+struct ImageTile {
+  int  col1, col2;
+  int  row1, row2;
+};
+
+
+/// Divides an nColumns x nRows image into tiles (with at least a few tiles for
+/// each OpenMP thread, if the image is large enough)
+void MakeImageTiles( int nColumns, int nRows, vector<ImageTile>& tiles );
+
+/// Stores indices of tiles in tileOrder, sorted from most to least expensive,
+/// using the FunctionObjects' EstimateCost() methods (Setup() must already have
+/// been called); xVals[j] and yVals[i] = coordinates of column j and row i
+void OrderTilesByCost( const vector<ImageTile>& tiles, const double *xVals,
+						const double *yVals, vector<FunctionObject *>& functionObjects,
+						int nFunctions, vector<int>& tileOrder );
+
+/// Computes the sum of all non-PointSource functions for each pixel of image
+/// (nColumns wide), using Kahan summation. If spanRowIndex != NULL, only the
+/// runs of pixels [spanStartCols[s], spanEndCols[s]), s = spanRowIndex[i] to
+/// spanRowIndex[i + 1] - 1, are computed for each row i (other pixels are = 0)
+void ComputeTiledImage( double *image, int nColumns, const vector<ImageTile>& tiles,
+						const vector<int>& tileOrder, const double *xVals, const double *yVals,
+						vector<FunctionObject *>& functionObjects, int nFunctions,
+						const long *spanRowIndex=NULL, const int *spanStartCols=NULL,
+						const int *spanEndCols=NULL );
+
+/// Same, for a single-precision image (sums are still computed in double precision)
+void ComputeTiledImage( float *image, int nColumns, const vector<ImageTile>& tiles,
+						const vector<int>& tileOrder, const double *xVals, const double *yVals,
+						vector<FunctionObject *>& functionObjects, int nFunctions,
+						const long *spanRowIndex=NULL, const int *spanStartCols=NULL,
+						const int *spanEndCols=NULL );
+
+/// Returns the sum of a single function's values over all the tiles
+double SumTiledFunction( const vector<ImageTile>& tiles, const vector<int>& tileOrder,
+						const double *xVals, const double *yVals, FunctionObject *functionObject );
+
+/// Divides work items (e.g., oversampled regions) with the given costs between
+/// largeItems, to be done one at a time with all nThreads threads, and smallItems,
+/// to be done in parallel (one per thread), sorted from most to least expensive
+void ScheduleWorkItems( const vector<double>& costs, int nThreads, vector<int>& largeItems,
+						vector<int>& smallItems );
+
+
+#endif /* _IMAGE_TILES_H_ */
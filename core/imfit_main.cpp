@@ -232,6 +232,11 @@ int main(int argc, char *argv[])
 
   theModel = SetupModelObject(options, nColumnsRowsVect, allPixels, psfPixels, allMaskPixels,
   								allErrorPixels, psfOversamplingInfoVect);
+  // ModelObject keeps its own (one byte per pixel) copy of the mask
+  if (maskAllocated) {
+    fftw_free(allMaskPixels);           // allocated externally, in ReadImageAsVector()
+    maskAllocated = false;
+  }
   
 
   // Add functions to the model object
@@ -301,21 +306,23 @@ int main(int argc, char *argv[])
   // memory usage and warn if it will be large
   long  estimatedMemory;
   double  nGBytes;
-  bool  usingLevMar, usingCashTerms;
+  bool  usingLevMar;
   if (options->solver == MPFIT_SOLVER)
     usingLevMar = true;
   else
     usingLevMar = false;
-  if ((options->useCashStatistic) || (options->usePoissonMLR))
-    usingCashTerms = true;
-  else
-    usingCashTerms = false;
 
-  estimatedMemory = EstimateMemoryUse(nColumns, nRows, nColumns_psf, nRows_psf, nFreeParams,
-										usingLevMar, usingCashTerms, options->saveResidualImage, 
+  // L-M fits compute the Jacobian by perturbing one parameter at a time, so keeping
+  // individual component images (if requested) lets ModelObject skip recomputing
+  // unchanged components; GetMemoryUse includes the cache
+  if ((options->useComponentCache) && (usingLevMar))
+    theModel->UseComponentCache();
+
+  // ModelObject's own buffers (including Convolver and oversampled-region buffers)
+  // are already allocated, so we use the actual figure for those
+  estimatedMemory = theModel->GetMemoryUse() + EstimateFitMemoryUse(nColumns, nRows, 
+  										nFreeParams, usingLevMar, options->saveResidualImage, 
   										options->saveModel);
-  if (options->psfOversampledImagePresent)
-    estimatedMemory += EstimatePsfOversamplingMemoryUse(psfOversamplingInfoVect);
 
   nGBytes = (1.0*estimatedMemory) / GIGABYTE;
   if (nGBytes >= 1.0)
@@ -453,8 +460,6 @@ int main(int argc, char *argv[])
     fftw_free(allErrorPixels);          // allocated externally, in ReadImageAsVector()
   if (options->psfImagePresent)
     fftw_free(psfPixels);               // allocated externally, in ReadImageAsVector()
-  if (maskAllocated)
-    fftw_free(allMaskPixels);           // allocated externally, in ReadImageAsVector()
   if (psfOversamplingInfoVect.size() > 0) {
     for (int nn = 0; nn < (int)psfOversamplingInfoVect.size(); nn++)
       free(psfOversamplingInfoVect[nn]);
@@ -559,9 +564,17 @@ void ProcessInput( int argc, char *argv[], ImfitOptions *theOptions )
   optParser->AddUsageLine("     --loud                   Print extra info during the fit");
   optParser->AddUsageLine("");
   optParser->AddUsageLine("     --max-threads <int>      Maximum number of threads to use");
+  optParser->AddUsageLine("     --fftw-wisdom <filename> Read/save FFTW wisdom (optimized FFT plans) from/to file");
+  optParser->AddUsageLine("     --separable-psf <tol>    Approximate PSF(s) by sums of separable kernels with relative error <= tol, if faster");
+  optParser->AddUsageLine("     --fft-tile-size <int>    Convolve with PSF in tiles, using FFTs of this size (for very large images)");
   optParser->AddUsageLine("");
   optParser->AddUsageLine("     --seed <int>             RNG seed (for testing purposes)");
   optParser->AddUsageLine("     --no-subsampling         Turn off pixel subsampling near centers of functions");
+  optParser->AddUsageLine("     --tabulate-profiles      Use lookup tables for radial profiles (Sersic, etc.)");
+  optParser->AddUsageLine("     --adaptive-subsampling   Integrate central pixels adaptively instead of uniform subsampling");
+  optParser->AddUsageLine("     --float32                Compute model images and FFT convolutions in single precision");
+  optParser->AddUsageLine("     --component-cache        Keep individual component images during L-M fits, to skip recomputing");
+  optParser->AddUsageLine("                              unchanged components (uses one extra model image per component)");
   optParser->AddUsageLine("");
   optParser->AddUsageLine("EXAMPLES:");
   optParser->AddUsageLine("   imfit -c model_config_n100a.dat ngc100.fits");
@@ -583,6 +596,10 @@ void ProcessInput( int argc, char *argv[], ImfitOptions *theOptions )
   optParser->AddFlag("mask-zero-is-bad");
   optParser->AddFlag("no-normalize");
   optParser->AddFlag("no-subsampling");
+  optParser->AddFlag("tabulate-profiles");
+  optParser->AddFlag("adaptive-subsampling");
+  optParser->AddFlag("float32");
+  optParser->AddFlag("component-cache");
   optParser->AddFlag("model-errors");
   optParser->AddFlag("cashstat");
   optParser->AddFlag("poisson-mlr");
@@ -615,6 +632,9 @@ void ProcessInput( int argc, char *argv[], ImfitOptions *theOptions )
   optParser->AddOption("save-bootstrap");
   optParser->AddOption("config", "c");
   optParser->AddOption("max-threads");
+  optParser->AddOption("fftw-wisdom");
+  optParser->AddOption("separable-psf");
+  optParser->AddOption("fft-tile-size");
   optParser->AddOption("seed");
 
   // Comment this out if you want unrecognized (e.g., mis-spelled) flags and options
@@ -718,6 +738,25 @@ void ProcessInput( int argc, char *argv[], ImfitOptions *theOptions )
   if (optParser->FlagSet("no-subsampling")) {
     theOptions->subsamplingFlag = false;
   }
+  if (optParser->FlagSet("tabulate-profiles")) {
+    theOptions->tabulateProfiles = true;
+  }
+  if (optParser->FlagSet("adaptive-subsampling")) {
+    theOptions->adaptiveSubsampling = true;
+  }
+  if (optParser->FlagSet("float32")) {
+#ifdef NO_FFTW_FLOAT
+    fprintf(stderr, "*** ERROR: --float32 requires single-precision FFTW; this program was compiled without it\n");
+    fprintf(stderr, "    (recompile with \"scons --fftw-float\")\n\n");
+    delete optParser;
+    exit(1);
+#else
+    theOptions->singlePrecision = true;
+#endif
+  }
+  if (optParser->FlagSet("component-cache")) {
+    theOptions->useComponentCache = true;
+  }
   if (optParser->FlagSet("silent")) {
     theOptions->verbose = -1;
   }
@@ -893,6 +932,25 @@ void ProcessInput( int argc, char *argv[], ImfitOptions *theOptions )
     theOptions->maxThreads = atol(optParser->GetTargetString("max-threads").c_str());
     theOptions->maxThreadsSet = true;
   }
+  if (optParser->OptionSet("fftw-wisdom")) {
+    theOptions->fftwWisdomFile = optParser->GetTargetString("fftw-wisdom");
+  }
+  if (optParser->OptionSet("separable-psf")) {
+    if (NotANumber(optParser->GetTargetString("separable-psf").c_str(), 0, kPosReal)) {
+      fprintf(stderr, "*** ERROR: separable-psf tolerance should be a positive real number!\n\n");
+      delete optParser;
+      exit(1);
+    }
+    theOptions->separablePSFTolerance = atof(optParser->GetTargetString("separable-psf").c_str());
+  }
+  if (optParser->OptionSet("fft-tile-size")) {
+    if (NotANumber(optParser->GetTargetString("fft-tile-size").c_str(), 0, kPosInt)) {
+      fprintf(stderr, "*** ERROR: fft-tile-size should be a positive integer!\n\n");
+      delete optParser;
+      exit(1);
+    }
+    theOptions->fftTileSize = atol(optParser->GetTargetString("fft-tile-size").c_str());
+  }
   if (optParser->OptionSet("seed")) {
     if (NotANumber(optParser->GetTargetString("seed").c_str(), 0, kPosInt)) {
       printf("*** WARNING: RNG seed should be a positive integer!\n");
@@ -407,6 +407,9 @@ void ProcessInput( int argc, char *argv[], MakeimageOptions *theOptions )
   optParser->AddUsageLine("     --ncols <number-of-columns>         x-size of output image");
   optParser->AddUsageLine("     --nrows <number-of-rows>            y-size of output image");
   optParser->AddUsageLine("     --no-subsampling                    Do *not* do pixel subsampling near centers");
+  optParser->AddUsageLine("     --tabulate-profiles                 Use lookup tables for radial profiles (Sersic, etc.)");
+  optParser->AddUsageLine("     --adaptive-subsampling              Integrate central pixels adaptively instead of uniform subsampling");
+  optParser->AddUsageLine("     --float32                           Compute model images and FFT convolutions in single precision");
 //  optParser->AddUsageLine("     --printimage             Print out images (for debugging)");
   optParser->AddUsageLine("");
   optParser->AddUsageLine("     --output-functions <root-name>      Output individual-function images");
@@ -420,6 +423,9 @@ void ProcessInput( int argc, char *argv[], MakeimageOptions *theOptions )
   optParser->AddUsageLine("     --timing <int>           Generate image specified number of times and estimate average creation time");
   optParser->AddUsageLine("");
   optParser->AddUsageLine("     --max-threads <int>      Maximum number of threads to use");
+  optParser->AddUsageLine("     --fftw-wisdom <filename> Read/save FFTW wisdom (optimized FFT plans) from/to file");
+  optParser->AddUsageLine("     --separable-psf <tol>    Approximate PSF(s) by sums of separable kernels with relative error <= tol, if faster");
+  optParser->AddUsageLine("     --fft-tile-size <int>    Convolve with PSF in tiles, using FFTs of this size (for very large images)");
   optParser->AddUsageLine("");
   optParser->AddUsageLine("     --debug <n>              Set the debugging level (integer)");
   optParser->AddUsageLine("");
@@ -438,6 +444,9 @@ void ProcessInput( int argc, char *argv[], MakeimageOptions *theOptions )
   optParser->AddFlag("save-expanded");
   optParser->AddFlag("no-normalize");
   optParser->AddFlag("no-subsampling");
+  optParser->AddFlag("tabulate-profiles");
+  optParser->AddFlag("adaptive-subsampling");
+  optParser->AddFlag("float32");
   optParser->AddFlag("print-fluxes");
   optParser->AddFlag("nosave");
   optParser->AddOption("output", "o");
@@ -453,6 +462,9 @@ void ProcessInput( int argc, char *argv[], MakeimageOptions *theOptions )
   optParser->AddOption("output-functions");
   optParser->AddOption("timing");
   optParser->AddOption("max-threads");
+  optParser->AddOption("fftw-wisdom");
+  optParser->AddOption("separable-psf");
+  optParser->AddOption("fft-tile-size");
   optParser->AddOption("debug");
 
   // Comment this out if you want unrecognized (e.g., mis-spelled) flags and options
@@ -509,6 +521,8 @@ void ProcessInput( int argc, char *argv[], MakeimageOptions *theOptions )
   }
   if (optParser->FlagSet("save-expanded")) {
     theOptions->saveExpandedImage = true;
+    // the expanded image includes the full PSF-sized padding, properly convolved
+    theOptions->croppedConvolution = false;
   }
   if (optParser->FlagSet("no-normalize")) {
     theOptions->normalizePSF = false;
@@ -516,6 +530,22 @@ void ProcessInput( int argc, char *argv[], MakeimageOptions *theOptions )
   if (optParser->FlagSet("no-subsampling")) {
     theOptions->subsamplingFlag = false;
   }
+  if (optParser->FlagSet("tabulate-profiles")) {
+    theOptions->tabulateProfiles = true;
+  }
+  if (optParser->FlagSet("adaptive-subsampling")) {
+    theOptions->adaptiveSubsampling = true;
+  }
+  if (optParser->FlagSet("float32")) {
+#ifdef NO_FFTW_FLOAT
+    fprintf(stderr, "*** ERROR: --float32 requires single-precision FFTW; this program was compiled without it\n");
+    fprintf(stderr, "    (recompile with \"scons --fftw-float\")\n\n");
+    delete optParser;
+    exit(1);
+#else
+    theOptions->singlePrecision = true;
+#endif
+  }
   if (optParser->FlagSet("nosave")) {
     theOptions->saveImage = false;
   }
@@ -626,6 +656,25 @@ void ProcessInput( int argc, char *argv[], MakeimageOptions *theOptions )
     theOptions->maxThreads = atol(optParser->GetTargetString("max-threads").c_str());
     theOptions->maxThreadsSet = true;
   }
+  if (optParser->OptionSet("fftw-wisdom")) {
+    theOptions->fftwWisdomFile = optParser->GetTargetString("fftw-wisdom");
+  }
+  if (optParser->OptionSet("separable-psf")) {
+    if (NotANumber(optParser->GetTargetString("separable-psf").c_str(), 0, kPosReal)) {
+      fprintf(stderr, "*** ERROR: separable-psf tolerance should be a positive real number!\n\n");
+      delete optParser;
+      exit(1);
+    }
+    theOptions->separablePSFTolerance = atof(optParser->GetTargetString("separable-psf").c_str());
+  }
+  if (optParser->OptionSet("fft-tile-size")) {
+    if (NotANumber(optParser->GetTargetString("fft-tile-size").c_str(), 0, kPosInt)) {
+      fprintf(stderr, "*** ERROR: fft-tile-size should be a positive integer!\n\n");
+      delete optParser;
+      exit(1);
+    }
+    theOptions->fftTileSize = atol(optParser->GetTargetString("fft-tile-size").c_str());
+  }
   if (optParser->OptionSet("debug")) {
     if (NotANumber(optParser->GetTargetString("debug").c_str(), 0, kAnyInt)) {
       fprintf(stderr, "*** ERROR: debug should be an integer!\n");
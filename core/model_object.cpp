@@ -51,6 +51,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <assert.h>
 #include <math.h>
 #include <iostream>
@@ -63,6 +64,7 @@ using namespace std;
 #include "function_object.h"
 #include "model_object.h"
 #include "oversampled_region.h"
+#include "image_tiles.h"
 #include "psf_oversampling_info.h"
 #include "psf_interpolators.h"
 #include "mp_enorm.h"
@@ -88,6 +90,10 @@ const int  DOUBLE_SIZE = 8;
 // Core i7 in MacBook Pro, under Mac OS X 10.6 and 10.7)
 #define DEFAULT_OPENMP_CHUNK_SIZE  10
 
+// maximum number of component images convolved together (see
+// ComputeModelFromComponentCache); each one needs three padded FFT arrays
+const int  MAX_COMPONENT_BATCH_SIZE = 4;
+
 
 // for use in ModelObject::AddFunction()
 map<string, int> interpolationMap{ {string("bicubic"), kInterpolator_bicubic}, 
@@ -110,8 +116,9 @@ ModelObject::ModelObject( )
 {
   dataValsSet = weightValsSet = false;
 
-  dataVector = modelVector = weightVector = standardWeightVector = NULL;
-  residualVector = maskVector = deviatesVector = NULL;
+  dataVector = modelVector = weightVector = NULL;
+  residualVector = deviatesVector = NULL;
+  maskVector = NULL;
   outputModelVector = extraCashTermsVector = NULL;
   bootstrapIndices = NULL;
   fblockStartFlags = NULL;
@@ -123,7 +130,8 @@ ModelObject::ModelObject( )
   modelVectorAllocated = false;
   maskVectorAllocated = false;
   weightVectorAllocated = false;
-  standardWeightVectorAllocated = false;
+  weightVectorIsStandard = false;
+  weightVectorShared = false;
   residualVectorAllocated = false;
   outputModelVectorAllocated = false;
   deviatesVectorAllocated = false;
@@ -150,6 +158,22 @@ ModelObject::ModelObject( )
   oversampledRegionsExist = false;
   zeroPointSet = false;
   pointSourcesPresent = false;
+  useComponentCache = false;
+  useProfileTables = false;
+  useAdaptiveSubsampling = false;
+  componentCacheAllocated = false;
+  componentCacheValid = false;
+  useActivePixelSpans = false;
+  activePixelSpansSuspended = false;
+  modelImageIsPartial = false;
+  useSinglePrecision = false;
+  modelImageIsSinglePrecision = false;
+  convolutionMethod = CONVOLUTION_AUTO;
+  separablePSFTolerance = 0.0;
+  cropConvolution = true;
+  fftTileSize = 0;
+  modelVector_spAllocated = false;
+  modelVector_sp = NULL;
   
   nFunctions = 0;
   nFunctionBlocks = 0;
@@ -173,6 +197,7 @@ ModelObject::ModelObject( )
   nDataVals = nDataColumns = nDataRows = 0;
   nModelVals = nModelColumns = nModelRows = 0;
   nPSFColumns = nPSFRows = 0;
+  nPaddingColumns = nPaddingRows = 0;
 }
 
 
@@ -180,24 +205,8 @@ ModelObject::ModelObject( )
 /// Destructor
 ModelObject::~ModelObject()
 {
-  if (modelVectorAllocated)
-    free(modelVector);
-  if (weightVectorAllocated)
-    free(weightVector);
-  if (standardWeightVectorAllocated)
-    free(standardWeightVector);
-  if (maskVectorAllocated)   // only true if we construct mask vector internally
-    free(maskVector);
-  if (deviatesVectorAllocated)
-    free(deviatesVector);
-  if (residualVectorAllocated)
-    free(residualVector);
-  if (outputModelVectorAllocated)
-    free(outputModelVector);
-  if (extraCashTermsVectorAllocated)
-    free(extraCashTermsVector);
-  if (localPsfPixels_allocated)
-    free(localPsfPixels);
+  // (modelVector, weightVector, maskVector, etc., and the Convolver and
+  // OversampledRegion buffers, are all freed when the arena is destroyed)
 
   if (psfInterpolator_allocated)
     delete psfInterpolator;
@@ -211,6 +220,7 @@ ModelObject::~ModelObject()
   
   if (doConvolution)
     delete psfConvolver;
+  FreeRegionFunctions();
   if (oversampledRegionsExist) {
     // since these were originally created with "new", we have to deallocate with "delete"
     for (int i = 0; i < nOversampledRegions; i++)
@@ -224,6 +234,8 @@ ModelObject::~ModelObject()
     free(bootstrapIndices);
     bootstrapIndicesAllocated = false;
   }
+  
+  FreeComponentCache();
 }
 
 
@@ -251,6 +263,9 @@ void ModelObject::SetMaxThreads( int maxThreadNumber )
 #ifdef USE_OPENMP
   omp_set_num_threads(maxRequestedThreads);
 #endif
+  // number of tiles depends on number of threads
+  if (modelImageSetupDone)
+    MakeImageTiles(nModelColumns, nModelRows, modelTiles);
 }
 
 
@@ -263,17 +278,162 @@ void ModelObject::SetOMPChunkSize( int chunkSize )
 }
 
 
+/* ---------------- PUBLIC METHOD: UseComponentCache ------------------- */
+/// Turns on (or off) caching of individual-component images. When this is on,
+/// CreateModelImage keeps a separate (post-convolution) image for each function
+/// and only recomputes those functions whose parameters have changed since the
+/// previous call -- e.g., during the finite-difference Jacobian computation in
+/// mpfit, where only one parameter changes at a time. Memory cost is one extra
+/// model-sized image per function. If this is called after SetupModelImage, the
+/// Convolver's batched-convolution buffers and FFTW plans are set up (or freed)
+/// here, so it should not be called while model images are being computed.
+void ModelObject::UseComponentCache( bool useCache )
+{
+  useComponentCache = useCache;
+  componentCacheValid = false;
+  if ((doConvolution) && (modelImageSetupDone)) {
+    if (useComponentCache)
+      psfConvolver->SetupBatchConvolution(NComponentBatchImages());
+    else
+      psfConvolver->FreeBatchConvolution();
+  }
+}
+
+
+/* ---------------- PUBLIC METHOD: SetProfileTabulation --------------- */
+/// Turns on (or off) the use of lookup tables for radial profiles, for all
+/// current and subsequently added functions which support them (e.g., Sersic);
+/// each such function then tabulates I(r) once per set of parameter values.
+void ModelObject::SetProfileTabulation( bool tabulateProfiles )
+{
+  useProfileTables = tabulateProfiles;
+  for (int n = 0; n < nFunctions; n++)
+    functionObjects[n]->SetProfileTabulation(useProfileTables);
+  componentCacheValid = false;
+}
+
+
+/* ---------------- PUBLIC METHOD: SetAdaptiveSubsampling ------------- */
+/// Turns on (or off) adaptive integration of pixels near function centers, in
+/// place of uniform subsampling, for all current and subsequently added functions
+/// which support it (e.g., Sersic).
+void ModelObject::SetAdaptiveSubsampling( bool adaptiveSubsampling )
+{
+  useAdaptiveSubsampling = adaptiveSubsampling;
+  for (int n = 0; n < nFunctions; n++)
+    functionObjects[n]->SetAdaptiveSubsampling(useAdaptiveSubsampling);
+  componentCacheValid = false;
+}
+
+
+/* ---------------- PUBLIC METHOD: SetSinglePrecision ----------------- */
+/// Turns on (or off) single-precision model images: the model image is stored
+/// as float, and PSF convolution uses single-precision FFTs. Pixel values are
+/// still computed and summed in double precision before being stored, and
+/// deviates, chi^2, etc., are accumulated in double precision. (The component
+/// cache and oversampled regions are not supported, so if either is used, the
+/// model image is computed in double precision.)
+/// Must be called *before* SetupModelImage().
+void ModelObject::SetSinglePrecision( bool singlePrecision )
+{
+  useSinglePrecision = singlePrecision;
+  if (modelImageSetupDone)
+    fprintf(stderr, "** WARNING: ModelObject::SetSinglePrecision called after SetupModelImage()!\n");
+}
+
+
+/* ---------------- PUBLIC METHOD: SetFFTWWisdomFile ------------------ */
+/// Specifies a file for storing FFTW wisdom, which is imported before the FFTW
+/// plans for PSF convolution (including those for oversampled regions) are made,
+/// and updated afterwards. The plans are then made with FFTW_MEASURE, which is
+/// only slow the first time a given image size is used. The file can be shared
+/// by simultaneously running processes.
+/// Must be called *before* SetupModelImage() and AddOversampledPsfInfo().
+void ModelObject::SetFFTWWisdomFile( const string& wisdomFileName )
+{
+  fftwWisdomFile = wisdomFileName;
+  if (modelImageSetupDone)
+    fprintf(stderr, "** WARNING: ModelObject::SetFFTWWisdomFile called after SetupModelImage()!\n");
+}
+
+
+/* ---------------- PUBLIC METHOD: SetConvolutionMethod --------------- */
+/// Specifies how PSF convolution (including convolution of oversampled regions)
+/// is done: with FFTs (CONVOLUTION_FFT), directly in the spatial domain
+/// (CONVOLUTION_DIRECT), or with whichever is estimated to be faster for the
+/// image and PSF sizes (CONVOLUTION_AUTO, the default).
+/// Must be called *before* SetupModelImage() and AddOversampledPsfInfo().
+void ModelObject::SetConvolutionMethod( int method )
+{
+  convolutionMethod = method;
+  if (modelImageSetupDone)
+    fprintf(stderr, "** WARNING: ModelObject::SetConvolutionMethod called after SetupModelImage()!\n");
+}
+
+
+/* ---------------- PUBLIC METHOD: SetCroppedConvolution -------------- */
+/// Turns on (the default) or off cropped PSF convolution, where the model image
+/// only extends half a PSF width past the data image on each side, and only the
+/// data-image part of it is convolved (see Convolver::SetOutputRegion); this is
+/// faster and uses less memory, especially for large PSFs. Without it, the model
+/// image is padded by the full PSF size on each side, and all of it is properly
+/// convolved (e.g., for saving the "expanded" model image).
+/// Must be called *before* SetupModelImage().
+void ModelObject::SetCroppedConvolution( bool cropped )
+{
+  cropConvolution = cropped;
+  if (modelImageSetupDone)
+    fprintf(stderr, "** WARNING: ModelObject::SetCroppedConvolution called after SetupModelImage()!\n");
+}
+
+
+/* ---------------- PUBLIC METHOD: SetFFTTileSize --------------------- */
+/// Specifies that the main model image is convolved with the PSF in tiles, using
+/// FFTs of (about) tileSize x tileSize pixels (see Convolver::SetTileSize), so
+/// that the memory needed for the FFTs doesn't grow with the image size. (Any
+/// oversampled regions are convolved as usual.) tileSize <= 0 turns this off.
+/// Must be called *before* SetupModelImage().
+void ModelObject::SetFFTTileSize( int tileSize )
+{
+  fftTileSize = (tileSize > 0) ? tileSize : 0;
+  if (modelImageSetupDone)
+    fprintf(stderr, "** WARNING: ModelObject::SetFFTTileSize called after SetupModelImage()!\n");
+}
+
+
+/* ---------------- PUBLIC METHOD: SetSeparablePSFTolerance ----------- */
+/// Allows the PSF (and any oversampled PSFs) to be replaced by the lowest-rank
+/// sum of separable kernels which matches it with a relative RMS error <= tolerance,
+/// if convolving with that is estimated to be faster (see Convolver::SetupPSF).
+/// Must be called *before* AddPSFVector() and AddOversampledPsfInfo().
+void ModelObject::SetSeparablePSFTolerance( double tolerance )
+{
+  separablePSFTolerance = tolerance;
+  if (doConvolution)
+    fprintf(stderr, "** WARNING: ModelObject::SetSeparablePSFTolerance called after AddPSFVector()!\n");
+}
+
+
 /* ---------------- PUBLIC METHOD: AddFunction ------------------------- */
 /// Adds a FunctionObject subclass to the model
 int ModelObject::AddFunction( FunctionObject *newFunctionObj_ptr )
 {
   int  nNewParams, result;
   
+  // any existing component-image cache (or per-region function lists) no longer
+  // matches the set of functions
+  FreeComponentCache();
+  FreeRegionFunctions();
+  if (useProfileTables)
+    newFunctionObj_ptr->SetProfileTabulation(true);
+  if (useAdaptiveSubsampling)
+    newFunctionObj_ptr->SetAdaptiveSubsampling(true);
   functionObjects.push_back(newFunctionObj_ptr);
   nFunctions += 1;
   nNewParams = newFunctionObj_ptr->GetNParams();
   paramSizes.push_back(nNewParams);
   nFunctionParams += nNewParams;
+  PartitionFunctions();
   
   // handle optional case of PointSource function
   if (newFunctionObj_ptr->IsPointSource()) {
@@ -292,6 +452,23 @@ int ModelObject::AddFunction( FunctionObject *newFunctionObj_ptr )
 }
 
 
+/* ---------------- PROTECTED METHOD: PartitionFunctions --------------- */
+/// Sorts the function objects into PointSource functions (which are added to
+/// the model image after PSF convolution; see AddPointSourceImages) and all
+/// the others (computed tile by tile; see image_tiles.cpp).
+void ModelObject::PartitionFunctions( )
+{
+  extendedFunctions.clear();
+  pointSourceIndices.clear();
+  for (int n = 0; n < nFunctions; n++) {
+    if (functionObjects[n]->IsPointSource())
+      pointSourceIndices.push_back(n);
+    else
+      extendedFunctions.push_back(functionObjects[n]);
+  }
+}
+
+
 /* ---------------- PUBLIC METHOD: SetupPsfInterpolation -------------- */
 /// Specify that PSF interpolation (by PointSource functions) will be used;
 /// causes an internal PsfInterpolator object of the appropriate subclass
@@ -320,11 +497,20 @@ int ModelObject::SetupPsfInterpolation( int interpolationType )
       }
       break;
     case kInterpolator_lanczos2:
-      printf("ERROR: Lanczos2 interpolation not yet implemented!\n");
-      return -2;
     case kInterpolator_lanczos3:
-      printf("ERROR: Lanczos3 interpolation not yet implemented!\n");
-      return -2;
+      if ((nPSFColumns >= 2) && (nPSFRows >= 2)) {
+        if (interpolationType == kInterpolator_lanczos2)
+          psfInterpolator = new PsfInterpolator_lanczos2(localPsfPixels, nPSFColumns, nPSFRows);
+        else
+          psfInterpolator = new PsfInterpolator_lanczos3(localPsfPixels, nPSFColumns, nPSFRows);
+        psfInterpolator_allocated = true;
+      }
+      else {
+        fprintf(stderr, "** ERROR: PSF image is too small for interpolation with PointSource functions!\n");
+        fprintf(stderr, "   (must be at least 2 x 2 pixels in size for Lanczos interpolation)\n");
+        return -2;
+      }
+      break;
   }
   
   return 0;
@@ -447,26 +633,60 @@ int ModelObject::SetupModelImage( int nImageColumns, int nImageRows )
   nDataVals = (long)nImageColumns * (long)nImageRows;
   
   if (doConvolution) {
-    nModelColumns = nDataColumns + 2*nPSFColumns;
-    nModelRows = nDataRows + 2*nPSFRows;
+    // The model image must include every pixel which contributes to the convolved
+    // data-image pixels, i.e., it must extend past the data image by half the PSF
+    // size; with cropped convolution (the default), this is all the padding, and
+    // only the data-image part of the model image is convolved. Otherwise, the
+    // padding is the full PSF size and the whole model image is convolved.
+    if (cropConvolution) {
+      nPaddingColumns = nPSFColumns / 2;
+      nPaddingRows = nPSFRows / 2;
+    } else {
+      nPaddingColumns = nPSFColumns;
+      nPaddingRows = nPSFRows;
+    }
+    nModelColumns = nDataColumns + 2*nPaddingColumns;
+    nModelRows = nDataRows + 2*nPaddingRows;
     psfConvolver->SetupImage(nModelColumns, nModelRows);
+    if (cropConvolution)
+      psfConvolver->SetOutputRegion(nPaddingColumns, nPaddingRows, nDataColumns, nDataRows);
+    if ((useSinglePrecision) && (psfConvolver->UseSinglePrecision() < 0)) {
+      fprintf(stderr, "** WARNING: single-precision FFTW not available; model images will be\n");
+      fprintf(stderr, "   computed in double precision.\n");
+      useSinglePrecision = false;
+    }
+    if (fftwWisdomFile.size() > 0)
+      psfConvolver->SetFFTWWisdomFile(fftwWisdomFile);
+    psfConvolver->SetConvolutionMethod(convolutionMethod);
+    if (fftTileSize > 0)
+      psfConvolver->SetTileSize(fftTileSize);
     result = psfConvolver->DoFullSetup(debugLevel);
     if (result < 0) {
       fprintf(stderr, "*** Error returned from Convolver::DoFullSetup!\n");
       return result;
     }
+    // changed component images are convolved in batches (this has no effect
+    // unless we're doing FFT convolution of the whole image)
+    if (useComponentCache)
+      psfConvolver->SetupBatchConvolution(NComponentBatchImages());
     nModelVals = (long)nModelColumns * (long)nModelRows;
   }
   else {
+    nPaddingColumns = nPaddingRows = 0;
     nModelColumns = nDataColumns;
     nModelRows = nDataRows;
     nModelVals = nDataVals;
   }
-  // Allocate modelimage vector
-  // WARNING: Possible memory leak (if this function is called more than once)!
-  //    If this function *is* called again, then nModelVals could be different
-  //    from the first call, in wich case we'd need to realloc modelVector
-  modelVector = (double *) calloc((size_t)nModelVals, sizeof(double));
+  FreeComponentCache();   // will be re-allocated (with new size) when needed
+  // Allocate modelimage vector (if this function is called more than once,
+  // nModelVals could be different from the first call, so we start over)
+  if (modelVectorAllocated)
+    arena.Free(modelVector);
+  if (modelVector_spAllocated) {
+    arena.Free(modelVector_sp);
+    modelVector_spAllocated = false;
+  }
+  modelVector = arena.AllocateArray<double>((size_t)nModelVals);
   if (modelVector == NULL) {
     fprintf(stderr, "*** ERROR: Unable to allocate memory for model image!\n");
     fprintf(stderr, "    (Requested image size was %d x %d = %ld pixels)\n", nModelRows,
@@ -474,6 +694,31 @@ int ModelObject::SetupModelImage( int nImageColumns, int nImageRows )
     return -1;
   }
   modelVectorAllocated = true;
+  // Single-precision version of the model image (modelVector is then used for
+  // output, and for the component-cache and oversampled-region cases)
+  if (useSinglePrecision) {
+    modelVector_sp = arena.AllocateArray<float>((size_t)nModelVals);
+    if (modelVector_sp == NULL) {
+      fprintf(stderr, "*** ERROR: Unable to allocate memory for model image!\n");
+      fprintf(stderr, "    (Requested image size was %d x %d = %ld pixels)\n", nModelRows,
+      		nModelColumns, nModelVals);
+      return -1;
+    }
+    modelVector_spAllocated = true;
+    if (useComponentCache)
+      fprintf(stderr, "** WARNING: component cache is not supported for single-precision model images\n   (model images will be computed in double precision).\n");
+  }
+
+  // Pixel coordinates and tiles for computing the model image
+  modelXVals.resize(nModelColumns);
+  modelYVals.resize(nModelRows);
+  for (int j = 0; j < nModelColumns; j++)
+    modelXVals[j] = (double)(j - nPaddingColumns + 1);    // Iraf counting: first column = 1
+                                                      // (note that nPaddingColumns = 0 if not doing PSF convolution)
+  for (int i = 0; i < nModelRows; i++)
+    modelYVals[i] = (double)(i - nPaddingRows + 1);       // Iraf counting: first row = 1
+  MakeImageTiles(nModelColumns, nModelRows, modelTiles);
+
   modelImageSetupDone = true;
   return 0;
 }
@@ -533,10 +778,11 @@ void ModelObject::AddErrorVector( long nDataValues, int nImageColumns,
   
   // Avoid memory leak if pre-existing weight vector was internally allocated
   if (weightVectorAllocated) {
-    free(weightVector);
+    arena.Free(weightVector);
     weightVectorAllocated = false;
   }
   weightVector = pixelVector;
+  weightVectorIsStandard = false;
   
   weightValsSet = true;
   externalErrorVectorSupplied = true;
@@ -599,7 +845,7 @@ int ModelObject::GenerateErrorVector( )
   // WARNING: If we are calling this function for a second or subsequent time,
   // nDataVals *might* have changed; we are currently assuming it hasn't!
   if (! weightVectorAllocated) {
-    weightVector = (double *) calloc((size_t)nDataVals, sizeof(double));
+    weightVector = arena.AllocateArray<double>((size_t)nDataVals);
     if (weightVector == NULL) {
       fprintf(stderr, "*** ERROR: Unable to allocate memory for weight image!\n");
       fprintf(stderr, "    (Requested image size was %ld pixels)\n", nDataVals);
@@ -620,6 +866,7 @@ int ModelObject::GenerateErrorVector( )
     weightVector[z] = 1.0 / sqrt(noise_squared);
   }
 
+  weightVectorIsStandard = false;
   weightValsSet = true;
   return 0;
 }
@@ -664,8 +911,10 @@ void ModelObject::GenerateExtraCashTerms( )
 /* ---------------- PUBLIC METHOD: AddMaskVector ----------------------- */
 // Code for adding and processing a vector containing the 2D mask image.
 // Note that although our default *input* format is "0 = good pixel, > 0 =
-// bad pixel", internally we convert all bad pixels to 0 and all good pixels
-// to 1, so that we can multiply the weight vector by the (internal) mask values.
+// bad pixel", internally we store the mask as one byte per pixel, with all bad
+// pixels = 0 and all good pixels = 1, so that we can multiply the weight vector
+// by the (internal) mask values. The input vector is not modified, and can be
+// freed once this method returns.
 // The mask is applied to the weight vector by calling the ApplyMask() method
 // for a given ModelObject instance.
 //
@@ -679,7 +928,10 @@ int ModelObject::AddMaskVector( long nDataValues, int nImageColumns,
   assert( (nDataValues == nDataVals) && (nImageColumns == nDataColumns) && 
           (nImageRows == nDataRows) );
 
-  maskVector = pixelVector;
+  if ((inputType == MASK_ZERO_IS_GOOD) || (inputType == MASK_ZERO_IS_BAD)) {
+    if (AllocateMaskVector() < 0)
+      return -1;
+  }
   nValidDataVals = 0;   // Since there's a mask, not all pixels from the original
                         // image will be valid
     
@@ -693,10 +945,10 @@ int ModelObject::AddMaskVector( long nDataValues, int nImageColumns,
         printf("ModelObject::AddMaskVector -- treating zero-valued pixels as good ...\n");
       for (z = 0; z < nDataVals; z++) {
         // Values of NaN or -infinity will fail > 0 test, but we want them masked, too
-        if ( (! isfinite(maskVector[z])) || (maskVector[z] > 0.0) )
-          maskVector[z] = 0.0;
+        if ( (! isfinite(pixelVector[z])) || (pixelVector[z] > 0.0) )
+          maskVector[z] = 0;
         else {
-          maskVector[z] = 1.0;
+          maskVector[z] = 1;
           nValidDataVals++;
         }
       }
@@ -708,10 +960,10 @@ int ModelObject::AddMaskVector( long nDataValues, int nImageColumns,
         printf("ModelObject::AddMaskVector -- treating zero-valued pixels as bad ...\n");
       for (z = 0; z < nDataVals; z++) {
         // Values of NaN or +infinity will fail < 1 test, but we want them masked, too
-        if ( (! isfinite(maskVector[z])) || (maskVector[z] < 1.0) )
-          maskVector[z] = 0.0;
+        if ( (! isfinite(pixelVector[z])) || (pixelVector[z] < 1.0) )
+          maskVector[z] = 0;
         else {
-          maskVector[z] = 1.0;
+          maskVector[z] = 1;
           nValidDataVals++;
         }
       }
@@ -740,7 +992,7 @@ void ModelObject::ApplyMask( )
       newVal = maskVector[z] * weightVector[z];
       // check to make sure that masked non-finite values (e.g. NaN) get zeroed
       // (because if weightVector[z] = NaN, then product will automatically be NaN)
-      if ( (! isfinite(newVal)) && (maskVector[z] == 0.0) )
+      if ( (! isfinite(newVal)) && (maskVector[z] == 0) )
         newVal = 0.0;
       weightVector[z] = newVal;
     }
@@ -772,11 +1024,11 @@ int ModelObject::AddPSFVector( long nPixels_psf, int nColumns_psf, int nRows_psf
   assert( (nPixels_psf >= 1) && (nColumns_psf >= 1) && (nRows_psf >= 1) );
 
   // store PSF pixels locally (and check for bad pixel values)
-  localPsfPixels = (double *) calloc((size_t)nPixels_psf, sizeof(double));
+  localPsfPixels = arena.AllocateArray<double>((size_t)nPixels_psf);
   for (long i = 0; i < nPixels_psf; i++) {
     if (! isfinite(psfPixels[i])) {
       fprintf(stderr, "** ERROR: PSF image has one or more non-finite values!\n");
-      free(localPsfPixels);
+      arena.Free(localPsfPixels);
       localPsfPixels_allocated = false;
       return -1;
     }
@@ -790,7 +1042,9 @@ int ModelObject::AddPSFVector( long nPixels_psf, int nColumns_psf, int nRows_psf
   nPSFColumns = nColumns_psf;
   nPSFRows = nRows_psf;
   psfConvolver = new Convolver();
-  psfConvolver->SetupPSF(psfPixels, nColumns_psf, nRows_psf, normalizePSF);
+  psfConvolver->SetArena(&arena);
+  psfConvolver->SetupPSF(psfPixels, nColumns_psf, nRows_psf, normalizePSF,
+  						separablePSFTolerance);
   psfConvolver->SetMaxThreads(maxRequestedThreads);
   doConvolution = true;
   
@@ -851,20 +1105,26 @@ int ModelObject::AddOversampledPSFVector( long nPixels, int nColumns_psf,
   // oversampled PSF and corresponding Convolver object
   nPSFColumns_osamp = nColumns_psf;
   nPSFRows_osamp = nRows_psf;
+  if ((useSinglePrecision) && (! oversampledRegionsExist))
+    fprintf(stderr, "** WARNING: oversampled PSF regions are not supported for single-precision model images\n   (model images will be computed in double precision).\n");
   oversampledRegionsExist = true;
 
   // Size of actual oversampled model sub-image (including padding for PSF conv.)
-  nOversampledModelColumns = nCols_osamp + 2*nPSFColumns_osamp;
-  nOversampledModelRows = nRows_osamp + 2*nPSFRows_osamp;
+  nOversampledModelColumns = nCols_osamp + 2*(nPSFColumns_osamp/2);
+  nOversampledModelRows = nRows_osamp + 2*(nPSFRows_osamp/2);
   nOversampledModelVals = (long)nOversampledModelColumns * (long)nOversampledModelRows;
 
   // Allocate OversampledRegion object and give it necessary info
   OversampledRegion *oversampledRegion = new OversampledRegion();
+  oversampledRegion->SetArena(&arena);
   oversampledRegion->SetDebugLevel(debugLevel);
+  oversampledRegion->SetFFTWWisdomFile(fftwWisdomFile);
+  oversampledRegion->SetConvolutionMethod(convolutionMethod);
+  oversampledRegion->SetSeparablePSFTolerance(separablePSFTolerance);
   oversampledRegion->AddPSFVector(psfPixels_osamp, nPSFColumns_osamp, nPSFRows_osamp,
   									normalizePSF);
   status = oversampledRegion->SetupModelImage(x1, y1, deltaX, deltaY, nModelColumns, nModelRows, 
-  									nPSFColumns, nPSFRows, oversampleScale);
+  									nPaddingColumns, nPaddingRows, oversampleScale);
   if (status < 0) {
     fprintf(stderr, "*** ERROR: AddOversampledPSFVector: Call to oversampledRegion->SetupModelImage failed!n");
     return -1;
@@ -927,20 +1187,26 @@ int ModelObject::AddOversampledPsfInfo( PsfOversamplingInfo *oversampledPsfInfo
   // oversampled PSF and corresponding Convolver object
   nPSFColumns_osamp = nColumns_psf;
   nPSFRows_osamp = nRows_psf;
+  if ((useSinglePrecision) && (! oversampledRegionsExist))
+    fprintf(stderr, "** WARNING: oversampled PSF regions are not supported for single-precision model images\n   (model images will be computed in double precision).\n");
   oversampledRegionsExist = true;
 
   // Size of actual oversampled model sub-image (including padding for PSF conv.)
-  nOversampledModelColumns = nCols_osamp + 2*nPSFColumns_osamp;
-  nOversampledModelRows = nRows_osamp + 2*nPSFRows_osamp;
+  nOversampledModelColumns = nCols_osamp + 2*(nPSFColumns_osamp/2);
+  nOversampledModelRows = nRows_osamp + 2*(nPSFRows_osamp/2);
   nOversampledModelVals = (long)nOversampledModelColumns * (long)nOversampledModelRows;
 
   // Allocate OversampledRegion object and give it necessary info
   OversampledRegion *oversampledRegion = new OversampledRegion();
+  oversampledRegion->SetArena(&arena);
   oversampledRegion->SetDebugLevel(debugLevel);
+  oversampledRegion->SetFFTWWisdomFile(fftwWisdomFile);
+  oversampledRegion->SetConvolutionMethod(convolutionMethod);
+  oversampledRegion->SetSeparablePSFTolerance(separablePSFTolerance);
   oversampledRegion->AddPSFVector(psfPixels_osamp, nPSFColumns_osamp, nPSFRows_osamp,
   									oversampledPsfInfo->GetNormalizationFlag());
   status = oversampledRegion->SetupModelImage(x1, y1, deltaX, deltaY, nModelColumns, nModelRows, 
-  									nPSFColumns, nPSFRows, oversampleScale);
+  									nPaddingColumns, nPaddingRows, oversampleScale);
   if (status < 0) {
     fprintf(stderr, "*** ERROR: AddOversampledPSFVector: Call to oversampledRegion->SetupModelImage failed!n");
     return -1;
@@ -974,26 +1240,21 @@ int ModelObject::FinalSetupForFitting( )
   
   // Create a default all-pixels-valid mask if no mask already exists
   if (! maskExists) {
-    maskVector = (double *) calloc((size_t)nDataVals, sizeof(double));
-    if (maskVector == NULL) {
-      fprintf(stderr, "*** ERROR: Unable to allocate memory for mask image!\n");
-      fprintf(stderr, "    (Requested vector size was %ld pixels)\n", nDataVals);
-      // go ahead and return now, otherwise we'll be trying to access a null
-      // pointer in the very next step
+    // go ahead and return now if allocation fails, otherwise we'll be trying to
+    // access a null pointer in the very next step
+    if (AllocateMaskVector() < 0)
       return -1;
-    }
     for (z = 0; z < nDataVals; z++) {
-      maskVector[z] = 1.0;
+      maskVector[z] = 1;
     }
-    maskVectorAllocated = true;
     maskExists = true;
   }
 
   // Identify currently unmasked data pixels which have non-finite values and 
   // add those pixels to the mask
   for (z = 0; z < nDataVals; z++) {
-    if ( (maskVector[z] > 0.0) && (! isfinite(dataVector[z])) ) {
-      maskVector[z] = 0.0;
+    if ( (maskVector[z] > 0) && (! isfinite(dataVector[z])) ) {
+      maskVector[z] = 0;
       nNonFinitePixels++;
       nValidDataVals--;
     }
@@ -1027,8 +1288,8 @@ int ModelObject::FinalSetupForFitting( )
   // Check only pixels which are still unmasked
   if (externalErrorVectorSupplied) {
     for (z = 0; z < nDataVals; z++) {
-      if ( (maskVector[z] > 0.0) && (! isfinite(weightVector[z])) ) {
-        maskVector[z] = 0.0;
+      if ( (maskVector[z] > 0) && (! isfinite(weightVector[z])) ) {
+        maskVector[z] = 0;
         weightVector[z] = 0.0;
         nNonFiniteErrorPixels++;
         nValidDataVals--;
@@ -1070,6 +1331,10 @@ int ModelObject::FinalSetupForFitting( )
   PrintWeights();
 #endif
 
+  // Identify runs of unmasked pixels, so we can skip computing the model for
+  // masked pixels
+  BuildActivePixelSpans();
+
   if (nValidDataVals < 1) {
     fprintf(stderr, "** ModelObject::FinalSetup -- not enough valid data values available for fitting!\n\n");
     returnStatus = -3;
@@ -1080,12 +1345,228 @@ int ModelObject::FinalSetupForFitting( )
 
 
 
+/* ---------------- PUBLIC METHOD: Clone ------------------------------- */
+/// Returns a new ModelObject which computes the same model images and fit
+/// statistics as this one, and which can be used at the same time (e.g., by a
+/// different thread running a separate fit). Everything which is modified when
+/// a model is computed -- the FunctionObjects, model image, Convolver work
+/// arrays, and OversampledRegion objects -- is copied; the data, weight, and
+/// mask vectors, PSF pixels, PSF Fourier transform(s), and PsfInterpolator are
+/// shared (read-only) with this object, which must not be deleted or set up
+/// further while its clones exist.
+/// This should be called after FinalSetupForFitting (or SetupModelImage, in
+/// make-image mode). Returns NULL if the model can't be cloned (1D models, 
+/// models not yet set up, or functions which don't support copying).
+/// Notes: with model-based errors (UseModelErrors), each clone gets its own copy
+/// of the weight vector, since the weights are recomputed with each model.
+/// MakeBootstrapSample uses a global random-number generator, and so should
+/// not be called for different clones at the same time.
+ModelObject * ModelObject::Clone( )
+{
+  ModelObject  *theClone;
+  FunctionObject  *newFunctionObj;
+  OversampledRegion  *newRegion;
+  
+  if (Dimensionality() != 2) {
+    fprintf(stderr, "*** ERROR: ModelObject::Clone can only be used with 2D models!\n");
+    return NULL;
+  }
+  if (! modelImageSetupDone) {
+    fprintf(stderr, "*** ERROR: ModelObject::Clone called before SetupModelImage!\n");
+    return NULL;
+  }
+  // weights must be in internal (1/sigma) form for sharing
+  if ((weightValsSet) && (weightVectorIsStandard))
+    RestoreInternalWeights();
+
+  theClone = new ModelObject();
+
+  // function objects
+  for (int n = 0; n < nFunctions; n++) {
+    newFunctionObj = functionObjects[n]->Clone();
+    if (newFunctionObj == NULL) {
+      fprintf(stderr, "*** ERROR: ModelObject::Clone -- unable to copy %s function!\n",
+      			functionObjects[n]->GetShortName().c_str());
+      delete theClone;
+      return NULL;
+    }
+    theClone->functionObjects.push_back(newFunctionObj);
+    theClone->nFunctions++;
+  }
+  theClone->PartitionFunctions();
+  theClone->paramSizes = paramSizes;
+  theClone->nFunctionBlocks = nFunctionBlocks;
+  theClone->nFunctionParams = nFunctionParams;
+  theClone->nParamsTot = nParamsTot;
+  if (fblockStartFlags_allocated) {
+    theClone->fblockStartFlags = (bool *)calloc(nFunctions, sizeof(bool));
+    theClone->fblockStartFlags_allocated = true;
+    for (int n = 0; n < nFunctions; n++)
+      theClone->fblockStartFlags[n] = fblockStartFlags[n];
+  }
+  theClone->parameterLabels = parameterLabels;
+  theClone->parameterInfoVect = parameterInfoVect;
+  theClone->pointSourcesPresent = pointSourcesPresent;
+
+  // general settings
+  theClone->imageOffset_X0 = imageOffset_X0;
+  theClone->imageOffset_Y0 = imageOffset_Y0;
+  theClone->debugLevel = debugLevel;
+  theClone->verboseLevel = verboseLevel;
+  theClone->maxRequestedThreads = maxRequestedThreads;
+  theClone->ompChunkSize = ompChunkSize;
+  theClone->zeroPoint = zeroPoint;
+  theClone->zeroPointSet = zeroPointSet;
+  theClone->gain = gain;
+  theClone->readNoise = readNoise;
+  theClone->exposureTime = exposureTime;
+  theClone->originalSky = originalSky;
+  theClone->effectiveGain = effectiveGain;
+  theClone->readNoise_adu_squared = readNoise_adu_squared;
+  theClone->nCombined = nCombined;
+  theClone->useProfileTables = useProfileTables;
+  theClone->useAdaptiveSubsampling = useAdaptiveSubsampling;
+  theClone->useComponentCache = useComponentCache;   // cache is allocated when needed
+  theClone->useSinglePrecision = useSinglePrecision;
+  theClone->fftwWisdomFile = fftwWisdomFile;
+  theClone->convolutionMethod = convolutionMethod;
+  theClone->separablePSFTolerance = separablePSFTolerance;
+
+  // data (shared)
+  theClone->dataVector = dataVector;
+  theClone->dataValsSet = dataValsSet;
+  theClone->nDataVals = nDataVals;
+  theClone->nValidDataVals = nValidDataVals;
+  theClone->nDataColumns = nDataColumns;
+  theClone->nDataRows = nDataRows;
+
+  // model image (copied)
+  theClone->nModelColumns = nModelColumns;
+  theClone->nModelRows = nModelRows;
+  theClone->nModelVals = nModelVals;
+  theClone->nPSFColumns = nPSFColumns;
+  theClone->nPSFRows = nPSFRows;
+  theClone->nPaddingColumns = nPaddingColumns;
+  theClone->nPaddingRows = nPaddingRows;
+  theClone->cropConvolution = cropConvolution;
+  theClone->fftTileSize = fftTileSize;
+  theClone->modelXVals = modelXVals;
+  theClone->modelYVals = modelYVals;
+  theClone->modelTiles = modelTiles;
+  theClone->modelTileOrder = modelTileOrder;
+  theClone->modelVector = theClone->arena.AllocateArray<double>((size_t)nModelVals);
+  if (theClone->modelVector == NULL) {
+    fprintf(stderr, "*** ERROR: Unable to allocate memory for model image!\n");
+    fprintf(stderr, "    (Requested image size was %d x %d = %ld pixels)\n", nModelRows,
+    		nModelColumns, nModelVals);
+    delete theClone;
+    return NULL;
+  }
+  theClone->modelVectorAllocated = true;
+  if (modelVector_spAllocated) {
+    theClone->modelVector_sp = theClone->arena.AllocateArray<float>((size_t)nModelVals);
+    if (theClone->modelVector_sp == NULL) {
+      fprintf(stderr, "*** ERROR: Unable to allocate memory for model image!\n");
+      fprintf(stderr, "    (Requested image size was %d x %d = %ld pixels)\n", nModelRows,
+      		nModelColumns, nModelVals);
+      delete theClone;
+      return NULL;
+    }
+    theClone->modelVector_spAllocated = true;
+  }
+  theClone->modelImageSetupDone = true;
+
+  // PSF convolution (Convolver work arrays copied, PSF FFT shared)
+  if (doConvolution) {
+    theClone->psfConvolver = psfConvolver->Clone(&theClone->arena);
+    if (theClone->psfConvolver == NULL) {
+      delete theClone;
+      return NULL;
+    }
+    theClone->doConvolution = true;
+    if (useComponentCache)
+      theClone->psfConvolver->SetupBatchConvolution(NComponentBatchImages());
+  }
+  theClone->localPsfPixels = localPsfPixels;
+  theClone->localPsfPixels_allocated = localPsfPixels_allocated;
+  theClone->psfInterpolator = psfInterpolator;   // so psfInterpolator_allocated = false
+  
+  // oversampled regions (copied, with shared oversampled-PSF FFTs)
+  theClone->nPSFColumns_osamp = nPSFColumns_osamp;
+  theClone->nPSFRows_osamp = nPSFRows_osamp;
+  theClone->nOversampledModelColumns = nOversampledModelColumns;
+  theClone->nOversampledModelRows = nOversampledModelRows;
+  theClone->nOversampledModelVals = nOversampledModelVals;
+  for (int i = 0; i < nOversampledRegions; i++) {
+    newRegion = oversampledRegionsVect[i]->Clone(&theClone->arena);
+    if (newRegion == NULL) {
+      delete theClone;
+      return NULL;
+    }
+    theClone->oversampledRegionsVect.push_back(newRegion);
+    theClone->nOversampledRegions++;
+    theClone->oversampledRegionsExist = true;
+  }
+
+  // weights, mask, and fit-statistic setup (shared, except for model-based weights)
+  theClone->dataErrors = dataErrors;
+  theClone->modelErrors = modelErrors;
+  theClone->externalErrorVectorSupplied = externalErrorVectorSupplied;
+  theClone->useCashStatistic = useCashStatistic;
+  theClone->poissonMLR = poissonMLR;
+  theClone->weightValsSet = weightValsSet;
+  theClone->maskExists = maskExists;
+  theClone->maskVector = maskVector;
+  theClone->maskVectorAllocated = maskVectorAllocated;
+  theClone->extraCashTermsVector = extraCashTermsVector;
+  theClone->extraCashTermsVectorAllocated = extraCashTermsVectorAllocated;
+  if ((weightVectorAllocated) && (modelErrors)) {
+    theClone->weightVector = theClone->arena.AllocateArray<double>((size_t)nDataVals);
+    if (theClone->weightVector == NULL) {
+      fprintf(stderr, "*** ERROR: Unable to allocate memory for weight vector!\n");
+      fprintf(stderr, "    (Requested image size was %ld pixels)\n", nDataVals);
+      delete theClone;
+      return NULL;
+    }
+    memcpy(theClone->weightVector, weightVector, (size_t)nDataVals*sizeof(double));
+    theClone->weightVectorAllocated = true;
+  }
+  else if (weightVectorAllocated) {
+    theClone->weightVector = weightVector;
+    theClone->weightVectorAllocated = true;
+    theClone->weightVectorShared = true;
+    weightVectorShared = true;
+  }
+  theClone->useActivePixelSpans = useActivePixelSpans;
+  theClone->activeSpanRowIndex = activeSpanRowIndex;
+  theClone->activeSpanStartCols = activeSpanStartCols;
+  theClone->activeSpanEndCols = activeSpanEndCols;
+
+  // bootstrap resampling (clone starts with the current sample)
+  theClone->doBootstrap = doBootstrap;
+  if (bootstrapIndicesAllocated) {
+    theClone->bootstrapIndices = (long *) calloc((size_t)nValidDataVals, sizeof(long));
+    if (theClone->bootstrapIndices == NULL) {
+      fprintf(stderr, "*** ERROR: Unable to allocate memory for bootstrap-resampling pixel indices!\n");
+      fprintf(stderr, "    (Requested vector size was %ld pixels)\n", nValidDataVals);
+      delete theClone;
+      return NULL;
+    }
+    theClone->bootstrapIndicesAllocated = true;
+    for (long i = 0; i < nValidDataVals; i++)
+      theClone->bootstrapIndices[i] = bootstrapIndices[i];
+  }
+  
+  return theClone;
+}
+
+
+
 /* ---------------- PUBLIC METHOD: CreateModelImage -------------------- */
 
 void ModelObject::CreateModelImage( double params[] )
 {
-  double  x0, y0, x, y, newValSum;
-  long  i, j;
+  double  x0, y0;
   int  n;
   int  offset = 0;
   
@@ -1101,6 +1582,14 @@ void ModelObject::CreateModelImage( double params[] )
   }
 
 
+  // Multiple oversampled regions are computed in parallel (with their own copies
+  // of any PointSource functions), if we have more than one thread
+  bool  parallelRegions = false;
+#ifdef USE_OPENMP
+  if ((nOversampledRegions > 1) && (omp_get_max_threads() > 1))
+    parallelRegions = (SetupRegionFunctions() == 0);
+#endif
+
   // 0. Separate out the individual-component parameters and tell the associated
   // function objects to do setup work.
   // The first component's parameters start at params[0]; the second's start at
@@ -1113,103 +1602,85 @@ void ModelObject::CreateModelImage( double params[] )
       offset += 2;
     }
     functionObjects[n]->Setup(params, offset, x0, y0);
+    if (parallelRegions)
+      for (int r = 0; r < nOversampledRegions; r++)
+        if (regionFunctionObjects[r][n] != functionObjects[n])
+          regionFunctionObjects[r][n]->Setup(params, offset, x0, y0);
     offset += paramSizes[n];
   }
   
   
-  // 1. OK, populate modelVector with the model image -- standard pixel scaling
-  double  tempSum, adjVal, storedError;
-  
-// Note that we cannot specify modelVector as shared [or private] bcs it is part
-// of a class (not an independent variable); happily, by default all references in
-// an omp-parallel section are shared unless specified otherwise
-#pragma omp parallel private(i,j,n,x,y,newValSum,tempSum,adjVal,storedError)
-  {
-  #pragma omp for schedule (static, ompChunkSize)
-//   for (i = 0; i < nModelRows; i++) {   // step by row number = y
-//     y = (double)(i - nPSFRows + 1);              // Iraf counting: first row = 1 
-//                                                  // (note that nPSFRows = 0 if not doing PSF convolution)
-//     for (j = 0; j < nModelColumns; j++) {   // step by column number = x
-//       x = (double)(j - nPSFColumns + 1);                 // Iraf counting: first column = 1
-//                                                          // (note that nPSFColumns = 0 if not doing PSF convolution)
-  // single-loop code which is ~ same in general case as double-loop, and
-  // faster for case of small image + many cores (André Luiz de Amorim suggestion)
-  for (long k = 0; k < nModelVals; k++) {
-    j = k % nModelColumns;
-    i = k / nModelColumns;
-    y = (double)(i - nPSFRows + 1);              // Iraf counting: first row = 1
-                                                 // (note that nPSFRows = 0 if not doing PSF convolution)
-    x = (double)(j - nPSFColumns + 1);           // Iraf counting: first column = 1
-                                                 // (note that nPSFColumns = 0 if not doing PSF convolution)
-    newValSum = 0.0;
-    storedError = 0.0;
-    for (n = 0; n < nFunctions; n++) {
-      if (! functionObjects[n]->IsPointSource()) {
-        // Kahan summation algorithm
-        adjVal = functionObjects[n]->GetValue(x, y) - storedError;
-        tempSum = newValSum + adjVal;
-        storedError = (tempSum - newValSum) - adjVal;
-        newValSum = tempSum;
-      }
-    }
-    modelVector[i*nModelColumns + j] = newValSum;
+  // 1--2 [alternate]. Use and update individual-component images, if requested
+  // (if the cache can't be allocated, we fall through to the standard computation)
+  if ((useComponentCache) && (ComputeModelFromComponentCache(params) == 0)) {
+    modelImageIsSinglePrecision = false;   // (AddPointSourceImages checks this)
+    if (pointSourcesPresent)
+      AddPointSourceImages();
+    if (oversampledRegionsExist)
+      ComputeOversampledRegions(parallelRegions);
+    modelImageComputed = true;
+    modelImageIsPartial = false;
+    return;
   }
-  
-  } // end omp parallel section
+
+
+  // 1. OK, populate modelVector with the model image -- standard pixel scaling
+  // The image is divided into cache-sized tiles, which are handed out to threads
+  // most-expensive-first; within each tile, each function's values are obtained
+  // with one ComputeValues() call per row and added to the tile using the Kahan
+  // summation algorithm (see image_tiles.cpp).
+  // If we're skipping masked pixels, ComputeValues() is called once per run of
+  // unmasked pixels, and masked pixels are left = 0
+  // In single-precision mode, the (double-precision) sums are stored in modelVector_sp
+  bool  useSpans = (useActivePixelSpans && (! activePixelSpansSuspended));
+  const long  *spanRowIndex = NULL;
+  const int  *spanStartCols = NULL, *spanEndCols = NULL;
+  if (useSpans) {
+    spanRowIndex = activeSpanRowIndex.data();
+    spanStartCols = activeSpanStartCols.data();
+    spanEndCols = activeSpanEndCols.data();
+  }
+  modelImageIsSinglePrecision = (useSinglePrecision && (! oversampledRegionsExist));
+  int  nExtendedFunctions = (int)extendedFunctions.size();
+  OrderTilesByCost(modelTiles, &modelXVals[0], &modelYVals[0], extendedFunctions, 
+  					nExtendedFunctions, modelTileOrder);
+  if (modelImageIsSinglePrecision)
+    ComputeTiledImage(modelVector_sp, nModelColumns, modelTiles, modelTileOrder, &modelXVals[0],
+    				&modelYVals[0], extendedFunctions, nExtendedFunctions, spanRowIndex, 
+    				spanStartCols, spanEndCols);
+  else
+    ComputeTiledImage(modelVector, nModelColumns, modelTiles, modelTileOrder, &modelXVals[0],
+    				&modelYVals[0], extendedFunctions, nExtendedFunctions, spanRowIndex, 
+    				spanStartCols, spanEndCols);
   
   
   // 2. Do PSF convolution (using standard pixel scale), if requested
-  if (doConvolution)
-    psfConvolver->ConvolveImage(modelVector);
+  if (doConvolution) {
+    if (modelImageIsSinglePrecision)
+      psfConvolver->ConvolveImage(modelVector_sp);
+    else
+      psfConvolver->ConvolveImage(modelVector);
+  }
   
   
   // 2.B Add flux from PointSource functions, if present 
   // (must be done *after* PSF convolution!)
-  if (pointSourcesPresent) {
-    // Re-assign psfInterpolator object (bcs. calls made to
-    // OversampledRegion::ComputeRegionAndDownsample result
-    // in PointSource objects getting assigned alternate psfInterpolators),
-    // so we have to reset PointSource objects to use the standard-resolution
-    // psfInterpolator object held by ModelObject
-    for (n = 0; n < nFunctions; n++)
-      if (functionObjects[n]->IsPointSource())
-        functionObjects[n]->AddPsfInterpolator(psfInterpolator);
-    
-#pragma omp parallel private(i,j,n,x,y,newValSum,tempSum,adjVal,storedError)
-    {
-    #pragma omp for schedule (static, ompChunkSize)
-    for (long k = 0; k < nModelVals; k++) {
-      j = k % nModelColumns;
-      i = k / nModelColumns;
-      y = (double)(i - nPSFRows + 1);              // Iraf counting: first row = 1
-                                                   // (note that nPSFRows = 0 if not doing PSF convolution)
-      x = (double)(j - nPSFColumns + 1);           // Iraf counting: first column = 1
-                                                   // (note that nPSFColumns = 0 if not doing PSF convolution)
-      newValSum = 0.0;
-      storedError = 0.0;
-      for (n = 0; n < nFunctions; n++) {
-        // Use Kahan summation algorithm
-        if (functionObjects[n]->IsPointSource()) {
-          adjVal = functionObjects[n]->GetValue(x, y) - storedError;
-          tempSum = newValSum + adjVal;
-          storedError = (tempSum - newValSum) - adjVal;
-          newValSum = tempSum;
-        }
-      }
-      modelVector[i*nModelColumns + j] += newValSum;
-    }
-    } // end omp parallel section
-  }
+  if (pointSourcesPresent)
+    AddPointSourceImages();
   
   
   // 3. Optional generation of oversampled sub-image and convolution with oversampled PSF
   if (oversampledRegionsExist)
-    for (n = 0; n < nOversampledRegions; n++)
-      oversampledRegionsVect[n]->ComputeRegionAndDownsample(modelVector, functionObjects, nFunctions);
+    ComputeOversampledRegions(parallelRegions);
   
   // [4. Possible location for charge-diffusion and other post-pixelization processing]
   
   modelImageComputed = true;
+  // Remember the parameters, so that CompleteModelImage() can fill in masked pixels
+  // if the full image is needed later
+  modelImageIsPartial = useSpans;
+  if (useSpans)
+    partialModelParams.assign(params, params + nParamsTot);
 }
 
 
@@ -1224,10 +1695,10 @@ void ModelObject::CreateModelImage( double params[] )
 // unless you are aware that it will NOT return the full (expanded) model image.
 double * ModelObject::GetSingleFunctionImage( double params[], int functionIndex )
 {
-  double  x0, y0, x, y, newVal;
+  double  x0, y0;
   int  offset = 0;
   int  iDataRow, iDataCol;
-  long  i, j, z, zModel;
+  long  z, zModel;
   vector<FunctionObject *> singleFuncObjVector;
   
   assert( (functionIndex >= 0) );
@@ -1265,22 +1736,10 @@ double * ModelObject::GetSingleFunctionImage( double params[], int functionIndex
     functionObjects[functionIndex]->AddPsfInterpolator(psfInterpolator);
 
   // 1. OK, populate modelVector with the model image -- standard pixel scaling
-  // OpenMP Parallel section; see CreateModelImage() for general notes on this
-  // Note that since we expect this code to be called only occasionally, we have
-  // not converted it to the fast-for-small-images, single-loop version used in
-  // CreateModelImages()
-#pragma omp parallel private(i,j,x,y,newVal)
-  {
-  #pragma omp for schedule (static, ompChunkSize)
-  for (i = 0; i < nModelRows; i++) {   // step by row number = y
-    y = (double)(i - nPSFRows + 1);              // Iraf counting: first row = 1
-    for (j = 0; j < nModelColumns; j++) {   // step by column number = x
-      x = (double)(j - nPSFColumns + 1);                 // Iraf counting: first column = 1
-      newVal = functionObjects[functionIndex]->GetValue(x, y);
-      modelVector[i*nModelColumns + j] = newVal;
-    }
-  }
-  } // end omp parallel section
+  // (modelVector no longer holds a partial model image, since all pixels are computed)
+  ComputeFunctionImage(functionIndex, modelVector);
+  modelImageIsPartial = false;
+  modelImageIsSinglePrecision = false;
   
   // 2. Do PSF convolution, if requested and if this is *not* a PointSource function
   if ((doConvolution) && (! functionObjects[functionIndex]->IsPointSource()))
@@ -1297,7 +1756,7 @@ double * ModelObject::GetSingleFunctionImage( double params[], int functionIndex
   // Return model image (extract correct subimage if PSF convolution was done)
   if (doConvolution) {
     if (! outputModelVectorAllocated) {
-      outputModelVector = (double *) calloc((size_t)nDataVals, sizeof(double));
+      outputModelVector = arena.AllocateArray<double>((size_t)nDataVals);
       if (outputModelVector == NULL) {
         fprintf(stderr, "*** ERROR: Unable to allocate memory for output model image!\n");
         fprintf(stderr, "    (Requested image size was %ld pixels)\n", nDataVals);
@@ -1310,7 +1769,7 @@ double * ModelObject::GetSingleFunctionImage( double params[], int functionIndex
     for (z = 0; z < nDataVals; z++) {
       iDataRow = z / nDataColumns;
       iDataCol = z - (long)iDataRow * (long)nDataColumns;
-      zModel = (long)nModelColumns * (long)(nPSFRows + iDataRow) + nPSFColumns + iDataCol;
+      zModel = (long)nModelColumns * (long)(nPaddingRows + iDataRow) + nPaddingColumns + iDataCol;
       outputModelVector[z] = modelVector[zModel];
     }
     return outputModelVector;
@@ -1327,6 +1786,21 @@ double * ModelObject::GetSingleFunctionImage( double params[], int functionIndex
  * (Pearson's chi^2).
  */
 void ModelObject::UpdateWeightVector(  )
+{
+  if (modelImageIsSinglePrecision)
+    UpdateWeightVectorFromModel(modelVector_sp);
+  else
+    UpdateWeightVectorFromModel(modelVector);
+  // masked pixels have weight = 0 in either form, so all weights are now 1/sigma
+  weightVectorIsStandard = false;
+}
+
+
+/* ---------------- PROTECTED METHOD: UpdateWeightVectorFromModel ----- */
+/// Does the actual work for UpdateWeightVector, using model (= modelVector or
+/// modelVector_sp)
+template <typename T>
+void ModelObject::UpdateWeightVectorFromModel( const T *model )
 {
   int  iDataRow, iDataCol;
   long  z, zModel;
@@ -1340,8 +1814,8 @@ void ModelObject::UpdateWeightVector(  )
         // might be zero for an unmasked pixel)
         iDataRow = z / nDataColumns;
         iDataCol = z - (long)iDataRow * (long)nDataColumns;
-        zModel = (long)nModelColumns * (long)(nPSFRows + iDataRow) + nPSFColumns + iDataCol;
-        totalFlux = modelVector[zModel] + originalSky;
+        zModel = (long)nModelColumns * (long)(nPaddingRows + iDataRow) + nPaddingColumns + iDataCol;
+        totalFlux = model[zModel] + originalSky;
         noise_squared = totalFlux/effectiveGain + nCombined*readNoise_adu_squared;
         // POSSIBLE PROBLEM: if originalSky = model flux = read noise = 0, we'll have /0 error!
         weightVector[z] = 1.0 / sqrt(noise_squared);
@@ -1355,7 +1829,7 @@ void ModelObject::UpdateWeightVector(  )
         // only update values that aren't masked out
         // (don't rely on previous weightVector[z] value, since sometimes model flux
         // might be zero for an unmasked pixel)
-        totalFlux = modelVector[z] + originalSky;
+        totalFlux = model[z] + originalSky;
         noise_squared = totalFlux/effectiveGain + nCombined*readNoise_adu_squared;
         // POSSIBLE PROBLEM: if originalSky = model flux = read noise = 0, we'll have /0 error!
         weightVector[z] = 1.0 / sqrt(noise_squared);
@@ -1371,7 +1845,10 @@ double ModelObject::ComputePoissonMLRDeviate( long i, long i_model )
 {
   double   modVal, dataVal, logModel, extraTerms, deviateVal;
   
-  modVal = effectiveGain*(modelVector[i_model] + originalSky);
+  if (modelImageIsSinglePrecision)
+    modVal = effectiveGain*(modelVector_sp[i_model] + originalSky);
+  else
+    modVal = effectiveGain*(modelVector[i_model] + originalSky);
   dataVal = effectiveGain*(dataVector[i] + originalSky);
   if (modVal <= 0)
     logModel = LOG_SMALL_VALUE;
@@ -1396,9 +1873,6 @@ double ModelObject::ComputePoissonMLRDeviate( long i, long i_model )
  */
 void ModelObject::ComputeDeviates( double yResults[], double params[] )
 {
-  int  iDataRow, iDataCol;
-  long  z, zModel, b, bModel;
-  
 #ifdef DEBUG
   printf("ComputeDeviates: Input parameters: ");
   for (int np = 0; np < nParamsTot; np++)
@@ -1409,11 +1883,30 @@ void ModelObject::ComputeDeviates( double yResults[], double params[] )
   CreateModelImage(params);
   if (modelErrors)
     UpdateWeightVector();
+  else if (weightVectorIsStandard)
+    RestoreInternalWeights();
+
+  if (modelImageIsSinglePrecision)
+    ComputeWeightedDeviates(modelVector_sp, yResults, poissonMLR);
+  else
+    ComputeWeightedDeviates(modelVector, yResults, poissonMLR);
+}
+
 
+/* ---------------- PROTECTED METHOD: ComputeWeightedDeviates ---------- */
+/// Does the actual work for ComputeDeviates and ChiSquared: computes the weighted
+/// deviates (or Poisson MLR deviates, if usePoissonMLR = true) from the current
+/// model image (model = modelVector or modelVector_sp) and stores them in deviates.
+template <typename T>
+void ModelObject::ComputeWeightedDeviates( const T *model, double *deviates, 
+											bool usePoissonMLR )
+{
+  int  iDataRow, iDataCol;
+  long  z, zModel, b, bModel, s, zStart, zEnd;
 
-  // In standard case, z = index into dataVector, weightVector, and yResults; it comes 
+  // In standard case, z = index into dataVector, weightVector, and deviates; it comes 
   // from linearly stepping through (0, ..., nDataVals).
-  // In the bootstrap case, z = index into yResults and bootstrapIndices vector;
+  // In the bootstrap case, z = index into deviates and bootstrapIndices vector;
   // b = bootstrapIndices[z] = index into dataVector and weightVector
   
   // NOTE: in the doConvolution case, the algorithm is sufficiently complicated that
@@ -1429,22 +1922,22 @@ void ModelObject::ComputeDeviates( double yResults[], double params[] )
         b = bootstrapIndices[z];
         iDataRow = b / nDataColumns;
         iDataCol = b - (long)iDataRow * (long)nDataColumns;
-        bModel = (long)nModelColumns * (long)(nPSFRows + iDataRow) + nPSFColumns + iDataCol;
-        if (poissonMLR)
-          yResults[z] = ComputePoissonMLRDeviate(b, bModel);
+        bModel = (long)nModelColumns * (long)(nPaddingRows + iDataRow) + nPaddingColumns + iDataCol;
+        if (usePoissonMLR)
+          deviates[z] = ComputePoissonMLRDeviate(b, bModel);
         else   // standard chi^2 term
-          yResults[z] = weightVector[b] * (dataVector[b] - modelVector[bModel]);
+          deviates[z] = weightVector[b] * (dataVector[b] - model[bModel]);
       }
     }
     else {
       for (z = 0; z < nDataVals; z++) {
         iDataRow = z / nDataColumns;
         iDataCol = z - (long)iDataRow * (long)nDataColumns;
-        zModel = (long)nModelColumns * (long)(nPSFRows + iDataRow) + nPSFColumns + iDataCol;
-        if (poissonMLR)
-          yResults[z] = ComputePoissonMLRDeviate(z, zModel);
+        zModel = (long)nModelColumns * (long)(nPaddingRows + iDataRow) + nPaddingColumns + iDataCol;
+        if (usePoissonMLR)
+          deviates[z] = ComputePoissonMLRDeviate(z, zModel);
         else   // standard chi^2 term
-          yResults[z] = weightVector[z] * (dataVector[z] - modelVector[zModel]);
+          deviates[z] = weightVector[z] * (dataVector[z] - model[zModel]);
       }
     }
   }   // end if convolution case
@@ -1455,24 +1948,41 @@ void ModelObject::ComputeDeviates( double yResults[], double params[] )
   else {
     // No convolution, so model image is same size & shape as data and weight images
     if (doBootstrap) {
-      if (poissonMLR)
+      if (usePoissonMLR)
         for (z = 0; z < nValidDataVals; z++) {
           b = bootstrapIndices[z];
-          yResults[z] = ComputePoissonMLRDeviate(b, b);
+          deviates[z] = ComputePoissonMLRDeviate(b, b);
         } else {   // standard chi^2 term
         for (z = 0; z < nValidDataVals; z++) {
           b = bootstrapIndices[z];
-          yResults[z] = weightVector[b] * (dataVector[b] - modelVector[b]);
+          deviates[z] = weightVector[b] * (dataVector[b] - model[b]);
         }
        }
     }
+    else if (useActivePixelSpans) {
+      // Only unmasked pixels need to be computed; masked pixels have deviate = 0
+      for (z = 0; z < nDataVals; z++)
+        deviates[z] = 0.0;
+      for (iDataRow = 0; iDataRow < nDataRows; iDataRow++) {
+        for (s = activeSpanRowIndex[iDataRow]; s < activeSpanRowIndex[iDataRow + 1]; s++) {
+          zStart = (long)iDataRow * (long)nDataColumns + activeSpanStartCols[s];
+          zEnd = (long)iDataRow * (long)nDataColumns + activeSpanEndCols[s];
+          if (usePoissonMLR)
+            for (z = zStart; z < zEnd; z++)
+              deviates[z] = ComputePoissonMLRDeviate(z, z);
+          else   // standard chi^2 term
+            for (z = zStart; z < zEnd; z++)
+              deviates[z] = weightVector[z] * (dataVector[z] - model[z]);
+        }
+      }
+    }
     else {
-      if (poissonMLR)
+      if (usePoissonMLR)
         for (z = 0; z < nDataVals; z++)
-          yResults[z] = ComputePoissonMLRDeviate(z, z);
+          deviates[z] = ComputePoissonMLRDeviate(z, z);
       else   // standard chi^2 term
         for (z = 0; z < nDataVals; z++)
-          yResults[z] = weightVector[z] * (dataVector[z] - modelVector[z]);
+          deviates[z] = weightVector[z] * (dataVector[z] - model[z]);
     }
     
   }  // end else (non-convolution case)
@@ -1500,7 +2010,7 @@ int ModelObject::UseModelErrors( )
   // WARNING: If we are calling this function for a second or subsequent time,
   // nDataVals *might* have changed; we are currently assuming it hasn't!
   if (! weightVectorAllocated) {
-    weightVector = (double *) calloc((size_t)nDataVals, sizeof(double));
+    weightVector = arena.AllocateArray<double>((size_t)nDataVals);
     if (weightVector == NULL) {
       fprintf(stderr, "*** ERROR: Unable to allocate memory for weight vector!\n");
       fprintf(stderr, "    (Requested image size was %ld pixels)\n", nDataVals);
@@ -1515,6 +2025,7 @@ int ModelObject::UseModelErrors( )
   for (long z = 0; z < nDataVals; z++) {
     weightVector[z] = 1.0;
   }
+  weightVectorIsStandard = false;
   weightValsSet = true;
   return 0;
 }
@@ -1535,14 +2046,14 @@ int ModelObject::UseCashStatistic( )
   // WARNING: If we are calling this function for a second or subsequent time,
   // nDataVals *might* have changed; we are currently assuming it hasn't!
   if (! weightVectorAllocated) {
-    weightVector = (double *) calloc((size_t)nDataVals, sizeof(double));
+    weightVector = arena.AllocateArray<double>((size_t)nDataVals);
     weightVectorAllocated = true;
   }
   else {
     fprintf(stderr, "WARNING: ModelImage::UseCashStatistic -- weight vector already allocated!\n");
   }
   if (! extraCashTermsVectorAllocated) {
-    extraCashTermsVector = (double *) calloc((size_t)nDataVals, sizeof(double));
+    extraCashTermsVector = arena.AllocateArray<double>((size_t)nDataVals);
     if (extraCashTermsVector == NULL) {
       fprintf(stderr, "*** ERROR: Unable to allocate memory for extra Cash terms vector!\n");
       fprintf(stderr, "    (Requested vector size was %ld pixels)\n", nDataVals);
@@ -1557,6 +2068,7 @@ int ModelObject::UseCashStatistic( )
   for (long z = 0; z < nDataVals; z++) {
     weightVector[z] = 1.0;
   }
+  weightVectorIsStandard = false;
   weightValsSet = true;
   return 0;
 }
@@ -1625,52 +2137,23 @@ double ModelObject::GetFitStatistic( double params[] )
  */
 double ModelObject::ChiSquared( double params[] )
 {
-  int  iDataRow, iDataCol;
-  long  z, zModel, b, bModel;
   double  chi;
   
   if (! deviatesVectorAllocated) {
-    deviatesVector = (double *) calloc((size_t)nDataVals, sizeof(double));
+    deviatesVector = arena.AllocateArray<double>((size_t)nDataVals);
     deviatesVectorAllocated = true;
   }
   
   CreateModelImage(params);
   if (modelErrors)
     UpdateWeightVector();
+  else if (weightVectorIsStandard)
+    RestoreInternalWeights();
   
-  if (doConvolution) {
-    // Step through model image so that we correctly match its pixels with corresponding
-    // pixels in data and weight images
-    if (doBootstrap) {
-      for (z = 0; z < nValidDataVals; z++) {
-        b = bootstrapIndices[z];
-        iDataRow = b / nDataColumns;
-        iDataCol = b - (long)iDataRow * (long)nDataColumns;
-        bModel = (long)nModelColumns * (long)(nPSFRows + iDataRow) + nPSFColumns + iDataCol;
-        deviatesVector[z] = weightVector[b] * (dataVector[b] - modelVector[bModel]);
-      }
-    } else {
-      for (z = 0; z < nDataVals; z++) {
-        iDataRow = z / nDataColumns;
-        iDataCol = z - (long)iDataRow * (long)nDataColumns;
-        zModel = (long)nModelColumns * (long)(nPSFRows + iDataRow) + nPSFColumns + iDataCol;
-        deviatesVector[z] = weightVector[z] * (dataVector[z] - modelVector[zModel]);
-      }
-    }
-  }
-  else {   // Model image is same size & shape as data and weight images
-    if (doBootstrap) {
-      for (z = 0; z < nValidDataVals; z++) {
-        b = bootstrapIndices[z];
-        deviatesVector[z] = weightVector[b] * (dataVector[b] - modelVector[b]);
-      }
-    } else {
-      // Note: this loop is auto-vectorized when compiling with -O3 and -sse2 (g++-7)
-      for (z = 0; z < nDataVals; z++) {
-        deviatesVector[z] = weightVector[z] * (dataVector[z] - modelVector[z]);
-      }
-    }
-  }
+  if (modelImageIsSinglePrecision)
+    ComputeWeightedDeviates(modelVector_sp, deviatesVector, false);
+  else
+    ComputeWeightedDeviates(modelVector, deviatesVector, false);
   
   // mp_enorm returns sqrt( Sum_i(chi_i^2) ) = sqrt( Sum_i(deviatesVector[i]^2) )
   if (doBootstrap)
@@ -1694,14 +2177,30 @@ double ModelObject::ChiSquared( double params[] )
 // classical Cash statistic).
 //
 double ModelObject::CashStatistic( double params[] )
+{
+  CreateModelImage(params);
+  if (weightVectorIsStandard)
+    RestoreInternalWeights();
+  
+  if (modelImageIsSinglePrecision)
+    return 2.0*SumCashTerms(modelVector_sp);
+  else
+    return 2.0*SumCashTerms(modelVector);
+}
+
+
+/* ---------------- PROTECTED METHOD: SumCashTerms --------------------- */
+/// Does the actual work for CashStatistic: returns the sum of the per-pixel terms
+/// (= half the Cash statistic) for the current model image (model = modelVector
+/// or modelVector_sp)
+template <typename T>
+double ModelObject::SumCashTerms( const T *model )
 {
   int  iDataRow, iDataCol;
-  long  z, zModel, b, bModel;
+  long  z, zModel, b, bModel, s, zStart, zEnd;
   double  modVal, dataVal, logModel, extraTerms;
   double  cashStat = 0.0;
   
-  CreateModelImage(params);
-  
   if (doConvolution) {
     // Step through model image so that we correctly match its pixels with corresponding
     // pixels in data and weight images
@@ -1710,8 +2209,8 @@ double ModelObject::CashStatistic( double params[] )
         b = bootstrapIndices[z];
         iDataRow = b / nDataColumns;
         iDataCol = b - (long)iDataRow * (long)nDataColumns;
-        bModel = (long)nModelColumns * (long)(nPSFRows + iDataRow) + nPSFColumns + iDataCol;
-        modVal = effectiveGain*(modelVector[bModel] + originalSky);
+        bModel = (long)nModelColumns * (long)(nPaddingRows + iDataRow) + nPaddingColumns + iDataCol;
+        modVal = effectiveGain*(model[bModel] + originalSky);
         dataVal = effectiveGain*(dataVector[b] + originalSky);
         if (modVal <= 0)
           logModel = LOG_SMALL_VALUE;
@@ -1724,9 +2223,9 @@ double ModelObject::CashStatistic( double params[] )
       for (z = 0; z < nDataVals; z++) {
         iDataRow = z / nDataColumns;
         iDataCol = z - (long)iDataRow * (long)nDataColumns;
-        zModel = (long)nModelColumns * (long)(nPSFRows + iDataRow) + nPSFColumns + iDataCol;
+        zModel = (long)nModelColumns * (long)(nPaddingRows + iDataRow) + nPaddingColumns + iDataCol;
         // Mi − Di + DilogDi − DilogMi
-        modVal = effectiveGain*(modelVector[zModel] + originalSky);
+        modVal = effectiveGain*(model[zModel] + originalSky);
         dataVal = effectiveGain*(dataVector[z] + originalSky);
         if (modVal <= 0)
           logModel = LOG_SMALL_VALUE;
@@ -1741,7 +2240,7 @@ double ModelObject::CashStatistic( double params[] )
     if (doBootstrap) {
       for (z = 0; z < nValidDataVals; z++) {
         b = bootstrapIndices[z];
-        modVal = effectiveGain*(modelVector[b] + originalSky);
+        modVal = effectiveGain*(model[b] + originalSky);
         dataVal = effectiveGain*(dataVector[b] + originalSky);
         if (modVal <= 0)
           logModel = LOG_SMALL_VALUE;
@@ -1750,9 +2249,27 @@ double ModelObject::CashStatistic( double params[] )
         extraTerms = extraCashTermsVector[b];   // = 0 for Cash stat
         cashStat += weightVector[b] * (modVal - dataVal*logModel + extraTerms);
       }
+    } else if (useActivePixelSpans) {
+      // Only unmasked pixels contribute
+      for (iDataRow = 0; iDataRow < nDataRows; iDataRow++) {
+        for (s = activeSpanRowIndex[iDataRow]; s < activeSpanRowIndex[iDataRow + 1]; s++) {
+          zStart = (long)iDataRow * (long)nDataColumns + activeSpanStartCols[s];
+          zEnd = (long)iDataRow * (long)nDataColumns + activeSpanEndCols[s];
+          for (z = zStart; z < zEnd; z++) {
+            modVal = effectiveGain*(model[z] + originalSky);
+            dataVal = effectiveGain*(dataVector[z] + originalSky);
+            if (modVal <= 0)
+              logModel = LOG_SMALL_VALUE;
+            else
+              logModel = log(modVal);
+            extraTerms = extraCashTermsVector[z];   // = 0 for Cash stat
+            cashStat += weightVector[z] * (modVal - dataVal*logModel + extraTerms);
+          }
+        }
+      }
     } else {
       for (z = 0; z < nDataVals; z++) {
-        modVal = effectiveGain*(modelVector[z] + originalSky);
+        modVal = effectiveGain*(model[z] + originalSky);
         dataVal = effectiveGain*(dataVector[z] + originalSky);
         if (modVal <= 0)
           logModel = LOG_SMALL_VALUE;
@@ -1764,7 +2281,7 @@ double ModelObject::CashStatistic( double params[] )
     }
   }
   
-  return (2.0*cashStat);
+  return cashStat;
 }
 
 
@@ -2052,6 +2569,7 @@ void ModelObject::PrintModelImage( )
     fprintf(stderr, "* ModelObject::PrintModelImage -- Model image has not yet been computed!\n\n");
     return;
   }
+  CompleteModelImage();
   printf("The model image, row by row:\n");
   PrintImage(modelVector, nModelColumns, nModelRows);
 }
@@ -2067,7 +2585,12 @@ void ModelObject::PrintMask( )
     return;
   }
   printf("The mask image, row by row:\n");
-  PrintImage(maskVector, nDataColumns, nDataRows);
+  for (int i = 0; i < nDataRows; i++) {
+    for (int j = 0; j < nDataColumns; j++)
+      printf(" %d", (int)maskVector[(long)i * (long)nDataColumns + j]);
+    printf("\n");
+  }
+  printf("\n");
 }
 
 
@@ -2133,6 +2656,18 @@ int ModelObject::GetNParams( )
 }
 
 
+/* ---------------- PUBLIC METHOD: GetNPointSources -------------------- */
+/// Returns the number of PointSource (or similar) functions in the model.
+int ModelObject::GetNPointSources( )
+{
+  int  nPointSources = 0;
+  for (int n = 0; n < nFunctions; n++)
+    if (functionObjects[n]->IsPointSource())
+      nPointSources++;
+  return nPointSources;
+}
+
+
 /* ---------------- PUBLIC METHOD: GetNDataValues ---------------------- */
 /// Prints the number of data values (pixels, masked or unmasked) in the data image.
 long ModelObject::GetNDataValues( )
@@ -2149,6 +2684,27 @@ long ModelObject::GetNValidPixels( )
 }
 
 
+/* ---------------- PUBLIC METHOD: GetMemoryUse ------------------------ */
+/// Returns the number of bytes currently allocated for internal images and
+/// other per-fit buffers (all held in the model's AlignedArena, which includes
+/// the buffers of the Convolver and OversampledRegion objects). If the
+/// component-image cache has been requested but not yet allocated (this happens
+/// when the first model image is computed), its size is included.
+long ModelObject::GetMemoryUse( )
+{
+  long  nBytes = arena.GetBytesReserved();
+
+  if ((useComponentCache) && (! componentCacheAllocated)) {
+    long  imageBytes = (long)nModelVals * (long)sizeof(double);
+    imageBytes = ((imageBytes + ARENA_ALIGNMENT - 1) / ARENA_ALIGNMENT) * ARENA_ALIGNMENT;
+    for (int n = 0; n < nFunctions; n++)
+      if (! functionObjects[n]->IsPointSource())
+        nBytes += imageBytes;
+  }
+  return nBytes;
+}
+
+
 /* ---------------- PUBLIC METHOD: HasPSF ------------------------------ */
 /// Returns true if the model has a PSF image
 bool ModelObject::HasPSF( )
@@ -2172,6 +2728,15 @@ bool ModelObject::HasMask( )
 }
 
 
+/* ---------------- PUBLIC METHOD: UsesSinglePrecision ----------------- */
+/// Returns true if model images are computed in single precision (so that
+/// they are only accurate to ~ 1e-7 relative to the largest pixel values).
+bool ModelObject::UsesSinglePrecision( )
+{
+  return useSinglePrecision;
+}
+
+
 /* ---------------- PUBLIC METHOD: GetModelImageVector ----------------- */
 /// Returns a pointer to the model image (matching the data image in size if
 /// convolution is being done).
@@ -2185,10 +2750,11 @@ double * ModelObject::GetModelImageVector( )
     fprintf(stderr, "* ModelObject::GetModelImageVector -- Model image has not yet been computed!\n\n");
     return NULL;
   }
+  CompleteModelImage();
   
   if (doConvolution) {
     if (! outputModelVectorAllocated) {
-      outputModelVector = (double *) calloc((size_t)nDataVals, sizeof(double));
+      outputModelVector = arena.AllocateArray<double>((size_t)nDataVals);
       if (outputModelVector == NULL) {
         fprintf(stderr, "*** ERROR: Unable to allocate memory for output model image!\n");
         fprintf(stderr, "    (Requested image size was %ld pixels)\n", nDataVals);
@@ -2201,7 +2767,7 @@ double * ModelObject::GetModelImageVector( )
     for (z = 0; z < nDataVals; z++) {
       iDataRow = z / nDataColumns;
       iDataCol = z - (long)iDataRow * (long)nDataColumns;
-      zModel = (long)nModelColumns * (long)(nPSFRows + iDataRow) + nPSFColumns + iDataCol;
+      zModel = (long)nModelColumns * (long)(nPaddingRows + iDataRow) + nPaddingColumns + iDataCol;
       outputModelVector[z] = modelVector[zModel];
     }
     return outputModelVector;
@@ -2223,6 +2789,7 @@ double * ModelObject::GetExpandedModelImageVector( )
     fprintf(stderr, "* ModelObject::GetExpandedModelImageVector -- Model image has not yet been computed!\n\n");
     return NULL;
   }
+  CompleteModelImage();
   return modelVector;
 }
 
@@ -2240,11 +2807,12 @@ double * ModelObject::GetResidualImageVector( )
     fprintf(stderr, "* ModelObject::GetResidualImageVector -- Model image has not yet been computed!\n\n");
     return NULL;
   }
+  CompleteModelImage();
   
   // WARNING: If we are calling this function for a second or subsequent time,
   // nDataVals *might* have changed; we are currently assuming it hasn't!
   if (! residualVectorAllocated) {
-    residualVector = (double *) calloc((size_t)nDataVals, sizeof(double));
+    residualVector = arena.AllocateArray<double>((size_t)nDataVals);
     if (residualVector == NULL) {
       fprintf(stderr, "*** ERROR: Unable to allocate memory for output residual image!\n");
       fprintf(stderr, "    (Requested image size was %ld pixels)\n", nDataVals);
@@ -2259,7 +2827,7 @@ double * ModelObject::GetResidualImageVector( )
     for (z = 0; z < nDataVals; z++) {
       iDataRow = z / nDataColumns;
       iDataCol = z - (long)iDataRow * (long)nDataColumns;
-      zModel = (long)nModelColumns * (long)(nPSFRows + iDataRow) + nPSFColumns + iDataCol;
+      zModel = (long)nModelColumns * (long)(nPaddingRows + iDataRow) + nPaddingColumns + iDataCol;
       residualVector[z] = (dataVector[z] - modelVector[zModel]);
     }
   }
@@ -2277,7 +2845,9 @@ double * ModelObject::GetResidualImageVector( )
 
 /* ---------------- PUBLIC METHOD: GetWeightImageVector ---------------- */
 /// Returns the weightVector converted to 1/sigma^2 (i.e., 1/variance) form.
-/// Returns NULL if memory allocation failed.
+/// The conversion is done in place (instead of in a second data-sized array),
+/// so the returned values are only valid until the next call to ComputeDeviates,
+/// ChiSquared, etc. (which convert the weights back to internal 1/sigma form).
 double * ModelObject::GetWeightImageVector( )
 {
   if (! weightValsSet) {
@@ -2285,19 +2855,28 @@ double * ModelObject::GetWeightImageVector( )
     return NULL;
   }
   
-  standardWeightVector = (double *) calloc((size_t)nDataVals, sizeof(double));
-  if (standardWeightVector == NULL) {
-    fprintf(stderr, "*** ERROR: Unable to allocate memory for output weight image!\n");
-    fprintf(stderr, "    (Requested image size was %ld pixels)\n", nDataVals);
-    return NULL;
+  if ((! weightVectorIsStandard) && (weightVectorShared)) {
+    // converting in place would change the weights of the original/clones, so
+    // switch to a private copy first (the shared vector is left alone)
+    double  *privateWeights = arena.AllocateArray<double>((size_t)nDataVals);
+    if (privateWeights == NULL) {
+      fprintf(stderr, "*** ERROR: Unable to allocate memory for weight vector!\n");
+      fprintf(stderr, "    (Requested image size was %ld pixels)\n", nDataVals);
+      return NULL;
+    }
+    memcpy(privateWeights, weightVector, (size_t)nDataVals*sizeof(double));
+    weightVector = privateWeights;
+    weightVectorShared = false;
   }
-  for (long z = 0; z < nDataVals; z++) {
-    // Note: this loop is auto-vectorized when compiling with -O3 and -sse2 (g++-7)
-    double  w_sqrt = weightVector[z];   // internal weight value (sqrt of formal weight)
-  	standardWeightVector[z] = w_sqrt*w_sqrt;
+  if (! weightVectorIsStandard) {
+    for (long z = 0; z < nDataVals; z++) {
+      // Note: this loop is auto-vectorized when compiling with -O3 and -sse2 (g++-7)
+      double  w_sqrt = weightVector[z];   // internal weight value (sqrt of formal weight)
+      weightVector[z] = w_sqrt*w_sqrt;
+    }
+    weightVectorIsStandard = true;
   }
-  standardWeightVectorAllocated = true;
-  return standardWeightVector;
+  return weightVector;
 }
 
 
@@ -2322,10 +2901,14 @@ double * ModelObject::GetDataVector( )
 double ModelObject::FindTotalFluxes( double params[], int xSize, int ySize,
                        double individualFluxes[] )
 {
-  double  x0_all, y0_all, x, y;
+  double  x0_all, y0_all;
   double  totalModelFlux, totalComponentFlux;
   int  i, j, n;
   int  offset = 0;
+  vector<ImageTile>  tiles;
+  vector<int>  tileOrder;
+  vector<double>  xVals(xSize), yVals(ySize);
+  vector<FunctionObject *>  singleFuncObjVector(1);
 
   assert( (xSize >= 1) && (ySize >= 1) );
   
@@ -2342,7 +2925,11 @@ double ModelObject::FindTotalFluxes( double params[], int xSize, int ySize,
     offset += paramSizes[n];
   }
 
-//  int  chunk = OPENMP_CHUNK_SIZE;
+  for (j = 0; j < xSize; j++)
+    xVals[j] = (double)(j + 1);        // Iraf counting: first column = 1
+  for (i = 0; i < ySize; i++)
+    yVals[i] = (double)(i + 1);        // Iraf counting: first row = 1
+  MakeImageTiles(xSize, ySize, tiles);
 
   // NOTE: I tried implementing the Kahan summation algorithm for this
   // calculation; it increased the time for a single-component Gaussian
@@ -2359,18 +2946,11 @@ double ModelObject::FindTotalFluxes( double params[], int xSize, int ySize,
       totalComponentFlux = functionObjects[n]->TotalFlux();
       printf("\tUsing %s.TotalFlux() method...\n", functionObjects[n]->GetShortName().c_str());
     } else {
-      totalComponentFlux = 0.0;
-      #pragma omp parallel private(i,j,x,y) reduction(+:totalComponentFlux)
-      {
-      #pragma omp for schedule (static, ompChunkSize)
-      for (i = 0; i < ySize; i++) {   // step by row number = y
-        y = (double)(i + 1);              // Iraf counting: first row = 1
-        for (j = 0; j < xSize; j++) {   // step by column number = x
-          x = (double)(j + 1);                 // Iraf counting: first column = 1
-          totalComponentFlux += functionObjects[n]->GetValue(x, y);
-        }
-      }
-    } // end omp parallel section
+      // sum over tiles of the giant image, most expensive (i.e., central) tiles first
+      singleFuncObjVector[0] = functionObjects[n];
+      OrderTilesByCost(tiles, &xVals[0], &yVals[0], singleFuncObjVector, 1, tileOrder);
+      totalComponentFlux = SumTiledFunction(tiles, tileOrder, &xVals[0], &yVals[0], 
+      										functionObjects[n]);
     } // end else [integrate total flux for component]
     individualFluxes[n] = totalComponentFlux;
     totalModelFlux += totalComponentFlux;
@@ -2380,6 +2960,341 @@ double ModelObject::FindTotalFluxes( double params[], int xSize, int ySize,
 }
 
 
+/* ---------------- PROTECTED METHOD: AddPointSourceImages ------------ */
+/// Adds flux from all PointSource functions to modelVector (or to modelVector_sp,
+/// for single-precision model images); this must be done *after* PSF convolution.
+/// Functions which report a footprint via GetFootprint() are only evaluated for
+/// pixels inside it, so that the cost scales with the number of point sources
+/// times the PSF size, rather than times the full image size.
+/// Assumes that the functions' Setup() methods have already been called.
+void ModelObject::AddPointSourceImages( )
+{
+  long  i, j;
+  int  m, n, nPointSources;
+  double  y, tempSum, adjVal;
+  double  xMin, xMax, yMin, yMax;
+  double  *modelRow;
+  float  *modelRow_sp;
+  bool  rowTouched;
+  vector<int>  psIndices, psColMin, psColMax, psRowMin, psRowMax;
+
+  // Re-assign psfInterpolator object (bcs. calls made to
+  // OversampledRegion::ComputeRegionAndDownsample result
+  // in PointSource objects getting assigned alternate psfInterpolators),
+  // so we have to reset PointSource objects to use the standard-resolution
+  // psfInterpolator object held by ModelObject
+  for (m = 0; m < (int)pointSourceIndices.size(); m++) {
+    n = pointSourceIndices[m];
+    functionObjects[n]->AddPsfInterpolator(psfInterpolator);
+    // Convert footprint to (conservative) range of model-image rows and columns;
+    // recall that x = j - nPaddingColumns + 1, y = i - nPaddingRows + 1
+    int  colMin = 0;
+    int  colMax = nModelColumns - 1;
+    int  rowMin = 0;
+    int  rowMax = nModelRows - 1;
+    if (functionObjects[n]->GetFootprint(xMin, xMax, yMin, yMax)) {
+      colMin = (int)fmax(0.0, floor(xMin) + nPaddingColumns - 1);
+      colMax = (int)fmin((double)(nModelColumns - 1), ceil(xMax) + nPaddingColumns - 1);
+      rowMin = (int)fmax(0.0, floor(yMin) + nPaddingRows - 1);
+      rowMax = (int)fmin((double)(nModelRows - 1), ceil(yMax) + nPaddingRows - 1);
+    }
+    if ((colMin <= colMax) && (rowMin <= rowMax)) {
+      psIndices.push_back(n);
+      psColMin.push_back(colMin);
+      psColMax.push_back(colMax);
+      psRowMin.push_back(rowMin);
+      psRowMax.push_back(rowMax);
+    }
+  }
+  nPointSources = (int)psIndices.size();
+  if (nPointSources == 0)
+    return;
+  
+  vector<double>  xVals(nModelColumns);
+  for (j = 0; j < nModelColumns; j++)
+    xVals[j] = (double)(j - nPaddingColumns + 1);    // Iraf counting: first column = 1
+
+  // Each row sums contributions from those point sources whose footprints
+  // overlap it, using Kahan summation for each pixel
+#pragma omp parallel private(i,j,m,n,y,tempSum,adjVal,modelRow,modelRow_sp,rowTouched)
+  {
+  vector<double>  yVals(nModelColumns), newVals(nModelColumns);
+  vector<double>  newValSums(nModelColumns), storedErrors(nModelColumns);
+
+  #pragma omp for schedule (dynamic, 1)
+  for (i = 0; i < nModelRows; i++) {
+    y = (double)(i - nPaddingRows + 1);              // Iraf counting: first row = 1
+    rowTouched = false;
+    for (m = 0; m < nPointSources; m++) {
+      if ((i < psRowMin[m]) || (i > psRowMax[m]))
+        continue;
+      if (! rowTouched) {
+        for (j = 0; j < nModelColumns; j++) {
+          yVals[j] = y;
+          newValSums[j] = 0.0;
+          storedErrors[j] = 0.0;
+        }
+        rowTouched = true;
+      }
+      n = psIndices[m];
+      functionObjects[n]->ComputeValues(&xVals[psColMin[m]], &yVals[psColMin[m]], 
+      							&newVals[psColMin[m]], psColMax[m] - psColMin[m] + 1);
+      for (j = psColMin[m]; j <= psColMax[m]; j++) {
+        // Kahan summation algorithm
+        adjVal = newVals[j] - storedErrors[j];
+        tempSum = newValSums[j] + adjVal;
+        storedErrors[j] = (tempSum - newValSums[j]) - adjVal;
+        newValSums[j] = tempSum;
+      }
+    }
+    if ((rowTouched) && (modelImageIsSinglePrecision)) {
+      modelRow_sp = modelVector_sp + i*nModelColumns;
+      for (j = 0; j < nModelColumns; j++)
+        modelRow_sp[j] += newValSums[j];
+    }
+    else if (rowTouched) {
+      modelRow = modelVector + i*nModelColumns;
+      for (j = 0; j < nModelColumns; j++)
+        modelRow[j] += newValSums[j];
+    }
+  }
+  } // end omp parallel section
+}
+
+
+/* ---------------- PROTECTED METHOD: ComputeFunctionImage ------------ */
+/// Computes the (unconvolved) image for the single function specified by
+/// functionIndex and stores it in outputImage, which must have nModelVals pixels.
+/// Assumes that the function's Setup() method has already been called.
+void ModelObject::ComputeFunctionImage( int functionIndex, double *outputImage )
+{
+  long  i, j;
+  double  y;
+  vector<double>  xVals(nModelColumns);
+
+  for (j = 0; j < nModelColumns; j++)
+    xVals[j] = (double)(j - nPaddingColumns + 1);    // Iraf counting: first column = 1
+
+  // OpenMP Parallel section; see CreateModelImage() for general notes on this
+#pragma omp parallel private(i,j,y)
+  {
+  vector<double>  yVals(nModelColumns);
+  #pragma omp for schedule (dynamic, 1)
+  for (i = 0; i < nModelRows; i++) {   // step by row number = y
+    y = (double)(i - nPaddingRows + 1);              // Iraf counting: first row = 1
+    for (j = 0; j < nModelColumns; j++)
+      yVals[j] = y;
+    functionObjects[functionIndex]->ComputeValues(&xVals[0], &yVals[0], 
+    										outputImage + i*nModelColumns, nModelColumns);
+  }
+  } // end omp parallel section
+}
+
+
+/* ---------------- PROTECTED METHOD: ComputeModelFromComponentCache --- */
+/// Alternate version of steps 1--2 of CreateModelImage: for each non-PointSource
+/// function, we store an individual (PSF-convolved) image; only those functions
+/// whose parameters (including the function block's x0,y0) differ from the previous
+/// call are recomputed. Because convolution is linear, the sum of the component
+/// images is the same as the convolution of the summed image. (PointSource functions
+/// are cheap to compute with AddPointSourceImages, so they are not cached.)
+/// Assumes the functions' Setup() methods have already been called.
+/// Returns 0 on success, -1 if the cache could not be allocated.
+int ModelObject::ComputeModelFromComponentCache( double params[] )
+{
+  int  n, p, offset = 0, centerOffset = 0;
+  bool  componentChanged;
+  double  newValSum, tempSum, adjVal, storedError;
+
+  if (! componentCacheAllocated) {
+    componentImages = (double **) calloc((size_t)nFunctions, sizeof(double *));
+    cachedParams = (double *) calloc((size_t)nParamsTot, sizeof(double));
+    if ((componentImages == NULL) || (cachedParams == NULL)) {
+      fprintf(stderr, "*** ERROR: Unable to allocate memory for component-image cache!\n");
+      fprintf(stderr, "    (Component caching will be turned off.)\n");
+      free(componentImages);
+      free(cachedParams);
+      useComponentCache = false;
+      return -1;
+    }
+    componentCacheAllocated = true;
+    for (n = 0; n < nFunctions; n++) {
+      if (functionObjects[n]->IsPointSource())
+        continue;
+      componentImages[n] = arena.AllocateArray<double>((size_t)nModelVals);
+      if (componentImages[n] == NULL) {
+        fprintf(stderr, "*** ERROR: Unable to allocate memory for component-image cache!\n");
+        fprintf(stderr, "    (Requested image size was %ld pixels; component caching will be turned off.)\n",
+        		nModelVals);
+        FreeComponentCache();
+        useComponentCache = false;
+        return -1;
+      }
+    }
+    componentCacheValid = false;
+  }
+
+  // Recompute images for those functions whose parameters have changed, then
+  // convolve all of them together (with batched FFTs, if there are enough)
+  vector<double *>  changedImages;
+  for (n = 0; n < nFunctions; n++) {
+    if (fblockStartFlags[n] == true) {
+      centerOffset = offset;
+      offset += 2;
+    }
+    componentChanged = (! componentCacheValid);
+    if ((params[centerOffset] != cachedParams[centerOffset]) || 
+    		(params[centerOffset + 1] != cachedParams[centerOffset + 1]))
+      componentChanged = true;
+    for (p = offset; p < offset + paramSizes[n]; p++)
+      if (params[p] != cachedParams[p])
+        componentChanged = true;
+    offset += paramSizes[n];
+    
+    if ((componentChanged) && (componentImages[n] != NULL)) {
+      ComputeFunctionImage(n, componentImages[n]);
+      changedImages.push_back(componentImages[n]);
+    }
+  }
+  if ((doConvolution) && (changedImages.size() > 0))
+    psfConvolver->ConvolveImages(&changedImages[0], (int)changedImages.size());
+  for (p = 0; p < nParamsTot; p++)
+    cachedParams[p] = params[p];
+  componentCacheValid = true;
+
+  // Sum component images, using Kahan summation
+#pragma omp parallel private(n,newValSum,tempSum,adjVal,storedError)
+  {
+  #pragma omp for schedule (static, ompChunkSize)
+  for (long k = 0; k < nModelVals; k++) {
+    newValSum = 0.0;
+    storedError = 0.0;
+    for (n = 0; n < nFunctions; n++) {
+      if (componentImages[n] == NULL)   // PointSource function
+        continue;
+      adjVal = componentImages[n][k] - storedError;
+      tempSum = newValSum + adjVal;
+      storedError = (tempSum - newValSum) - adjVal;
+      newValSum = tempSum;
+    }
+    modelVector[k] = newValSum;
+  }
+  } // end omp parallel section
+  
+  return 0;
+}
+
+
+/* ---------------- PROTECTED METHOD: NComponentBatchImages ------------ */
+/// Returns the number of component images to convolve together (the number of
+/// cached components, up to MAX_COMPONENT_BATCH_SIZE).
+int ModelObject::NComponentBatchImages( )
+{
+  int  nCached = nFunctions - GetNPointSources();
+  return (nCached < MAX_COMPONENT_BATCH_SIZE) ? nCached : MAX_COMPONENT_BATCH_SIZE;
+}
+
+
+/* ---------------- PROTECTED METHOD: FreeComponentCache --------------- */
+/// Frees the individual-component images (if any); they will be re-allocated
+/// by ComputeModelFromComponentCache the next time they are needed.
+void ModelObject::FreeComponentCache( )
+{
+  if (componentCacheAllocated) {
+    for (int n = 0; n < nFunctions; n++)
+      arena.Free(componentImages[n]);   // OK if some were never allocated (= NULL)
+    free(componentImages);
+    free(cachedParams);
+    componentCacheAllocated = false;
+  }
+  componentCacheValid = false;
+}
+
+
+/* ---------------- PROTECTED METHOD: SetupRegionFunctions ------------- */
+/// Makes sure that regionFunctionObjects has a function list for each oversampled
+/// region: the same as functionObjects, except that PointSource functions are
+/// replaced by copies belonging to the region. (Each region gives its PointSource
+/// functions its own PsfInterpolator, so regions computed at the same time can't
+/// share them; the other functions are only read while computing images.)
+/// Returns -1 if a PointSource function can't be copied.
+int ModelObject::SetupRegionFunctions( )
+{
+  FunctionObject  *newFunctionObj;
+  
+  if ((int)regionFunctionObjects.size() == nOversampledRegions)
+    return 0;
+  FreeRegionFunctions();
+  for (int r = 0; r < nOversampledRegions; r++) {
+    regionFunctionObjects.push_back(functionObjects);
+    for (int n = 0; n < nFunctions; n++) {
+      if (functionObjects[n]->IsPointSource()) {
+        newFunctionObj = functionObjects[n]->Clone();
+        regionFunctionObjects[r][n] = newFunctionObj;
+        if (newFunctionObj == NULL) {
+          FreeRegionFunctions();
+          return -1;
+        }
+      }
+    }
+  }
+  return 0;
+}
+
+
+/* ---------------- PROTECTED METHOD: FreeRegionFunctions -------------- */
+
+void ModelObject::FreeRegionFunctions( )
+{
+  for (int r = 0; r < (int)regionFunctionObjects.size(); r++)
+    for (int n = 0; n < (int)regionFunctionObjects[r].size(); n++)
+      if (regionFunctionObjects[r][n] != functionObjects[n])
+        delete regionFunctionObjects[r][n];   // OK if NULL
+  regionFunctionObjects.clear();
+}
+
+
+/* ---------------- PROTECTED METHOD: ComputeOversampledRegions -------- */
+/// Computes the oversampled regions and copies them into the model image. If
+/// parallelRegions is true, the regions' oversampled images are computed using
+/// regionFunctionObjects: regions which are large enough to keep all the threads
+/// busy are computed one at a time, and the rest are computed at the same time
+/// by different threads, largest first (see ScheduleWorkItems). The regions are
+/// then downsampled into the model image one by one, in the same order as in the
+/// serial case (regions may overlap), so the results are identical.
+void ModelObject::ComputeOversampledRegions( bool parallelRegions )
+{
+  int  nThreads = 1;
+  vector<double>  costs(nOversampledRegions);
+  vector<int>  largeRegions, smallRegions;
+  
+  if (! parallelRegions) {
+    for (int n = 0; n < nOversampledRegions; n++)
+      oversampledRegionsVect[n]->ComputeRegionAndDownsample(modelVector, functionObjects, nFunctions);
+    return;
+  }
+
+#ifdef USE_OPENMP
+  nThreads = omp_get_max_threads();
+#endif
+  for (int n = 0; n < nOversampledRegions; n++)
+    costs[n] = oversampledRegionsVect[n]->EstimateCost();
+  ScheduleWorkItems(costs, nThreads, largeRegions, smallRegions);
+  for (int k = 0; k < (int)largeRegions.size(); k++) {
+    int  n = largeRegions[k];
+    oversampledRegionsVect[n]->ComputeRegion(regionFunctionObjects[n], nFunctions);
+  }
+  int  nSmallRegions = (int)smallRegions.size();
+#pragma omp parallel for schedule (dynamic, 1)
+  for (int k = 0; k < nSmallRegions; k++) {
+    int  n = smallRegions[k];
+    oversampledRegionsVect[n]->ComputeRegion(regionFunctionObjects[n], nFunctions);
+  }
+  for (int n = 0; n < nOversampledRegions; n++)
+    oversampledRegionsVect[n]->DownsampleRegion(modelVector);
+}
+
+
 /* ---------------- PROTECTED METHOD: CheckParamVector ----------------- */
 /// Returns true if all values in the parameter vector are finite.
 bool ModelObject::CheckParamVector( int nParams, double paramVector[] )
@@ -2410,7 +3325,7 @@ bool ModelObject::VetDataVector( )
   
   for (long z = 0; z < nDataVals; z++) {
     if (! isfinite(dataVector[z])) {
-      if (maskVector[z] > 0.0)
+      if (maskVector[z] > 0)
         nonFinitePixels = true;
       else
         dataVector[z] = 0.0;
@@ -2425,6 +3340,36 @@ bool ModelObject::VetDataVector( )
 }
 
 
+/* ---------------- PROTECTED METHOD: AllocateMaskVector --------------- */
+/// Allocates the internal (one byte per pixel) mask vector, if it doesn't
+/// already exist. Returns -1 if memory allocation failed.
+int ModelObject::AllocateMaskVector( )
+{
+  if (maskVectorAllocated)
+    return 0;
+  maskVector = arena.AllocateArray<unsigned char>((size_t)nDataVals);
+  if (maskVector == NULL) {
+    fprintf(stderr, "*** ERROR: Unable to allocate memory for mask image!\n");
+    fprintf(stderr, "    (Requested vector size was %ld pixels)\n", nDataVals);
+    return -1;
+  }
+  maskVectorAllocated = true;
+  return 0;
+}
+
+
+/* ---------------- PROTECTED METHOD: RestoreInternalWeights ----------- */
+/// Converts weightVector back to internal 1/sigma form after a call to
+/// GetWeightImageVector. (For IEEE doubles, sqrt(w*w) == w exactly, so this
+/// does not change the weights.)
+void ModelObject::RestoreInternalWeights( )
+{
+  for (long z = 0; z < nDataVals; z++)
+    weightVector[z] = sqrt(weightVector[z]);
+  weightVectorIsStandard = false;
+}
+
+
 /* ---------------- PROTECTED METHOD: CheckWeightVector ---------------- */
 /// Returns true if all pixels in the weight vector are finite *and* nonnegative.
 bool ModelObject::CheckWeightVector( )
@@ -2437,7 +3382,7 @@ bool ModelObject::CheckWeightVector( )
   // check individual pixels in weightVector, but only if they aren't masked by maskVector
   if (maskExists) {
     for (z = 0; z < nDataVals; z++) {
-      if (maskVector[z] > 0.0) {
+      if (maskVector[z] > 0) {
         if (! isfinite(weightVector[z]))
           nonFinitePixels = true;
         else if (weightVector[z] < 0.0)
@@ -2472,6 +3417,68 @@ bool ModelObject::CheckWeightVector( )
 
 
 
+/* ---------------- PROTECTED METHOD: BuildActivePixelSpans ------------ */
+/// Identifies the runs of consecutive unmasked pixels in each row of the data
+/// image; CreateModelImage() then computes the model only for those pixels,
+/// and ComputeDeviates(), etc., skip the masked pixels. This is only done if
+/// there is no PSF convolution (otherwise the model is needed for all pixels)
+/// and if at least one pixel is masked.
+void ModelObject::BuildActivePixelSpans( )
+{
+  int  i, j, jStart;
+  long  zRow;
+
+  useActivePixelSpans = false;
+  modelImageIsPartial = false;
+  activeSpanRowIndex.clear();
+  activeSpanStartCols.clear();
+  activeSpanEndCols.clear();
+  if ((doConvolution) || (oversampledRegionsExist) || (! maskExists) 
+  		|| (nValidDataVals >= nDataVals))
+    return;
+
+  activeSpanRowIndex.resize(nDataRows + 1);
+  for (i = 0; i < nDataRows; i++) {
+    activeSpanRowIndex[i] = (long)activeSpanStartCols.size();
+    zRow = (long)i * (long)nDataColumns;
+    j = 0;
+    while (j < nDataColumns) {
+      if (maskVector[zRow + j] > 0) {
+        jStart = j;
+        while ((j < nDataColumns) && (maskVector[zRow + j] > 0))
+          j++;
+        activeSpanStartCols.push_back(jStart);
+        activeSpanEndCols.push_back(j);
+      }
+      else
+        j++;
+    }
+  }
+  activeSpanRowIndex[nDataRows] = (long)activeSpanStartCols.size();
+  useActivePixelSpans = true;
+}
+
+
+/* ---------------- PROTECTED METHOD: CompleteModelImage --------------- */
+/// If the current model image was computed only for unmasked pixels, this
+/// recomputes it for all pixels (e.g., so that it can be saved); if it is a
+/// single-precision image, this copies it into modelVector.
+void ModelObject::CompleteModelImage( )
+{
+  if (modelImageIsPartial) {
+    activePixelSpansSuspended = true;
+    CreateModelImage(&partialModelParams[0]);
+    activePixelSpansSuspended = false;
+  }
+  if (modelImageIsSinglePrecision) {
+    for (long z = 0; z < nModelVals; z++)
+      modelVector[z] = modelVector_sp[z];
+    modelImageIsSinglePrecision = false;
+  }
+}
+
+
+
 
 // Extra stuff
 
@@ -19,8 +19,10 @@
 #include "definitions.h"
 #include "function_object.h"
 #include "psf_interpolators.h"
+#include "aligned_arena.h"
 #include "convolver.h"
 #include "oversampled_region.h"
+#include "image_tiles.h"
 #include "psf_oversampling_info.h"
 #include "param_struct.h"
 
@@ -45,6 +47,32 @@ class ModelObject
     void SetMaxThreads( int maxThreadNumber );
 
     void SetOMPChunkSize( int chunkSize );
+
+    // 2D only
+    void UseComponentCache( bool useCache=true );
+
+    // 2D only
+    void SetProfileTabulation( bool tabulateProfiles=true );
+
+    // 2D only
+    void SetAdaptiveSubsampling( bool adaptiveSubsampling=true );
+
+    // 2D only
+    void SetSinglePrecision( bool singlePrecision=true );
+
+    // 2D only
+    void SetFFTWWisdomFile( const string& wisdomFileName );
+
+    void SetConvolutionMethod( int method );
+
+    // 2D only
+    void SetSeparablePSFTolerance( double tolerance );
+
+    // 2D only
+    void SetCroppedConvolution( bool cropped=true );
+
+    // 2D only
+    void SetFFTTileSize( int tileSize );
     
     
     // Adds a new FunctionObject pointer to the internal vector
@@ -189,22 +217,33 @@ class ModelObject
     // common, but specialized by ModelObject1D
     virtual int FinalSetupForFitting( );
 
+    // 2D only
+    ModelObject * Clone( );
+
     string& GetParameterName( int i );
 
     int GetNFunctions( );
 
     int GetNParams( );
 
+    // 2D only
+    int GetNPointSources( );
+
     // Returns total number of data values
     long GetNDataValues( );
 
     // Returns total number of *non-masked* data values
     virtual long GetNValidPixels( );
 
+    // Returns number of bytes allocated for internal images (including those
+    // of Convolver and OversampledRegion objects)
+    long GetMemoryUse( );
+
 	// 2D only
     bool HasPSF( );
     bool HasOversampledPSF( );
     bool HasMask( );
+    bool UsesSinglePrecision( );
 
 	// 2D only
     virtual double * GetModelImageVector( );
@@ -244,11 +283,58 @@ class ModelObject
 
   protected:
     bool CheckParamVector( int nParams, double paramVector[] );
+
+    // 2D only
+    void ComputeFunctionImage( int functionIndex, double *outputImage );
+
+    // 2D only
+    void AddPointSourceImages( );
+
+    // 2D only
+    void PartitionFunctions( );
+
+    // 2D only
+    int ComputeModelFromComponentCache( double params[] );
+
+    // 2D only
+    int NComponentBatchImages( );
+
+    // 2D only
+    void FreeComponentCache( );
+
+    // 2D only
+    int SetupRegionFunctions( );
+
+    // 2D only
+    void FreeRegionFunctions( );
+
+    // 2D only
+    void ComputeOversampledRegions( bool parallelRegions );
     
+    int AllocateMaskVector( );
+
+    void RestoreInternalWeights( );
+
     bool CheckWeightVector( );
     
     bool VetDataVector( );
 
+    // 2D only
+    void BuildActivePixelSpans( );
+
+    // 2D only
+    void CompleteModelImage( );
+
+    // 2D only
+    template <typename T> void ComputeWeightedDeviates( const T *model, double *deviates,
+    													bool usePoissonMLR );
+
+    // 2D only
+    template <typename T> double SumCashTerms( const T *model );
+
+    // 2D only
+    template <typename T> void UpdateWeightVectorFromModel( const T *model );
+
 
 
   private:
@@ -258,6 +344,7 @@ class ModelObject
     long  nDataVals, nValidDataVals, nModelVals;
     int  nDataColumns, nDataRows, nCombined;
     int  nModelColumns, nModelRows, nPSFColumns, nPSFRows;
+    int  nPaddingColumns, nPaddingRows;   // padding on each side of data image in model image
 	double  zeroPoint;
 	double  gain, readNoise, exposureTime, originalSky, effectiveGain;
 	double  readNoise_adu_squared;
@@ -265,7 +352,8 @@ class ModelObject
     int  maxRequestedThreads, ompChunkSize;
     bool  dataValsSet;
     bool  modelVectorAllocated, weightVectorAllocated, maskVectorAllocated;
-    bool  standardWeightVectorAllocated;
+    bool  weightVectorIsStandard;   // true if weightVector holds 1/sigma^2 values
+    bool  weightVectorShared;   // true if weightVector is also used by a clone (or original)
     bool  residualVectorAllocated, outputModelVectorAllocated;
     bool  fblockStartFlags_allocated;
     bool  modelImageSetupDone;
@@ -280,8 +368,9 @@ class ModelObject
     bool  zeroPointSet;
     int  nFunctions, nFunctionBlocks, nFunctionParams, nParamsTot;
     double  *dataVector;
-    double  *weightVector, *standardWeightVector;
-    double  *maskVector;
+    AlignedArena  arena;   // owns modelVector, weightVector, maskVector, etc.
+    double  *weightVector;
+    unsigned char  *maskVector;   // 1 = good pixel, 0 = bad pixel
     double  *modelVector;
     double  *deviatesVector;
     double  *residualVector;
@@ -291,6 +380,10 @@ class ModelObject
     long  *bootstrapIndices;
     bool  *fblockStartFlags;
     vector<FunctionObject *> functionObjects;
+    // functionObjects split into PointSource and other ("extended") functions
+    // when they are added, so the model-image code doesn't have to check each time
+    vector<FunctionObject *> extendedFunctions;
+    vector<int>  pointSourceIndices;
     vector<int> paramSizes;
     vector<string>  parameterLabels;
     vector<SimpleParameterInfo> parameterInfoVect;
@@ -307,6 +400,39 @@ class ModelObject
     bool  oversampledRegionsExist;
     int  nOversampledRegions;
     vector<OversampledRegion *>oversampledRegionsVect;
+    // per-region function lists (with the region's own copies of PointSource
+    // functions), for computing regions in parallel
+    vector< vector<FunctionObject *> >  regionFunctionObjects;
+
+    // stuff for per-component image caching
+    bool  useComponentCache, componentCacheAllocated, componentCacheValid;
+    bool  useProfileTables, useAdaptiveSubsampling;
+    double  **componentImages;   // one (post-convolution) image per non-PointSource function
+    double  *cachedParams;       // parameter vector used for current componentImages
+
+    // stuff for tiled computation of the model image (see image_tiles.h)
+    vector<ImageTile>  modelTiles;
+    vector<int>  modelTileOrder;
+    vector<double>  modelXVals, modelYVals;   // x (y) coordinates of model-image columns (rows)
+
+    // stuff for skipping masked pixels (no-PSF case only): runs of unmasked pixels
+    // in row i are [activeSpanStartCols[s], activeSpanEndCols[s]) for s =
+    // activeSpanRowIndex[i], ..., activeSpanRowIndex[i + 1] - 1
+    bool  useActivePixelSpans, activePixelSpansSuspended, modelImageIsPartial;
+    vector<long>  activeSpanRowIndex;
+    vector<int>  activeSpanStartCols, activeSpanEndCols;
+    vector<double>  partialModelParams;   // parameter vector for partial model image
+
+    // stuff for single-precision model images: if modelImageIsSinglePrecision, the
+    // current model image is in modelVector_sp (and modelVector is out of date)
+    bool  useSinglePrecision, modelImageIsSinglePrecision, modelVector_spAllocated;
+    float  *modelVector_sp;
+
+    string  fftwWisdomFile;   // if non-empty, FFTW wisdom is read from/saved to this file
+    int  convolutionMethod;   // CONVOLUTION_AUTO, CONVOLUTION_FFT, or CONVOLUTION_DIRECT
+    double  separablePSFTolerance;   // > 0 to allow separable PSF approximations
+    bool  cropConvolution;   // pad model image by PSF half-width, convolve data region only
+    int  fftTileSize;   // > 0 for tiled convolution of the main model image
 
   
 };
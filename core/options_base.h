@@ -70,6 +70,13 @@ class OptionsBase
       solver = MPFIT_SOLVER;
 
       subsamplingFlag = true;
+      tabulateProfiles = false;
+      adaptiveSubsampling = false;
+      singlePrecision = false;
+      fftwWisdomFile = "";
+      separablePSFTolerance = 0.0;
+      croppedConvolution = true;
+      fftTileSize = 0;
 
       rngSeed = 0;           // 0 = get seed value from system clock
   
@@ -111,6 +118,13 @@ class OptionsBase
     int  maskFormat;
   
     bool  subsamplingFlag;
+    bool  tabulateProfiles;
+    bool  adaptiveSubsampling;
+    bool  singlePrecision;
+    string  fftwWisdomFile;
+    double  separablePSFTolerance;
+    bool  croppedConvolution;
+    int  fftTileSize;   // > 0 for tiled (overlap-save) convolution
 
     bool  gainSet;
     double  gain;
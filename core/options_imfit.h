@@ -37,6 +37,8 @@ class ImfitOptions : public OptionsBase
       useCashStatistic = false;
       usePoissonMLR = false;
 
+      useComponentCache = false;
+
       noParamLimits = true;
 
       ftolSet = false;
@@ -64,6 +66,7 @@ class ImfitOptions : public OptionsBase
     bool  saveBestFitParams;
     string  outputParameterFileName;
   
+    bool  useComponentCache;
     bool  noParamLimits;
     bool  ftolSet;
     double  ftol;
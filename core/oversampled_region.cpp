@@ -71,6 +71,7 @@
 #include "convolver.h"
 #include "function_objects/function_object.h"
 #include "oversampled_region.h"
+#include "image_tiles.h"
 #include "downsample.h"
 #ifdef DEBUG
 #include "image_io.h"
@@ -100,18 +101,20 @@ OversampledRegion::OversampledRegion( )
   psfInterpolator = nullptr;
   psfInterpolator_allocated = false;
   ompChunkSize = DEFAULT_OPENMP_CHUNK_SIZE;
+  arena = &ownArena;
   
   debugImageName = "oversampled_region_testoutput";
+  convolutionMethod = CONVOLUTION_AUTO;
+  separablePSFTolerance = 0.0;
 }
 
 
 /* ---------------- DESTRUCTOR ----------------------------------------- */
 
-/// Destructor for OversampledRegion class
+/// Destructor for OversampledRegion class. (modelVector and the Convolver's
+/// buffers belong to the arena, and are freed when it is destroyed.)
 OversampledRegion::~OversampledRegion( )
 {
-  if (modelVectorAllocated)
-    free(modelVector);
   if (psfInterpolator_allocated)
     delete psfInterpolator;
   if (doConvolution)
@@ -135,6 +138,33 @@ void OversampledRegion::SetDebugLevel( int debuggingLevel )
 }
 
 
+/* ---------------- SetFFTWWisdomFile ---------------------------------- */
+/// Passes the FFTW wisdom-file name on to the Convolver (see Convolver::
+/// SetFFTWWisdomFile). Must be called before SetupModelImage().
+void OversampledRegion::SetFFTWWisdomFile( const string& wisdomFileName )
+{
+  fftwWisdomFile = wisdomFileName;
+}
+
+
+/* ---------------- SetConvolutionMethod ------------------------------- */
+/// Passes the convolution method on to the Convolver (see Convolver::
+/// SetConvolutionMethod). Must be called before SetupModelImage().
+void OversampledRegion::SetConvolutionMethod( int method )
+{
+  convolutionMethod = method;
+}
+
+
+/* ---------------- SetSeparablePSFTolerance --------------------------- */
+/// Passes the tolerance for separable PSF approximations on to the Convolver (see
+/// Convolver::SetupPSF). Must be called before AddPSFVector().
+void OversampledRegion::SetSeparablePSFTolerance( double tolerance )
+{
+  separablePSFTolerance = tolerance;
+}
+
+
 /* ---------------- SetMaxThreads -------------------------------------- */
 /// User specifies maximum number of FFTW threads to use (ignored if not compiled
 /// with multithreaded FFTW library)
@@ -144,6 +174,16 @@ void OversampledRegion::SetMaxThreads( int maximumThreadNumber )
 }
 
 
+/* ---------------- SetArena ------------------------------------------- */
+/// Tells the OversampledRegion (and its Convolver) to allocate buffers from
+/// externalArena (which must outlive this object) instead of its own arena.
+/// Must be called before SetupModelImage().
+void OversampledRegion::SetArena( AlignedArena *externalArena )
+{
+  arena = externalArena;
+}
+
+
 /* ---------------- SetupPSF ------------------------------------------- */
 /// Pass in a pointer to the pixel vector for the input PSF image, as well as
 /// the image dimensions.
@@ -162,7 +202,8 @@ void OversampledRegion::AddPSFVector( double *psfPixels, int nColumns_psf, int n
     nPSFColumns = nColumns_psf;
     nPSFRows = nRows_psf;
     psfConvolver = new Convolver();
-    psfConvolver->SetupPSF(psfPixels, nColumns_psf, nRows_psf, normalizePSF);
+    psfConvolver->SetupPSF(psfPixels, nColumns_psf, nRows_psf, normalizePSF,
+    						separablePSFTolerance);
     psfConvolver->SetMaxThreads(maxRequestedThreads);
     doConvolution = true;
   }
@@ -185,23 +226,27 @@ void OversampledRegion::AddPSFVector( double *psfPixels, int nColumns_psf, int n
 ///    x1,y1 = x,y location of lower-left corner of image region w/in main image (IRAF-numbering)
 ///    nBaseColumns,nBaseRows = x,y size of region in main ("base") image
 ///    nColumnsMain, nRowsMain = x,y size of full main model ("base") image
+///    nColumnsPadding_main, nRowsPadding_main = padding on each side of the data image
+///       within the main model image
+/// The oversampled model image is padded by half the oversampled PSF size on each
+/// side, and only the region itself is convolved (see Convolver::SetOutputRegion).
 int OversampledRegion::SetupModelImage( int x1, int y1, int nBaseColumns, int nBaseRows, 
-						int nColumnsMain, int nRowsMain, int nColumnsPSF_main,
-						int nRowsPSF_main, int oversampScale )
+						int nColumnsMain, int nRowsMain, int nColumnsPadding_main,
+						int nRowsPadding_main, int oversampScale )
 {
   int  result = 0;
 
   assert( (nBaseColumns >= 1) && (nBaseRows >= 1) && (oversampScale >= 1) );
   assert( (nColumnsMain >= 1) && (nRowsMain >= 1) );
-  assert( (nColumnsPSF_main >= 0) && (nRowsPSF_main >= 0) );
+  assert( (nColumnsPadding_main >= 0) && (nRowsPadding_main >= 0) );
   
   // info about main image (including where LL corner of region is within main image)
   x1_region = x1;
   y1_region = y1;
   nMainImageColumns = nColumnsMain;
   nMainImageRows = nRowsMain;
-  nMainPSFColumns = nColumnsPSF_main;
-  nMainPSFRows = nRowsPSF_main;
+  nMainPaddingColumns = nColumnsPadding_main;
+  nMainPaddingRows = nRowsPadding_main;
   
   // oversampling info and setup
   oversamplingScale = oversampScale;
@@ -215,9 +260,16 @@ int OversampledRegion::SetupModelImage( int x1, int y1, int nBaseColumns, int nB
   nRegionVals = nRegionColumns*nRegionRows;
   
   if (doConvolution) {
-    nModelColumns = nRegionColumns + 2*nPSFColumns;
-    nModelRows = nRegionRows + 2*nPSFRows;
+    nPaddingColumns = nPSFColumns / 2;
+    nPaddingRows = nPSFRows / 2;
+    nModelColumns = nRegionColumns + 2*nPaddingColumns;
+    nModelRows = nRegionRows + 2*nPaddingRows;
     psfConvolver->SetupImage(nModelColumns, nModelRows);
+    psfConvolver->SetOutputRegion(nPaddingColumns, nPaddingRows, nRegionColumns, nRegionRows);
+    psfConvolver->SetArena(arena);
+    if (fftwWisdomFile.size() > 0)
+      psfConvolver->SetFFTWWisdomFile(fftwWisdomFile);
+    psfConvolver->SetConvolutionMethod(convolutionMethod);
     result = psfConvolver->DoFullSetup(debugLevel);
     if (result < 0) {
       fprintf(stderr, "*** Error returned from Convolver::DoFullSetup!\n");
@@ -226,28 +278,113 @@ int OversampledRegion::SetupModelImage( int x1, int y1, int nBaseColumns, int nB
     nModelVals = nModelColumns*nModelRows;
   }
   else {
+    nPaddingColumns = nPaddingRows = 0;
     nModelColumns = nRegionColumns;
     nModelRows = nRegionRows;
     nModelVals = nRegionVals;
   }
   
-  // Allocate modelimage vector
-  // WARNING: Possible memory leak (if this function is called more than once)!
-  //    If this function *is* called again, then nModelVals could be different
-  //    from the first call, in wich case we'd need to realloc modelVector
-  modelVector = (double *) calloc((size_t)nModelVals, sizeof(double));
+  // Allocate modelimage vector (if this function is called more than once,
+  // nModelVals could be different from the first call, so we start over)
+  if (modelVectorAllocated)
+    arena->Free(modelVector);
+  modelVector = arena->AllocateArray<double>((size_t)nModelVals);
   if (modelVector == NULL) {
     fprintf(stderr, "*** ERROR: Unable to allocate memory for oversampled model image!\n");
     fprintf(stderr, "    (Requested image size was %d pixels)\n", nModelVals);
     return -1;
   }
   modelVectorAllocated = true;
+
+  // Pixel coordinates and tiles for computing the model image
+  modelXVals.resize(nModelColumns);
+  modelYVals.resize(nModelRows);
+  for (int j = 0; j < nModelColumns; j++)
+    modelXVals[j] = x1_region + startX_offset + (j - nPaddingColumns)*subpixFrac;   // Iraf counting: first column = 1
+                                                 // (note that nPaddingColumns = 0 if not doing PSF convolution)
+  for (int i = 0; i < nModelRows; i++)
+    modelYVals[i] = y1_region + startY_offset + (i - nPaddingRows)*subpixFrac;      // Iraf counting: first row = 1
+  MakeImageTiles(nModelColumns, nModelRows, modelTiles);
+
   setupComplete = true;
   
   return 0;
 }
 
 
+/* ---------------- Clone ---------------------------------------------- */
+/// Returns a new OversampledRegion for the same region and oversampled PSF, which
+/// can be used at the same time as this one (e.g., in a different thread). The
+/// copy has its own model image (allocated from cloneArena) and its own copy of
+/// the Convolver (see Convolver::Clone); the PSF transform and PsfInterpolator
+/// are shared with this object, which must outlive the copy.
+/// Returns NULL if SetupModelImage() hasn't been called or memory allocation failed.
+OversampledRegion * OversampledRegion::Clone( AlignedArena *cloneArena )
+{
+  OversampledRegion  *theCopy;
+  
+  if (! setupComplete) {
+    fprintf(stderr, "*** ERROR: OversampledRegion::Clone called before SetupModelImage!\n");
+    return NULL;
+  }
+  
+  theCopy = new OversampledRegion();
+  theCopy->SetArena(cloneArena);
+  theCopy->ompChunkSize = ompChunkSize;
+  theCopy->maxRequestedThreads = maxRequestedThreads;
+  theCopy->debugLevel = debugLevel;
+  theCopy->oversamplingScale = oversamplingScale;
+  theCopy->subpixFrac = subpixFrac;
+  theCopy->startX_offset = startX_offset;
+  theCopy->startY_offset = startY_offset;
+  theCopy->nPSFColumns = nPSFColumns;
+  theCopy->nPSFRows = nPSFRows;
+  theCopy->nPaddingColumns = nPaddingColumns;
+  theCopy->nPaddingRows = nPaddingRows;
+  theCopy->nRegionColumns = nRegionColumns;
+  theCopy->nRegionRows = nRegionRows;
+  theCopy->nRegionVals = nRegionVals;
+  theCopy->x1_region = x1_region;
+  theCopy->y1_region = y1_region;
+  theCopy->nMainImageColumns = nMainImageColumns;
+  theCopy->nMainImageRows = nMainImageRows;
+  theCopy->nMainPaddingColumns = nMainPaddingColumns;
+  theCopy->nMainPaddingRows = nMainPaddingRows;
+  theCopy->nModelColumns = nModelColumns;
+  theCopy->nModelRows = nModelRows;
+  theCopy->nModelVals = nModelVals;
+  theCopy->debugImageName = debugImageName;
+  theCopy->fftwWisdomFile = fftwWisdomFile;
+  theCopy->convolutionMethod = convolutionMethod;
+  theCopy->separablePSFTolerance = separablePSFTolerance;
+  theCopy->psfInterpolator = psfInterpolator;   // shared, so psfInterpolator_allocated = false
+  theCopy->modelTiles = modelTiles;
+  theCopy->modelTileOrder = modelTileOrder;
+  theCopy->modelXVals = modelXVals;
+  theCopy->modelYVals = modelYVals;
+
+  if (doConvolution) {
+    theCopy->psfConvolver = psfConvolver->Clone(cloneArena);
+    if (theCopy->psfConvolver == NULL) {
+      delete theCopy;
+      return NULL;
+    }
+    theCopy->doConvolution = true;
+  }
+  theCopy->modelVector = cloneArena->AllocateArray<double>((size_t)nModelVals);
+  if (theCopy->modelVector == NULL) {
+    fprintf(stderr, "*** ERROR: Unable to allocate memory for oversampled model image!\n");
+    fprintf(stderr, "    (Requested image size was %d pixels)\n", nModelVals);
+    delete theCopy;
+    return NULL;
+  }
+  theCopy->modelVectorAllocated = true;
+  theCopy->setupComplete = true;
+  
+  return theCopy;
+}
+
+
 /* ---------------- ComputeRegionAndDownsample ------------------------- */
 /// This is the main method, which computes the oversampled (sub-region) model image,
 /// then downsamples it to the main image pixel scale and copies it into the main
@@ -258,43 +395,47 @@ int OversampledRegion::SetupModelImage( int x1, int y1, int nBaseColumns, int nB
 /// *this* method.
 void OversampledRegion::ComputeRegionAndDownsample( double *mainImageVector, 
 					vector<FunctionObject *> functionObjectVect, int nFunctions  )
+{
+  ComputeRegion(functionObjectVect, nFunctions);
+  DownsampleRegion(mainImageVector);
+}
+
+
+/* ---------------- EstimateCost --------------------------------------- */
+/// Returns the (relative) cost of ComputeRegion, for scheduling regions among
+/// threads: the number of pixels in the oversampled model image, since computing
+/// the functions and convolving both scale (roughly) with this.
+double OversampledRegion::EstimateCost( )
+{
+  return (double)nModelVals;
+}
+
+
+/* ---------------- ComputeRegion -------------------------------------- */
+/// Computes the oversampled (and PSF-convolved) model image of the region, without
+/// touching the main image; this only modifies this object and the PointSource
+/// functions in functionObjectVect (which are given this region's PsfInterpolator),
+/// so different regions can be computed at the same time if they don't share
+/// PointSource objects. (Parallel loops inside are then run by the calling thread.)
+void OversampledRegion::ComputeRegion( vector<FunctionObject *>& functionObjectVect, 
+										int nFunctions )
 {
   int   i, j, n, status;
-  double  x, y, newValSum, tempSum, adjVal, storedError;
+  double  y, tempSum, adjVal;
+  double  *modelRow;
   string  outputName;
 
 // Compute oversampled-region image, using OpenMP for speed
 // (possibly slower if sub-region is really small, but in that case this whole
 // function will only take a small part of total runtime)
+// As in ModelObject::CreateModelImage, the image is computed tile by tile (see
+// image_tiles.cpp), most expensive tiles first
 
   // 1. Do main image computation (all non-PointSource functions)
-#pragma omp parallel private(i,j,n,x,y,newValSum,tempSum,adjVal,storedError)
-  {
-  #pragma omp for schedule (static, ompChunkSize)
-  // single-loop code which is ~ same in general case as double-loop, and
-  // faster for case of small image + many cores (André Luiz de Amorim suggestion)
-  for (int k = 0; k < nModelVals; k++) {
-    j = k % nModelColumns;
-    i = k / nModelColumns;
-    y = y1_region + startY_offset + (i - nPSFRows)*subpixFrac;              // Iraf counting: first row = 1
-                                                 // (note that nPSFRows = 0 if not doing PSF convolution)
-    x = x1_region + startX_offset + (j - nPSFColumns)*subpixFrac;           // Iraf counting: first column = 1
-                                                 // (note that nPSFColumns = 0 if not doing PSF convolution)
-    newValSum = 0.0;
-    storedError = 0.0;
-    for (n = 0; n < nFunctions; n++) {
-      if (! functionObjectVect[n]->IsPointSource()) {
-        // Kahan summation algorithm
-        adjVal = functionObjectVect[n]->GetValue(x, y) - storedError;
-        tempSum = newValSum + adjVal;
-        storedError = (tempSum - newValSum) - adjVal;
-        newValSum = tempSum;
-      }
-    }
-    modelVector[i*nModelColumns + j] = newValSum;
-  }
-  
-  } // end omp parallel section
+  OrderTilesByCost(modelTiles, &modelXVals[0], &modelYVals[0], functionObjectVect, nFunctions,
+  					modelTileOrder);
+  ComputeTiledImage(modelVector, nModelColumns, modelTiles, modelTileOrder, &modelXVals[0],
+  					&modelYVals[0], functionObjectVect, nFunctions);
 
 #ifdef DEBUG
   if (debugLevel > 0) {
@@ -330,35 +471,88 @@ void OversampledRegion::ComputeRegionAndDownsample( double *mainImageVector,
     if (functionObjectVect[n]->IsPointSource())
       functionObjectVect[n]->AddPsfInterpolator(psfInterpolator);
 
-#pragma omp parallel private(i,j,n,x,y,newValSum,tempSum,adjVal,storedError)
+  // Only visit pixels inside each point source's footprint (if it reports one);
+  // footprints are converted to conservative ranges of oversampled rows & columns
+  // (recall that x = x1_region + startX_offset + (j - nPaddingColumns)*subpixFrac)
+  double  xMin, xMax, yMin, yMax;
+  bool  rowTouched;
+  vector<int>  psIndices, psColMin, psColMax, psRowMin, psRowMax;
+  for (n = 0; n < nFunctions; n++) {
+    if (functionObjectVect[n]->IsPointSource()) {
+      int  colMin = 0;
+      int  colMax = nModelColumns - 1;
+      int  rowMin = 0;
+      int  rowMax = nModelRows - 1;
+      if (functionObjectVect[n]->GetFootprint(xMin, xMax, yMin, yMax)) {
+        colMin = (int)fmax(0.0, floor((xMin - x1_region - startX_offset)/subpixFrac) + nPaddingColumns);
+        colMax = (int)fmin((double)(nModelColumns - 1), 
+        					ceil((xMax - x1_region - startX_offset)/subpixFrac) + nPaddingColumns);
+        rowMin = (int)fmax(0.0, floor((yMin - y1_region - startY_offset)/subpixFrac) + nPaddingRows);
+        rowMax = (int)fmin((double)(nModelRows - 1), 
+        					ceil((yMax - y1_region - startY_offset)/subpixFrac) + nPaddingRows);
+      }
+      if ((colMin <= colMax) && (rowMin <= rowMax)) {
+        psIndices.push_back(n);
+        psColMin.push_back(colMin);
+        psColMax.push_back(colMax);
+        psRowMin.push_back(rowMin);
+        psRowMax.push_back(rowMax);
+      }
+    }
+  }
+  int  nPointSources = (int)psIndices.size();
+
+  if (nPointSources > 0) {
+#pragma omp parallel private(i,j,n,y,tempSum,adjVal,modelRow,rowTouched)
   {
-  #pragma omp for schedule (static, ompChunkSize)
-  for (long k = 0; k < nModelVals; k++) {
-    j = k % nModelColumns;
-    i = k / nModelColumns;
-    y = y1_region + startY_offset + (i - nPSFRows)*subpixFrac;
-    x = x1_region + startX_offset + (j - nPSFColumns)*subpixFrac;
-    newValSum = 0.0;
-    storedError = 0.0;
-    for (n = 0; n < nFunctions; n++) {
-      if (functionObjectVect[n]->IsPointSource()) {
+  vector<double>  yVals(nModelColumns), newVals(nModelColumns);
+  vector<double>  newValSums(nModelColumns), storedErrors(nModelColumns);
+
+  #pragma omp for schedule (dynamic, 1)
+  for (i = 0; i < nModelRows; i++) {
+    y = y1_region + startY_offset + (i - nPaddingRows)*subpixFrac;
+    rowTouched = false;
+    for (int m = 0; m < nPointSources; m++) {
+      if ((i < psRowMin[m]) || (i > psRowMax[m]))
+        continue;
+      if (! rowTouched) {
+        for (j = 0; j < nModelColumns; j++) {
+          yVals[j] = y;
+          newValSums[j] = 0.0;
+          storedErrors[j] = 0.0;
+        }
+        rowTouched = true;
+      }
+      n = psIndices[m];
+      functionObjectVect[n]->ComputeValues(&modelXVals[psColMin[m]], &yVals[psColMin[m]], 
+      							&newVals[psColMin[m]], psColMax[m] - psColMin[m] + 1);
+      for (j = psColMin[m]; j <= psColMax[m]; j++) {
         // Use Kahan summation algorithm
-        adjVal = functionObjectVect[n]->GetValue(x, y) - storedError;
-        tempSum = newValSum + adjVal;
-        storedError = (tempSum - newValSum) - adjVal;
-        newValSum = tempSum;
+        adjVal = newVals[j] - storedErrors[j];
+        tempSum = newValSums[j] + adjVal;
+        storedErrors[j] = (tempSum - newValSums[j]) - adjVal;
+        newValSums[j] = tempSum;
       }
     }
-    modelVector[i*nModelColumns + j] += newValSum;
+    if (rowTouched) {
+      modelRow = modelVector + i*nModelColumns;
+      for (j = 0; j < nModelColumns; j++)
+        modelRow[j] += newValSums[j];
+    }
   }
   } // end omp parallel section
+  }
+}
 
 
-
-  // downsample & copy into main image
-  DownsampleAndReplace(modelVector, nModelColumns,nModelRows,nPSFColumns,nPSFRows, 
-  						mainImageVector, nMainImageColumns,nMainImageRows,nMainPSFColumns,
-  						nMainPSFRows, x1_region,y1_region, oversamplingScale, debugLevel);
+/* ---------------- DownsampleRegion ----------------------------------- */
+/// Downsamples the oversampled model image computed by ComputeRegion to the main
+/// image pixel scale, and copies it into the main image (mainImageVector).
+void OversampledRegion::DownsampleRegion( double *mainImageVector )
+{
+  DownsampleAndReplace(modelVector, nModelColumns,nModelRows,nPaddingColumns,nPaddingRows, 
+  						mainImageVector, nMainImageColumns,nMainImageRows,nMainPaddingColumns,
+  						nMainPaddingRows, x1_region,y1_region, oversamplingScale, debugLevel);
 }
 
 
@@ -12,7 +12,9 @@
 #include <string>
 #include <vector>
 
+#include "aligned_arena.h"
 #include "convolver.h"
+#include "image_tiles.h"
 #include "function_objects/function_object.h"
 #include "function_objects/psf_interpolators.h"
 
@@ -38,15 +40,31 @@ class OversampledRegion
     
     void SetMaxThreads( int maximumThreadNumber );
 
+    void SetArena( AlignedArena *externalArena );
+
     void SetDebugLevel( int debuggingLevel );
 
+    void SetFFTWWisdomFile( const string& wisdomFileName );
+
+    void SetConvolutionMethod( int method );
+
+    void SetSeparablePSFTolerance( double tolerance );
+
     int SetupModelImage( int x1, int y1, int nBaseColumns, int nBaseRows, 
-    					int nColumnsMain, int nRowsMain, int nColumnsPSF_main,
-    					int nRowsPSF_main, int oversampScale );
+    					int nColumnsMain, int nRowsMain, int nColumnsPadding_main,
+    					int nRowsPadding_main, int oversampScale );
     					
     void ComputeRegionAndDownsample( double *mainImageVector, 
     				vector<FunctionObject *> functionObjectVect, int nFunctionObjects );
 
+    void ComputeRegion( vector<FunctionObject *>& functionObjectVect, int nFunctionObjects );
+
+    void DownsampleRegion( double *mainImageVector );
+
+    double EstimateCost( );
+
+    OversampledRegion * Clone( AlignedArena *cloneArena );
+
 
   private:
   // Data members:
@@ -55,15 +73,24 @@ class OversampledRegion
     int  oversamplingScale;
     double  subpixFrac, startX_offset, startY_offset;
     int  nPSFColumns, nPSFRows;
+    int  nPaddingColumns, nPaddingRows;   // padding on each side of region in model image
     int  nRegionColumns, nRegionRows, nRegionVals;
     int  x1_region, y1_region;
-    int  nMainImageColumns, nMainImageRows, nMainPSFColumns, nMainPSFRows;
+    int  nMainImageColumns, nMainImageRows, nMainPaddingColumns, nMainPaddingRows;
     int  nModelColumns, nModelRows, nModelVals;
     bool  doConvolution, setupComplete, modelVectorAllocated;
     double  *modelVector;
+    AlignedArena  ownArena;   // used unless SetArena() is called
+    AlignedArena  *arena;
     string  debugImageName;
+    string  fftwWisdomFile;
+    int  convolutionMethod;
+    double  separablePSFTolerance;
     PsfInterpolator *psfInterpolator;
     bool  psfInterpolator_allocated;
+    vector<ImageTile>  modelTiles;   // for computing the model image (see image_tiles.h)
+    vector<int>  modelTileOrder;
+    vector<double>  modelXVals, modelYVals;
 
 };
 
@@ -0,0 +1,206 @@
+/* FILE: psf_transform_cache.cpp --------------------------------------- */
+/*
+ *   Process-wide cache of PSF Fourier transforms and the FFTW plans which go with
+ * them, shared by Convolver objects (e.g., the main model-image Convolver and
+ * those of oversampled regions, or the Convolvers of many ModelObjects in the same
+ * process) which have the same PSF and padded image size.
+ *
+ *   The number of entries is small (one per distinct PSF and padded size), so
+ * entries are kept in a simple vector and found by linear search on the hash.
+ */
+
+// Copyright 2018 by Peter Erwin.
+//
+// This file is part of Imfit.
+//
+// Imfit is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Imfit is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with Imfit.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+
+#include "fftw3.h"
+
+#include "psf_transform_cache.h"
+
+using namespace std;
+
+
+// FNV-1a (64-bit) hash constants
+const uint64_t  FNV_OFFSET_BASIS = 14695981039346656037ULL;
+const uint64_t  FNV_PRIME = 1099511628211ULL;
+
+
+/* ------------------- Function Prototypes ----------------------------- */
+
+static uint64_t HashPSF( const double *psfPixels, int nColumns_psf, int nRows_psf );
+
+
+// All current entries
+static vector<PsfTransform *>  cachedTransforms;
+
+
+
+/* ---------------- FUNCTION: FindPsfTransform ------------------------- */
+
+PsfTransform * FindPsfTransform( const double *psfPixels, int nColumns_psf, int nRows_psf,
+								int nColumns_padded, int nRows_padded, bool normalized,
+								bool singlePrecision, unsigned planFlags, int nThreads )
+{
+  uint64_t  hash = HashPSF(psfPixels, nColumns_psf, nRows_psf);
+  long  nPixels_psf = (long)nColumns_psf * nRows_psf;
+  PsfTransform  *match = NULL;
+  
+#pragma omp critical (psf_transform_cache)
+  {
+  for (int n = 0; n < (int)cachedTransforms.size(); n++) {
+    PsfTransform  *entry = cachedTransforms[n];
+    if ((entry->hash == hash) && (entry->nColumns_psf == nColumns_psf) 
+    		&& (entry->nRows_psf == nRows_psf) && (entry->nColumns_padded == nColumns_padded)
+    		&& (entry->nRows_padded == nRows_padded) && (entry->normalized == normalized)
+    		&& (entry->singlePrecision == singlePrecision) && (entry->planFlags == planFlags)
+    		&& (entry->nThreads == nThreads) && (entry->plansCreated)
+    		&& (memcmp(&(entry->psfPixels[0]), psfPixels, nPixels_psf*sizeof(double)) == 0)) {
+      entry->nReferences += 1;
+      match = entry;
+      break;
+    }
+  }
+  }
+  return match;
+}
+
+
+/* ---------------- FUNCTION: AddPsfTransform -------------------------- */
+
+PsfTransform * AddPsfTransform( const double *psfPixels, int nColumns_psf, int nRows_psf,
+								int nColumns_padded, int nRows_padded, bool normalized,
+								bool singlePrecision, unsigned planFlags, int nThreads )
+{
+  PsfTransform  *entry;
+  long  nPixels_psf = (long)nColumns_psf * nRows_psf;
+  long  nPixels_padded_complex = (long)nRows_padded * (nColumns_padded/2 + 1);
+  
+  entry = new PsfTransform;
+  entry->hash = HashPSF(psfPixels, nColumns_psf, nRows_psf);
+  entry->psfPixels.assign(psfPixels, psfPixels + nPixels_psf);
+  entry->nColumns_psf = nColumns_psf;
+  entry->nRows_psf = nRows_psf;
+  entry->nColumns_padded = nColumns_padded;
+  entry->nRows_padded = nRows_padded;
+  entry->normalized = normalized;
+  entry->singlePrecision = singlePrecision;
+  entry->planFlags = planFlags;
+  entry->nThreads = nThreads;
+  entry->psf_fft_cmplx = NULL;
+#ifndef NO_FFTW_FLOAT
+  entry->psf_fft_cmplx_sp = NULL;
+  if (singlePrecision)
+    entry->psf_fft_cmplx_sp = (fftwf_complex *)fftwf_malloc(sizeof(fftwf_complex) * nPixels_padded_complex);
+  else
+#endif
+    entry->psf_fft_cmplx = (fftw_complex *)fftw_malloc(sizeof(fftw_complex) * nPixels_padded_complex);
+  entry->plansCreated = false;
+  entry->nReferences = 1;
+  if ((entry->psf_fft_cmplx == NULL)
+#ifndef NO_FFTW_FLOAT
+  		&& (entry->psf_fft_cmplx_sp == NULL)
+#endif
+  		) {
+    delete entry;
+    return NULL;
+  }
+  
+#pragma omp critical (psf_transform_cache)
+  cachedTransforms.push_back(entry);
+  return entry;
+}
+
+
+/* ---------------- FUNCTION: ReleasePsfTransform ---------------------- */
+
+void ReleasePsfTransform( PsfTransform *psfTransform )
+{
+  bool  lastReference = false;
+  
+  if (psfTransform == NULL)
+    return;
+  // (once the entry has been removed from the list, no one else can find it)
+#pragma omp critical (psf_transform_cache)
+  {
+  psfTransform->nReferences -= 1;
+  if (psfTransform->nReferences == 0) {
+    lastReference = true;
+    for (int n = 0; n < (int)cachedTransforms.size(); n++) {
+      if (cachedTransforms[n] == psfTransform) {
+        cachedTransforms.erase(cachedTransforms.begin() + n);
+        break;
+      }
+    }
+  }
+  }
+  if (! lastReference)
+    return;
+  
+#ifndef NO_FFTW_FLOAT
+  if (psfTransform->singlePrecision) {
+    if (psfTransform->plansCreated) {
+      fftwf_destroy_plan(psfTransform->plan_inputImage_sp);
+      fftwf_destroy_plan(psfTransform->plan_inverse_sp);
+    }
+    fftwf_free(psfTransform->psf_fft_cmplx_sp);
+    delete psfTransform;
+    return;
+  }
+#endif
+  if (psfTransform->plansCreated) {
+    fftw_destroy_plan(psfTransform->plan_inputImage);
+    fftw_destroy_plan(psfTransform->plan_inverse);
+  }
+  fftw_free(psfTransform->psf_fft_cmplx);
+  delete psfTransform;
+}
+
+
+/* ---------------- FUNCTION: NumberOfCachedPsfTransforms -------------- */
+
+int NumberOfCachedPsfTransforms( )
+{
+  int  nEntries;
+  
+#pragma omp critical (psf_transform_cache)
+  nEntries = (int)cachedTransforms.size();
+  return nEntries;
+}
+
+
+/* ---------------- FUNCTION: HashPSF ---------------------------------- */
+/// FNV-1a hash of the PSF dimensions and pixel values (as bytes).
+static uint64_t HashPSF( const double *psfPixels, int nColumns_psf, int nRows_psf )
+{
+  uint64_t  hash = FNV_OFFSET_BASIS;
+  long  nPixels_psf = (long)nColumns_psf * nRows_psf;
+  const unsigned char  *bytes = (const unsigned char *)psfPixels;
+  
+  hash = (hash ^ (uint64_t)nColumns_psf) * FNV_PRIME;
+  hash = (hash ^ (uint64_t)nRows_psf) * FNV_PRIME;
+  for (long k = 0; k < nPixels_psf*(long)sizeof(double); k++)
+    hash = (hash ^ bytes[k]) * FNV_PRIME;
+  return hash;
+}
+
+
+
+/* END OF FILE: psf_transform_cache.cpp -------------------------------- */
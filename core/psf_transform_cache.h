@@ -0,0 +1,73 @@
+/** @file
+ * \brief Process-wide cache of PSF Fourier transforms and FFTW plans, so that
+ *        Convolvers with the same PSF and padded image size can share them
+ *
+ */
+/*    Entries are keyed on the (normalized) PSF pixel values -- via a hash, with
+ * a full comparison on a hash match -- and dimensions, the padded image size, the
+ * normalization flag, the precision, and the FFTW planner settings. Each entry
+ * holds the PSF transform and the forward (image) and inverse FFTW plans, which
+ * are used read-only (with the "new-array" execute functions) by every Convolver
+ * holding a reference to the entry; the entry is freed when its last reference
+ * is released.
+ *    Changes to the list of entries and to their reference counts are made in
+ * an OpenMP critical section, so Convolvers may be deleted on different threads;
+ * but creating an entry's plans (and destroying them, when its last reference is
+ * released) is FFTW planning, which is *not* thread-safe, so Convolvers should
+ * only be set up (and deleted) while no other thread is creating FFTW plans.
+ */
+
+#ifndef _PSF_TRANSFORM_CACHE_H_
+#define _PSF_TRANSFORM_CACHE_H_
+
+#include <stdint.h>
+#include <vector>
+
+#include "fftw3.h"
+
+using namespace std;
+
+
+/// Cached PSF transform and FFTW plans for one PSF and padded size
+typedef struct {
+  // key
+  uint64_t  hash;
+  vector<double>  psfPixels;
+  int  nColumns_psf, nRows_psf;
+  int  nColumns_padded, nRows_padded;
+  bool  normalized, singlePrecision;
+  unsigned  planFlags;
+  int  nThreads;
+  // shared (read-only) data; only the single-precision transform and plans are
+  // used in single-precision mode
+  fftw_complex  *psf_fft_cmplx;
+  fftw_plan  plan_inputImage, plan_inverse;
+#ifndef NO_FFTW_FLOAT
+  fftwf_complex  *psf_fft_cmplx_sp;
+  fftwf_plan  plan_inputImage_sp, plan_inverse_sp;
+#endif
+  bool  plansCreated;
+  int  nReferences;
+} PsfTransform;
+
+
+/// Returns the cached entry matching the arguments (adding a reference to it),
+/// or NULL if there isn't one
+PsfTransform * FindPsfTransform( const double *psfPixels, int nColumns_psf, int nRows_psf,
+								int nColumns_padded, int nRows_padded, bool normalized,
+								bool singlePrecision, unsigned planFlags, int nThreads );
+
+/// Adds a new entry (with one reference) and allocates its PSF transform, which
+/// the caller must fill in along with the plans; returns NULL if allocation fails
+PsfTransform * AddPsfTransform( const double *psfPixels, int nColumns_psf, int nRows_psf,
+								int nColumns_padded, int nRows_padded, bool normalized,
+								bool singlePrecision, unsigned planFlags, int nThreads );
+
+/// Removes a reference to the entry; frees it when no references remain
+void ReleasePsfTransform( PsfTransform *psfTransform );
+
+/// Returns the number of entries currently in the cache
+int NumberOfCachedPsfTransforms( );
+
+
+#endif  // _PSF_TRANSFORM_CACHE_H_
@@ -49,6 +49,20 @@ ModelObject* SetupModelObject( OptionsBase *options, vector<int> nColumnsRowsVec
   if (options->maxThreadsSet)
     newModelObj->SetMaxThreads(options->maxThreads);
   newModelObj->SetDebugLevel(options->debugLevel);
+  if (options->tabulateProfiles)
+    newModelObj->SetProfileTabulation(true);
+  if (options->adaptiveSubsampling)
+    newModelObj->SetAdaptiveSubsampling(true);
+  if (options->singlePrecision)
+    newModelObj->SetSinglePrecision(true);
+  if (options->fftwWisdomFile.size() > 0)
+    newModelObj->SetFFTWWisdomFile(options->fftwWisdomFile);
+  if (options->separablePSFTolerance > 0.0)
+    newModelObj->SetSeparablePSFTolerance(options->separablePSFTolerance);
+  if (! options->croppedConvolution)
+    newModelObj->SetCroppedConvolution(false);
+  if (options->fftTileSize > 0)
+    newModelObj->SetFFTTileSize(options->fftTileSize);
 
 
   // Add PSF image vector, if present (needs to be added prior to image data or
@@ -0,0 +1,272 @@
+/* FILE: spatial_convolution.cpp --------------------------------------- */
+/*
+ *   Direct (spatial-domain) convolution, used by Convolver and Convolver1D in
+ * place of FFT convolution when the PSF is small enough that this is faster.
+ *
+ *   The output is accumulated one image row at a time: for each PSF pixel, the
+ * corresponding (shifted) input row is scaled and added to the output row. The
+ * inner loop runs over contiguous pixels with no branches, so it is vectorized
+ * by the compiler (with "omp simd" as a hint); rows are divided among OpenMP
+ * threads when the image is large enough for this to pay off.
+ *
+ *   Separable approximations are computed with one-sided Jacobi SVD (PSF images
+ * are small, and this is simple and accurate); the row and column passes of
+ * separable convolution are direct convolutions with 1-row and 1-column kernels.
+ */
+
+// Copyright 2018 by Peter Erwin.
+//
+// This file is part of Imfit.
+//
+// Imfit is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Imfit is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with Imfit.  If not, see <http://www.gnu.org/licenses/>.
+
+
+#include <stdio.h>
+#include <math.h>
+#include <vector>
+#include <algorithm>
+
+#include "spatial_convolution.h"
+
+using namespace std;
+
+
+// Estimated cost of one (vectorized) multiply-add of direct convolution,
+// relative to the per-point cost of one radix-2 FFT pass (see FFTCostPerPoint
+// in convolver.cpp)
+const double  DIRECT_COST_PER_TERM = 0.2;
+
+// Minimum number of multiply-adds for which we use multiple OpenMP threads
+const long  MIN_PARALLEL_TERMS = 200000;
+
+// Jacobi SVD: maximum number of sweeps, and convergence threshold for the
+// (cosine of the) angle between two columns
+const int  MAX_JACOBI_SWEEPS = 60;
+const double  JACOBI_TOLERANCE = 1.0e-15;
+
+
+
+/* ---------------- FUNCTION: ConvolveDirect2D ------------------------- */
+
+template <typename T>
+void ConvolveDirect2D( const T *input, int nColumns, int nRows, const double *kernel,
+						int nColumns_kernel, int nRows_kernel, double *output )
+{
+  int  centerX = nColumns_kernel / 2;
+  int  centerY = nRows_kernel / 2;
+  long  nTerms = (long)nColumns * nRows * nColumns_kernel * nRows_kernel;
+
+#pragma omp parallel for schedule (static) if (nTerms >= MIN_PARALLEL_TERMS)
+  for (int y = 0; y < nRows; y++) {
+    double  *outputRow = output + (long)y*nColumns;
+    for (int x = 0; x < nColumns; x++)
+      outputRow[x] = 0.0;
+    for (int i = 0; i < nRows_kernel; i++) {
+      int  yInput = y - i + centerY;
+      if ((yInput < 0) || (yInput >= nRows))
+        continue;
+      for (int j = 0; j < nColumns_kernel; j++) {
+        double  kernelValue = kernel[(long)i*nColumns_kernel + j];
+        // output pixel x gets input pixel x + shift, for the range of x where
+        // the latter is within the image
+        int  shift = centerX - j;
+        int  xStart = (shift < 0) ? -shift : 0;
+        int  xEnd = (shift > 0) ? nColumns - shift : nColumns;
+        const T  *inputRow = input + (long)yInput*nColumns + shift;
+#pragma omp simd
+        for (int x = xStart; x < xEnd; x++)
+          outputRow[x] += kernelValue * inputRow[x];
+      }
+    }
+  }
+}
+
+template void ConvolveDirect2D<double>( const double *input, int nColumns, int nRows,
+						const double *kernel, int nColumns_kernel, int nRows_kernel,
+						double *output );
+template void ConvolveDirect2D<float>( const float *input, int nColumns, int nRows,
+						const double *kernel, int nColumns_kernel, int nRows_kernel,
+						double *output );
+
+
+/* ---------------- FUNCTION: ConvolveSeparable2D ---------------------- */
+
+template <typename T>
+void ConvolveSeparable2D( const T *input, int nColumns, int nRows, int rank,
+						const double *rowKernels, int nColumns_kernel, const double *columnKernels,
+						int nRows_kernel, double *workspace, double *output )
+{
+  long  nPixels = (long)nColumns * nRows;
+  int  centerY = nRows_kernel / 2;
+  long  nTerms = nPixels * nRows_kernel;
+
+  for (long z = 0; z < nPixels; z++)
+    output[z] = 0.0;
+  for (int k = 0; k < rank; k++) {
+    const double  *columnKernel = columnKernels + (long)k*nRows_kernel;
+    // row pass: workspace = input convolved with 1-row kernel
+    ConvolveDirect2D(input, nColumns, nRows, rowKernels + (long)k*nColumns_kernel,
+    				nColumns_kernel, 1, workspace);
+    // column pass, added to output
+#pragma omp parallel for schedule (static) if (nTerms >= MIN_PARALLEL_TERMS)
+    for (int y = 0; y < nRows; y++) {
+      double  *outputRow = output + (long)y*nColumns;
+      for (int i = 0; i < nRows_kernel; i++) {
+        int  yInput = y - i + centerY;
+        if ((yInput < 0) || (yInput >= nRows))
+          continue;
+        double  kernelValue = columnKernel[i];
+        const double  *inputRow = workspace + (long)yInput*nColumns;
+#pragma omp simd
+        for (int x = 0; x < nColumns; x++)
+          outputRow[x] += kernelValue * inputRow[x];
+      }
+    }
+  }
+}
+
+template void ConvolveSeparable2D<double>( const double *input, int nColumns, int nRows,
+						int rank, const double *rowKernels, int nColumns_kernel,
+						const double *columnKernels, int nRows_kernel, double *workspace,
+						double *output );
+template void ConvolveSeparable2D<float>( const float *input, int nColumns, int nRows,
+						int rank, const double *rowKernels, int nColumns_kernel,
+						const double *columnKernels, int nRows_kernel, double *workspace,
+						double *output );
+
+
+/* ---------------- FUNCTION: SeparableKernelApproximation ------------- */
+/// Computes the SVD kernel = U S V^T with one-sided Jacobi rotations of the
+/// kernel's columns (after which column j = s_j u_j, and the accumulated rotations
+/// give V); the rank-k approximation uses the k largest singular values, and its
+/// relative error is sqrt(sum of remaining s_j^2 / sum of all s_j^2).
+int SeparableKernelApproximation( const double *kernel, int nColumns, int nRows,
+						double tolerance, int maxRank, double *rowKernels, double *columnKernels,
+						double *relativeError )
+{
+  // columns of the kernel (stored contiguously) and of V
+  vector<double>  A((long)nColumns*nRows), V((long)nColumns*nColumns, 0.0);
+  vector<double>  sigmaSquared(nColumns), tailSums(nColumns + 1);
+  vector< pair<double, int> >  order(nColumns);
+  double  total;
+  int  rank;
+
+  for (int i = 0; i < nRows; i++)
+    for (int j = 0; j < nColumns; j++)
+      A[(long)j*nRows + i] = kernel[(long)i*nColumns + j];
+  for (int j = 0; j < nColumns; j++)
+    V[(long)j*nColumns + j] = 1.0;
+
+  for (int sweep = 0; sweep < MAX_JACOBI_SWEEPS; sweep++) {
+    bool  rotated = false;
+    for (int p = 0; p < nColumns - 1; p++) {
+      for (int q = p + 1; q < nColumns; q++) {
+        double  *colP = &A[(long)p*nRows];
+        double  *colQ = &A[(long)q*nRows];
+        double  alpha = 0.0, beta = 0.0, gamma = 0.0;
+        for (int i = 0; i < nRows; i++) {
+          alpha += colP[i]*colP[i];
+          beta += colQ[i]*colQ[i];
+          gamma += colP[i]*colQ[i];
+        }
+        if (fabs(gamma) <= JACOBI_TOLERANCE*sqrt(alpha*beta))
+          continue;
+        rotated = true;
+        double  zeta = (beta - alpha) / (2.0*gamma);
+        double  t = (zeta >= 0.0 ? 1.0 : -1.0) / (fabs(zeta) + sqrt(1.0 + zeta*zeta));
+        double  c = 1.0 / sqrt(1.0 + t*t);
+        double  s = c*t;
+        for (int i = 0; i < nRows; i++) {
+          double  a = colP[i], b = colQ[i];
+          colP[i] = c*a - s*b;
+          colQ[i] = s*a + c*b;
+        }
+        double  *vP = &V[(long)p*nColumns];
+        double  *vQ = &V[(long)q*nColumns];
+        for (int i = 0; i < nColumns; i++) {
+          double  a = vP[i], b = vQ[i];
+          vP[i] = c*a - s*b;
+          vQ[i] = s*a + c*b;
+        }
+      }
+    }
+    if (! rotated)
+      break;
+  }
+
+  // sort singular values (largest first); tailSums[k] = sum of all but the k
+  // largest squared singular values (summed from the smallest, for accuracy)
+  for (int j = 0; j < nColumns; j++) {
+    sigmaSquared[j] = 0.0;
+    for (int i = 0; i < nRows; i++)
+      sigmaSquared[j] += A[(long)j*nRows + i]*A[(long)j*nRows + i];
+    order[j] = make_pair(-sigmaSquared[j], j);
+  }
+  sort(order.begin(), order.end());
+  tailSums[nColumns] = 0.0;
+  for (int k = nColumns - 1; k >= 0; k--)
+    tailSums[k] = tailSums[k + 1] + sigmaSquared[order[k].second];
+  total = tailSums[0];
+
+  if (maxRank > nColumns)
+    maxRank = nColumns;
+  rank = 0;
+  *relativeError = 1.0;
+  for (int k = 0; k < maxRank; k++) {
+    int  j = order[k].second;
+    for (int i = 0; i < nRows; i++)
+      columnKernels[(long)k*nRows + i] = A[(long)j*nRows + i];
+    for (int i = 0; i < nColumns; i++)
+      rowKernels[(long)k*nColumns + i] = V[(long)j*nColumns + i];
+    if (total > 0.0)
+      *relativeError = sqrt(tailSums[k + 1] / total);
+    if (*relativeError <= tolerance) {
+      rank = k + 1;
+      break;
+    }
+  }
+  return rank;
+}
+
+
+/* ---------------- FUNCTION: EstimateDirectConvolutionCost ------------ */
+
+double EstimateDirectConvolutionCost( long nPixels_image, long nPixels_psf )
+{
+  return DIRECT_COST_PER_TERM * (double)nPixels_image * (double)nPixels_psf;
+}
+
+
+/* ---------------- FUNCTION: EstimateSeparableConvolutionCost --------- */
+/// Each term needs a row pass and a column pass (plus zeroing the row-pass output)
+double EstimateSeparableConvolutionCost( long nPixels_image, int rank, int nColumns_kernel,
+										int nRows_kernel )
+{
+  return DIRECT_COST_PER_TERM * (double)nPixels_image * rank
+  			* (nColumns_kernel + nRows_kernel + 1);
+}
+
+
+/* ---------------- FUNCTION: ChooseConvolutionMethod ------------------ */
+
+int ChooseConvolutionMethod( double directCost, double fftCost )
+{
+  if (directCost < fftCost)
+    return CONVOLUTION_DIRECT;
+  return CONVOLUTION_FFT;
+}
+
+
+
+/* END OF FILE: spatial_convolution.cpp -------------------------------- */
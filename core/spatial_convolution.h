@@ -0,0 +1,61 @@
+/** @file
+ * \brief Direct (spatial-domain) convolution of images and profiles with small
+ *        PSFs, low-rank separable approximations of PSFs, and the cost model
+ *        used to choose between direct, separable, and FFT convolution
+ *
+ */
+/*    Direct convolution uses the same conventions as FFT convolution in the
+ * Convolver and Convolver1D classes: the PSF is centered on its central pixel
+ * (pixel nColumns_psf/2, nRows_psf/2), and the image is treated as zero outside
+ * its boundaries.
+ *    A separable approximation of rank k writes the PSF as the sum of k outer
+ * products (column kernel) x (row kernel), obtained from its singular value
+ * decomposition; convolution with it is k pairs of 1D convolutions.
+ */
+
+#ifndef _SPATIAL_CONVOLUTION_H_
+#define _SPATIAL_CONVOLUTION_H_
+
+
+// Convolution methods for Convolver and Convolver1D
+const int  CONVOLUTION_AUTO = 0;     // choose the (estimated) faster method at setup
+const int  CONVOLUTION_FFT = 1;
+const int  CONVOLUTION_DIRECT = 2;
+const int  CONVOLUTION_SEPARABLE = 3;   // only chosen automatically; see Convolver::SetupPSF
+const int  CONVOLUTION_TILED = 4;   // overlap-save FFT tiles; see Convolver::SetTileSize
+
+
+/// Convolves input (nColumns x nRows) with kernel (nColumns_kernel x nRows_kernel),
+/// storing the result in output (which must not overlap input)
+template <typename T>
+void ConvolveDirect2D( const T *input, int nColumns, int nRows, const double *kernel,
+						int nColumns_kernel, int nRows_kernel, double *output );
+
+/// Convolves input with the rank-k kernel sum_i columnKernels[i] x rowKernels[i]
+/// (rowKernels = k x nColumns_kernel values, columnKernels = k x nRows_kernel values);
+/// workspace must have room for nColumns*nRows values
+template <typename T>
+void ConvolveSeparable2D( const T *input, int nColumns, int nRows, int rank,
+						const double *rowKernels, int nColumns_kernel, const double *columnKernels,
+						int nRows_kernel, double *workspace, double *output );
+
+/// Finds the lowest-rank separable approximation of kernel whose relative (Frobenius-
+/// norm) error is <= tolerance, up to rank maxRank; stores the row and column kernels
+/// (maxRank x nColumns and maxRank x nRows values) and the error. Returns the rank,
+/// or 0 if rank maxRank isn't good enough (relativeError is then the error for maxRank)
+int SeparableKernelApproximation( const double *kernel, int nColumns, int nRows,
+						double tolerance, int maxRank, double *rowKernels, double *columnKernels,
+						double *relativeError );
+
+/// Estimated relative cost of direct convolution (same units as FFTCostPerPoint)
+double EstimateDirectConvolutionCost( long nPixels_image, long nPixels_psf );
+
+/// Estimated relative cost of convolution with a rank-k separable kernel
+double EstimateSeparableConvolutionCost( long nPixels_image, int rank, int nColumns_kernel,
+										int nRows_kernel );
+
+/// Returns CONVOLUTION_DIRECT or CONVOLUTION_FFT, whichever has the lower cost
+int ChooseConvolutionMethod( double directCost, double fftCost );
+
+
+#endif  // _SPATIAL_CONVOLUTION_H_
@@ -39,8 +39,11 @@ convolver
 definitions
 downsample
 estimate_memory 
+fftw_wisdom
 getimages
 image_io
+image_tiles
+aligned_arena
 mersenne_twister
 model_object
 mp_enorm
@@ -52,8 +55,10 @@ oversampled_region
 param_struct
 print_results
 psf_oversampling_info
+psf_transform_cache
 sample_configs
 setup_model_object
+spatial_convolution
 statistics
 utilities_pub
 """
@@ -82,8 +87,11 @@ config_file_parser
 convolver
 downsample
 estimate_memory 
+fftw_wisdom
 getimages
 image_io 
+image_tiles
+aligned_arena
 imfit_main
 makeimage_main
 mcmc_main
@@ -93,7 +101,9 @@ mp_enorm
 oversampled_region
 print_results
 psf_oversampling_info
+psf_transform_cache
 setup_model_object
+spatial_convolution
 statistics
 utilities 
 """
@@ -149,6 +159,9 @@ helper_funcs
 helper_funcs_3d
 integrator
 psf_interpolators
+radial_profile_table
+pixel_integration
+simd_kernels
 """
 
 
@@ -36,6 +36,7 @@ class BrokenExponentialBar : public FunctionObject
   public:
     // Constructors:
     BrokenExponentialBar( );
+    FunctionObject * Clone( ) { return new BrokenExponentialBar(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -33,6 +33,7 @@ class BrokenExponential : public FunctionObject
   public:
     // Constructors:
     BrokenExponential( );
+    FunctionObject * Clone( ) { return new BrokenExponential(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
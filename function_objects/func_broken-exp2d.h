@@ -33,6 +33,7 @@ class BrokenExponential2D : public FunctionObject
   public:
     // Constructors:
     BrokenExponential2D( );
+    FunctionObject * Clone( ) { return new BrokenExponential2D(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
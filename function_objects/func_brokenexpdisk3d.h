@@ -28,6 +28,7 @@ class BrokenExponentialDisk3D : public FunctionObject
   public:
     // Constructor
     BrokenExponentialDisk3D( );
+    FunctionObject * Clone( ) { return new BrokenExponentialDisk3D(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -48,6 +48,7 @@
 #include <algorithm>
 
 #include "func_core-sersic.h"
+#include "pixel_integration.h"
 #include "helper_funcs.h"
 
 using namespace std;
@@ -84,6 +85,7 @@ CoreSersic::CoreSersic( )
   }
   
   doSubsampling = true;
+  useProfileTable = false;
 }
 
 
@@ -111,6 +113,12 @@ void CoreSersic::Setup( double params[], int offsetIndex, double xc, double yc )
   bn = Calculate_bn(n);
   invn = 1.0 / n;
   Iprime = I_b * pow(2.0, -gamma/alpha) * exp( bn * pow( pow(2.0, 1.0/alpha) * r_b/r_e, (1.0/n) ));
+
+  // optional lookup table for I(r); note that this must be built *after*
+  // everything CalculateIntensity() needs has been computed
+  useProfileTable = false;
+  if (doTabulation)
+    useProfileTable = (profileTable.Build(ProfileIntensity, this, r_b) > 0);
 }
 
 
@@ -123,6 +131,8 @@ double CoreSersic::CalculateIntensity( double r )
 {
   double  powerlaw_part, exp_part, intensity;
   
+  if (useProfileTable && profileTable.Lookup(r, &intensity))
+    return intensity;
   // kludge to handle cases when r is very close to zero:
   if (r < R_MIN)
     r = R_MIN;
@@ -133,6 +143,15 @@ double CoreSersic::CalculateIntensity( double r )
 }
 
 
+/* ---------------- PRIVATE METHOD: ProfileIntensity ------------------- */
+// Wrapper for CalculateIntensity(), for use by RadialProfileTable::Build()
+
+double CoreSersic::ProfileIntensity( double r, void *funcObject )
+{
+  return ((CoreSersic *)funcObject)->CalculateIntensity(r);
+}
+
+
 
 /* ---------------- PUBLIC METHOD: GetValue ---------------------------- */
 // This function calculates and returns the intensity value for a pixel with
@@ -153,7 +172,9 @@ double CoreSersic::GetValue( double x, double y )
   r = sqrt(xp*xp + yp_scaled*yp_scaled);
   
   nSubsamples = CalculateSubsamples(r);
-  if (nSubsamples > 1) {
+  if ((nSubsamples > 1) && (doAdaptiveSubsampling))
+    totalIntensity = IntegratePixel(PixelIntensity, this, x, y, x0, y0);
+  else if (nSubsamples > 1) {
     // Do subsampling
     // start in center of leftmost/bottommost sub-pixel
     double deltaSubpix = 1.0 / nSubsamples;
@@ -181,6 +202,20 @@ double CoreSersic::GetValue( double x, double y )
 }
 
 
+/* ---------------- PRIVATE METHOD: PixelIntensity --------------------- */
+// Intensity at image coordinates (x,y), for use by IntegratePixel()
+
+double CoreSersic::PixelIntensity( double x, double y, void *funcObject )
+{
+  CoreSersic  *theFunc = (CoreSersic *)funcObject;
+  double  x_diff = x - theFunc->x0;
+  double  y_diff = y - theFunc->y0;
+  double  xp = x_diff*theFunc->cosPA + y_diff*theFunc->sinPA;
+  double  yp_scaled = (-x_diff*theFunc->sinPA + y_diff*theFunc->cosPA)/theFunc->q;
+  return theFunc->CalculateIntensity(sqrt(xp*xp + yp_scaled*yp_scaled));
+}
+
+
 /* ---------------- PROTECTED METHOD: CalculateSubsamples ------------------------- */
 // Function which determines the number of pixel subdivisions for sub-pixel integration,
 // given that the current pixel is a distance of r away from the center of the
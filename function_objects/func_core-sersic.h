@@ -24,6 +24,7 @@
 // CLASS CoreSersic:
 
 #include "function_object.h"
+#include "radial_profile_table.h"
 
 
 
@@ -36,6 +37,7 @@ class CoreSersic : public FunctionObject
   public:
     // Constructors:
     CoreSersic( );
+    FunctionObject * Clone( ) { return new CoreSersic(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -47,6 +49,8 @@ class CoreSersic : public FunctionObject
 
   protected:
     double CalculateIntensity( double r );
+    static double PixelIntensity( double x, double y, void *funcObject );
+    static double ProfileIntensity( double r, void *funcObject );
     int  CalculateSubsamples( double r );
 
 
@@ -54,4 +58,6 @@ class CoreSersic : public FunctionObject
   double  x0, y0, PA, ell, n, I_b, r_e, r_b, alpha, gamma;   // parameters
   double  bn, invn, Iprime;
   double  q, PA_rad, cosPA, sinPA;   // other useful (shape-related) quantities
+  RadialProfileTable  profileTable;   // optional lookup table for I(r)
+  bool  useProfileTable;
 };
@@ -36,6 +36,7 @@ class DoubleBrokenExponential : public FunctionObject
   public:
     // Constructors:
     DoubleBrokenExponential( );
+    FunctionObject * Clone( ) { return new DoubleBrokenExponential(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
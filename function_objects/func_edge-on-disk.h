@@ -39,6 +39,7 @@ class EdgeOnDisk : public FunctionObject
   public:
     // Constructors:
     EdgeOnDisk( );
+    FunctionObject * Clone( ) { return new EdgeOnDisk(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
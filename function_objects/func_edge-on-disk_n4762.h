@@ -34,6 +34,7 @@ class EdgeOnDiskN4762 : public FunctionObject
   public:
     // Constructors:
     EdgeOnDiskN4762( );
+    FunctionObject * Clone( ) { return new EdgeOnDiskN4762(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -36,6 +36,7 @@ class EdgeOnDiskN4762v2 : public FunctionObject
   public:
     // Constructors:
     EdgeOnDiskN4762v2( );
+    FunctionObject * Clone( ) { return new EdgeOnDiskN4762v2(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -33,6 +33,7 @@ class EdgeOnRing : public FunctionObject
   public:
     // Constructors:
     EdgeOnRing( );
+    FunctionObject * Clone( ) { return new EdgeOnRing(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -34,6 +34,7 @@ class EdgeOnRing2Side : public FunctionObject
   public:
     // Constructors:
     EdgeOnRing2Side( );
+    FunctionObject * Clone( ) { return new EdgeOnRing2Side(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -49,6 +49,7 @@
 #include <string>
 
 #include "func_exp.h"
+#include "simd_kernels.h"
 
 using namespace std;
 
@@ -80,6 +81,7 @@ Exponential::Exponential( )
   }
   
   doSubsampling = true;
+  useProfileTable = false;
 }
 
 
@@ -99,6 +101,12 @@ void Exponential::Setup( double params[], int offsetIndex, double xc, double yc
   PA_rad = (PA + 90.0) * DEG2RAD;
   cosPA = cos(PA_rad);
   sinPA = sin(PA_rad);
+
+  // optional lookup table for I(r); note that this must be built *after*
+  // everything CalculateIntensity() needs has been computed
+  useProfileTable = false;
+  if (doTabulation)
+    useProfileTable = (profileTable.Build(ProfileIntensity, this, h) > 0);
 }
 
 
@@ -109,10 +117,23 @@ void Exponential::Setup( double params[], int offsetIndex, double xc, double yc
 
 double Exponential::CalculateIntensity( double r )
 {
+  double  intensity;
+  
+  if (useProfileTable && profileTable.Lookup(r, &intensity))
+    return intensity;
   return I_0 * exp(-r/h);
 }
 
 
+/* ---------------- PRIVATE METHOD: ProfileIntensity ------------------- */
+// Wrapper for CalculateIntensity(), for use by RadialProfileTable::Build()
+
+double Exponential::ProfileIntensity( double r, void *funcObject )
+{
+  return ((Exponential *)funcObject)->CalculateIntensity(r);
+}
+
+
 /* ---------------- PUBLIC METHOD: GetValue ---------------------------- */
 
 double Exponential::GetValue( double x, double y )
@@ -156,6 +177,35 @@ double Exponential::GetValue( double x, double y )
 }
 
 
+/* ---------------- PUBLIC METHOD: GetValues --------------------------- */
+/// (Uses the profile lookup table in place of ExponentialProfile, if tabulation is on.)
+void Exponential::GetValues( const double *xVals, const double *yVals, double *outVals, 
+										long nVals )
+{
+  EllipticalValues(this, xVals, yVals, outVals, nVals,
+  		[this]( const double *rVals, long nChunk, double *outChunk )
+  		{
+  		  if (useProfileTable) {
+  		    for (long i = 0; i < nChunk; i++)
+  		      outChunk[i] = CalculateIntensity(rVals[i]);
+  		  }
+  		  else
+  		    ExponentialProfile(rVals, nChunk, I_0, h, outChunk);
+  		});
+}
+
+
+/* ---------------- PUBLIC METHOD: EstimateCost ------------------------ */
+/// Pixels within r = 10 are subsampled (up to 100 x 100 subpixels if h < 1).
+double Exponential::EstimateCost( double xMin, double xMax, double yMin, double yMax, 
+										long nPixels )
+{
+  double  r = DistanceToBox(x0, y0, xMin, xMax, yMin, yMax);
+  
+  return SubsampledPixelsCost(nPixels, CalculateSubsamples(r), M_PI*100.0/q);
+}
+
+
 /* ---------------- PROTECTED METHOD: CalculateSubsamples ------------------------- */
 // Function which determines the number of pixel subdivisions for sub-pixel integration,
 // given that the current pixel is a distance of r away from the center of the
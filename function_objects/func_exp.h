@@ -19,6 +19,7 @@
 // CLASS Exponential:
 
 #include "function_object.h"
+#include "radial_profile_table.h"
 #include <string>
 using namespace std;
 
@@ -29,13 +30,20 @@ class Exponential : public FunctionObject
 {
   // the following static constant will be defined/initialized in the .cpp file
   static const char  className[];
+  // (FunctionObject::EllipticalValues uses the geometry and CalculateSubsamples)
+  friend class FunctionObject;
   
   public:
     // Constructors:
     Exponential( );
+    FunctionObject * Clone( ) { return new Exponential(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
+    void  GetValues( const double *xVals, const double *yVals, double *outVals, 
+    										long nVals );
+    double  EstimateCost( double xMin, double xMax, double yMin, double yMax, 
+    										long nPixels );
     bool CanCalculateTotalFlux(  );
     double TotalFlux( );
    // No destructor for now
@@ -45,11 +53,14 @@ class Exponential : public FunctionObject
 
   protected:
     double CalculateIntensity( double r );
+    static double ProfileIntensity( double r, void *funcObject );
     int  CalculateSubsamples( double r );
 
 
   private:
     double  x0, y0, PA, ell, I_0, h;   // parameters
     double  q, PA_rad, cosPA, sinPA;   // other useful quantities
+    RadialProfileTable  profileTable;   // optional lookup table for I(r)
+    bool  useProfileTable;
 };
 
@@ -28,6 +28,7 @@ class ExponentialDisk3D : public FunctionObject
   public:
     // Constructor
     ExponentialDisk3D( );
+    FunctionObject * Clone( ) { return new ExponentialDisk3D(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
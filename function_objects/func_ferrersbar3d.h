@@ -40,6 +40,7 @@ class FerrersBar3D : public FunctionObject
   public:
     // Constructor
     FerrersBar3D( );
+    FunctionObject * Clone( ) { return new FerrersBar3D(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -34,6 +34,7 @@ class FlatExponential : public FunctionObject
   public:
     // Constructors:
     FlatExponential( );
+    FunctionObject * Clone( ) { return new FlatExponential(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
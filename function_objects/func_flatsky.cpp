@@ -83,5 +83,15 @@ double FlatSky::GetValue( double x, double y )
 }
 
 
+/* ---------------- PUBLIC METHOD: GetValues --------------------------- */
+
+void FlatSky::GetValues( const double *xVals, const double *yVals, double *outVals, 
+										long nVals )
+{
+  for (long i = 0; i < nVals; i++)
+    outVals[i] = I_sky;
+}
+
+
 
 /* END OF FILE: func_flatsky.cpp --------------------------------------- */
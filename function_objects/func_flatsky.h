@@ -21,9 +21,12 @@ class FlatSky : public FunctionObject
   public:
     // Constructors:
     FlatSky( );
+    FunctionObject * Clone( ) { return new FlatSky(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
+    void  GetValues( const double *xVals, const double *yVals, double *outVals, 
+    										long nVals );
     // No destructor for now
 
     // class method for returning official short name of class
@@ -26,6 +26,7 @@ class GaussianExtraParams : public FunctionObject
   public:
     // Constructors:
     GaussianExtraParams( );
+    FunctionObject * Clone( ) { return new GaussianExtraParams(*this); };
     // redefined method/member function:
     void Setup( double params[], int offsetIndex, double xc, double yc );
     bool HasExtraParams( );
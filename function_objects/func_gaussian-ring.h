@@ -31,6 +31,7 @@ class GaussianRing : public FunctionObject
   public:
     // Constructors:
     GaussianRing( );
+    FunctionObject * Clone( ) { return new GaussianRing(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -34,6 +34,7 @@ class GaussianRing2Side : public FunctionObject
   public:
     // Constructors:
     GaussianRing2Side( );
+    FunctionObject * Clone( ) { return new GaussianRing2Side(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -48,6 +48,7 @@
 #include <string>
 
 #include "func_gaussian.h"
+#include "simd_kernels.h"
 
 using namespace std;
 
@@ -163,6 +164,28 @@ double Gaussian::GetValue( double x, double y )
 }
 
 
+/* ---------------- PUBLIC METHOD: GetValues --------------------------- */
+
+void Gaussian::GetValues( const double *xVals, const double *yVals, double *outVals, 
+										long nVals )
+{
+  EllipticalValues(this, xVals, yVals, outVals, nVals,
+  		[this]( const double *rVals, long nChunk, double *outChunk )
+  		{ GaussianProfile(rVals, nChunk, I_0, twosigma_squared, outChunk); });
+}
+
+
+/* ---------------- PUBLIC METHOD: EstimateCost ------------------------ */
+/// Pixels within r = 10 are subsampled (up to 100 x 100 subpixels if sigma < 1).
+double Gaussian::EstimateCost( double xMin, double xMax, double yMin, double yMax, 
+										long nPixels )
+{
+  double  r = DistanceToBox(x0, y0, xMin, xMax, yMin, yMax);
+  
+  return SubsampledPixelsCost(nPixels, CalculateSubsamples(r), M_PI*100.0/q);
+}
+
+
 /* ---------------- PROTECTED METHOD: CalculateSubsamples ------------------------- */
 // Function which determines the number of pixel subdivisions for sub-pixel integration,
 // given that the current pixel is a distance of r away from the center of the
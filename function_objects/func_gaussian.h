@@ -19,13 +19,20 @@ class Gaussian : public FunctionObject
 {
   // the following static constant will be defined/initialized in the .cpp file
   static const char  className[];
+  // (FunctionObject::EllipticalValues uses the geometry and CalculateSubsamples)
+  friend class FunctionObject;
   
   public:
     // Constructors:
     Gaussian( );
+    FunctionObject * Clone( ) { return new Gaussian(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
+    void  GetValues( const double *xVals, const double *yVals, double *outVals, 
+    										long nVals );
+    double  EstimateCost( double xMin, double xMax, double yMin, double yMax, 
+    										long nPixels );
     bool CanCalculateTotalFlux(  );
     double TotalFlux( );
     // No destructor for now
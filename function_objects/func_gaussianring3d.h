@@ -42,6 +42,7 @@ class GaussianRing3D : public FunctionObject
   public:
     // Constructor
     GaussianRing3D( );
+    FunctionObject * Clone( ) { return new GaussianRing3D(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -32,6 +32,7 @@ class GenExponential : public FunctionObject
   public:
     // Constructors:
     GenExponential( );
+    FunctionObject * Clone( ) { return new GenExponential(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
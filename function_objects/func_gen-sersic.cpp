@@ -49,6 +49,8 @@
 #include <algorithm>
 
 #include "func_gen-sersic.h"
+#include "simd_kernels.h"
+#include "pixel_integration.h"
 #include "helper_funcs.h"
 
 using namespace std;
@@ -81,6 +83,7 @@ GenSersic::GenSersic( )
   }
   
   doSubsampling = true;
+  useProfileTable = false;
 }
 
 
@@ -109,6 +112,12 @@ void GenSersic::Setup( double params[], int offsetIndex, double xc, double yc )
 
   bn = Calculate_bn(n);
   invn = 1.0 / n;
+
+  // optional lookup table for I(r); note that this must be built *after*
+  // everything CalculateIntensity() needs has been computed
+  useProfileTable = false;
+  if (doTabulation)
+    useProfileTable = (profileTable.Build(ProfileIntensity, this, r_e) > 0);
 }
 
 
@@ -121,11 +130,22 @@ double GenSersic::CalculateIntensity( double r )
 {
   double  intensity;
   
+  if (useProfileTable && profileTable.Lookup(r, &intensity))
+    return intensity;
   intensity = I_e * exp( -bn * (pow((r/r_e), invn) - 1.0));
   return intensity;
 }
 
 
+/* ---------------- PRIVATE METHOD: ProfileIntensity ------------------- */
+// Wrapper for CalculateIntensity(), for use by RadialProfileTable::Build()
+
+double GenSersic::ProfileIntensity( double r, void *funcObject )
+{
+  return ((GenSersic *)funcObject)->CalculateIntensity(r);
+}
+
+
 /* ---------------- PRIVATE METHOD: CalculateRadius -------------------- */
 // This function calculates the equivalent radius for a generalized ellipse,
 // for a coordinate system where r=0 at deltaX = deltaY = 0.
@@ -159,7 +179,9 @@ double GenSersic::GetValue( double x, double y )
   r = CalculateRadius(x_diff, y_diff);
   
   nSubsamples = CalculateSubsamples(r);
-  if (nSubsamples > 1) {
+  if ((nSubsamples > 1) && (doAdaptiveSubsampling))
+    totalIntensity = IntegratePixel(PixelIntensity, this, x, y, x0, y0);
+  else if (nSubsamples > 1) {
     // Do subsampling
     // start in center of leftmost/bottommost sub-pixel
     double deltaSubpix = 1.0 / nSubsamples;
@@ -185,6 +207,41 @@ double GenSersic::GetValue( double x, double y )
 }
 
 
+/* ---------------- PRIVATE METHOD: PixelIntensity --------------------- */
+// Intensity at image coordinates (x,y), for use by IntegratePixel()
+
+double GenSersic::PixelIntensity( double x, double y, void *funcObject )
+{
+  GenSersic  *theFunc = (GenSersic *)funcObject;
+  double  r = theFunc->CalculateRadius(x - theFunc->x0, y - theFunc->y0);
+  return theFunc->CalculateIntensity(r);
+}
+
+
+/* ---------------- PUBLIC METHOD: GetValues --------------------------- */
+/// Radii are generalized (boxy/disky) elliptical radii; uses the profile lookup
+/// table in place of SersicProfile, if tabulation is on.
+void GenSersic::GetValues( const double *xVals, const double *yVals, double *outVals, 
+										long nVals )
+{
+  EllipticalValues(this, xVals, yVals, outVals, nVals,
+  		[this]( const double *xChunk, const double *yChunk, long nChunk, double *rVals )
+  		{
+  		  GeneralizedEllipticalRadii(xChunk, yChunk, nChunk, x0, y0, cosPA, sinPA, q,
+  		  				ellExp, invEllExp, rVals);
+  		},
+  		[this]( const double *rVals, long nChunk, double *outChunk )
+  		{
+  		  if (useProfileTable) {
+  		    for (long i = 0; i < nChunk; i++)
+  		      outChunk[i] = CalculateIntensity(rVals[i]);
+  		  }
+  		  else
+  		    SersicProfile(rVals, nChunk, I_e, r_e, bn, invn, outChunk);
+  		});
+}
+
+
 /* ---------------- PROTECTED METHOD: CalculateSubsamples ------------------------- */
 // Function which determines the number of pixel subdivisions for sub-pixel integration,
 // given that the current pixel is a distance of r away from the center of the
@@ -21,6 +21,7 @@
 // CLASS GenSersic:
 
 #include "function_object.h"
+#include "radial_profile_table.h"
 
 
 
@@ -29,13 +30,18 @@ class GenSersic : public FunctionObject
 {
   // the following static constant will be defined/initialized in the .cpp file
   static const char  className[];
+  // (FunctionObject::EllipticalValues uses the geometry and CalculateSubsamples)
+  friend class FunctionObject;
   
   public:
     // Constructors:
     GenSersic( );
+    FunctionObject * Clone( ) { return new GenSersic(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
+    void  GetValues( const double *xVals, const double *yVals, double *outVals, 
+    										long nVals );
     // No destructor for now
 
     // class method for returning official short name of class
@@ -44,6 +50,8 @@ class GenSersic : public FunctionObject
 
   protected:
     double CalculateIntensity( double r );
+    static double PixelIntensity( double x, double y, void *funcObject );
+    static double ProfileIntensity( double r, void *funcObject );
     double CalculateRadius( double deltaX, double deltaY );  // new!
     int  CalculateSubsamples( double r );
 
@@ -53,4 +61,6 @@ class GenSersic : public FunctionObject
     double  bn, invn;
     double  q, PA_rad, cosPA, sinPA;   // other useful quantities (basic geometry)
     double  ellExp, invEllExp;         // more useful quantities
+    RadialProfileTable  profileTable;   // optional lookup table for I(r)
+    bool  useProfileTable;
 };
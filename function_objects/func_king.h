@@ -36,6 +36,7 @@ class ModifiedKing : public FunctionObject
   public:
     // Constructors:
     ModifiedKing( );
+    FunctionObject * Clone( ) { return new ModifiedKing(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -39,6 +39,7 @@ class ModifiedKing2 : public FunctionObject
   public:
     // Constructors:
     ModifiedKing2( );
+    FunctionObject * Clone( ) { return new ModifiedKing2(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
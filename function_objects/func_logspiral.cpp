@@ -56,6 +56,7 @@
 #include <string>
 
 #include "func_logspiral.h"
+#include "pixel_integration.h"
 
 using namespace std;
 
@@ -159,7 +160,9 @@ double LogSpiral::GetValue( double x, double y )
 //   }
   
   nSubsamples = CalculateSubsamples(r);
-  if (nSubsamples > 1) {
+  if ((nSubsamples > 1) && (doAdaptiveSubsampling))
+    totalIntensity = IntegratePixel(PixelIntensity, this, x, y, x0, y0);
+  else if (nSubsamples > 1) {
     // Do subsampling
     // start in center of leftmost/bottommost sub-pixel
     double deltaSubpix = 1.0 / nSubsamples;
@@ -186,6 +189,21 @@ double LogSpiral::GetValue( double x, double y )
 }
 
 
+/* ---------------- PRIVATE METHOD: PixelIntensity --------------------- */
+// Intensity at image coordinates (x,y), for use by IntegratePixel()
+
+double LogSpiral::PixelIntensity( double x, double y, void *funcObject )
+{
+  LogSpiral  *theFunc = (LogSpiral *)funcObject;
+  double  x_diff = x - theFunc->x0;
+  double  y_diff = y - theFunc->y0;
+  double  xp = x_diff*theFunc->cosPA + y_diff*theFunc->sinPA;
+  double  yp_scaled = (-x_diff*theFunc->sinPA + y_diff*theFunc->cosPA)/theFunc->q;
+  double  r = sqrt(xp*xp + yp_scaled*yp_scaled);
+  return theFunc->CalculateIntensity(r, atan(yp_scaled/xp));
+}
+
+
 /* ---------------- PROTECTED METHOD: CalculateSubsamples ------------------------- */
 // Function which determines the number of pixel subdivisions for sub-pixel integration,
 // given that the current pixel is a (scaled) distance of r away from the center of the
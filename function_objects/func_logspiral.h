@@ -32,6 +32,7 @@ class LogSpiral : public FunctionObject
   public:
     // Constructors:
     LogSpiral( );
+    FunctionObject * Clone( ) { return new LogSpiral(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -43,6 +44,7 @@ class LogSpiral : public FunctionObject
 
   protected:
     double CalculateIntensity( double r, double phi );
+    static double PixelIntensity( double x, double y, void *funcObject );
     int  CalculateSubsamples( double r );
 
 
@@ -39,6 +39,7 @@ class LogSpiral2 : public FunctionObject
   public:
     // Constructors:
     LogSpiral2( );
+    FunctionObject * Clone( ) { return new LogSpiral2(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -36,6 +36,7 @@ class LogSpiralGauss : public FunctionObject
   public:
     // Constructors:
     LogSpiralGauss( );
+    FunctionObject * Clone( ) { return new LogSpiralGauss(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -26,13 +26,20 @@ class Moffat : public FunctionObject
 {
   // the following static constant will be defined/initialized in the .cpp file
   static const char  className[];
+  // (FunctionObject::EllipticalValues uses the geometry and CalculateSubsamples)
+  friend class FunctionObject;
   
   public:
     // Constructors:
     Moffat( );
+    FunctionObject * Clone( ) { return new Moffat(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
+    void  GetValues( const double *xVals, const double *yVals, double *outVals, 
+    										long nVals );
+    double  EstimateCost( double xMin, double xMax, double yMin, double yMax, 
+    										long nPixels );
     // No destructor for now
 
     // class method for returning official short name of class
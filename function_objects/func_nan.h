@@ -21,6 +21,7 @@ class NaNFunc : public FunctionObject
   public:
     // Constructors:
     NaNFunc( );
+    FunctionObject * Clone( ) { return new NaNFunc(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -89,6 +89,17 @@ PointSource::~PointSource( )
 }
 
 
+/* ---------------- PUBLIC METHOD: Clone ------------------------------- */
+/// The copy uses the same PsfInterpolator object as this one (which must
+/// outlive it), whether or not the latter was allocated by this object.
+FunctionObject * PointSource::Clone( )
+{
+  PointSource  *theCopy = new PointSource(*this);
+  theCopy->interpolatorAllocated = false;
+  return theCopy;
+}
+
+
 /* ---------------- PUBLIC METHOD: IsPointSource ----------------------- */
 
 bool PointSource::IsPointSource( )
@@ -112,6 +123,7 @@ void PointSource::AddPsfData( double *psfPixels, int nColumns_psf, int nRows_psf
 {
   psfInterpolator = new PsfInterpolator_bicubic(psfPixels, nColumns_psf, nRows_psf);
   interpolatorAllocated = true;
+  stampValid = false;
 }
 
 
@@ -120,6 +132,31 @@ void PointSource::AddPsfData( double *psfPixels, int nColumns_psf, int nRows_psf
 void PointSource::AddPsfInterpolator( PsfInterpolator *theInterpolator )
 {
   psfInterpolator = theInterpolator;
+  // ModelObject re-assigns the same interpolator each time it computes a model
+  // image, so only recompute the stamp if something has actually changed
+  if ((theInterpolator != stampInterpolator) || (! stampValid)) {
+    if (setupDone)
+      ComputeShiftedStamp();
+    else
+      stampValid = false;
+  }
+}
+
+
+/* ---------------- PUBLIC METHOD: GetFootprint ------------------------ */
+// Returns the region outside of which the (interpolated) PSF is zero, centered
+// on the current x0,y0
+
+bool PointSource::GetFootprint( double& xMin, double& xMax, double& yMin, double& yMax )
+{
+  double  deltaXMin, deltaXMax, deltaYMin, deltaYMax;
+  
+  psfInterpolator->GetBounds(deltaXMin, deltaXMax, deltaYMin, deltaYMax);
+  xMin = x0 + deltaXMin;
+  xMax = x0 + deltaXMax;
+  yMin = y0 + deltaYMin;
+  yMax = y0 + deltaYMax;
+  return true;
 }
 
 
@@ -130,6 +167,38 @@ void PointSource::Setup( double params[], int offsetIndex, double xc, double yc
   x0 = xc;
   y0 = yc;
   I_tot = params[0 + offsetIndex];
+  setupDone = true;
+  ComputeShiftedStamp();
+}
+
+
+/* ---------------- PRIVATE METHOD: ComputeShiftedStamp ---------------- */
+// If the current interpolator supports it, precompute the interpolated PSF
+// (normalized, i.e., without the I_tot factor) at all integer pixel positions
+// within the PSF footprint centered on x0,y0. GetValues then only has to
+// look up values for integer pixel coordinates.
+
+void PointSource::ComputeShiftedStamp( )
+{
+  double  deltaXMin, deltaXMax, deltaYMin, deltaYMax;
+  
+  stampValid = false;
+  stampInterpolator = psfInterpolator;
+  if ((psfInterpolator == NULL) || (! psfInterpolator->CanMakeShiftedStamp()))
+    return;
+  
+  psfInterpolator->GetBounds(deltaXMin, deltaXMax, deltaYMin, deltaYMax);
+  stampX1 = ceil(x0 + deltaXMin);
+  stampY1 = ceil(y0 + deltaYMin);
+  nStampColumns = (int)(floor(x0 + deltaXMax) - stampX1) + 1;
+  nStampRows = (int)(floor(y0 + deltaYMax) - stampY1) + 1;
+  if ((nStampColumns <= 0) || (nStampRows <= 0))
+    return;
+  
+  stampPixels.resize((size_t)nStampColumns * nStampRows);
+  psfInterpolator->MakeShiftedStamp(stampX1 - x0, stampY1 - y0, nStampColumns, 
+  									nStampRows, &stampPixels[0]);
+  stampValid = true;
 }
 
 
@@ -164,6 +233,10 @@ int PointSource::SetExtraParams( map<string,string>& inputMap )
         interpolationType = "lanczos2";
         break;
       }
+      if ((iter->second == "lanczos3") || (iter->second == "Lanczos3")) {
+        interpolationType = "lanczos3";
+        break;
+      }
       fprintf(stderr, "ERROR: unidentified interpolation type in PointSource::SetExtraParams!\n");
       fprintf(stderr, "(\"%s\" is not a recognized interpolation type)\n",
       			iter->second.c_str());
@@ -199,6 +272,36 @@ double PointSource::GetValue( double x, double y )
 }
 
 
+/* ---------------- PUBLIC METHOD: GetValues --------------------------- */
+// Computes intensity values for nVals pixels. Pixels at integer coordinates
+// (the standard model-image grid) are copied from the precomputed shifted PSF
+// stamp, if we have one; everything else is interpolated individually.
+
+void PointSource::GetValues( const double *xVals, const double *yVals, double *outVals, 
+							long nVals )
+{
+  long  k;
+  double  dx, dy;
+  
+  if (! stampValid) {
+    for (k = 0; k < nVals; k++)
+      outVals[k] = GetValue(xVals[k], yVals[k]);
+    return;
+  }
+  
+  for (k = 0; k < nVals; k++) {
+    dx = xVals[k] - stampX1;
+    dy = yVals[k] - stampY1;
+    if ((dx != floor(dx)) || (dy != floor(dy)))
+      outVals[k] = GetValue(xVals[k], yVals[k]);
+    else if ((dx < 0) || (dx >= nStampColumns) || (dy < 0) || (dy >= nStampRows))
+      outVals[k] = 0.0;   // outside PSF footprint
+    else
+      outVals[k] = I_tot * stampPixels[(long)dy*nStampColumns + (long)dx];
+  }
+}
+
+
 
 /* ---------------- PUBLIC METHOD: CanCalculateTotalFlux --------------- */
 
@@ -11,6 +11,7 @@
 #include "function_object.h"
 #include "psf_interpolators.h"
 #include <string>
+#include <vector>
 
 
 
@@ -25,17 +26,20 @@ class PointSource : public FunctionObject
     PointSource( );
     // Need a destructor to dispose of PsfInterpolator object
     ~PointSource( );
+    FunctionObject * Clone( );
 
     // redefined method/member function:
     bool IsPointSource( );
     void AddPsfInterpolator( PsfInterpolator *theInterpolator );
     void AddPsfData( double *psfPixels, int nColumns_psf, int nRows_psf );
     string GetInterpolationType( );
+    bool GetFootprint( double& xMin, double& xMax, double& yMin, double& yMax );
     bool HasExtraParams( );
     int SetExtraParams( map<string, string>& inputMap );
 
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
+    void  GetValues( const double *xVals, const double *yVals, double *outVals, long nVals );
     bool CanCalculateTotalFlux(  );
     double TotalFlux( );
     
@@ -45,9 +49,19 @@ class PointSource : public FunctionObject
 
 
   private:
+    void  ComputeShiftedStamp( );
+
     double  x0, y0, I_tot;   // parameters
     double  I_scaled;
     string  interpolationType = "bicubic";
     PsfInterpolator *psfInterpolator;
     bool interpolatorAllocated = false;
+    // shifted, interpolated copy of PSF for current x0,y0, sampled at integer
+    // pixel coordinates starting at (stampX1,stampY1)
+    bool  setupDone = false;
+    bool  stampValid = false;
+    PsfInterpolator *stampInterpolator = nullptr;
+    int  nStampColumns, nStampRows;
+    double  stampX1, stampY1;
+    std::vector<double>  stampPixels;
 };
@@ -51,6 +51,8 @@
 #include <gsl/gsl_sf_gamma.h>
 
 #include "func_sersic.h"
+#include "simd_kernels.h"
+#include "pixel_integration.h"
 #include "helper_funcs.h"
 
 using namespace std;
@@ -83,6 +85,7 @@ Sersic::Sersic( )
   }
   
   doSubsampling = true;
+  useProfileTable = false;
 }
 
 
@@ -106,6 +109,12 @@ void Sersic::Setup( double params[], int offsetIndex, double xc, double yc )
   sinPA = sin(PA_rad);
   bn = Calculate_bn(n);
   invn = 1.0 / n;
+
+  // optional lookup table for I(r); note that this must be built *after*
+  // everything CalculateIntensity() needs has been computed
+  useProfileTable = false;
+  if (doTabulation)
+    useProfileTable = (profileTable.Build(ProfileIntensity, this, r_e) > 0);
 }
 
 
@@ -118,11 +127,22 @@ double Sersic::CalculateIntensity( double r )
 {
   double  intensity;
   
+  if (useProfileTable && profileTable.Lookup(r, &intensity))
+    return intensity;
   intensity = I_e * exp( -bn * (pow((r/r_e), invn) - 1.0));
   return intensity;
 }
 
 
+/* ---------------- PRIVATE METHOD: ProfileIntensity ------------------- */
+// Wrapper for CalculateIntensity(), for use by RadialProfileTable::Build()
+
+double Sersic::ProfileIntensity( double r, void *funcObject )
+{
+  return ((Sersic *)funcObject)->CalculateIntensity(r);
+}
+
+
 /* ---------------- PUBLIC METHOD: GetValue ---------------------------- */
 // This function calculates and returns the intensity value for a pixel with
 // coordinates (x,y), including pixel subsampling if necessary (and if subsampling
@@ -142,7 +162,9 @@ double Sersic::GetValue( double x, double y )
   r = sqrt(xp*xp + yp_scaled*yp_scaled);
   
   nSubsamples = CalculateSubsamples(r);
-  if (nSubsamples > 1) {
+  if ((nSubsamples > 1) && (doAdaptiveSubsampling))
+    totalIntensity = IntegratePixel(PixelIntensity, this, x, y, x0, y0);
+  else if (nSubsamples > 1) {
     // Do subsampling
     // start in center of leftmost/bottommost sub-pixel
     double deltaSubpix = 1.0 / nSubsamples;
@@ -170,6 +192,50 @@ double Sersic::GetValue( double x, double y )
 }
 
 
+/* ---------------- PRIVATE METHOD: PixelIntensity --------------------- */
+// Intensity at image coordinates (x,y), for use by IntegratePixel()
+
+double Sersic::PixelIntensity( double x, double y, void *funcObject )
+{
+  Sersic  *theFunc = (Sersic *)funcObject;
+  double  x_diff = x - theFunc->x0;
+  double  y_diff = y - theFunc->y0;
+  double  xp = x_diff*theFunc->cosPA + y_diff*theFunc->sinPA;
+  double  yp_scaled = (-x_diff*theFunc->sinPA + y_diff*theFunc->cosPA)/theFunc->q;
+  return theFunc->CalculateIntensity(sqrt(xp*xp + yp_scaled*yp_scaled));
+}
+
+
+/* ---------------- PUBLIC METHOD: GetValues --------------------------- */
+/// (Uses the profile lookup table in place of SersicProfile, if tabulation is on.)
+void Sersic::GetValues( const double *xVals, const double *yVals, double *outVals, 
+										long nVals )
+{
+  EllipticalValues(this, xVals, yVals, outVals, nVals,
+  		[this]( const double *rVals, long nChunk, double *outChunk )
+  		{
+  		  if (useProfileTable) {
+  		    for (long i = 0; i < nChunk; i++)
+  		      outChunk[i] = CalculateIntensity(rVals[i]);
+  		  }
+  		  else
+  		    SersicProfile(rVals, nChunk, I_e, r_e, bn, invn, outChunk);
+  		});
+}
+
+
+/* ---------------- PUBLIC METHOD: EstimateCost ------------------------ */
+/// Pixels within r = 10 are subsampled (2*SUBSAMPLE_R per side out to r = 4, and
+/// up to 100 x 100 subpixels if r_e < 1).
+double Sersic::EstimateCost( double xMin, double xMax, double yMin, double yMax, 
+										long nPixels )
+{
+  double  r = DistanceToBox(x0, y0, xMin, xMax, yMin, yMax);
+  
+  return SubsampledPixelsCost(nPixels, CalculateSubsamples(r), M_PI*100.0/q);
+}
+
+
 /* ---------------- PROTECTED METHOD: CalculateSubsamples ------------------------- */
 // Function which determines the number of pixel subdivisions for sub-pixel integration,
 // given that the current pixel is a distance of r away from the center of the
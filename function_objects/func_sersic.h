@@ -20,6 +20,7 @@
 // CLASS Sersic:
 
 #include "function_object.h"
+#include "radial_profile_table.h"
 
 
 /// Class for image function with elliptical isophotes and %Sersic profile
@@ -27,13 +28,20 @@ class Sersic : public FunctionObject
 {
   // the following static constant will be defined/initialized in the .cpp file
   static const char  className[];
+  // (FunctionObject::EllipticalValues uses the geometry and CalculateSubsamples)
+  friend class FunctionObject;
 
   public:
     // Constructors:
     Sersic( );
+    FunctionObject * Clone( ) { return new Sersic(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
+    void  GetValues( const double *xVals, const double *yVals, double *outVals, 
+    										long nVals );
+    double  EstimateCost( double xMin, double xMax, double yMin, double yMax, 
+    										long nPixels );
     bool CanCalculateTotalFlux(  );
     double TotalFlux( );
     // No destructor for now
@@ -44,6 +52,8 @@ class Sersic : public FunctionObject
 
   protected:
     double CalculateIntensity( double r );
+    static double PixelIntensity( double x, double y, void *funcObject );
+    static double ProfileIntensity( double r, void *funcObject );
     int  CalculateSubsamples( double r );
 
 
@@ -51,4 +61,6 @@ class Sersic : public FunctionObject
   double  x0, y0, PA, ell, n, I_e, r_e;   // parameters
   double  bn, invn;
   double  q, PA_rad, cosPA, sinPA;   // other useful (shape-related) quantities
+  RadialProfileTable  profileTable;   // optional lookup table for I(r)
+  bool  useProfileTable;
 };
@@ -39,6 +39,7 @@ class TriaxBar3D : public FunctionObject
   public:
     // Constructor
     TriaxBar3D( );
+    FunctionObject * Clone( ) { return new TriaxBar3D(*this); };
     // redefined method/member function:
     void  Setup( double params[], int offsetIndex, double xc, double yc );
     double  GetValue( double x, double y );
@@ -44,6 +44,7 @@
 
 #include <stdio.h>
 #include <string.h>
+#include <math.h>
 #include <map>
 #include <string>
 
@@ -63,6 +64,9 @@ FunctionObject::FunctionObject( )
   functionName = "Base (undefined) function";
   shortFunctionName = "BaseFunction";
   extraParamsSet = false;
+  doTabulation = false;
+  doAdaptiveSubsampling = false;
+  valuesKernel = NULL;
 }
 
 
@@ -74,6 +78,64 @@ void FunctionObject::SetSubsampling( bool subsampleFlag )
 }
 
 
+/* ---------------- PUBLIC METHOD: SetProfileTabulation --------------- */
+/// Turn use of lookup tables for radial profiles on or off (true = on, 
+/// false = off); this has no effect for classes which don't support it.
+void FunctionObject::SetProfileTabulation( bool tabulateFlag )
+{
+  doTabulation = tabulateFlag;
+}
+
+
+/* ---------------- PUBLIC METHOD: SetAdaptiveSubsampling ------------- */
+/// Turn adaptive integration (see pixel_integration.cpp) of pixels which need
+/// subsampling on or off; this has no effect for classes which don't support it.
+void FunctionObject::SetAdaptiveSubsampling( bool adaptiveFlag )
+{
+  doAdaptiveSubsampling = adaptiveFlag;
+}
+
+
+/* ---------------- PROTECTED METHOD: DistanceToBox ------------------- */
+/// Returns the distance from (xc,yc) to the nearest point of the box xMin--xMax,
+/// yMin--yMax (= 0 if the point is inside the box); for use in EstimateCost().
+/// Since a function's elliptical radius is always >= the distance from its center,
+/// the number of subsamples (CalculateSubsamples) at this distance is an upper
+/// limit for the pixels in the box.
+double FunctionObject::DistanceToBox( double xc, double yc, double xMin, double xMax, 
+									double yMin, double yMax )
+{
+  double  dx = 0.0, dy = 0.0;
+  
+  if (xc < xMin)
+    dx = xMin - xc;
+  else if (xc > xMax)
+    dx = xc - xMax;
+  if (yc < yMin)
+    dy = yMin - yc;
+  else if (yc > yMax)
+    dy = yc - yMax;
+  return sqrt(dx*dx + dy*dy);
+}
+
+
+/* ---------------- PROTECTED METHOD: SubsampledPixelsCost ------------ */
+/// Returns estimated cost for nPixels pixels, of which up to nSubsampledPixels
+/// are subsampled with nSamples x nSamples subpixels; for use in EstimateCost().
+/// Subsampling functions typically call this with nSamples for the distance from
+/// DistanceToBox and nSubsampledPixels = the area of the ellipse within which
+/// they subsample (e.g., pi r^2/q), so that boxes near the center of a function
+/// are much more expensive than the rest -- but no box costs more than the
+/// whole subsampled region.
+double FunctionObject::SubsampledPixelsCost( long nPixels, int nSamples, 
+									double nSubsampledPixels )
+{
+  if (nSamples <= 1)
+    return (double)nPixels;
+  return (double)nPixels + fmin((double)nPixels, nSubsampledPixels)*(nSamples*nSamples - 1);
+}
+
+
 /* ---------------- PUBLIC METHOD: SetZeroPoint ------------------------ */
 /// Used to specify a magnitude zero point (for *1D* functions).
 void FunctionObject::SetZeroPoint( double zeroPoint )
@@ -116,6 +178,19 @@ double FunctionObject::GetValue( double x, double y )
 }
 
 
+/* ---------------- PUBLIC METHOD: GetValues --------------------------- */
+/// Base method for 2D functions: Compute function values for a batch of nVals
+/// pixels (typically one image row), with coordinates (xVals[i],yVals[i]), and
+/// store them in outVals. Default is to call GetValue() for each pixel; derived
+/// classes can override this to avoid a virtual call per pixel.
+void FunctionObject::GetValues( const double *xVals, const double *yVals, double *outVals, 
+											long nVals )
+{
+  for (long i = 0; i < nVals; i++)
+    outVals[i] = GetValue(xVals[i], yVals[i]);
+}
+
+
 /* ---------------- PUBLIC METHOD: GetValue ---------------------------- */
 /// Base method for 1D functions: Compute and return actual function value at
 /// specified value of independent variable x.
@@ -12,14 +12,23 @@
 #ifndef _FUNCTION_OBJ_H_
 #define _FUNCTION_OBJ_H_
 
+#include <algorithm>
 #include <map>
 #include <string>
 #include <vector>
 
 #include "psf_interpolators.h"
+#include "simd_kernels.h"
 
 using namespace std;
 
+class FunctionObject;
+
+/// Statically dispatched version of FunctionObject::GetValues for a specific
+/// derived class (see SetValuesKernel and add_functions.cpp)
+typedef void (*ValuesKernel)( FunctionObject *funcObj, const double *xVals, 
+								const double *yVals, double *outVals, long nVals );
+
 
 /// Virtual base class for function objects (i.e., 2D image functions)
 class FunctionObject
@@ -48,9 +57,33 @@ class FunctionObject
     /// Returns string with name of interpolation type (point-source classes only)
     virtual string GetInterpolationType( ) { return string(""); };
 
+    // override in derived classes only if said class is zero outside some
+    // finite region (e.g., PointSource)
+    /// Returns true if function is zero everywhere outside a bounding box, in which
+    /// case the box (inclusive, same coordinates as GetValue) is stored in xMin, etc.
+    /// Valid only after Setup() has been called.
+    virtual bool GetFootprint( double& xMin, double& xMax, double& yMin, double& yMax )
+    											{ return false; };
+
+    // override in derived classes if some pixels are much more expensive to
+    // compute than others (e.g., because of subsampling near the center)
+    /// Returns estimated cost (in units of a single ordinary pixel evaluation) of
+    /// computing nPixels pixels within the box xMin--xMax, yMin--yMax (same
+    /// coordinates as GetValue). Valid only after Setup() has been called.
+    virtual double EstimateCost( double xMin, double xMax, double yMin, double yMax,
+    								long nPixels ) { return (double)nPixels; };
+
     // probably no need to modify this:
     virtual void SetSubsampling( bool subsampleFlag );
 
+    // probably no need to modify this (only meaningful for classes which can
+    // tabulate their radial profiles, e.g. Sersic):
+    virtual void SetProfileTabulation( bool tabulateFlag );
+
+    // probably no need to modify this (only meaningful for classes which can
+    // integrate subsampled pixels adaptively, e.g. Sersic):
+    virtual void SetAdaptiveSubsampling( bool adaptiveFlag );
+
     // probably no need to modify this:
     virtual void SetZeroPoint( double zeroPoint );
 
@@ -67,6 +100,34 @@ class FunctionObject
     // all derived classes working with 1D data must override this:
     virtual double GetValue( double x );
 
+    // derived classes *may* override this with a faster, non-virtual loop;
+    // default is to call GetValue() for each pixel
+    /// Compute function values for nVals pixels (typically one image row) with
+    /// coordinates (xVals[i],yVals[i]), storing them in outVals. The values must match
+    /// those from GetValue() for each pixel. Overrides normally compute radii and
+    /// intensities for chunks of SIMD_CHUNK_SIZE pixels with the vectorized kernels
+    /// in simd_kernels.h, then recompute pixels which need subsampling individually
+    /// with (non-virtual calls to) their own GetValue(); see EllipticalValues().
+    virtual void GetValues( const double *xVals, const double *yVals, double *outVals, 
+    										long nVals );
+
+    // no need to modify this (normally called only by the factory code in
+    // add_functions.cpp, with a kernel compiled for the object's actual class):
+    /// Sets a function which computes the same values as GetValues() for this
+    /// object without virtual calls (NULL = use GetValues)
+    void SetValuesKernel( ValuesKernel kernel ) { valuesKernel = kernel; };
+
+    /// Computes function values for nVals pixels (same as GetValues), using the
+    /// statically dispatched kernel if one has been set
+    void ComputeValues( const double *xVals, const double *yVals, double *outVals, 
+    										long nVals )
+    {
+      if (valuesKernel != NULL)
+        valuesKernel(this, xVals, yVals, outVals, nVals);
+      else
+        GetValues(xVals, yVals, outVals, nVals);
+    };
+
     // override in derived classes only if said class *can* calcluate total flux
     /// Returns true if class can calculate total flux internally
     virtual bool CanCalculateTotalFlux(  ) { return(false); }
@@ -74,6 +135,12 @@ class FunctionObject
     /// Returns total flux of image function, given most recent parameter values
     virtual double TotalFlux( ) { return -1.0; }
 
+    // all derived classes working with 2D images should override this (see
+    // ModelObject::Clone), unless they own data which can't simply be copied:
+    /// Returns a new copy of this object, including the state from the most recent
+    /// Setup() call (returns NULL if the class doesn't support copying)
+    virtual FunctionObject * Clone( ) { return NULL; };
+
     // no need to modify this:
     virtual string GetDescription( );
 
@@ -96,12 +163,30 @@ class FunctionObject
   private:
   
   protected:
+    double DistanceToBox( double xc, double yc, double xMin, double xMax, 
+    								double yMin, double yMax );
+    double SubsampledPixelsCost( long nPixels, int nSamples, double nSubsampledPixels );
+
+    // for use in GetValues() by derived classes with elliptical isophotes (which
+    // must declare FunctionObject a friend, and have the members x0, y0, cosPA,
+    // sinPA, q, and CalculateSubsamples()):
+    template <class F, class ProfileKernel>
+    static void EllipticalValues( F *theFunction, const double *xVals, const double *yVals, 
+    								double *outVals, long nVals, ProfileKernel computeProfile );
+    template <class F, class RadiiKernel, class ProfileKernel>
+    static void EllipticalValues( F *theFunction, const double *xVals, const double *yVals, 
+    								double *outVals, long nVals, RadiiKernel computeRadii,
+    								ProfileKernel computeProfile );
+
     int  nParams;  ///< number of input parameters that image-function uses
     bool  doSubsampling;
+    bool  doTabulation;  ///< use lookup table for radial profile, if class supports it
+    bool  doAdaptiveSubsampling;  ///< use IntegratePixel instead of uniform subsampling
     bool  extraParamsSet;
     vector<string>  parameterLabels;
     string  functionName, shortFunctionName;
     double  ZP;
+    ValuesKernel  valuesKernel;  ///< non-virtual replacement for GetValues (or NULL)
 
     // class member (constant char-vector string) which will hold name of
     // individual class in derived classes
@@ -109,4 +194,47 @@ class FunctionObject
   
 };
 
+
+/* ---------------- PROTECTED METHOD: EllipticalValues ----------------- */
+/// Computes values for nVals pixels (as for GetValues()) in chunks of up to
+/// SIMD_CHUNK_SIZE pixels: computeRadii(xChunk, yChunk, nChunk, rVals) computes
+/// the radii, computeProfile(rVals, nChunk, outChunk) the intensities at those
+/// radii, and then pixels which need subsampling are recomputed with (non-virtual
+/// calls to) the function's own GetValue().
+template <class F, class RadiiKernel, class ProfileKernel>
+void FunctionObject::EllipticalValues( F *theFunction, const double *xVals, 
+									const double *yVals, double *outVals, long nVals, 
+									RadiiKernel computeRadii, ProfileKernel computeProfile )
+{
+  double  rVals[SIMD_CHUNK_SIZE];
+  
+  for (long iStart = 0; iStart < nVals; iStart += SIMD_CHUNK_SIZE) {
+    long  nChunk = min((long)SIMD_CHUNK_SIZE, nVals - iStart);
+    const double  *xChunk = xVals + iStart;
+    const double  *yChunk = yVals + iStart;
+    double  *outChunk = outVals + iStart;
+    computeRadii(xChunk, yChunk, nChunk, rVals);
+    computeProfile(rVals, nChunk, outChunk);
+    for (long i = 0; i < nChunk; i++) {
+      if (theFunction->CalculateSubsamples(rVals[i]) > 1)
+        outChunk[i] = theFunction->F::GetValue(xChunk[i], yChunk[i]);
+    }
+  }
+}
+
+/// Same, for ordinary elliptical radii (EllipticalRadii).
+template <class F, class ProfileKernel>
+void FunctionObject::EllipticalValues( F *theFunction, const double *xVals, 
+									const double *yVals, double *outVals, long nVals, 
+									ProfileKernel computeProfile )
+{
+  EllipticalValues(theFunction, xVals, yVals, outVals, nVals,
+  		[theFunction]( const double *xChunk, const double *yChunk, long nChunk, double *rVals )
+  		{
+  		  EllipticalRadii(xChunk, yChunk, nChunk, theFunction->x0, theFunction->y0, 
+  		  				theFunction->cosPA, theFunction->sinPA, theFunction->q, rVals);
+  		},
+  		computeProfile);
+}
+
 #endif   // _FUNCTION_OBJ_H_
@@ -0,0 +1,109 @@
+/* FILE: pixel_integration.cpp ----------------------------------------- */
+/*
+ *   Adaptive integration of image functions over individual pixels.
+ *
+ *   The standard approach for pixels near the center of a function (e.g.,
+ * Sersic::GetValue) is to subdivide the pixel into N x N subpixels and average
+ * the intensities at the subpixel centers; for functions with small r_e this
+ * can mean up to 100 x 100 evaluations for a single pixel, and the accuracy
+ * is still limited by the (nonsmooth) central cusp of the profile.
+ *
+ *   Here, we instead integrate the pixel using 4 x 4-point Gauss-Legendre
+ * quadrature on squares, recursively subdividing into quarters only those
+ * squares which contain or lie close to the function center (xc,yc) --
+ * i.e., where the integrand is not smooth on the scale of the square. Squares
+ * whose distance from the center is at least half their size are integrated
+ * directly. Pixels well away from the center thus cost 16 evaluations, while
+ * the pixel containing the center costs ~ 2000 (for the default maximum of 10
+ * levels), with relative errors typically ~ 1e-5 or better even for n = 10 
+ * Sersic profiles.
+ */
+
+// Copyright 2018 by Peter Erwin.
+// 
+// This file is part of Imfit.
+// 
+// Imfit is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+// 
+// Imfit is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+// 
+// You should have received a copy of the GNU General Public License along
+// with Imfit.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+/* ------------------------ Include Files (Header Files )--------------- */
+#include <math.h>
+
+#include "pixel_integration.h"
+
+
+/* ---------------- Definitions ---------------------------------------- */
+
+// 4-point Gauss-Legendre abscissas and weights on [-1,1]
+const int  N_GAUSS = 4;
+const double  GAUSS_X[N_GAUSS] = {-0.86113631159405258, -0.33998104358485626, 
+									0.33998104358485626, 0.86113631159405258};
+const double  GAUSS_W[N_GAUSS] = {0.34785484513745386, 0.65214515486254614, 
+									0.65214515486254614, 0.34785484513745386};
+
+// squares closer to the function center than this fraction of their size
+// are subdivided
+const double  SUBDIVIDE_DISTANCE = 0.5;
+
+
+
+/* ---------------- IntegrateSquare (local function) ------------------- */
+// Returns the integral of intensityFunc over the square with center (xs,ys)
+// and side length size, subdividing as necessary
+
+static double IntegrateSquare( PixelIntensityFunc intensityFunc, void *funcObject, 
+								double xs, double ys, double size, double xc, double yc,
+								int level )
+{
+  double  halfSize = 0.5*size;
+  double  dx, dy, theSum;
+  
+  // Chebyshev distance from function center to nearest point of square
+  dx = fmax(0.0, fabs(xs - xc) - halfSize);
+  dy = fmax(0.0, fabs(ys - yc) - halfSize);
+  if ((fmax(dx, dy) < SUBDIVIDE_DISTANCE*size) && (level < PIXEL_INTEGRATION_MAX_LEVEL)) {
+    double  q = 0.5*halfSize;
+    return IntegrateSquare(intensityFunc, funcObject, xs - q, ys - q, halfSize, xc, yc, level + 1)
+    		+ IntegrateSquare(intensityFunc, funcObject, xs + q, ys - q, halfSize, xc, yc, level + 1)
+    		+ IntegrateSquare(intensityFunc, funcObject, xs - q, ys + q, halfSize, xc, yc, level + 1)
+    		+ IntegrateSquare(intensityFunc, funcObject, xs + q, ys + q, halfSize, xc, yc, level + 1);
+  }
+  
+  theSum = 0.0;
+  for (int j = 0; j < N_GAUSS; j++) {
+    double  y = ys + halfSize*GAUSS_X[j];
+    double  rowSum = 0.0;
+    for (int i = 0; i < N_GAUSS; i++)
+      rowSum += GAUSS_W[i]*intensityFunc(xs + halfSize*GAUSS_X[i], y, funcObject);
+    theSum += GAUSS_W[j]*rowSum;
+  }
+  // Gauss weights sum to 2 in each dimension
+  return theSum*halfSize*halfSize;
+}
+
+
+
+/* ---------------- FUNCTION: IntegratePixel --------------------------- */
+
+double IntegratePixel( PixelIntensityFunc intensityFunc, void *funcObject, 
+						double x, double y, double xc, double yc )
+{
+  // pixel has unit area, so integral = mean value
+  return IntegrateSquare(intensityFunc, funcObject, x, y, 1.0, xc, yc, 0);
+}
+
+
+
+/* END OF FILE: pixel_integration.cpp ---------------------------------- */
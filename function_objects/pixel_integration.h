@@ -0,0 +1,24 @@
+// Adaptive integration of image functions over individual pixels, for use
+// near the centers of functions with steep central profiles (Sersic, etc.)
+// in place of uniform pixel subsampling.
+
+#ifndef _PIXEL_INTEGRATION_H_
+#define _PIXEL_INTEGRATION_H_
+
+
+/// Pointer to function returning intensity at image coordinates (x,y), where
+/// funcObject is typically the FunctionObject instance doing the calculation
+typedef double (*PixelIntensityFunc)( double x, double y, void *funcObject );
+
+
+/// Maximum number of subdivision levels (finest squares = 2^-10 pixels on a side)
+const int  PIXEL_INTEGRATION_MAX_LEVEL = 10;
+
+
+/// Returns the mean intensity over the pixel centered at (x,y), given a function
+/// with a (possibly singular) peak at (xc,yc)
+double IntegratePixel( PixelIntensityFunc intensityFunc, void *funcObject, 
+						double x, double y, double xc, double yc );
+
+
+#endif  // _PIXEL_INTEGRATION_H_
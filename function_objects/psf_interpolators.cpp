@@ -2,8 +2,6 @@
 #include <stdio.h>
 #include <math.h>
 
-// The following requires GSL version 2.0 or later
-#include "gsl/gsl_spline2d.h"
 #include "psf_interpolators.h"
 
 
@@ -13,40 +11,101 @@
 const double PI = 3.14159265358979;
 const double PI_SQUARED = 9.86960440108936;
 
+// Coefficients (for powers t^0 ... t^3) of the cubic Hermite basis functions
+// on [0,1]: H0, H1 multiply the function values at t = 0, 1; G0, G1 multiply 
+// the first derivatives at t = 0, 1
+static const double  hermiteBasis[4][4] = { {1.0, 0.0, -3.0, 2.0},    // H0
+											{0.0, 0.0, 3.0, -2.0},    // H1
+											{0.0, 1.0, -2.0, 1.0},    // G0
+											{0.0, 0.0, -1.0, 1.0} };  // G1
 
 
-// DERIVED CLASS: PsfInterpolator_bicubic -- uses GNU Scientific Library's
-// 2D bicubic interpolation
+
+// DERIVED CLASS: PsfInterpolator_bicubic -- bicubic interpolation, equivalent 
+// to GNU Scientific Library's gsl_interp2d_bicubic
 
 // Internally, we work in PSF-center-relative coordinates, which run from
 // (xMin,yMin) = (-halfXsize,-halfYsize) to (xMax,yMax) = (+halfXsize,+halfYsize)
 // and the center of the PSF is at (0,0)
+//
+// As in GSL, the partial derivatives df/dx, df/dy, and d2f/dxdy at each PSF pixel
+// are computed from natural cubic splines along rows and columns; each cell 
+// between four pixel centers is then described by a bicubic polynomial. We 
+// compute the 16 polynomial coefficients for every cell when the object is 
+// created, so that GetValue only has to locate the cell (trivial for a grid 
+// with unit spacing) and evaluate the polynomial. Since GetValue does not 
+// modify any data members (unlike GSL's interpolation accelerators), it can 
+// safely be called from multiple OpenMP threads at the same time.
 
 /* ---------------- CONSTRUCTOR ---------------------------------------- */
 
 PsfInterpolator_bicubic::PsfInterpolator_bicubic( double *inputImage, int nCols_image, 
 													int nRows_image )
 {
+  double  *derivX, *derivY, *derivXY;
+  
   nColumns = nCols_image;
   nRows = nRows_image;
   nPixelsTot = (long)(nColumns * nRows);
   xBound = (nColumns - 1) / 2.0;
   yBound = (nRows - 1) / 2.0;
-  xArray = (double *)calloc((size_t)nColumns, sizeof(double));
-  yArray = (double *)calloc((size_t)nRows, sizeof(double));
-  for (int n = 0; n < nColumns; n++)
-    xArray[n] = n - xBound;
-  for (int n = 0; n < nRows; n++)
-    yArray[n] = n - yBound;
   deltaXMin = -xBound;
   deltaXMax = xBound;
   deltaYMin = -yBound;
   deltaYMax = yBound;
   
-  xacc = gsl_interp_accel_alloc();
-  yacc = gsl_interp_accel_alloc();
-  splineInterp = gsl_spline2d_alloc(gsl_interp2d_bicubic, nColumns, nRows);
-  int result = gsl_spline2d_init(splineInterp, xArray, yArray, inputImage, nColumns, nRows);
+  // partial derivatives at each PSF pixel
+  derivX = (double *)calloc((size_t)nPixelsTot, sizeof(double));
+  derivY = (double *)calloc((size_t)nPixelsTot, sizeof(double));
+  derivXY = (double *)calloc((size_t)nPixelsTot, sizeof(double));
+  for (int j = 0; j < nRows; j++)
+    SplineDerivatives(inputImage + j*nColumns, 1, nColumns, derivX + j*nColumns);
+  for (int i = 0; i < nColumns; i++)
+    SplineDerivatives(inputImage + i, nColumns, nRows, derivY + i);
+  for (int j = 0; j < nRows; j++)
+    SplineDerivatives(derivY + j*nColumns, 1, nColumns, derivXY + j*nColumns);
+  
+  // bicubic coefficients for each cell; coefficients for cell (i,j) [lower-left
+  // corner = PSF pixel (i,j)] are stored as 16 values a[n*4 + m] multiplying t^m u^n
+  nCellColumns = nColumns - 1;
+  nCellRows = nRows - 1;
+  cellCoeffs = (double *)calloc((size_t)(16*nCellColumns*nCellRows), sizeof(double));
+  for (int j = 0; j < nCellRows; j++) {
+    for (int i = 0; i < nCellColumns; i++) {
+      double  *a = cellCoeffs + 16*(j*nCellColumns + i);
+      // corner values: cornerVals[0..3][b*2 + a] for corner at (i + a, j + b)
+      double  cornerVals[4][4];
+      for (int b = 0; b < 2; b++) {
+        for (int aa = 0; aa < 2; aa++) {
+          long  z = (j + b)*nColumns + i + aa;
+          cornerVals[0][b*2 + aa] = inputImage[z];
+          cornerVals[1][b*2 + aa] = derivX[z];
+          cornerVals[2][b*2 + aa] = derivY[z];
+          cornerVals[3][b*2 + aa] = derivXY[z];
+        }
+      }
+      for (int b = 0; b < 2; b++) {
+        for (int aa = 0; aa < 2; aa++) {
+          // basis functions in x (t) and y (u) for value and derivative terms
+          const double  *hX = hermiteBasis[aa];
+          const double  *gX = hermiteBasis[2 + aa];
+          const double  *hY = hermiteBasis[b];
+          const double  *gY = hermiteBasis[2 + b];
+          double  f = cornerVals[0][b*2 + aa];
+          double  fx = cornerVals[1][b*2 + aa];
+          double  fy = cornerVals[2][b*2 + aa];
+          double  fxy = cornerVals[3][b*2 + aa];
+          for (int n = 0; n < 4; n++)
+            for (int m = 0; m < 4; m++)
+              a[n*4 + m] += f*hX[m]*hY[n] + fx*gX[m]*hY[n] + fy*hX[m]*gY[n] 
+              				+ fxy*gX[m]*gY[n];
+        }
+      }
+    }
+  }
+  free(derivX);
+  free(derivY);
+  free(derivXY);
   
   interpolatorType = kInterpolator_bicubic;
 }
@@ -56,11 +115,7 @@ PsfInterpolator_bicubic::PsfInterpolator_bicubic( double *inputImage, int nCols_
 
 PsfInterpolator_bicubic::~PsfInterpolator_bicubic( )
 {
-  gsl_spline2d_free(splineInterp);
-  gsl_interp_accel_free(xacc);
-  gsl_interp_accel_free(yacc);
-  free(xArray);
-  free(yArray);
+  free(cellCoeffs);
 }
 
 
@@ -76,27 +131,83 @@ PsfInterpolator_bicubic::~PsfInterpolator_bicubic( )
 
 double PsfInterpolator_bicubic::GetValue( double x, double y )
 {
-  double newVal;
+  double  t, u, tx, ty, rowVal, newVal;
+  int  i, j;
+  
   if ((x < deltaXMin) || (x > deltaXMax) || (y < deltaYMin) || (y > deltaYMax))
-    newVal = 0.0;
-  else
-    newVal = gsl_spline2d_eval(splineInterp, x, y, xacc, yacc);
+    return 0.0;
+
+  // locate cell (the last row/column of pixels belongs to the preceding cell)
+  tx = x + xBound;
+  ty = y + yBound;
+  i = (int)tx;
+  j = (int)ty;
+  if (i >= nCellColumns)
+    i = nCellColumns - 1;
+  if (j >= nCellRows)
+    j = nCellRows - 1;
+  t = tx - i;
+  u = ty - j;
+  
+  const double  *a = cellCoeffs + 16*(j*nCellColumns + i);
+  newVal = 0.0;
+  for (int n = 3; n >= 0; n--) {
+    rowVal = ((a[n*4 + 3]*t + a[n*4 + 2])*t + a[n*4 + 1])*t + a[n*4];
+    newVal = newVal*u + rowVal;
+  }
   return newVal;
 }
 
 
+/* ---------------- PRIVATE METHOD: SplineDerivatives ------------------ */
+// Computes the first derivatives at the nodes of a natural cubic spline through
+// nVals equally spaced (unit spacing) values; input and output values are
+// separated by stride elements in their respective arrays.
 
-// DERIVED CLASS: PsfInterpolator_lanczos2 -- uses Lanczos2 interpolation
+void PsfInterpolator_bicubic::SplineDerivatives( const double *vals, int stride, int nVals,
+												double *derivs )
+{
+  double  *M, *cPrime;
+  int  n = nVals;
+  
+  // second derivatives M[k], with M[0] = M[n-1] = 0 (natural spline), from
+  // the tridiagonal system M[k-1] + 4 M[k] + M[k+1] = 6(y[k+1] - 2y[k] + y[k-1])
+  M = (double *)calloc((size_t)n, sizeof(double));
+  cPrime = (double *)calloc((size_t)n, sizeof(double));
+  for (int k = 1; k < n - 1; k++) {
+    double  rhs = 6.0*(vals[(k + 1)*stride] - 2.0*vals[k*stride] + vals[(k - 1)*stride]);
+    double  denom = 4.0 - ((k > 1) ? cPrime[k - 1] : 0.0);
+    cPrime[k] = 1.0 / denom;
+    M[k] = (rhs - ((k > 1) ? M[k - 1] : 0.0)) / denom;
+  }
+  for (int k = n - 3; k >= 1; k--)
+    M[k] -= cPrime[k]*M[k + 1];
+  
+  for (int k = 0; k < n - 1; k++)
+    derivs[k*stride] = (vals[(k + 1)*stride] - vals[k*stride]) - (2.0*M[k] + M[k + 1])/6.0;
+  derivs[(n - 1)*stride] = (vals[(n - 1)*stride] - vals[(n - 2)*stride]) 
+  							+ (M[n - 2] + 2.0*M[n - 1])/6.0;
+  free(M);
+  free(cPrime);
+}
+
+
+
+// DERIVED CLASS: PsfInterpolator_lanczos -- uses Lanczos2 or Lanczos3 interpolation
+// (PsfInterpolator_lanczos2 and PsfInterpolator_lanczos3 just set the order)
+
+// As with the bicubic case, we work in PSF-center-relative coordinates.
 
 /* ---------------- CONSTRUCTOR ---------------------------------------- */
 
-PsfInterpolator_lanczos2::PsfInterpolator_lanczos2( double *inputImage, int nCols_image, 
-													int nRows_image )
+PsfInterpolator_lanczos::PsfInterpolator_lanczos( double *inputImage, int nCols_image, 
+													int nRows_image, int order )
 {
   nColumns = nCols_image;
   nRows = nRows_image;
   nPixelsTot = (long)(nColumns * nRows);
   psfDataArray = inputImage;
+  lanczosOrder = order;
   
   xBound = (nColumns - 1) / 2.0;
   yBound = (nRows - 1) / 2.0;
@@ -111,15 +222,13 @@ PsfInterpolator_lanczos2::PsfInterpolator_lanczos2( double *inputImage, int nCol
   deltaYMin = -yBound;
   deltaYMax = yBound;
 
-  // FIXME: add stuff for Lanczos2  
-
   interpolatorType = kInterpolator_lanczos2;
 }
 
 
 /* ---------------- DESTRUCTOR ----------------------------------------- */
 
-PsfInterpolator_lanczos2::~PsfInterpolator_lanczos2( )
+PsfInterpolator_lanczos::~PsfInterpolator_lanczos( )
 {
   free(xArray);
   free(yArray);
@@ -127,56 +236,130 @@ PsfInterpolator_lanczos2::~PsfInterpolator_lanczos2( )
 
 
 /* ---------------- PUBLIC METHOD: GetValue ---------------------------- */
-// This function calculates and returns the value of the Lanczos2
+// This function calculates and returns the value of the Lanczos
 // interpolation kernel, convolved with the PSF image, at x_diff,y_diff, with 
 // those coordinates being relative to the center of the PSF. The corresponding 
 // calculations and call in PointSource::GetValue are
 //    x_diff = x - x0;
 //    y_diff = y - y0;
 //    normalizedIntensity = psfInterpolator->GetValue(x_diff, y_diff);
+// Since the kernel is separable, we compute the 2*lanczosOrder weights in x and
+// in y once, then apply them to the (2*lanczosOrder)^2 nearest PSF pixels.
 
-double PsfInterpolator_lanczos2::GetValue( double x, double y )
+double PsfInterpolator_lanczos::GetValue( double x, double y )
 {
-  double newVal;
-  double lanczosScaling;
+  double newVal, rowSum;
+  double xWeights[6], yWeights[6];   // room for up to Lanczos3
   int i_data_mid_x, i_data_mid_y;
   int i_data_x, i_data_y;
-  double x_dat, y_dat;
+  int  nWeights = 2*lanczosOrder;
   
   if ((x < deltaXMin) || (x > deltaXMax) || (y < deltaYMin) || (y > deltaYMax))
-    newVal = 0.0;
-  else {
-    // FIXME: do Lanczos2 interpolation
-    // reminder: xArray runs from [-halfXwidth, .., +halfXwidth], etc.
-    i_data_mid_x = FindIndex(xArray, x);
-    i_data_mid_y = FindIndex(yArray, y);
-    
-    newVal = 0.0;
-    // loop over columns in PSF image
-    for (int i = -2; i <= 2; i++) {
-      i_data_x = i_data_mid_x + i;
+    return 0.0;
+
+  // reminder: xArray runs from [-halfXwidth, .., +halfXwidth], etc.
+  i_data_mid_x = FindIndex(xArray, x);
+  i_data_mid_y = FindIndex(yArray, y);
+  // kernel weights for PSF pixels i_data_mid - lanczosOrder + 1 ... i_data_mid + lanczosOrder
+  for (int k = 0; k < nWeights; k++) {
+    i_data_x = i_data_mid_x - lanczosOrder + 1 + k;
+    i_data_y = i_data_mid_y - lanczosOrder + 1 + k;
+    xWeights[k] = Lanczos(x - (i_data_x - xBound), lanczosOrder);
+    yWeights[k] = Lanczos(y - (i_data_y - yBound), lanczosOrder);
+  }
+  
+  newVal = 0.0;
+  // loop over rows in PSF image
+  for (int j = 0; j < nWeights; j++) {
+    i_data_y = i_data_mid_y - lanczosOrder + 1 + j;
+    if ((i_data_y < 0) || (i_data_y >= nRows))
+      continue;  // outside PSF image (in y)
+    // loop over columns in PSF image (for this row)
+    rowSum = 0.0;
+    for (int i = 0; i < nWeights; i++) {
+      i_data_x = i_data_mid_x - lanczosOrder + 1 + i;
       if ((i_data_x < 0) || (i_data_x >= nColumns))
-        newVal += 0.0;  // outside PSF image (in x)
-      else {
-        x_dat = xArray[i_data_x];  // current x-value for PSF pixels
-        // loop over rows in PSF image (for this column)
-        for (int j = -2; j <= 2; j++) {
-          i_data_y = i_data_mid_y + j;
-          if ((i_data_y < 0) || (i_data_y >= nRows))
-            newVal += 0.0;  // outside PSF image (in y)
-          else {
-            y_dat = yArray[i_data_y];  // current y-value for PSF pixels
-            lanczosScaling = Lanczos(x - x_dat, 2) * Lanczos(y - y_dat, 2);
-            newVal += lanczosScaling * psfDataArray[i_data_x*nColumns + i_data_y];
-          }
-        }
-      }
+        continue;  // outside PSF image (in x)
+      rowSum += xWeights[i] * psfDataArray[i_data_y*nColumns + i_data_x];
     }
+    newVal += yWeights[j] * rowSum;
   }
   return newVal;
 }
 
 
+/* ---------------- PUBLIC METHOD: MakeShiftedStamp ------------------- */
+// Computes interpolated PSF values on a grid of nStampCols x nStampRows points
+// with unit spacing, starting at (xStart,yStart) [PSF-center-relative coordinates],
+// and stores them in stampPixels (which must already be allocated).
+//
+// Because the grid spacing matches the PSF pixel spacing, the sub-pixel shift --
+// and thus the set of 2*lanczosOrder kernel weights in each direction -- is the
+// same for every point. We compute the two 1D weight vectors once and then apply
+// them as two separable passes (first along rows, then along columns), which
+// takes O(N_psf * lanczosOrder) operations in total, instead of evaluating the
+// kernel (sin terms, index searches) for each point separately. The inner loops
+// run over contiguous output pixels, so the compiler can vectorize them.
+
+void PsfInterpolator_lanczos::MakeShiftedStamp( double xStart, double yStart, 
+								int nStampCols, int nStampRows, double *stampPixels )
+{
+  double xWeights[6], yWeights[6];   // room for up to Lanczos3
+  int  nWeights = 2*lanczosOrder;
+  int  i_start_x, i_start_y, c1, c2, r1, r2;
+  long  nTemp;
+  double *tempPixels;
+  
+  if ((nStampCols <= 0) || (nStampRows <= 0))
+    return;
+
+  // PSF pixel index for first stamp point, and weights for PSF pixels
+  // i_start - lanczosOrder + 1 ... i_start + lanczosOrder (relative to each point)
+  i_start_x = FindIndex(xArray, xStart);
+  i_start_y = FindIndex(yArray, yStart);
+  for (int k = 0; k < nWeights; k++) {
+    xWeights[k] = Lanczos(xStart - (i_start_x - lanczosOrder + 1 + k - xBound), lanczosOrder);
+    yWeights[k] = Lanczos(yStart - (i_start_y - lanczosOrder + 1 + k - yBound), lanczosOrder);
+  }
+  
+  // 1. Interpolate along rows: tempPixels[row, c] for all PSF rows
+  nTemp = (long)nRows * (long)nStampCols;
+  tempPixels = (double *)calloc((size_t)nTemp, sizeof(double));
+  for (int j = 0; j < nRows; j++) {
+    const double *psfRow = psfDataArray + (long)j*nColumns;
+    double *tempRow = tempPixels + (long)j*nStampCols;
+    for (int k = 0; k < nWeights; k++) {
+      // stamp column c uses PSF column i_start_x + c - lanczosOrder + 1 + k;
+      // restrict c so that this is inside the PSF image
+      int  offset = i_start_x - lanczosOrder + 1 + k;
+      c1 = (offset < 0) ? -offset : 0;
+      c2 = (nColumns - offset < nStampCols) ? nColumns - offset : nStampCols;
+      double  w = xWeights[k];
+      for (int c = c1; c < c2; c++)
+        tempRow[c] += w * psfRow[c + offset];
+    }
+  }
+  
+  // 2. Interpolate along columns
+  for (long z = 0; z < (long)nStampCols*nStampRows; z++)
+    stampPixels[z] = 0.0;
+  for (int k = 0; k < nWeights; k++) {
+    int  offset = i_start_y - lanczosOrder + 1 + k;
+    r1 = (offset < 0) ? -offset : 0;
+    r2 = (nRows - offset < nStampRows) ? nRows - offset : nStampRows;
+    double  w = yWeights[k];
+    for (int r = r1; r < r2; r++) {
+      const double *tempRow = tempPixels + (long)(r + offset)*nStampCols;
+      double *stampRow = stampPixels + (long)r*nStampCols;
+      for (int c = 0; c < nStampCols; c++)
+        stampRow[c] += w * tempRow[c];
+    }
+  }
+  
+  free(tempPixels);
+}
+
+
 
 // Extra non-method functions
 
@@ -194,7 +377,7 @@ int FindIndex( double xArray[], double xVal )
 // Generalized Lanczsos function (a.k.a. Lanczos-windowed sinc function)
 double Lanczos( double x, int n )
 {
-  double x_abs = abs(x);
+  double x_abs = fabs(x);
   if (x_abs < 1.0e-6)
     return 1.0;
   else if (x_abs > n)
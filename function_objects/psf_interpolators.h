@@ -1,9 +1,6 @@
 #ifndef _PSF_INTERPOLATORS_H_
 #define _PSF_INTERPOLATORS_H_
 
-// The following requires GSL version 2.0 or later
-#include "gsl/gsl_spline2d.h"
-
 #define kInterpolator_Base 0
 #define kInterpolator_bicubic 1
 #define kInterpolator_lanczos2 2
@@ -35,6 +32,22 @@ class PsfInterpolator
   // pure virtual function (making this an abstract base class)
   virtual double GetValue( double x, double y ) = 0;
 
+  // Derived classes which can efficiently compute the whole PSF at once for a
+  // fixed sub-pixel shift should override these
+  virtual bool CanMakeShiftedStamp( ) { return false; };
+  virtual void MakeShiftedStamp( double xStart, double yStart, int nStampCols, 
+  								int nStampRows, double *stampPixels ) { ; };
+
+  // Range of x and y offsets (relative to PSF center) outside of which GetValue
+  // returns 0
+  void GetBounds( double& xMin, double& xMax, double& yMin, double& yMax )
+  {
+    xMin = deltaXMin;
+    xMax = deltaXMax;
+    yMin = deltaYMin;
+    yMax = deltaYMax;
+  };
+
   protected:
     int  interpolatorType = kInterpolator_Base;
     // data members proper
@@ -44,7 +57,8 @@ class PsfInterpolator
 };
 
 
-// Derived class using GNU Scientific Library's 2D bicubic interpolation
+// Derived class using bicubic interpolation (same as GNU Scientific Library's
+// 2D bicubic interpolation); GetValue is thread-safe
 class PsfInterpolator_bicubic : public PsfInterpolator
 {
   public:
@@ -55,30 +69,57 @@ class PsfInterpolator_bicubic : public PsfInterpolator
   double GetValue( double x, double y );
 
   private:
+    void SplineDerivatives( const double *vals, int stride, int nVals, double *derivs );
+
     // new data members
-    gsl_spline2d *splineInterp;
-    gsl_interp_accel *xacc;
-    gsl_interp_accel *yacc;
-    double *xArray;
-    double *yArray;
+    int  nCellColumns, nCellRows;
+    double *cellCoeffs;
 };
 
 
-// Derived class using Lanczos2 kernel
-class PsfInterpolator_lanczos2 : public PsfInterpolator
+// Derived class using Lanczos kernels (Lanczos2 or Lanczos3); the kernel is
+// separable, so shifted copies of the whole PSF can be computed efficiently
+class PsfInterpolator_lanczos : public PsfInterpolator
 {
   public:
-  PsfInterpolator_lanczos2( double *inputImage, int nCols_image, int nRows_image );
+  PsfInterpolator_lanczos( double *inputImage, int nCols_image, int nRows_image,
+  							int order );
   
-  ~PsfInterpolator_lanczos2( );
+  ~PsfInterpolator_lanczos( );
   
   double GetValue( double x, double y );
 
-  private:
+  bool CanMakeShiftedStamp( ) { return true; };
+
+  void MakeShiftedStamp( double xStart, double yStart, int nStampCols, 
+  						int nStampRows, double *stampPixels );
+
+  protected:
     // new data members
+    int  lanczosOrder;
     double *xArray;
     double *yArray;
     double *psfDataArray;
 };
 
+
+// Derived class using Lanczos2 kernel
+class PsfInterpolator_lanczos2 : public PsfInterpolator_lanczos
+{
+  public:
+  PsfInterpolator_lanczos2( double *inputImage, int nCols_image, int nRows_image )
+  		: PsfInterpolator_lanczos(inputImage, nCols_image, nRows_image, 2)
+  		{ interpolatorType = kInterpolator_lanczos2; };
+};
+
+
+// Derived class using Lanczos3 kernel
+class PsfInterpolator_lanczos3 : public PsfInterpolator_lanczos
+{
+  public:
+  PsfInterpolator_lanczos3( double *inputImage, int nCols_image, int nRows_image )
+  		: PsfInterpolator_lanczos(inputImage, nCols_image, nRows_image, 3)
+  		{ interpolatorType = kInterpolator_lanczos3; };
+};
+
 #endif   // _PSF_INTERPOLATORS_H_
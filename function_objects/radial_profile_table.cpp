@@ -0,0 +1,145 @@
+/* FILE: radial_profile_table.cpp -------------------------------------- */
+/* 
+ *   Lookup tables for radial intensity profiles.
+ *
+ *   Profiles like the Sersic function require pow() and exp() for every pixel
+ * (and every subpixel); for images with many pixels it is cheaper to tabulate
+ * I(r) once for each set of parameters and interpolate.
+ *
+ *   The table is organized in octaves of r: octave k covers 
+ * rMin*2^k <= r < rMin*2^(k+1), with N_k equally spaced points (plus one point
+ * before and two after, so that cubic interpolation never has to cross into 
+ * a neighboring octave). Locating a value only requires frexp() and some 
+ * multiplications. Octave spacing makes the table denser near the center, 
+ * where profiles typically change fastest in r, and N_k is chosen separately
+ * for each octave, by doubling until the interpolation error at all midpoints
+ * between table points is <= relTolerance (relative to the true value).
+ */
+
+// Copyright 2018 by Peter Erwin.
+// 
+// This file is part of Imfit.
+// 
+// Imfit is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+// 
+// Imfit is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+// 
+// You should have received a copy of the GNU General Public License along
+// with Imfit.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+/* ------------------------ Include Files (Header Files )--------------- */
+#include <math.h>
+#include <vector>
+
+#include "radial_profile_table.h"
+
+using namespace std;
+
+
+/* ---------------- Definitions ---------------------------------------- */
+
+// inner edge of table, relative to rScale
+const double  R_MIN_RELATIVE = 1.0e-3;
+// maximum number of octaves (rMax = 2^24 rMin ~ 1.7e4 rScale)
+const int  MAX_OCTAVES = 24;
+// range of points per octave
+const int  MIN_POINTS_PER_OCTAVE = 8;
+const int  MAX_POINTS_PER_OCTAVE = 4096;
+// table ends once intensity falls below this fraction of I(rMin)
+const double  NEGLIGIBLE_INTENSITY_FRACTION = 1.0e-30;
+
+
+
+/* ---------------- CONSTRUCTOR ---------------------------------------- */
+
+RadialProfileTable::RadialProfileTable( )
+{
+  rMin = 1.0;
+  invRMin = 1.0;
+  scaledMax = 1.0;   // i.e., empty table
+}
+
+
+/* ---------------- PUBLIC METHOD: Build ------------------------------- */
+/// Tabulates intensityFunc(r, funcObject) over the range rScale*1e-3 <= r <= 
+/// rScale*1.7e4 (or less, if the profile becomes negligible or can't be 
+/// tabulated to the requested accuracy). Previous contents of the table are 
+/// discarded (though the allocated memory is reused). Returns the number of 
+/// octaves in the table (0 if table could not be built).
+int RadialProfileTable::Build( double (*intensityFunc)(double, void *), void *funcObject, 
+							double rScale, double relTolerance )
+{
+  int  nOctaves = 0;
+  int  nPoints = MIN_POINTS_PER_OCTAVE;
+  long  offset;
+  double  octaveStart, I_min, I_end;
+  
+  tableValues.clear();
+  octaveNPoints.clear();
+  octaveOffsets.clear();
+  rMin = R_MIN_RELATIVE*rScale;
+  scaledMax = 1.0;
+  if (! (rMin > 0.0)) {
+    rMin = 1.0;
+    invRMin = 1.0;
+    return 0;
+  }
+  invRMin = 1.0 / rMin;
+  I_min = fabs(intensityFunc(rMin, funcObject));
+  
+  for (int k = 0; k < MAX_OCTAVES; k++) {
+    octaveStart = rMin*ldexp(1.0, k);
+    offset = (long)tableValues.size();
+    bool  octaveOK = false;
+    // try to tabulate this octave with nPoints, doubling if necessary
+    while (nPoints <= MAX_POINTS_PER_OCTAVE) {
+      double  deltaR = octaveStart / nPoints;
+      tableValues.resize(offset + nPoints + 3);
+      for (int j = 0; j < nPoints + 3; j++)
+        tableValues[offset + j] = intensityFunc(octaveStart + (j - 1)*deltaR, funcObject);
+      // check midpoints
+      octaveOK = true;
+      for (int j = 0; j < nPoints; j++) {
+        double  trueVal = intensityFunc(octaveStart + (j + 0.5)*deltaR, funcObject);
+        double  interpVal = Interpolate(&tableValues[offset + j], 0.5);
+        if (! (fabs(interpVal - trueVal) <= relTolerance*fabs(trueVal))) {
+          octaveOK = false;
+          break;
+        }
+      }
+      if (octaveOK)
+        break;
+      nPoints *= 2;
+    }
+    if (! octaveOK) {
+      tableValues.resize(offset);
+      break;
+    }
+    octaveNPoints.push_back(nPoints);
+    octaveOffsets.push_back((int)offset);
+    nOctaves += 1;
+    // stop if the profile has become negligible
+    I_end = fabs(tableValues[offset + nPoints + 1]);
+    if (I_end < NEGLIGIBLE_INTENSITY_FRACTION*I_min)
+      break;
+    // next octave has twice the spacing, so the previous number of points is
+    // probably more than sufficient
+    if (nPoints > MIN_POINTS_PER_OCTAVE)
+      nPoints /= 2;
+  }
+  
+  scaledMax = ldexp(1.0, nOctaves);
+  return nOctaves;
+}
+
+
+
+/* END OF FILE: radial_profile_table.cpp ------------------------------- */
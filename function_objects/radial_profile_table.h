@@ -0,0 +1,82 @@
+/*   Class interface definition for radial_profile_table.cpp
+ *
+ *   A lookup table for radial intensity profiles I(r), which image functions
+ * with expensive profiles (Sersic, etc.) can build once per Setup() call and
+ * then use in place of direct evaluation for each pixel.
+ *
+ */
+
+#ifndef _RADIAL_PROFILE_TABLE_H_
+#define _RADIAL_PROFILE_TABLE_H_
+
+#include <math.h>
+#include <vector>
+
+using namespace std;
+
+
+/// Default maximum relative error for tabulated profiles
+const double  PROFILE_TABLE_TOLERANCE = 1.0e-7;
+
+
+/// \brief Lookup table for I(r), with octave-based spacing in r and cubic interpolation
+///
+/// The table covers rMin <= r < rMin * 2^nOctaves; each octave [rMin*2^k, rMin*2^(k+1))
+/// has its own number of equally spaced points, doubled until interpolation 
+/// errors at the midpoints between table points are within the requested 
+/// relative tolerance. Octaves which can't satisfy the tolerance (or where the 
+/// profile has become negligible) end the table, so callers should evaluate
+/// the profile directly whenever Lookup() returns false.
+class RadialProfileTable
+{
+  public:
+    RadialProfileTable( );
+
+    int Build( double (*intensityFunc)(double, void *), void *funcObject, 
+    			double rScale, double relTolerance=PROFILE_TABLE_TOLERANCE );
+    
+    /// Returns false if r is outside the range of the table; otherwise stores
+    /// interpolated intensity in value and returns true
+    bool Lookup( double r, double *value ) const
+    {
+      double  scaled = r*invRMin;
+      if (! ((scaled >= 1.0) && (scaled < scaledMax)))
+        return false;
+      // scaled = m * 2^e, with 0.5 <= m < 1; octave k = e - 1
+      int  e;
+      double  m = frexp(scaled, &e);
+      int  k = e - 1;
+      double  pos = (2.0*m - 1.0)*octaveNPoints[k];
+      int  j = (int)pos;
+      *value = Interpolate(&tableValues[octaveOffsets[k] + j], pos - j);
+      return true;
+    };
+    
+    /// Range of r values covered by the table (rMax = rMin if table is empty)
+    void GetRange( double& rMinimum, double& rMaximum ) const
+    {
+      rMinimum = rMin;
+      rMaximum = rMin*scaledMax;
+    };
+    
+    int GetNPoints( ) const { return (int)tableValues.size(); };
+
+
+  private:
+    // cubic (Lagrange) interpolation between p[1] and p[2], for 0 <= f < 1
+    static double Interpolate( const double *p, double f )
+    {
+      double  fp1 = f + 1.0;
+      double  fm1 = f - 1.0;
+      double  fm2 = f - 2.0;
+      return (-p[0]*f*fm1*fm2 + 3.0*(p[1]*fp1*fm1*fm2 - p[2]*fp1*f*fm2) 
+      			+ p[3]*fp1*f*fm1) / 6.0;
+    };
+
+    double  rMin, invRMin, scaledMax;
+    vector<double>  tableValues;
+    vector<int>  octaveNPoints, octaveOffsets;
+};
+
+
+#endif   // _RADIAL_PROFILE_TABLE_H_
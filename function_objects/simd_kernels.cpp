@@ -0,0 +1,726 @@
+/* FILE: simd_kernels.cpp ---------------------------------------------- */
+/*
+ *   Vectorized kernels for elliptical radii and radial profiles (Sersic, etc.),
+ * with runtime selection of AVX-512, AVX2+FMA, or scalar implementations.
+ *
+ *   The AVX2 and AVX-512 versions are compiled using per-function target
+ * attributes (so the rest of the program does not need to be compiled with
+ * -mavx2, etc.), and are only called if the CPU supports them.
+ *
+ *   Vector exp(x): x = k*ln(2) + r, with |r| <= ln(2)/2 (two-part Cody-Waite
+ * reduction), exp(r) from its Taylor series through r^13 (truncation error
+ * < 5e-18), then scaled by 2^k.
+ *   Vector log(x): x = 2^e * m, with sqrt(1/2) < m <= sqrt(2); then
+ * log(m) = 2 atanh(s), s = (m - 1)/(m + 1), using the series through s^23
+ * (|s| < 0.172, so truncation error < 1e-19), and log(x) = e*ln(2) + log(m).
+ *   The scalar versions are the same expressions used in the individual
+ * FunctionObject classes, using the standard math library.
+ */
+
+// Copyright 2018 by Peter Erwin.
+//
+// This file is part of Imfit.
+//
+// Imfit is free software: you can redistribute it and/or modify it under
+// the terms of the GNU General Public License as published by the Free
+// Software Foundation, either version 3 of the License, or (at your
+// option) any later version.
+//
+// Imfit is distributed in the hope that it will be useful, but WITHOUT ANY
+// WARRANTY; without even the implied warranty of MERCHANTABILITY or
+// FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License
+// for more details.
+//
+// You should have received a copy of the GNU General Public License along
+// with Imfit.  If not, see <http://www.gnu.org/licenses/>.
+
+
+
+/* ------------------------ Include Files (Header Files )--------------- */
+#include <math.h>
+
+#include "simd_kernels.h"
+
+#if !defined(NO_SIMD) && (defined(__x86_64__) || defined(__i386__)) && \
+		(defined(__GNUC__) || defined(__clang__))
+#define USE_X86_SIMD
+#include <immintrin.h>
+#define TARGET_AVX2  __attribute__((target("avx2,fma")))
+#define TARGET_AVX2_NOFMA  __attribute__((target("avx2")))
+#define TARGET_AVX512  __attribute__((target("avx512f")))
+#endif
+
+
+/* ---------------- Definitions ---------------------------------------- */
+
+#ifdef USE_X86_SIMD
+const double  LOG2E = 1.4426950408889634074;
+const double  LN2_HI = 6.93147180369123816490e-01;
+const double  LN2_LO = 1.90821492927058770002e-10;
+const double  SQRT2 = 1.41421356237309504880;
+const double  TWO52 = 4503599627370496.0;
+// 2^52 + 2^51: adding this rounds to nearest integer, which ends up in low bits
+const double  ROUNDING_MAGIC = 6755399441055744.0;
+// range of exp() arguments for which 2^k is a normal double
+const double  EXP_MIN_ARG = -708.39;
+const double  EXP_MAX_ARG = 709.43;
+// wider range for AVX-512, where scalef handles overflow and underflow
+const double  EXP_MIN_ARG_512 = -746.0;
+const double  EXP_MAX_ARG_512 = 710.0;
+
+// Taylor coefficients 1/k! for exp(r), highest order first
+const int  N_EXP_COEFFS = 14;
+const double  EXP_COEFFS[N_EXP_COEFFS] = { 1.6059043836821613e-10, 2.0876756987868099e-09,
+		2.5052108385441720e-08, 2.7557319223985893e-07, 2.7557319223985888e-06,
+		2.4801587301587302e-05, 1.9841269841269841e-04, 1.3888888888888889e-03,
+		8.3333333333333333e-03, 4.1666666666666667e-02, 1.6666666666666667e-01,
+		0.5, 1.0, 1.0 };
+// coefficients 2/(2k + 1) for 2 atanh(s)/s, as series in s^2, highest order first
+const int  N_LOG_COEFFS = 12;
+const double  LOG_COEFFS[N_LOG_COEFFS] = { 2.0/23.0, 2.0/21.0, 2.0/19.0, 2.0/17.0,
+		2.0/15.0, 2.0/13.0, 2.0/11.0, 2.0/9.0, 2.0/7.0, 2.0/5.0, 2.0/3.0, 2.0 };
+#endif
+
+static SimdLevel  currentSimdLevel = DetectSimdLevel();
+
+
+
+/* ---------------- FUNCTION: DetectSimdLevel -------------------------- */
+
+SimdLevel DetectSimdLevel( )
+{
+#ifdef USE_X86_SIMD
+  // needed if we're called before libgcc's own constructors (e.g., when
+  // initializing currentSimdLevel)
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx512f"))
+    return SIMD_AVX512;
+  if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+    return SIMD_AVX2;
+#endif
+  return SIMD_SCALAR;
+}
+
+
+/* ---------------- FUNCTION: GetSimdLevel ----------------------------- */
+
+SimdLevel GetSimdLevel( )
+{
+  return currentSimdLevel;
+}
+
+
+/* ---------------- FUNCTION: SetSimdLevel ----------------------------- */
+
+SimdLevel SetSimdLevel( SimdLevel level )
+{
+  SimdLevel  bestLevel = DetectSimdLevel();
+
+  currentSimdLevel = (level > bestLevel) ? bestLevel : level;
+  return currentSimdLevel;
+}
+
+
+/* ---------------- FUNCTION: SimdLevelName ---------------------------- */
+
+const char * SimdLevelName( SimdLevel level )
+{
+  switch (level) {
+    case SIMD_AVX512:
+      return "AVX-512";
+    case SIMD_AVX2:
+      return "AVX2";
+    default:
+      return "scalar";
+  }
+}
+
+
+
+/* ---------------- Scalar implementations ----------------------------- */
+
+// Elliptical radius for a single pixel (also used for the tails of the
+// vector loops)
+
+static inline double EllipticalRadius_scalar( double x_diff, double y_diff, double cosPA,
+										double sinPA, double q )
+{
+  double  xp = x_diff*cosPA + y_diff*sinPA;
+  double  yp_scaled = (-x_diff*sinPA + y_diff*cosPA)/q;
+  return sqrt(xp*xp + yp_scaled*yp_scaled);
+}
+
+
+static void EllipticalRadii_scalar( const double *xVals, const double *yVals, long nVals,
+					double x0, double y0, double cosPA, double sinPA, double q,
+					double *rVals )
+{
+  for (long i = 0; i < nVals; i++)
+    rVals[i] = EllipticalRadius_scalar(xVals[i] - x0, yVals[i] - y0, cosPA, sinPA, q);
+}
+
+
+static void GeneralizedEllipticalRadii_scalar( const double *xVals, const double *yVals,
+					long nVals, double x0, double y0, double cosPA, double sinPA, double q,
+					double ellExponent, double invEllExponent, double *rVals )
+{
+  for (long i = 0; i < nVals; i++) {
+    double  x_diff = xVals[i] - x0;
+    double  y_diff = yVals[i] - y0;
+    double  xp = fabs(x_diff*cosPA + y_diff*sinPA);
+    double  yp_scaled = fabs((-x_diff*sinPA + y_diff*cosPA)/q);
+    double  powerSum = pow(xp, ellExponent) + pow(yp_scaled, ellExponent);
+    rVals[i] = pow(powerSum, invEllExponent);
+  }
+}
+
+
+
+#ifdef USE_X86_SIMD
+/* ---------------- AVX2 implementations ------------------------------- */
+
+static inline __m256d TARGET_AVX2 Exp_avx2( __m256d x )
+{
+  const __m256d  magic = _mm256_set1_pd(ROUNDING_MAGIC);
+  __m256d  xc = _mm256_min_pd(_mm256_max_pd(x, _mm256_set1_pd(EXP_MIN_ARG)),
+  							_mm256_set1_pd(EXP_MAX_ARG));
+
+  // x = k*ln(2) + r
+  __m256d  kPlusMagic = _mm256_fmadd_pd(xc, _mm256_set1_pd(LOG2E), magic);
+  __m256d  k = _mm256_sub_pd(kPlusMagic, magic);
+  __m256d  r = _mm256_fnmadd_pd(k, _mm256_set1_pd(LN2_HI), xc);
+  r = _mm256_fnmadd_pd(k, _mm256_set1_pd(LN2_LO), r);
+  __m256d  p = _mm256_set1_pd(EXP_COEFFS[0]);
+  for (int i = 1; i < N_EXP_COEFFS; i++)
+    p = _mm256_fmadd_pd(p, r, _mm256_set1_pd(EXP_COEFFS[i]));
+
+  // 2^k, constructed directly from bits (k is in the low bits of kPlusMagic;
+  // the high bits are shifted out)
+  __m256i  scaleBits = _mm256_slli_epi64(_mm256_add_epi64(_mm256_castpd_si256(kPlusMagic),
+  							_mm256_set1_epi64x(1023)), 52);
+  __m256d  result = _mm256_mul_pd(p, _mm256_castsi256_pd(scaleBits));
+
+  // out-of-range and NaN inputs
+  result = _mm256_blendv_pd(result, _mm256_setzero_pd(),
+  					_mm256_cmp_pd(x, _mm256_set1_pd(EXP_MIN_ARG), _CMP_LT_OQ));
+  result = _mm256_blendv_pd(result, _mm256_set1_pd(HUGE_VAL),
+  					_mm256_cmp_pd(x, _mm256_set1_pd(EXP_MAX_ARG), _CMP_GT_OQ));
+  return _mm256_blendv_pd(result, x, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+}
+
+
+static inline __m256d TARGET_AVX2 Log_avx2( __m256d x )
+{
+  const __m256d  one = _mm256_set1_pd(1.0);
+  const __m256d  two52 = _mm256_set1_pd(TWO52);
+
+  // scale denormals into normal range
+  __m256d  denormMask = _mm256_cmp_pd(x, _mm256_set1_pd(2.2250738585072014e-308), _CMP_LT_OQ);
+  __m256d  xs = _mm256_blendv_pd(x, _mm256_mul_pd(x, two52), denormMask);
+  __m256d  eAdjust = _mm256_and_pd(denormMask, _mm256_set1_pd(-52.0));
+
+  // x = 2^e * m, 1 <= m < 2 (exponent bits converted to double via 2^52 trick)
+  __m256i  bits = _mm256_castpd_si256(xs);
+  __m256d  e = _mm256_sub_pd(_mm256_castsi256_pd(_mm256_or_si256(_mm256_srli_epi64(bits, 52),
+  						_mm256_castpd_si256(two52))), _mm256_set1_pd(TWO52 + 1023.0));
+  __m256d  m = _mm256_castsi256_pd(_mm256_or_si256(_mm256_and_si256(bits,
+  						_mm256_set1_epi64x(0x000FFFFFFFFFFFFFLL)), _mm256_castpd_si256(one)));
+  // shift to sqrt(1/2) < m <= sqrt(2)
+  __m256d  bigMask = _mm256_cmp_pd(m, _mm256_set1_pd(SQRT2), _CMP_GT_OQ);
+  m = _mm256_blendv_pd(m, _mm256_mul_pd(m, _mm256_set1_pd(0.5)), bigMask);
+  e = _mm256_add_pd(_mm256_add_pd(e, _mm256_and_pd(bigMask, one)), eAdjust);
+
+  __m256d  f = _mm256_sub_pd(m, one);
+  __m256d  s = _mm256_div_pd(f, _mm256_add_pd(f, _mm256_set1_pd(2.0)));
+  __m256d  s2 = _mm256_mul_pd(s, s);
+  __m256d  p = _mm256_set1_pd(LOG_COEFFS[0]);
+  for (int i = 1; i < N_LOG_COEFFS - 1; i++)
+    p = _mm256_fmadd_pd(p, s2, _mm256_set1_pd(LOG_COEFFS[i]));
+  __m256d  logm = _mm256_fmadd_pd(_mm256_mul_pd(s, s2), p, _mm256_add_pd(s, s));
+  __m256d  result = _mm256_fmadd_pd(e, _mm256_set1_pd(LN2_HI),
+  						_mm256_fmadd_pd(e, _mm256_set1_pd(LN2_LO), logm));
+
+  // zero, negative, infinite, and NaN inputs
+  const __m256d  zero = _mm256_setzero_pd();
+  result = _mm256_blendv_pd(result, _mm256_set1_pd(-HUGE_VAL),
+  					_mm256_cmp_pd(x, zero, _CMP_EQ_OQ));
+  result = _mm256_blendv_pd(result, _mm256_set1_pd(NAN), _mm256_cmp_pd(x, zero, _CMP_LT_OQ));
+  result = _mm256_blendv_pd(result, x,
+  					_mm256_cmp_pd(x, _mm256_set1_pd(HUGE_VAL), _CMP_EQ_OQ));
+  return _mm256_blendv_pd(result, x, _mm256_cmp_pd(x, x, _CMP_UNORD_Q));
+}
+
+
+// x^y for x >= 0, y > 0
+static inline __m256d TARGET_AVX2 Pow_avx2( __m256d x, __m256d y )
+{
+  return Exp_avx2(_mm256_mul_pd(y, Log_avx2(x)));
+}
+
+
+// Elliptical radii (used for AVX-512 as well). This uses the same operations
+// as EllipticalRadius_scalar, and is deliberately compiled *without* FMA, so
+// that the compiler cannot fuse multiplications and additions; the results are
+// then identical to the scalar version's (so subsampling decisions, etc., do
+// not depend on the CPU)
+static void TARGET_AVX2_NOFMA EllipticalRadii_avx2( const double *xVals, const double *yVals,
+					long nVals, double x0, double y0, double cosPA, double sinPA, double q,
+					double *rVals )
+{
+  __m256d  x0_vec = _mm256_set1_pd(x0);
+  __m256d  y0_vec = _mm256_set1_pd(y0);
+  __m256d  c = _mm256_set1_pd(cosPA);
+  __m256d  s = _mm256_set1_pd(sinPA);
+  __m256d  q_vec = _mm256_set1_pd(q);
+  long  i;
+  for (i = 0; i + 4 <= nVals; i += 4) {
+    __m256d  x_diff = _mm256_sub_pd(_mm256_loadu_pd(xVals + i), x0_vec);
+    __m256d  y_diff = _mm256_sub_pd(_mm256_loadu_pd(yVals + i), y0_vec);
+    __m256d  xp = _mm256_add_pd(_mm256_mul_pd(x_diff, c), _mm256_mul_pd(y_diff, s));
+    __m256d  yp_scaled = _mm256_div_pd(_mm256_sub_pd(_mm256_mul_pd(y_diff, c),
+  						_mm256_mul_pd(x_diff, s)), q_vec);
+    _mm256_storeu_pd(rVals + i, _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(xp, xp),
+  						_mm256_mul_pd(yp_scaled, yp_scaled))));
+  }
+  for ( ; i < nVals; i++)
+    rVals[i] = EllipticalRadius_scalar(xVals[i] - x0, yVals[i] - y0, cosPA, sinPA, q);
+}
+
+
+// Operations on single vectors of values, for use with Apply_avx2()
+
+struct ExpOp_avx2 {
+  __m256d TARGET_AVX2 operator()( __m256d x ) const { return Exp_avx2(x); }
+};
+
+struct LogOp_avx2 {
+  __m256d TARGET_AVX2 operator()( __m256d x ) const { return Log_avx2(x); }
+};
+
+struct PowOp_avx2 {
+  double  exponent;
+  __m256d TARGET_AVX2 operator()( __m256d x ) const
+  { return Pow_avx2(x, _mm256_set1_pd(exponent)); }
+};
+
+struct SersicOp_avx2 {
+  double  I_e, r_e, bn, invn;
+  __m256d TARGET_AVX2 operator()( __m256d r ) const
+  {
+    __m256d  rPow = Pow_avx2(_mm256_div_pd(r, _mm256_set1_pd(r_e)), _mm256_set1_pd(invn));
+    __m256d  arg = _mm256_mul_pd(_mm256_set1_pd(-bn), _mm256_sub_pd(rPow, _mm256_set1_pd(1.0)));
+    return _mm256_mul_pd(_mm256_set1_pd(I_e), Exp_avx2(arg));
+  }
+};
+
+struct ExponentialOp_avx2 {
+  double  I_0, h;
+  __m256d TARGET_AVX2 operator()( __m256d r ) const
+  {
+    __m256d  arg = _mm256_div_pd(_mm256_sub_pd(_mm256_setzero_pd(), r), _mm256_set1_pd(h));
+    return _mm256_mul_pd(_mm256_set1_pd(I_0), Exp_avx2(arg));
+  }
+};
+
+struct GaussianOp_avx2 {
+  double  I_0, twoSigmaSquared;
+  __m256d TARGET_AVX2 operator()( __m256d r ) const
+  {
+    __m256d  arg = _mm256_div_pd(_mm256_sub_pd(_mm256_setzero_pd(), _mm256_mul_pd(r, r)),
+    							_mm256_set1_pd(twoSigmaSquared));
+    return _mm256_mul_pd(_mm256_set1_pd(I_0), Exp_avx2(arg));
+  }
+};
+
+struct MoffatOp_avx2 {
+  double  I_0, alpha, beta;
+  __m256d TARGET_AVX2 operator()( __m256d r ) const
+  {
+    __m256d  scaledR = _mm256_div_pd(r, _mm256_set1_pd(alpha));
+    __m256d  denominator = Pow_avx2(_mm256_fmadd_pd(scaledR, scaledR, _mm256_set1_pd(1.0)),
+    							_mm256_set1_pd(beta));
+    return _mm256_div_pd(_mm256_set1_pd(I_0), denominator);
+  }
+};
+
+// Operations on pairs of (x - x0, y - y0) vectors, for use with ApplyXY_avx2()
+
+struct GeneralizedRadiusOp_avx2 {
+  double  cosPA, sinPA, q, ellExponent, invEllExponent;
+  __m256d TARGET_AVX2 operator()( __m256d x_diff, __m256d y_diff ) const
+  {
+    const __m256d  absMask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7FFFFFFFFFFFFFFFLL));
+    __m256d  c = _mm256_set1_pd(cosPA);
+    __m256d  s = _mm256_set1_pd(sinPA);
+    __m256d  xp = _mm256_and_pd(absMask, _mm256_add_pd(_mm256_mul_pd(x_diff, c),
+    							_mm256_mul_pd(y_diff, s)));
+    __m256d  yp_scaled = _mm256_and_pd(absMask, _mm256_div_pd(_mm256_sub_pd(
+    						_mm256_mul_pd(y_diff, c), _mm256_mul_pd(x_diff, s)),
+    						_mm256_set1_pd(q)));
+    __m256d  exponent = _mm256_set1_pd(ellExponent);
+    __m256d  powerSum = _mm256_add_pd(Pow_avx2(xp, exponent), Pow_avx2(yp_scaled, exponent));
+    return Pow_avx2(powerSum, _mm256_set1_pd(invEllExponent));
+  }
+};
+
+
+// outVals[i] = op(inVals[i]); the final partial vector (if any) is padded with 1s
+template <typename Op>
+static void TARGET_AVX2 Apply_avx2( const Op& op, const double *inVals, double *outVals,
+									long nVals )
+{
+  long  i;
+  for (i = 0; i + 4 <= nVals; i += 4)
+    _mm256_storeu_pd(outVals + i, op(_mm256_loadu_pd(inVals + i)));
+  if (i < nVals) {
+    double  buffer[4] = {1.0, 1.0, 1.0, 1.0};
+    for (long k = 0; k < nVals - i; k++)
+      buffer[k] = inVals[i + k];
+    _mm256_storeu_pd(buffer, op(_mm256_loadu_pd(buffer)));
+    for (long k = 0; k < nVals - i; k++)
+      outVals[i + k] = buffer[k];
+  }
+}
+
+
+// outVals[i] = op(xVals[i] - x0, yVals[i] - y0)
+template <typename Op>
+static void TARGET_AVX2 ApplyXY_avx2( const Op& op, const double *xVals, const double *yVals,
+									long nVals, double x0, double y0, double *outVals )
+{
+  __m256d  x0_vec = _mm256_set1_pd(x0);
+  __m256d  y0_vec = _mm256_set1_pd(y0);
+  long  i;
+  for (i = 0; i + 4 <= nVals; i += 4)
+    _mm256_storeu_pd(outVals + i, op(_mm256_sub_pd(_mm256_loadu_pd(xVals + i), x0_vec),
+    								_mm256_sub_pd(_mm256_loadu_pd(yVals + i), y0_vec)));
+  if (i < nVals) {
+    double  xBuffer[4] = {x0, x0, x0, x0};
+    double  yBuffer[4] = {y0, y0, y0, y0};
+    for (long k = 0; k < nVals - i; k++) {
+      xBuffer[k] = xVals[i + k];
+      yBuffer[k] = yVals[i + k];
+    }
+    _mm256_storeu_pd(xBuffer, op(_mm256_sub_pd(_mm256_loadu_pd(xBuffer), x0_vec),
+    								_mm256_sub_pd(_mm256_loadu_pd(yBuffer), y0_vec)));
+    for (long k = 0; k < nVals - i; k++)
+      outVals[i + k] = xBuffer[k];
+  }
+}
+
+
+
+/* ---------------- AVX-512 implementations ---------------------------- */
+
+static inline __m512d TARGET_AVX512 Exp_avx512( __m512d x )
+{
+  __m512d  xc = _mm512_min_pd(_mm512_max_pd(x, _mm512_set1_pd(EXP_MIN_ARG_512)),
+  							_mm512_set1_pd(EXP_MAX_ARG_512));
+
+  // x = k*ln(2) + r
+  __m512d  k = _mm512_roundscale_pd(_mm512_mul_pd(xc, _mm512_set1_pd(LOG2E)),
+  							_MM_FROUND_TO_NEAREST_INT | _MM_FROUND_NO_EXC);
+  __m512d  r = _mm512_fnmadd_pd(k, _mm512_set1_pd(LN2_HI), xc);
+  r = _mm512_fnmadd_pd(k, _mm512_set1_pd(LN2_LO), r);
+  __m512d  p = _mm512_set1_pd(EXP_COEFFS[0]);
+  for (int i = 1; i < N_EXP_COEFFS; i++)
+    p = _mm512_fmadd_pd(p, r, _mm512_set1_pd(EXP_COEFFS[i]));
+
+  // p * 2^k (with correct overflow to infinity and underflow to denormals or 0)
+  __m512d  result = _mm512_scalef_pd(p, k);
+  return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, x, _CMP_UNORD_Q), result, x);
+}
+
+
+static inline __m512d TARGET_AVX512 Log_avx512( __m512d x )
+{
+  const __m512d  one = _mm512_set1_pd(1.0);
+
+  // x = 2^e * m, 1 <= m < 2 (getexp and getmant handle denormals for us;
+  // negative x yields m = NaN)
+  __m512d  e = _mm512_getexp_pd(x);
+  __m512d  m = _mm512_getmant_pd(x, _MM_MANT_NORM_1_2, _MM_MANT_SIGN_nan);
+  // shift to sqrt(1/2) < m <= sqrt(2)
+  __mmask8  bigMask = _mm512_cmp_pd_mask(m, _mm512_set1_pd(SQRT2), _CMP_GT_OQ);
+  m = _mm512_mask_mul_pd(m, bigMask, m, _mm512_set1_pd(0.5));
+  e = _mm512_mask_add_pd(e, bigMask, e, one);
+
+  __m512d  f = _mm512_sub_pd(m, one);
+  __m512d  s = _mm512_div_pd(f, _mm512_add_pd(f, _mm512_set1_pd(2.0)));
+  __m512d  s2 = _mm512_mul_pd(s, s);
+  __m512d  p = _mm512_set1_pd(LOG_COEFFS[0]);
+  for (int i = 1; i < N_LOG_COEFFS - 1; i++)
+    p = _mm512_fmadd_pd(p, s2, _mm512_set1_pd(LOG_COEFFS[i]));
+  __m512d  logm = _mm512_fmadd_pd(_mm512_mul_pd(s, s2), p, _mm512_add_pd(s, s));
+  __m512d  result = _mm512_fmadd_pd(e, _mm512_set1_pd(LN2_HI),
+  						_mm512_fmadd_pd(e, _mm512_set1_pd(LN2_LO), logm));
+
+  // zero, infinite, and NaN inputs
+  const __m512d  zero = _mm512_setzero_pd();
+  result = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, zero, _CMP_EQ_OQ), result,
+  						_mm512_set1_pd(-HUGE_VAL));
+  result = _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, _mm512_set1_pd(HUGE_VAL), _CMP_EQ_OQ),
+  						result, x);
+  return _mm512_mask_blend_pd(_mm512_cmp_pd_mask(x, x, _CMP_UNORD_Q), result, x);
+}
+
+
+// x^y for x >= 0, y > 0
+static inline __m512d TARGET_AVX512 Pow_avx512( __m512d x, __m512d y )
+{
+  return Exp_avx512(_mm512_mul_pd(y, Log_avx512(x)));
+}
+
+
+// Operations on single vectors of values, for use with Apply_avx512()
+
+struct ExpOp_avx512 {
+  __m512d TARGET_AVX512 operator()( __m512d x ) const { return Exp_avx512(x); }
+};
+
+struct LogOp_avx512 {
+  __m512d TARGET_AVX512 operator()( __m512d x ) const { return Log_avx512(x); }
+};
+
+struct PowOp_avx512 {
+  double  exponent;
+  __m512d TARGET_AVX512 operator()( __m512d x ) const
+  { return Pow_avx512(x, _mm512_set1_pd(exponent)); }
+};
+
+struct SersicOp_avx512 {
+  double  I_e, r_e, bn, invn;
+  __m512d TARGET_AVX512 operator()( __m512d r ) const
+  {
+    __m512d  rPow = Pow_avx512(_mm512_div_pd(r, _mm512_set1_pd(r_e)), _mm512_set1_pd(invn));
+    __m512d  arg = _mm512_mul_pd(_mm512_set1_pd(-bn), _mm512_sub_pd(rPow, _mm512_set1_pd(1.0)));
+    return _mm512_mul_pd(_mm512_set1_pd(I_e), Exp_avx512(arg));
+  }
+};
+
+struct ExponentialOp_avx512 {
+  double  I_0, h;
+  __m512d TARGET_AVX512 operator()( __m512d r ) const
+  {
+    __m512d  arg = _mm512_div_pd(_mm512_sub_pd(_mm512_setzero_pd(), r), _mm512_set1_pd(h));
+    return _mm512_mul_pd(_mm512_set1_pd(I_0), Exp_avx512(arg));
+  }
+};
+
+struct GaussianOp_avx512 {
+  double  I_0, twoSigmaSquared;
+  __m512d TARGET_AVX512 operator()( __m512d r ) const
+  {
+    __m512d  arg = _mm512_div_pd(_mm512_sub_pd(_mm512_setzero_pd(), _mm512_mul_pd(r, r)),
+    							_mm512_set1_pd(twoSigmaSquared));
+    return _mm512_mul_pd(_mm512_set1_pd(I_0), Exp_avx512(arg));
+  }
+};
+
+struct MoffatOp_avx512 {
+  double  I_0, alpha, beta;
+  __m512d TARGET_AVX512 operator()( __m512d r ) const
+  {
+    __m512d  scaledR = _mm512_div_pd(r, _mm512_set1_pd(alpha));
+    __m512d  denominator = Pow_avx512(_mm512_fmadd_pd(scaledR, scaledR, _mm512_set1_pd(1.0)),
+    							_mm512_set1_pd(beta));
+    return _mm512_div_pd(_mm512_set1_pd(I_0), denominator);
+  }
+};
+
+// Operations on pairs of (x - x0, y - y0) vectors, for use with ApplyXY_avx512()
+
+struct GeneralizedRadiusOp_avx512 {
+  double  cosPA, sinPA, q, ellExponent, invEllExponent;
+  __m512d TARGET_AVX512 operator()( __m512d x_diff, __m512d y_diff ) const
+  {
+    const __m512i  absMask = _mm512_set1_epi64(0x7FFFFFFFFFFFFFFFLL);
+    __m512d  c = _mm512_set1_pd(cosPA);
+    __m512d  s = _mm512_set1_pd(sinPA);
+    __m512d  xp = _mm512_add_pd(_mm512_mul_pd(x_diff, c), _mm512_mul_pd(y_diff, s));
+    __m512d  yp_scaled = _mm512_div_pd(_mm512_sub_pd(_mm512_mul_pd(y_diff, c),
+    						_mm512_mul_pd(x_diff, s)), _mm512_set1_pd(q));
+    xp = _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(xp), absMask));
+    yp_scaled = _mm512_castsi512_pd(_mm512_and_si512(_mm512_castpd_si512(yp_scaled), absMask));
+    __m512d  exponent = _mm512_set1_pd(ellExponent);
+    __m512d  powerSum = _mm512_add_pd(Pow_avx512(xp, exponent), Pow_avx512(yp_scaled, exponent));
+    return Pow_avx512(powerSum, _mm512_set1_pd(invEllExponent));
+  }
+};
+
+
+// outVals[i] = op(inVals[i]); the final partial vector (if any) is handled with
+// masked loads and stores (masked-off elements are set to 1)
+template <typename Op>
+static void TARGET_AVX512 Apply_avx512( const Op& op, const double *inVals, double *outVals,
+									long nVals )
+{
+  long  i;
+  for (i = 0; i + 8 <= nVals; i += 8)
+    _mm512_storeu_pd(outVals + i, op(_mm512_loadu_pd(inVals + i)));
+  if (i < nVals) {
+    __mmask8  tailMask = (__mmask8)((1 << (nVals - i)) - 1);
+    __m512d  v = _mm512_mask_loadu_pd(_mm512_set1_pd(1.0), tailMask, inVals + i);
+    _mm512_mask_storeu_pd(outVals + i, tailMask, op(v));
+  }
+}
+
+
+// outVals[i] = op(xVals[i] - x0, yVals[i] - y0)
+template <typename Op>
+static void TARGET_AVX512 ApplyXY_avx512( const Op& op, const double *xVals, const double *yVals,
+									long nVals, double x0, double y0, double *outVals )
+{
+  __m512d  x0_vec = _mm512_set1_pd(x0);
+  __m512d  y0_vec = _mm512_set1_pd(y0);
+  long  i;
+  for (i = 0; i + 8 <= nVals; i += 8)
+    _mm512_storeu_pd(outVals + i, op(_mm512_sub_pd(_mm512_loadu_pd(xVals + i), x0_vec),
+    								_mm512_sub_pd(_mm512_loadu_pd(yVals + i), y0_vec)));
+  if (i < nVals) {
+    __mmask8  tailMask = (__mmask8)((1 << (nVals - i)) - 1);
+    __m512d  x = _mm512_mask_loadu_pd(x0_vec, tailMask, xVals + i);
+    __m512d  y = _mm512_mask_loadu_pd(y0_vec, tailMask, yVals + i);
+    _mm512_mask_storeu_pd(outVals + i, tailMask, op(_mm512_sub_pd(x, x0_vec),
+    								_mm512_sub_pd(y, y0_vec)));
+  }
+}
+#endif   // USE_X86_SIMD
+
+
+
+/* ---------------- Public functions (with dispatch) ------------------- */
+
+// Calls the AVX-512 or AVX2 version of an operation (if available), using
+// Apply_xxx(op, ...) with op initialized from the remaining macro arguments
+// (e.g., DISPATCH_SIMD(Apply, ExpOp, OP_INIT(), inVals, ...)); if neither is
+// available, execution continues with the code following the macro.
+#ifdef USE_X86_SIMD
+#define DISPATCH_SIMD(applyFunc, opName, opInit, ...)  \
+  if (currentSimdLevel == SIMD_AVX512) {  \
+    opName##_avx512  op = opInit;  \
+    applyFunc##_avx512(op, __VA_ARGS__);  \
+    return;  \
+  }  \
+  if (currentSimdLevel == SIMD_AVX2) {  \
+    opName##_avx2  op = opInit;  \
+    applyFunc##_avx2(op, __VA_ARGS__);  \
+    return;  \
+  }
+#else
+#define DISPATCH_SIMD(applyFunc, opName, opInit, ...)
+#endif
+
+// brace-enclosed initializer lists for operation structs
+#define OP_INIT(...)  {__VA_ARGS__}
+
+
+/* ---------------- FUNCTION: VectorExp -------------------------------- */
+
+void VectorExp( const double *inVals, double *outVals, long nVals )
+{
+  DISPATCH_SIMD(Apply, ExpOp, OP_INIT(), inVals, outVals, nVals)
+  for (long i = 0; i < nVals; i++)
+    outVals[i] = exp(inVals[i]);
+}
+
+
+/* ---------------- FUNCTION: VectorLog -------------------------------- */
+
+void VectorLog( const double *inVals, double *outVals, long nVals )
+{
+  DISPATCH_SIMD(Apply, LogOp, OP_INIT(), inVals, outVals, nVals)
+  for (long i = 0; i < nVals; i++)
+    outVals[i] = log(inVals[i]);
+}
+
+
+/* ---------------- FUNCTION: VectorPow -------------------------------- */
+
+void VectorPow( const double *inVals, double exponent, double *outVals, long nVals )
+{
+  DISPATCH_SIMD(Apply, PowOp, OP_INIT(exponent), inVals, outVals, nVals)
+  for (long i = 0; i < nVals; i++)
+    outVals[i] = pow(inVals[i], exponent);
+}
+
+
+/* ---------------- FUNCTION: EllipticalRadii -------------------------- */
+
+void EllipticalRadii( const double *xVals, const double *yVals, long nVals,
+					double x0, double y0, double cosPA, double sinPA, double q,
+					double *rVals )
+{
+#ifdef USE_X86_SIMD
+  if (currentSimdLevel >= SIMD_AVX2) {
+    EllipticalRadii_avx2(xVals, yVals, nVals, x0, y0, cosPA, sinPA, q, rVals);
+    return;
+  }
+#endif
+  EllipticalRadii_scalar(xVals, yVals, nVals, x0, y0, cosPA, sinPA, q, rVals);
+}
+
+
+/* ---------------- FUNCTION: GeneralizedEllipticalRadii --------------- */
+
+void GeneralizedEllipticalRadii( const double *xVals, const double *yVals, long nVals,
+					double x0, double y0, double cosPA, double sinPA, double q,
+					double ellExponent, double invEllExponent, double *rVals )
+{
+  DISPATCH_SIMD(ApplyXY, GeneralizedRadiusOp,
+  				OP_INIT(cosPA, sinPA, q, ellExponent, invEllExponent),
+  				xVals, yVals, nVals, x0, y0, rVals)
+  GeneralizedEllipticalRadii_scalar(xVals, yVals, nVals, x0, y0, cosPA, sinPA, q,
+  				ellExponent, invEllExponent, rVals);
+}
+
+
+/* ---------------- FUNCTION: SersicProfile ---------------------------- */
+
+void SersicProfile( const double *rVals, long nVals, double I_e, double r_e,
+					double bn, double invn, double *outVals )
+{
+  DISPATCH_SIMD(Apply, SersicOp, OP_INIT(I_e, r_e, bn, invn), rVals, outVals, nVals)
+  for (long i = 0; i < nVals; i++)
+    outVals[i] = I_e * exp( -bn * (pow((rVals[i]/r_e), invn) - 1.0));
+}
+
+
+/* ---------------- FUNCTION: ExponentialProfile ----------------------- */
+
+void ExponentialProfile( const double *rVals, long nVals, double I_0, double h,
+					double *outVals )
+{
+  DISPATCH_SIMD(Apply, ExponentialOp, OP_INIT(I_0, h), rVals, outVals, nVals)
+  for (long i = 0; i < nVals; i++)
+    outVals[i] = I_0 * exp(-rVals[i]/h);
+}
+
+
+/* ---------------- FUNCTION: GaussianProfile -------------------------- */
+
+void GaussianProfile( const double *rVals, long nVals, double I_0,
+					double twoSigmaSquared, double *outVals )
+{
+  DISPATCH_SIMD(Apply, GaussianOp, OP_INIT(I_0, twoSigmaSquared), rVals, outVals, nVals)
+  for (long i = 0; i < nVals; i++) {
+    double  r_squared = rVals[i]*rVals[i];
+    outVals[i] = I_0 * exp(-r_squared/twoSigmaSquared);
+  }
+}
+
+
+/* ---------------- FUNCTION: MoffatProfile ---------------------------- */
+
+void MoffatProfile( const double *rVals, long nVals, double I_0, double alpha,
+					double beta, double *outVals )
+{
+  DISPATCH_SIMD(Apply, MoffatOp, OP_INIT(I_0, alpha, beta), rVals, outVals, nVals)
+  for (long i = 0; i < nVals; i++) {
+    double  scaledR = rVals[i] / alpha;
+    outVals[i] = I_0 / pow((1.0 + scaledR*scaledR), beta);
+  }
+}
+
+
+/* END OF FILE: simd_kernels.cpp --------------------------------------- */
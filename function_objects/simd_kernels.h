@@ -0,0 +1,94 @@
+// Vectorized (SIMD) kernels for evaluating the more common image functions
+// (Sersic, Exponential, Gaussian, Moffat, GenSersic) over many pixels at once.
+//
+// Each public function below dispatches at runtime to the best available
+// implementation: AVX-512 (8 doubles at a time), AVX2+FMA (4 doubles at a time),
+// or a plain scalar loop using the standard math library. The choice is made
+// once, via CPU feature detection, so a single binary runs on any x86-64 CPU;
+// on other architectures (or if compiled with NO_SIMD defined) only the scalar
+// versions are used.
+//
+// ACCURACY of the vector math functions (measured against the standard math
+// library over the full double range, for normal inputs):
+//    VectorExp:  relative error < 2.5e-16 (~1 ulp); in the AVX2 version, results
+//                for x < -708.39 are 0 (no denormal outputs) and results for
+//                x > 709.43 are +infinity.
+//    VectorLog:  relative error < 5e-16 (< 1.2e-16 unless x is close to 1).
+//    VectorPow:  computed as exp(y*log(x)), so relative error is approximately
+//                2.5e-16 * (1 + |y*log(x)|) -- i.e., the same conditioning as pow().
+// EllipticalRadii() uses the same sequence of (non-fused) operations as the
+// scalar code, so its results are bit-for-bit identical for all implementations.
+
+#ifndef _SIMD_KERNELS_H_
+#define _SIMD_KERNELS_H_
+
+
+/// Instruction sets which can be used for the vectorized kernels
+enum SimdLevel { SIMD_SCALAR = 0, SIMD_AVX2 = 1, SIMD_AVX512 = 2 };
+
+/// Suggested maximum number of pixels per call (e.g., for stack buffers of radii)
+const int  SIMD_CHUNK_SIZE = 256;
+
+
+/// Returns the best instruction set supported by the CPU (and by the compiled code)
+SimdLevel DetectSimdLevel( );
+
+/// Returns the instruction set currently used by the kernels
+SimdLevel GetSimdLevel( );
+
+/// Sets the instruction set used by the kernels (e.g., SIMD_SCALAR for testing);
+/// requests for unsupported instruction sets are reduced to the best supported one.
+/// Returns the level actually set. (Not thread-safe: call before computing images.)
+SimdLevel SetSimdLevel( SimdLevel level );
+
+/// Returns the name of the instruction set ("scalar", "AVX2", "AVX-512")
+const char * SimdLevelName( SimdLevel level );
+
+
+// Elementwise math functions; inVals and outVals may be the same array
+
+/// outVals[i] = exp(inVals[i])
+void VectorExp( const double *inVals, double *outVals, long nVals );
+
+/// outVals[i] = log(inVals[i])
+void VectorLog( const double *inVals, double *outVals, long nVals );
+
+/// outVals[i] = pow(inVals[i], exponent), for inVals[i] >= 0 and exponent > 0
+void VectorPow( const double *inVals, double exponent, double *outVals, long nVals );
+
+
+// Geometry
+
+/// Elliptical radii for pixels at (xVals[i],yVals[i]), for an ellipse centered
+/// at (x0,y0) with cos and sin of (PA + 90 deg) = cosPA, sinPA and axis ratio q
+void EllipticalRadii( const double *xVals, const double *yVals, long nVals,
+					double x0, double y0, double cosPA, double sinPA, double q,
+					double *rVals );
+
+/// Radii for a generalized ellipse (see GeneralizedRadius in helper_funcs.h),
+/// with ellExponent = c0 + 2 and invEllExponent = 1/ellExponent
+void GeneralizedEllipticalRadii( const double *xVals, const double *yVals, long nVals,
+					double x0, double y0, double cosPA, double sinPA, double q,
+					double ellExponent, double invEllExponent, double *rVals );
+
+
+// Radial profiles; rVals and outVals may be the same array
+
+/// outVals[i] = I_e * exp(-bn*((rVals[i]/r_e)^invn - 1))
+void SersicProfile( const double *rVals, long nVals, double I_e, double r_e,
+					double bn, double invn, double *outVals );
+
+/// outVals[i] = I_0 * exp(-rVals[i]/h)
+void ExponentialProfile( const double *rVals, long nVals, double I_0, double h,
+					double *outVals );
+
+/// outVals[i] = I_0 * exp(-rVals[i]^2/twoSigmaSquared)
+void GaussianProfile( const double *rVals, long nVals, double I_0,
+					double twoSigmaSquared, double *outVals );
+
+/// outVals[i] = I_0 / (1 + (rVals[i]/alpha)^2)^beta
+void MoffatProfile( const double *rVals, long nVals, double I_0, double alpha,
+					double beta, double *outVals );
+
+
+#endif  // _SIMD_KERNELS_H_
@@ -19,6 +19,8 @@
 #include "fftw3.h"
 
 #include "convolver1d.h"
+#include "convolver.h"
+#include "spatial_convolution.h"
 
 //using namespace std;
 
@@ -32,6 +34,9 @@ Convolver1D::Convolver1D( )
   profileInfoSet = false;
   fftVectorsAllocated = false;
   fftPlansCreated = false;
+  requestedConvolutionMethod = CONVOLUTION_AUTO;
+  convolutionMethod = CONVOLUTION_AUTO;
+  directBuffersAllocated = false;
 }
 
 
@@ -54,6 +59,10 @@ Convolver1D::~Convolver1D( )
     fftw_free(convolvedProfile_cmplx);
 
   }
+  if (directBuffersAllocated) {
+    free(directKernel);
+    free(directOutput);
+  }
 }
 
 
@@ -79,6 +88,25 @@ void Convolver1D::SetupProfile( int nPixels )
 }
 
 
+/* ---------------- SetConvolutionMethod ------------------------------- */
+// Specify whether convolution is done with FFTs (CONVOLUTION_FFT), directly
+// (CONVOLUTION_DIRECT), or with whichever is estimated to be faster
+// (CONVOLUTION_AUTO, the default). Must be called before DoFullSetup().
+void Convolver1D::SetConvolutionMethod( int method )
+{
+  requestedConvolutionMethod = method;
+  convolutionMethod = method;
+}
+
+
+/* ---------------- GetConvolutionMethod ------------------------------- */
+
+int Convolver1D::GetConvolutionMethod( )
+{
+  return convolutionMethod;
+}
+
+
 /* ---------------- DoFullSetup ---------------------------------------- */
 // General setup prior to actually supplying the profiles data and doing the
 // convolution: determine padding size; allocate FFTW arrays and plans;
@@ -87,7 +115,6 @@ int Convolver1D::DoFullSetup( int debugLevel, bool doFFTWMeasure )
 {
   int  k;
   unsigned  fftwFlags;
-  double  psfSum;
   
   debugStatus = debugLevel;
   
@@ -98,6 +125,30 @@ int Convolver1D::DoFullSetup( int debugLevel, bool doFFTWMeasure )
   }
   nPixels_padded = nPixels_data + nPixels_psf - 1;
   rescaleFactor = 1.0 / nPixels_padded;
+
+  // Small PSFs: direct convolution may be faster than FFT convolution (the
+  // complex FFTs used here cost about twice as much as real-to-complex FFTs)
+  convolutionMethod = requestedConvolutionMethod;
+  if (convolutionMethod == CONVOLUTION_AUTO)
+    convolutionMethod = ChooseConvolutionMethod(
+    					EstimateDirectConvolutionCost(nPixels_data, nPixels_psf),
+    					2.0*EstimateFFTConvolutionCost(nPixels_padded, 1));
+  if (convolutionMethod == CONVOLUTION_DIRECT) {
+    if (debugStatus >= 1)
+      printf("Using direct convolution\n");
+    NormalizePSF();
+    if (directBuffersAllocated) {
+      free(directKernel);
+      free(directOutput);
+    }
+    directKernel = (double *)malloc(nPixels_psf*sizeof(double));
+    directOutput = (double *)malloc(nPixels_data*sizeof(double));
+    directBuffersAllocated = true;
+    for (k = 0; k < nPixels_psf; k++)
+      directKernel[k] = psfPixels[k];
+    return 0;
+  }
+
   if (debugStatus >= 1)
     printf("Profiles will be padded to %d pixels in size\n", nPixels_padded);
 
@@ -141,22 +192,7 @@ int Convolver1D::DoFullSetup( int debugLevel, bool doFFTWMeasure )
 
   // Generate the Fourier transform of the PSF:
   // First, normalize the PSF
-  if (debugStatus >= 1) {
-    printf("Normalizing the PSF ...\n");
-    if (debugStatus >= 2) {
-      printf("The whole input PSF profile:\n");
-      PrintRealProfile(psfPixels, nPixels_psf);
-    }
-  }
-  psfSum = 0.0;
-  for (k = 0; k < nPixels_psf; k++)
-    psfSum += psfPixels[k];
-  for (k = 0; k < nPixels_psf; k++)
-    psfPixels[k] = psfPixels[k] / psfSum;
-  if (debugStatus >= 2) {
-    printf("The whole *normalized* PSF profile:\n");
-    PrintRealProfile(psfPixels, nPixels_psf);
-  }
+  NormalizePSF();
 
   // Second, prepare (complex) psf array for FFT, and then copy input PSF into
   // it with appropriate shift/wrap:
@@ -191,6 +227,12 @@ void Convolver1D::ConvolveProfile( double *pixelVector )
   int  ii, jj;
   double  a, b, c, d, realPart;
   
+  if (convolutionMethod == CONVOLUTION_DIRECT) {
+    ConvolveDirect2D(pixelVector, nPixels_data, 1, directKernel, nPixels_psf, 1, directOutput);
+    for (ii = 0; ii < nPixels_data; ii++)
+      pixelVector[ii] = directOutput[ii];
+    return;
+  }
   if (debugStatus >= 3) {
     printf("nPixels_data = %d, nPixels_padded = %d\n", nPixels_data, nPixels_padded);
     printf("Original input profile [pixelVector]:\n");
@@ -263,6 +305,31 @@ void Convolver1D::ConvolveProfile( double *pixelVector )
 }
 
 
+// NormalizePSF: Normalizes the input PSF profile in place.
+void Convolver1D::NormalizePSF( )
+{
+  int  k;
+  double  psfSum;
+
+  if (debugStatus >= 1) {
+    printf("Normalizing the PSF ...\n");
+    if (debugStatus >= 2) {
+      printf("The whole input PSF profile:\n");
+      PrintRealProfile(psfPixels, nPixels_psf);
+    }
+  }
+  psfSum = 0.0;
+  for (k = 0; k < nPixels_psf; k++)
+    psfSum += psfPixels[k];
+  for (k = 0; k < nPixels_psf; k++)
+    psfPixels[k] = psfPixels[k] / psfSum;
+  if (debugStatus >= 2) {
+    printf("The whole *normalized* PSF profile:\n");
+    PrintRealProfile(psfPixels, nPixels_psf);
+  }
+}
+
+
 // ShiftAndWrapPSF: Takes the input PSF (assumed to be centered in the central pixel
 // of the profile) and copy it into the real part of the (padded) fftw_complex profile,
 // with the PSF wrapped into the edges, suitable for convolutions.
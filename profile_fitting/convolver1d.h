@@ -30,6 +30,8 @@
 
 #include "fftw3.h"
 
+#include "spatial_convolution.h"
+
 using namespace std;
 
 
@@ -50,6 +52,10 @@ class Convolver1D
     
     void SetupProfile( int nPixels );
     
+    void SetConvolutionMethod( int method );
+    
+    int GetConvolutionMethod( );
+    
     int DoFullSetup( int debugLevel=0, bool doFFTWMeasure=false );
 
     void ConvolveProfile( double *pixelVector );
@@ -57,6 +63,8 @@ class Convolver1D
 
   private:
   // Private member functions:
+    void NormalizePSF( );
+
     void ShiftAndWrapPSF( );
   
     // Data members:
@@ -70,6 +78,9 @@ class Convolver1D
     fftw_complex  *multiplied_cmplx, *convolvedProfile_cmplx;
     fftw_plan  plan_InputProfile, plan_psf, plan_inverse;
     bool  psfInfoSet, profileInfoSet, fftVectorsAllocated, fftPlansCreated;
+    int  requestedConvolutionMethod, convolutionMethod;
+    bool  directBuffersAllocated;
+    double  *directKernel, *directOutput;
     int  debugStatus;
 };
 
@@ -129,7 +129,7 @@ void ModelObject1d::AddDataVectors( int nDataValues, double *xValVector,
   dataValsSet = true;
   dataAreMagnitudes = magnitudeData;  // are yValVector data magnitudes?
 
-  modelVector = (double *) calloc((size_t)nDataVals, sizeof(double));
+  modelVector = arena.AllocateArray<double>((size_t)nDataVals);
   modelVectorAllocated = true;
 }
 
@@ -179,8 +179,9 @@ void ModelObject1d::AddErrorVector1D( int nDataValues, double *inputVector,
 /* ---------------- PUBLIC METHOD: AddMaskVector1D --------------------- */
 // Code for adding and processing a vector containing the 1-D mask.
 // Note that although our default *input* format is "0 = good pixel, > 0 =
-// bad pixel", internally we convert all bad pixels to 0 and all good pixels
-// to 1, so that we can multiply the weight vector by the (internal) mask values.
+// bad pixel", internally we store the mask as one byte per pixel, with all bad
+// pixels = 0 and all good pixels = 1, so that we can multiply the weight vector
+// by the (internal) mask values. (The input vector is not modified.)
 int ModelObject1d::AddMaskVector1D( int nDataValues, double *inputVector,
                                       int inputType )
 {
@@ -188,7 +189,8 @@ int ModelObject1d::AddMaskVector1D( int nDataValues, double *inputVector,
   
   assert (nDataValues == nDataVals);
 
-  maskVector = inputVector;
+  if (AllocateMaskVector() < 0)
+    return -1;
   nValidDataVals = 0;   // Since there's a mask, not all pixels from the original
                         // profile will be valid
     
@@ -200,10 +202,10 @@ int ModelObject1d::AddMaskVector1D( int nDataValues, double *inputVector,
       // are positive integers
       printf("ModelObject1D::AddMaskVector -- treating zero-valued pixels as good ...\n");
       for (int z = 0; z < nDataVals; z++) {
-        if (maskVector[z] > 0.0) {
-          maskVector[z] = 0.0;
+        if (inputVector[z] > 0.0) {
+          maskVector[z] = 0;
         } else {
-          maskVector[z] = 1.0;
+          maskVector[z] = 1;
           nValidDataVals++;
         }
       }
@@ -213,10 +215,10 @@ int ModelObject1d::AddMaskVector1D( int nDataValues, double *inputVector,
       // Alternate form for input masks: good pixels are 1, bad pixels are 0
       printf("ModelObject::AddMaskVector -- treating zero-valued pixels as bad ...\n");
       for (int z = 0; z < nDataVals; z++) {
-        if (maskVector[z] < 1.0)
-          maskVector[z] = 0.0;
+        if (inputVector[z] < 1.0)
+          maskVector[z] = 0;
         else {
-          maskVector[z] = 1.0;
+          maskVector[z] = 1;
           nValidDataVals++;
         }
       }
@@ -246,8 +248,8 @@ int ModelObject1d::AddPSFVector1D( int nPixels_psf, double *xValVector, double *
   dataStartOffset = nPSFVals;
   // 2. Create new model vector and set dataStartOffset to nPSFVals
   if (modelVectorAllocated)
-    free(modelVector);
-  modelVector = (double *) calloc((size_t)nModelVals, sizeof(double));
+    arena.Free(modelVector);
+  modelVector = arena.AllocateArray<double>((size_t)nModelVals);
   modelVectorAllocated = true;
   // 3. Create new xVals vector for model
   modelXValues = (double *) calloc((size_t)nModelVals, sizeof(double));
@@ -263,6 +265,7 @@ int ModelObject1d::AddPSFVector1D( int nPixels_psf, double *xValVector, double *
   psfConvolver = new Convolver1D();
   psfConvolver->SetupPSF(yValVector, nPSFVals);
   psfConvolver->SetupProfile(nModelVals);
+  psfConvolver->SetConvolutionMethod(convolutionMethod);
   psfConvolver->DoFullSetup(debugLevel);
   doConvolution = true;
   
@@ -281,19 +284,19 @@ int ModelObject1d::FinalSetupForFitting( )
   
   // Create a default all-pixels-valid mask if no mask already exists
   if (! maskExists) {
-    maskVector = (double *) calloc((size_t)nDataVals, sizeof(double));
+    if (AllocateMaskVector() < 0)
+      return -1;
     for (int z = 0; z < nDataVals; z++) {
-      maskVector[z] = 1.0;
+      maskVector[z] = 1;
     }
-    maskVectorAllocated = true;
     maskExists = true;
   }
 
   // Identify currently unmasked data pixels which have non-finite values and 
   // add those pixels to the mask
   for (int z = 0; z < nDataVals; z++) {
-    if ( (maskVector[z] > 0.0) && (! isfinite(dataVector[z])) ) {
-      maskVector[z] = 0.0;
+    if ( (maskVector[z] > 0) && (! isfinite(dataVector[z])) ) {
+      maskVector[z] = 0;
       nNonFinitePixels++;
       nValidDataVals--;
     }
@@ -318,7 +321,7 @@ int ModelObject1d::FinalSetupForFitting( )
   // Apply mask to weight vector (i.e., weight -> 0 for masked pixels)
   if (! weightValsSet) {
     if (! weightVectorAllocated) {
-      weightVector = (double *) calloc((size_t)nDataVals, sizeof(double));
+      weightVector = arena.AllocateArray<double>((size_t)nDataVals);
       weightVectorAllocated = true;
     }
     for (int z = 0; z < nDataVals; z++) {
@@ -727,7 +730,9 @@ void ModelObject1d::PrintMask( )
     return;
   }
   printf("The mask vector:\n");
-  PrintVector(maskVector, nDataVals);
+  for (int i = 0; i < nDataVals; i++)
+    printf(" %d", (int)maskVector[i]);
+  printf("\n");
 }
 
 
@@ -769,20 +774,10 @@ int ModelObject1d::GetModelVector( double *profileVector )
 // (which happens automatically just after *this* destructor is called) -- we
 // can end up trying to free vectors that have already been freed, because the
 // associated bool variables are still = true...
+// (modelVector, weightVector, and maskVector belong to the arena, and are freed
+// when the base class destructor is done.)
 ModelObject1d::~ModelObject1d()
 {
-  if (modelVectorAllocated) {
-    free(modelVector);
-    modelVectorAllocated = false;
-  }
-  if (weightVectorAllocated) {
-    free(weightVector);
-    weightVectorAllocated = false;
-  }
-  if (maskVectorAllocated) {
-    free(maskVector);
-    maskVectorAllocated = false;
-  }
   if (doConvolution) {
     free(psfConvolver);
     free(modelXValues);
@@ -88,6 +88,32 @@ echo $RESULT
 RESULT+=$?
 echo $RESULT
 
+# Unit tests for SIMD kernels
+./run_unittest_simd_kernels.sh 2>> temperror.log
+RESULT+=$?
+echo $RESULT
+
+# Unit tests for tiled model-image computation
+./run_unittest_image_tiles.sh 2>> temperror.log
+RESULT+=$?
+echo $RESULT
+
+# Unit tests for aligned memory arena
+./run_unittest_aligned_arena.sh 2>> temperror.log
+RESULT+=$?
+echo $RESULT
+
+# Unit tests for PSF convolution
+./run_unittest_convolver.sh 2>> temperror.log
+RESULT+=$?
+echo $RESULT
+
+# Same, with single-precision FFTW (requires libfftw3f; uncomment if you compile
+# with "scons --fftw-float")
+# ./run_unittest_convolver_float.sh 2>> temperror.log
+# RESULT+=$?
+# echo $RESULT
+
 # Unit tests for model_object
 ./run_unittest_model_object.sh
 RESULT+=$?
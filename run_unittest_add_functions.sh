@@ -12,9 +12,9 @@ NC='\033[0m' # No Color
 echo
 echo "Generating and compiling unit tests for add_functions..."
 $CXXTESTGEN --error-printer -o test_runner_add_functions.cpp unit_tests/unittest_add_functions.t.h
-$CPP -std=c++11 -o test_runner_add_functions test_runner_add_functions.cpp core/add_functions.cpp \
-core/model_object.cpp core/utilities.cpp core/convolver.cpp core/config_file_parser.cpp  \
-core/oversampled_region.cpp core/downsample.cpp core/image_io.cpp core/psf_oversampling_info.cpp \
+$CPP -std=c++11 -DNO_FFTW_FLOAT -o test_runner_add_functions test_runner_add_functions.cpp core/add_functions.cpp \
+core/model_object.cpp core/utilities.cpp core/convolver.cpp core/aligned_arena.cpp core/fftw_wisdom.cpp core/spatial_convolution.cpp core/psf_transform_cache.cpp core/config_file_parser.cpp  \
+core/oversampled_region.cpp core/downsample.cpp core/image_tiles.cpp core/image_io.cpp core/psf_oversampling_info.cpp \
 function_objects/function_object.cpp function_objects/func_gaussian.cpp \
 function_objects/func_exp.cpp function_objects/func_gen-exp.cpp \
 function_objects/func_sersic.cpp function_objects/func_gen-sersic.cpp \
@@ -29,6 +29,7 @@ function_objects/func_gaussianring3d.cpp function_objects/func_ferrersbar3d.cpp
 function_objects/func_king.cpp function_objects/func_king2.cpp \
 function_objects/func_pointsource.cpp \
 function_objects/helper_funcs.cpp function_objects/helper_funcs_3d.cpp \
+function_objects/radial_profile_table.cpp function_objects/pixel_integration.cpp function_objects/simd_kernels.cpp \
 function_objects/psf_interpolators.cpp \
 core/mersenne_twister.cpp core/mp_enorm.cpp \
 -I. -Icore -Isolvers -I/usr/local/include -Ifunction_objects -I$CXXTEST -L/usr/local/lib \
@@ -0,0 +1,24 @@
+#!/bin/bash
+
+# load environment-dependent definitions for CXXTESTGEN, CPP, etc.
+. ./define_unittest_vars.sh
+
+# Predefine some ANSI color escape codes
+RED='\033[0;31m'
+GREEN='\033[0;0;32m'
+NC='\033[0m' # No Color
+
+echo
+echo "Generating and compiling unit tests for aligned_arena..."
+$CXXTESTGEN --error-printer -o test_runner_aligned_arena.cpp unit_tests/unittest_aligned_arena.t.h 
+$CPP -std=c++11 -o test_runner_aligned_arena test_runner_aligned_arena.cpp core/aligned_arena.cpp \
+-I/usr/local/include -I$CXXTEST -I. -Icore -lm
+if [ $? -eq 0 ]
+then
+  echo "Running unit tests for aligned_arena:"
+  ./test_runner_aligned_arena
+  exit
+else
+  echo -e "${RED}Compilation of unit tests for aligned_arena failed.${NC}"
+  exit 1
+fi
@@ -0,0 +1,25 @@
+#!/bin/bash
+
+# load environment-dependent definitions for CXXTESTGEN, CPP, etc.
+. ./define_unittest_vars.sh
+
+# Predefine some ANSI color escape codes
+RED='\033[0;31m'
+GREEN='\033[0;0;32m'
+NC='\033[0m' # No Color
+
+echo
+echo "Generating and compiling unit tests for convolver (with single-precision FFTW)..."
+$CXXTESTGEN --error-printer -o test_runner_convolver_float.cpp unit_tests/unittest_convolver.t.h 
+$CPP -std=c++11 -o test_runner_convolver_float test_runner_convolver_float.cpp core/convolver.cpp \
+core/aligned_arena.cpp core/fftw_wisdom.cpp core/spatial_convolution.cpp core/psf_transform_cache.cpp -I. -Icore -I/usr/local/include -I$CXXTEST \
+-L/usr/local/lib -lfftw3 -lfftw3f -lm
+if [ $? -eq 0 ]
+then
+  echo "Running unit tests for convolver (single-precision FFTW):"
+  ./test_runner_convolver_float
+  exit
+else
+  echo -e "${RED}Compilation of unit tests for convolver.cpp failed.${NC}"
+  exit 1
+fi
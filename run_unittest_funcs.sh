@@ -20,7 +20,7 @@ function_objects/func_broken-exp2d.cpp function_objects/func_edge-on-disk.cpp \
 function_objects/func_gauss_extraparams.cpp \
 function_objects/func_pointsource.cpp function_objects/psf_interpolators.cpp \
 function_objects_1d/func1d_exp_test.cpp \
-function_objects/helper_funcs.cpp core/utilities.cpp \
+function_objects/helper_funcs.cpp function_objects/radial_profile_table.cpp function_objects/pixel_integration.cpp function_objects/simd_kernels.cpp core/utilities.cpp \
 -I/usr/local/include -I$CXXTEST -I. -Icore -Isolvers -Ifunction_objects \
 -L/usr/local/lib -lm -lgsl -lgslcblas
 if [ $? -eq 0 ]
@@ -0,0 +1,29 @@
+#!/bin/bash
+
+# load environment-dependent definitions for CXXTESTGEN, CPP, etc.
+. ./define_unittest_vars.sh
+
+# Predefine some ANSI color escape codes
+RED='\033[0;31m'
+GREEN='\033[0;0;32m'
+NC='\033[0m' # No Color
+
+echo
+echo "Generating and compiling unit tests for image_tiles..."
+$CXXTESTGEN --error-printer -o test_runner_image_tiles.cpp unit_tests/unittest_image_tiles.t.h 
+$CPP -std=c++11 -o test_runner_image_tiles test_runner_image_tiles.cpp core/image_tiles.cpp \
+function_objects/function_object.cpp function_objects/func_sersic.cpp \
+function_objects/func_gaussian.cpp function_objects/func_flatsky.cpp \
+function_objects/helper_funcs.cpp function_objects/radial_profile_table.cpp \
+function_objects/pixel_integration.cpp function_objects/simd_kernels.cpp \
+-I/usr/local/include -I$CXXTEST -I. -Icore -Isolvers -Ifunction_objects \
+-L/usr/local/lib -lgsl -lgslcblas -lm
+if [ $? -eq 0 ]
+then
+  echo "Running unit tests for image_tiles:"
+  ./test_runner_image_tiles
+  exit
+else
+  echo -e "${RED}Compilation of unit tests for image_tiles failed.${NC}"
+  exit 1
+fi
@@ -15,11 +15,11 @@ NC='\033[0m' # No Color
 echo
 echo "Generating and compiling unit tests for model_object..."
 $CXXTESTGEN --error-printer -o test_runner_modelobj.cpp unit_tests/unittest_model_object.t.h
-$CPP -std=c++11 -fsanitize=address -DDEBUG -DUSE_TEST_FUNCS \
+$CPP -std=c++11 -fsanitize=address -DDEBUG -DUSE_TEST_FUNCS -DNO_FFTW_FLOAT \
 -o test_runner_modelobj \
-test_runner_modelobj.cpp core/model_object.cpp core/utilities.cpp core/convolver.cpp \
+test_runner_modelobj.cpp core/model_object.cpp core/utilities.cpp core/convolver.cpp core/aligned_arena.cpp core/fftw_wisdom.cpp core/spatial_convolution.cpp core/psf_transform_cache.cpp \
 core/add_functions.cpp core/config_file_parser.cpp core/mersenne_twister.cpp \
-core/mp_enorm.cpp core/oversampled_region.cpp core/downsample.cpp \
+core/mp_enorm.cpp solvers/mpfit.cpp core/oversampled_region.cpp core/downsample.cpp core/image_tiles.cpp \
 core/image_io.cpp core/psf_oversampling_info.cpp \
 function_objects/function_object.cpp function_objects/func_gaussian.cpp \
 function_objects/func_exp.cpp function_objects/func_gen-exp.cpp \
@@ -35,6 +35,7 @@ function_objects/func_ferrersbar3d.cpp function_objects/func_king.cpp \
 function_objects/func_king2.cpp function_objects/func_gauss_extraparams.cpp \
 function_objects/func_pointsource.cpp \
 function_objects/helper_funcs.cpp function_objects/helper_funcs_3d.cpp \
+function_objects/radial_profile_table.cpp function_objects/pixel_integration.cpp function_objects/simd_kernels.cpp \
 function_objects/psf_interpolators.cpp \
 -I. -Icore -Isolvers -I/usr/local/include -Ifunction_objects -I$CXXTEST \
 -L/usr/local/lib -lfftw3_threads -lcfitsio -lfftw3 -lgsl -lgslcblas -lm
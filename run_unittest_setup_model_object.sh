@@ -12,10 +12,10 @@ NC='\033[0m' # No Color
 echo
 echo "Generating and compiling unit tests for setup_model_object..."
 $CXXTESTGEN --error-printer -o test_runner_setup_modelobj.cpp unit_tests/unittest_setup_model_object.t.h
-$CPP -std=c++11 -o test_runner_setup_modelobj test_runner_setup_modelobj.cpp core/model_object.cpp \
-core/setup_model_object.cpp core/utilities.cpp core/convolver.cpp core/config_file_parser.cpp \
+$CPP -std=c++11 -DNO_FFTW_FLOAT -o test_runner_setup_modelobj test_runner_setup_modelobj.cpp core/model_object.cpp \
+core/setup_model_object.cpp core/utilities.cpp core/convolver.cpp core/aligned_arena.cpp core/fftw_wisdom.cpp core/spatial_convolution.cpp core/psf_transform_cache.cpp core/config_file_parser.cpp \
 core/mersenne_twister.cpp core/mp_enorm.cpp core/oversampled_region.cpp core/downsample.cpp \
-core/image_io.cpp core/psf_oversampling_info.cpp function_objects/psf_interpolators.cpp \
+core/image_tiles.cpp core/image_io.cpp core/psf_oversampling_info.cpp function_objects/psf_interpolators.cpp \
 -I. -Icore -Isolvers -I/usr/local/include -Ifunction_objects -I$CXXTEST \
 -L/usr/local/lib -lfftw3_threads -lcfitsio -lfftw3 -lgsl -lgslcblas -lm
 if [ $? -eq 0 ]
@@ -0,0 +1,26 @@
+#!/bin/bash
+
+# load environment-dependent definitions for CXXTESTGEN, CPP, etc.
+. ./define_unittest_vars.sh
+
+# Predefine some ANSI color escape codes
+RED='\033[0;31m'
+GREEN='\033[0;0;32m'
+NC='\033[0m' # No Color
+
+echo
+echo "Generating and compiling unit tests for SIMD kernels..."
+$CXXTESTGEN --error-printer -o test_runner_simd_kernels.cpp unit_tests/unittest_simd_kernels.t.h 
+$CPP -std=c++11 -o test_runner_simd_kernels test_runner_simd_kernels.cpp \
+function_objects/simd_kernels.cpp \
+-I/usr/local/include -I$CXXTEST -I. -Icore -Isolvers -Ifunction_objects \
+-L/usr/local/lib -lm
+if [ $? -eq 0 ]
+then
+  echo "Running unit tests for SIMD kernels:"
+  ./test_runner_simd_kernels
+  exit
+else
+  echo -e "${RED}Compilation of unit tests for SIMD kernels failed.${NC}"
+  exit 1
+fi
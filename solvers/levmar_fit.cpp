@@ -28,6 +28,7 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <math.h>
+#include <float.h>
 
 #include "model_object.h"
 #include "param_struct.h"   // for mp_par structure
@@ -99,6 +100,10 @@ int LevMarFit( int nParamsTot, int nFreeParams, int nDataVals, double *paramVect
   mpConfig.maxiter = MAX_ITERATIONS;
   mpConfig.ftol = ftol;
   mpConfig.verbose = verbose;
+  // finite-difference steps must be large compared with the precision of
+  // single-precision model images
+  if (theModel->UsesSinglePrecision())
+    mpConfig.epsfcn = FLT_EPSILON;
 
   status = mpfit(myfunc_mpfit, nDataVals, nParamsTot, paramVector, mpfitParameterConstraints,
 					&mpConfig, theModel, &mpfitResult);
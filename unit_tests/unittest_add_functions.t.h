@@ -13,6 +13,10 @@ using namespace std;
 #include "add_functions.h"
 #include "model_object.h"
 #include "config_file_parser.h"
+#include "func_sersic.h"
+#include "func_broken-exp.h"
+#include "func_edge-on-ring.h"
+#include "func_flatsky.h"
 
 #define SIMPLE_CONFIG_FILE "tests/config_imfit_flatsky.dat"
 
@@ -164,4 +168,53 @@ public:
     }
   }
 
+
+  // Functions created by AddFunctions (which use statically dispatched kernels)
+  // should give the same model image as the same functions added directly to
+  // the model (which use the virtual GetValue/GetValues methods)
+  void testStaticKernelsMatchVirtualCalls( void )
+  {
+    vector<string>  fnameList;
+    vector<int>  funcBlockIndices;
+    // X0, Y0, Sersic (PA, ell, n, I_e, r_e), BrokenExponential (PA, ell, I_0, h1,
+    // h2, r_break, alpha), X0, Y0, EdgeOnRing (PA, I_0, r, sigma_r, sigma_z), FlatSky (I_sky)
+    double  params[22] = {20.3, 15.7, 10.0, 0.3, 2.5, 20.0, 4.0, 40.0, 0.2, 100.0, 5.0, 2.0,
+    						8.0, 3.0, 25.5, 16.2, 30.0, 10.0, 9.0, 1.0, 1.5, 3.0};
+    int  status;
+    
+    fnameList.push_back("Sersic");
+    fnameList.push_back("BrokenExponential");
+    fnameList.push_back("EdgeOnRing");
+    fnameList.push_back("FlatSky");
+    funcBlockIndices.push_back(0);
+    funcBlockIndices.push_back(2);
+    
+    ModelObject *modelObj_static = new ModelObject();
+    status = AddFunctions(modelObj_static, fnameList, funcBlockIndices, true, -1);
+    TS_ASSERT_EQUALS(status, 0);
+    
+    ModelObject *modelObj_virtual = new ModelObject();
+    FunctionObject *functions[4] = {new Sersic(), new BrokenExponential(), new EdgeOnRing(),
+    								new FlatSky()};
+    for (int n = 0; n < 4; n++) {
+      functions[n]->SetSubsampling(true);
+      modelObj_virtual->AddFunction(functions[n]);
+    }
+    modelObj_virtual->DefineFunctionBlocks(funcBlockIndices);
+    modelObj_virtual->PopulateParameterNames();
+    TS_ASSERT_EQUALS(modelObj_virtual->GetNParams(), modelObj_static->GetNParams());
+    
+    modelObj_static->SetupModelImage(40, 30);
+    modelObj_virtual->SetupModelImage(40, 30);
+    modelObj_static->CreateModelImage(params);
+    modelObj_virtual->CreateModelImage(params);
+    double  *model_static = modelObj_static->GetModelImageVector();
+    double  *model_virtual = modelObj_virtual->GetModelImageVector();
+    for (long z = 0; z < 40*30; z++)
+      TS_ASSERT_EQUALS(model_static[z], model_virtual[z]);
+    
+    delete modelObj_static;
+    delete modelObj_virtual;
+  }
+
 };
@@ -0,0 +1,81 @@
+// Unit tests for the AlignedArena class (aligned_arena.cpp)
+//
+
+// See run_unittest_aligned_arena.sh for how to compile and run these tests.
+
+
+#include <cxxtest/TestSuite.h>
+
+#include <stdint.h>
+#include <string.h>
+using namespace std;
+
+#include "aligned_arena.h"
+
+
+class TestAlignedArena : public CxxTest::TestSuite
+{
+public:
+
+  void testAlignedAndZeroed( void )
+  {
+    AlignedArena  arena;
+    // mixture of small (shared-block) and large (dedicated-block) buffers,
+    // including sizes which aren't multiples of the alignment
+    size_t  sizes[] = {8, 3, 1000, 300000, 17, 5000000, 65};
+
+    for (int k = 0; k < 7; k++) {
+      unsigned char *buffer = (unsigned char *)arena.Allocate(sizes[k]);
+      TS_ASSERT( buffer != NULL );
+      TS_ASSERT_EQUALS( (uintptr_t)buffer % ARENA_ALIGNMENT, (uintptr_t)0 );
+      for (size_t i = 0; i < sizes[k]; i++)
+        TS_ASSERT_EQUALS( buffer[i], 0 );
+      memset(buffer, 0xff, sizes[k]);
+    }
+  }
+
+  void testSmallBuffersDontOverlap( void )
+  {
+    AlignedArena  arena;
+
+    double *vect1 = arena.AllocateArray<double>(10);
+    double *vect2 = arena.AllocateArray<double>(10);
+    TS_ASSERT( vect2 >= vect1 + 10 );
+    // both fit in a single shared block
+    TS_ASSERT_EQUALS( arena.GetBytesReserved(), (long)ARENA_BLOCK_SIZE );
+    TS_ASSERT_EQUALS( arena.GetBytesAllocated(), (long)(2*128) );
+  }
+
+  void testFreeLargeBuffer( void )
+  {
+    AlignedArena  arena;
+    long  nBytes = 1000*1000*sizeof(double);
+
+    double *vect1 = arena.AllocateArray<double>(1000*1000);
+    TS_ASSERT_EQUALS( arena.GetBytesReserved(), nBytes );
+    arena.Free(vect1);
+    TS_ASSERT_EQUALS( arena.GetBytesReserved(), (long)0 );
+    TS_ASSERT_EQUALS( arena.GetBytesAllocated(), (long)0 );
+
+    // freeing a small buffer (or NULL) does nothing
+    double *vect2 = arena.AllocateArray<double>(10);
+    arena.Free(vect2);
+    arena.Free(NULL);
+    TS_ASSERT_EQUALS( arena.GetBytesReserved(), (long)ARENA_BLOCK_SIZE );
+  }
+
+  void testFreeAll( void )
+  {
+    AlignedArena  arena;
+
+    arena.AllocateArray<double>(10);
+    arena.AllocateArray<double>(1000*1000);
+    arena.FreeAll();
+    TS_ASSERT_EQUALS( arena.GetBytesReserved(), (long)0 );
+    TS_ASSERT_EQUALS( arena.GetBytesAllocated(), (long)0 );
+    // arena can be re-used
+    double *vect = arena.AllocateArray<double>(10);
+    TS_ASSERT( vect != NULL );
+    TS_ASSERT_EQUALS( vect[9], 0.0 );
+  }
+};
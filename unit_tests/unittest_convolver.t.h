@@ -0,0 +1,554 @@
+// Unit tests for the Convolver class and padded-size selection (convolver.cpp),
+// and for direct convolution (spatial_convolution.cpp)
+//
+
+// See run_unittest_convolver.sh for how to compile and run these tests.
+
+
+#include <cxxtest/TestSuite.h>
+
+#include <math.h>
+#include <vector>
+using namespace std;
+
+#include "convolver.h"
+
+
+// Direct (spatial-domain) convolution of image with psf, with zero outside the
+// image, using the same PSF-centering convention as Convolver
+static void DirectConvolution( const double *image, int nColumns, int nRows,
+							const double *psf, int nColumns_psf, int nRows_psf, double *output )
+{
+  int  centerX = nColumns_psf / 2;
+  int  centerY = nRows_psf / 2;
+
+  for (int y = 0; y < nRows; y++) {
+    for (int x = 0; x < nColumns; x++) {
+      double  sum = 0.0;
+      for (int i = 0; i < nRows_psf; i++) {
+        for (int j = 0; j < nColumns_psf; j++) {
+          int  xx = x - (j - centerX);
+          int  yy = y - (i - centerY);
+          if ((xx >= 0) && (xx < nColumns) && (yy >= 0) && (yy < nRows))
+            sum += psf[i*nColumns_psf + j] * image[yy*nColumns + xx];
+        }
+      }
+      output[y*nColumns + x] = sum;
+    }
+  }
+}
+
+
+class TestFFTFriendlySizes : public CxxTest::TestSuite
+{
+public:
+
+  void testFFTCostPerPoint( void )
+  {
+    TS_ASSERT_EQUALS( FFTCostPerPoint(1), 0.0 );
+    TS_ASSERT_EQUALS( FFTCostPerPoint(8), 3.0 );
+    TS_ASSERT_EQUALS( FFTCostPerPoint(16), 4.0 );
+    // radix-3 passes cost more than radix-2 passes
+    TS_ASSERT( FFTCostPerPoint(12) > FFTCostPerPoint(8) );
+    TS_ASSERT( FFTCostPerPoint(12) < FFTCostPerPoint(16) );
+    TS_ASSERT( FFTCostPerPoint(2*3*5*7) > 0.0 );
+    TS_ASSERT_EQUALS( FFTCostPerPoint(11), -1.0 );
+    TS_ASSERT_EQUALS( FFTCostPerPoint(2*13), -1.0 );
+    TS_ASSERT_EQUALS( FFTCostPerPoint(0), -1.0 );
+  }
+
+  // chosen sizes are at least as large as requested, at most twice as large,
+  // and have no prime factors > 7
+  void testGetFFTFriendlySize( void )
+  {
+    TS_ASSERT_EQUALS( GetFFTFriendlySize(1), 1 );
+    TS_ASSERT_EQUALS( GetFFTFriendlySize(64), 64 );
+    for (int n = 2; n <= 3000; n++) {
+      int  nGood = GetFFTFriendlySize(n);
+      TS_ASSERT( nGood >= n );
+      TS_ASSERT( nGood <= 2*n );
+      TS_ASSERT( FFTCostPerPoint(nGood) >= 0.0 );
+    }
+    // large prime
+    int  nGood = GetFFTFriendlySize(1031);
+    TS_ASSERT( (nGood >= 1031) && (FFTCostPerPoint(nGood) >= 0.0) );
+  }
+
+  void testGetFFTFriendlyPaddedSizes( void )
+  {
+    int  nCols, nRows;
+    int  minSizes[7] = {1, 17, 64, 101, 389, 1031, 2039};
+
+    for (int i = 0; i < 7; i++) {
+      for (int j = 0; j < 7; j++) {
+        GetFFTFriendlyPaddedSizes(minSizes[i], minSizes[j], nCols, nRows);
+        TS_ASSERT( (nCols >= minSizes[i]) && (nCols <= 2*minSizes[i]) );
+        TS_ASSERT( (nRows >= minSizes[j]) && (nRows <= 2*minSizes[j]) );
+        TS_ASSERT( FFTCostPerPoint(nCols) >= 0.0 );
+        TS_ASSERT( FFTCostPerPoint(nRows) >= 0.0 );
+      }
+    }
+    GetFFTFriendlyPaddedSizes(128, 256, nCols, nRows);
+    TS_ASSERT_EQUALS( nCols, 128 );
+    TS_ASSERT_EQUALS( nRows, 256 );
+  }
+};
+
+
+class TestConvolver : public CxxTest::TestSuite
+{
+public:
+
+  // Convolves an nColumns x nRows image with an nColumns_psf x nRows_psf PSF, using
+  // the specified method, and compares the result with (reference) direct convolution
+  void CheckConvolution( int nColumns, int nRows, int nColumns_psf, int nRows_psf,
+  						int method, bool singlePrecision, double tolerance )
+  {
+    long  nPixels = (long)nColumns*nRows;
+    vector<double>  image(nPixels), convolved(nPixels), reference(nPixels);
+    vector<double>  psf(nColumns_psf*nRows_psf);
+    double  maxValue = 0.0;
+
+    // asymmetric PSF, so that flips or shifts would be detected
+    for (int i = 0; i < nRows_psf; i++)
+      for (int j = 0; j < nColumns_psf; j++)
+        psf[i*nColumns_psf + j] = exp(-0.3*(i - 1.3)*(i - 1.3) - 0.5*(j - 2.1)*(j - 2.1)) + 0.01*j;
+    for (long z = 0; z < nPixels; z++) {
+      image[z] = 1.0 + (double)((z*37) % 11) + ((z % 13) == 0 ? 50.0 : 0.0);
+      convolved[z] = image[z];
+    }
+    DirectConvolution(&image[0], nColumns, nRows, &psf[0], nColumns_psf, nRows_psf,
+    					&reference[0]);
+
+    Convolver  psfConvolver;
+    psfConvolver.SetupPSF(&psf[0], nColumns_psf, nRows_psf, false);
+    psfConvolver.SetupImage(nColumns, nRows);
+    psfConvolver.SetConvolutionMethod(method);
+    if (singlePrecision)
+      TS_ASSERT_EQUALS( psfConvolver.UseSinglePrecision(), 0 );
+    TS_ASSERT_EQUALS( psfConvolver.DoFullSetup(), 0 );
+    TS_ASSERT_EQUALS( psfConvolver.GetConvolutionMethod(), method );
+    psfConvolver.ConvolveImage(&convolved[0]);
+
+    for (long z = 0; z < nPixels; z++)
+      maxValue = fmax(maxValue, fabs(reference[z]));
+    for (long z = 0; z < nPixels; z++)
+      TS_ASSERT_DELTA( convolved[z], reference[z], tolerance*maxValue );
+
+    // single-precision model images are convolved in place as floats
+    if (singlePrecision) {
+      vector<float>  convolved_sp(image.begin(), image.end());
+      psfConvolver.ConvolveImage(&convolved_sp[0]);
+      for (long z = 0; z < nPixels; z++)
+        TS_ASSERT_DELTA( convolved_sp[z], reference[z], tolerance*maxValue );
+    }
+  }
+
+  // image + PSF - 1 = 27 x 23 (23 is prime, so the rows are padded further)
+  void testConvolutionMatchesDirect_primeSize( void )
+  {
+    CheckConvolution(23, 17, 5, 7, CONVOLUTION_FFT, false, 1.0e-12);
+  }
+
+  void testConvolutionMatchesDirect_smoothSize( void )
+  {
+    CheckConvolution(12, 14, 5, 3, CONVOLUTION_FFT, false, 1.0e-12);
+  }
+
+  void testConvolutionMatchesDirect_largerPSF( void )
+  {
+    CheckConvolution(19, 11, 9, 9, CONVOLUTION_FFT, false, 1.0e-12);
+  }
+
+  // (single-precision tests do nothing if we're compiled without single-precision FFTW)
+  void testConvolutionMatchesDirect_singlePrecision( void )
+  {
+#ifndef NO_FFTW_FLOAT
+    CheckConvolution(23, 17, 5, 7, CONVOLUTION_FFT, true, 1.0e-5);
+#endif
+  }
+
+  void testDirectConvolution( void )
+  {
+    CheckConvolution(23, 17, 5, 7, CONVOLUTION_DIRECT, false, 1.0e-14);
+    CheckConvolution(12, 14, 5, 3, CONVOLUTION_DIRECT, false, 1.0e-14);
+    // PSF larger than the image along one axis
+    CheckConvolution(19, 7, 9, 9, CONVOLUTION_DIRECT, false, 1.0e-14);
+    CheckConvolution(1, 1, 3, 3, CONVOLUTION_DIRECT, false, 1.0e-14);
+  }
+
+  void testDirectConvolution_singlePrecision( void )
+  {
+#ifndef NO_FFTW_FLOAT
+    CheckConvolution(23, 17, 5, 7, CONVOLUTION_DIRECT, true, 1.0e-6);
+#endif
+  }
+
+  // small PSFs should be convolved directly, large ones with FFTs
+  void testAutomaticMethodChoice( void )
+  {
+    int  methods[2];
+    int  nColumns_psf[2] = {5, 41};
+    vector<double>  psf(41*41, 1.0);
+
+    for (int k = 0; k < 2; k++) {
+      Convolver  psfConvolver;
+      psfConvolver.SetupPSF(&psf[0], nColumns_psf[k], nColumns_psf[k], false);
+      psfConvolver.SetupImage(200, 200);
+      TS_ASSERT_EQUALS( psfConvolver.DoFullSetup(), 0 );
+      methods[k] = psfConvolver.GetConvolutionMethod();
+    }
+    TS_ASSERT_EQUALS( methods[0], CONVOLUTION_DIRECT );
+    TS_ASSERT_EQUALS( methods[1], CONVOLUTION_FFT );
+  }
+
+  // ConvolveImages gives the same results as ConvolveImage for each image, both
+  // for batches (and the leftover images) and when batching isn't used
+  void testBatchConvolution( void )
+  {
+    int  nColumns = 23, nRows = 17, nColumns_psf = 5, nRows_psf = 7;
+    int  nImages = 5;
+    long  nPixels = (long)nColumns*nRows;
+    int  methods[2] = {CONVOLUTION_FFT, CONVOLUTION_DIRECT};
+    vector<double>  psf(nColumns_psf*nRows_psf);
+
+    for (int i = 0; i < nRows_psf; i++)
+      for (int j = 0; j < nColumns_psf; j++)
+        psf[i*nColumns_psf + j] = exp(-0.3*(i - 1.3)*(i - 1.3) - 0.5*(j - 2.1)*(j - 2.1));
+
+    for (int m = 0; m < 2; m++) {
+      vector< vector<double> >  batchImages(nImages), singleImages(nImages);
+      double  *imagePointers[5];
+      for (int n = 0; n < nImages; n++) {
+        batchImages[n].resize(nPixels);
+        for (long z = 0; z < nPixels; z++)
+          batchImages[n][z] = 1.0 + (double)((z*(37 + n)) % 11) + ((z % (13 + n)) == 0 ? 50.0 : 0.0);
+        singleImages[n] = batchImages[n];
+        imagePointers[n] = &batchImages[n][0];
+      }
+
+      Convolver  psfConvolver;
+      psfConvolver.SetupPSF(&psf[0], nColumns_psf, nRows_psf, true);
+      psfConvolver.SetupImage(nColumns, nRows);
+      psfConvolver.SetConvolutionMethod(methods[m]);
+      TS_ASSERT_EQUALS( psfConvolver.DoFullSetup(), 0 );
+      TS_ASSERT_EQUALS( psfConvolver.SetupBatchConvolution(2), 0 );
+      psfConvolver.ConvolveImages(imagePointers, nImages);
+      for (int n = 0; n < nImages; n++) {
+        psfConvolver.ConvolveImage(&singleImages[n][0]);
+        for (long z = 0; z < nPixels; z++)
+          TS_ASSERT_DELTA( batchImages[n][z], singleImages[n][z], 1.0e-12 );
+      }
+    }
+  }
+
+  void testMinimumPaddedLength( void )
+  {
+    // whole image: image + half the PSF is enough (vs. image + PSF - 1)
+    TS_ASSERT_EQUALS( MinimumPaddedLength(100, 9, 0, 100), 104 );
+    TS_ASSERT_EQUALS( MinimumPaddedLength(100, 8, 0, 100), 104 );
+    // region at least half a PSF from the edges: no padding needed
+    TS_ASSERT_EQUALS( MinimumPaddedLength(108, 9, 4, 100), 108 );
+    TS_ASSERT_EQUALS( MinimumPaddedLength(702, 351, 175, 352), 702 );
+    // region touching one edge
+    TS_ASSERT_EQUALS( MinimumPaddedLength(100, 9, 0, 50), 104 );
+    TS_ASSERT_EQUALS( MinimumPaddedLength(100, 9, 50, 50), 104 );
+  }
+
+  // Convolves an image with the PSF, computing only the specified region, and
+  // compares that region with (reference) direct convolution of the whole image;
+  // returns the padded size used. If tileSize >= 0, tiled convolution is used
+  // (and a clone of the Convolver is checked as well)
+  void CheckRegionConvolution( int nColumns, int nRows, int nColumns_psf, int nRows_psf,
+  						int x0, int y0, int nColumns_out, int nRows_out, bool singlePrecision,
+  						double tolerance, int& nColumns_padded, int& nRows_padded,
+  						int tileSize=-1 )
+  {
+    long  nPixels = (long)nColumns*nRows;
+    vector<double>  image(nPixels), convolved(nPixels), reference(nPixels);
+    vector<double>  psf(nColumns_psf*nRows_psf);
+    double  maxValue = 0.0;
+
+    for (int i = 0; i < nRows_psf; i++)
+      for (int j = 0; j < nColumns_psf; j++)
+        psf[i*nColumns_psf + j] = exp(-0.3*(i - 1.3)*(i - 1.3) - 0.5*(j - 2.1)*(j - 2.1)) + 0.01*j;
+    for (long z = 0; z < nPixels; z++) {
+      image[z] = 1.0 + (double)((z*37) % 11) + ((z % 13) == 0 ? 50.0 : 0.0);
+      convolved[z] = image[z];
+    }
+    DirectConvolution(&image[0], nColumns, nRows, &psf[0], nColumns_psf, nRows_psf,
+    					&reference[0]);
+    for (long z = 0; z < nPixels; z++)
+      maxValue = fmax(maxValue, fabs(reference[z]));
+
+    Convolver  psfConvolver;
+    psfConvolver.SetupPSF(&psf[0], nColumns_psf, nRows_psf, false);
+    psfConvolver.SetupImage(nColumns, nRows);
+    psfConvolver.SetOutputRegion(x0, y0, nColumns_out, nRows_out);
+    if (tileSize >= 0)
+      psfConvolver.SetTileSize(tileSize);
+    else
+      psfConvolver.SetConvolutionMethod(CONVOLUTION_FFT);
+    if (singlePrecision)
+      TS_ASSERT_EQUALS( psfConvolver.UseSinglePrecision(), 0 );
+    TS_ASSERT_EQUALS( psfConvolver.DoFullSetup(), 0 );
+    psfConvolver.GetPaddedImageSize(nColumns_padded, nRows_padded);
+    if (singlePrecision) {
+      vector<float>  convolved_sp(image.begin(), image.end());
+      psfConvolver.ConvolveImage(&convolved_sp[0]);
+      for (long z = 0; z < nPixels; z++)
+        convolved[z] = convolved_sp[z];
+    } else
+      psfConvolver.ConvolveImage(&convolved[0]);
+
+    for (int y = y0; y < y0 + nRows_out; y++)
+      for (int x = x0; x < x0 + nColumns_out; x++)
+        TS_ASSERT_DELTA( convolved[y*nColumns + x], reference[y*nColumns + x], 
+        				tolerance*maxValue );
+
+    if ((tileSize >= 0) && (! singlePrecision)) {
+      AlignedArena  cloneArena;
+      Convolver  *theCopy = psfConvolver.Clone(&cloneArena);
+      TS_ASSERT( theCopy != NULL );
+      vector<double>  convolved2(image);
+      theCopy->ConvolveImage(&convolved2[0]);
+      for (int y = y0; y < y0 + nRows_out; y++)
+        for (int x = x0; x < x0 + nColumns_out; x++)
+          TS_ASSERT_DELTA( convolved2[y*nColumns + x], convolved[y*nColumns + x], 1.0e-14*maxValue );
+      delete theCopy;
+    }
+  }
+
+  // convolving only the central region (as for ModelObject's model images) needs
+  // less padding than convolving the whole image
+  void testOutputRegion( void )
+  {
+    int  nCols_padded, nRows_padded;
+
+    // model image = 23 x 17 data image + half of 9 x 7 PSF on each side
+    CheckRegionConvolution(31, 23, 9, 7, 4, 3, 23, 17, false, 1.0e-12, nCols_padded, nRows_padded);
+    TS_ASSERT( (nCols_padded >= 31) && (nCols_padded < 31 + 9 - 1) );
+    TS_ASSERT( (nRows_padded >= 23) && (nRows_padded < 23 + 7 - 1) );
+#ifndef NO_FFTW_FLOAT
+    CheckRegionConvolution(31, 23, 9, 7, 4, 3, 23, 17, true, 1.0e-5, nCols_padded, nRows_padded);
+#endif
+    // off-center regions, touching the image edges
+    CheckRegionConvolution(23, 17, 5, 7, 0, 0, 10, 8, false, 1.0e-12, nCols_padded, nRows_padded);
+    CheckRegionConvolution(23, 17, 5, 7, 13, 9, 10, 8, false, 1.0e-12, nCols_padded, nRows_padded);
+    // whole image (same as no region)
+    CheckRegionConvolution(23, 17, 6, 4, 0, 0, 23, 17, false, 1.0e-12, nCols_padded, nRows_padded);
+  }
+
+  // overlap-save convolution with several rows and columns of tiles
+  void testTiledConvolution( void )
+  {
+    int  nCols_padded, nRows_padded;
+
+    // 20 x 20 FFTs --> 12 x 14 tiles, partial tiles at the right and top edges
+    CheckRegionConvolution(61, 47, 9, 7, 0, 0, 61, 47, false, 1.0e-12, nCols_padded, 
+    						nRows_padded, 20);
+    TS_ASSERT_EQUALS( nCols_padded, 20 );
+    TS_ASSERT_EQUALS( nRows_padded, 20 );
+    // even-sized PSF; requested size raised to 2*PSF - 1 = 15 x 11 (--> 16 x 12)
+    CheckRegionConvolution(40, 33, 8, 6, 0, 0, 40, 33, false, 1.0e-12, nCols_padded, 
+    						nRows_padded, 10);
+    TS_ASSERT_EQUALS( nCols_padded, 16 );
+    TS_ASSERT_EQUALS( nRows_padded, 12 );
+    // output region (model image with padding)
+    CheckRegionConvolution(69, 53, 9, 7, 4, 3, 61, 47, false, 1.0e-12, nCols_padded, 
+    						nRows_padded, 18);
+    // default size: a single tile covers the (small) image
+    CheckRegionConvolution(23, 17, 5, 7, 0, 0, 23, 17, false, 1.0e-12, nCols_padded, 
+    						nRows_padded, 0);
+    TS_ASSERT_EQUALS( nCols_padded, 27 );
+    TS_ASSERT_EQUALS( nRows_padded, 24 );
+#ifndef NO_FFTW_FLOAT
+    // single precision isn't tiled (but still works)
+    CheckRegionConvolution(61, 47, 9, 7, 0, 0, 61, 47, true, 1.0e-5, nCols_padded, 
+    						nRows_padded, 20);
+    TS_ASSERT( nCols_padded >= 61 );
+#endif
+  }
+};
+
+
+class TestSeparablePSF : public CxxTest::TestSuite
+{
+public:
+
+  // Reconstructs the rank-k kernel from its row and column kernels
+  void Reconstruct( int rank, const double *rowKernels, const double *columnKernels,
+  					int nColumns, int nRows, double *kernel )
+  {
+    for (int i = 0; i < nRows; i++)
+      for (int j = 0; j < nColumns; j++) {
+        kernel[i*nColumns + j] = 0.0;
+        for (int k = 0; k < rank; k++)
+          kernel[i*nColumns + j] += columnKernels[k*nRows + i] * rowKernels[k*nColumns + j];
+      }
+  }
+
+  void testExactlySeparableKernels( void )
+  {
+    int  nColumns = 9, nRows = 7;
+    double  kernel[63], reconstructed[63];
+    double  rowKernels[7*9], columnKernels[7*7];
+    double  error;
+    int  rank;
+
+    // rank 1: elliptical Gaussian
+    for (int i = 0; i < nRows; i++)
+      for (int j = 0; j < nColumns; j++)
+        kernel[i*nColumns + j] = exp(-0.5*(i - 3)*(i - 3)/1.5 - 0.5*(j - 4)*(j - 4)/4.0);
+    rank = SeparableKernelApproximation(kernel, nColumns, nRows, 1.0e-10, 7, rowKernels,
+    									columnKernels, &error);
+    TS_ASSERT_EQUALS( rank, 1 );
+    TS_ASSERT( error <= 1.0e-10 );
+    Reconstruct(rank, rowKernels, columnKernels, nColumns, nRows, reconstructed);
+    for (int z = 0; z < 63; z++)
+      TS_ASSERT_DELTA( reconstructed[z], kernel[z], 1.0e-12 );
+
+    // rank 2: sum of two Gaussians with different widths
+    for (int i = 0; i < nRows; i++)
+      for (int j = 0; j < nColumns; j++)
+        kernel[i*nColumns + j] += 0.3*exp(-0.5*((i - 3)*(i - 3) + (j - 4)*(j - 4))/9.0);
+    rank = SeparableKernelApproximation(kernel, nColumns, nRows, 1.0e-10, 7, rowKernels,
+    									columnKernels, &error);
+    TS_ASSERT_EQUALS( rank, 2 );
+    Reconstruct(rank, rowKernels, columnKernels, nColumns, nRows, reconstructed);
+    for (int z = 0; z < 63; z++)
+      TS_ASSERT_DELTA( reconstructed[z], kernel[z], 1.0e-12 );
+  }
+
+  // if maxRank isn't enough, 0 is returned along with the error for maxRank
+  void testRankLimit( void )
+  {
+    double  kernel[25], rowKernels[2*5], columnKernels[2*5];
+    double  error;
+
+    for (int z = 0; z < 25; z++)
+      kernel[z] = 1.0 + ((z*7) % 5) + ((z % 3) == 0 ? 2.0 : 0.0);
+    TS_ASSERT_EQUALS( SeparableKernelApproximation(kernel, 5, 5, 1.0e-10, 2, rowKernels,
+    						columnKernels, &error), 0 );
+    TS_ASSERT( (error > 1.0e-10) && (error < 1.0) );
+  }
+
+  // Moffat PSF (not separable) approximated with a few terms; convolved image
+  // should match the exact convolution to about the requested tolerance
+  void testConvolutionWithSeparablePSF( void )
+  {
+    int  nColumns = 200, nRows = 200, nColumns_psf = 15, nRows_psf = 15;
+    long  nPixels = (long)nColumns*nRows;
+    double  tolerance = 5.0e-3;
+    vector<double>  psf(nColumns_psf*nRows_psf), psfCopy(nColumns_psf*nRows_psf);
+    vector<double>  image(nPixels), convolved(nPixels), reference(nPixels);
+    double  maxValue = 0.0;
+
+    for (int i = 0; i < nRows_psf; i++)
+      for (int j = 0; j < nColumns_psf; j++) {
+        double  r2 = (i - 7)*(i - 7) + (j - 7)*(j - 7)/1.2;
+        psf[i*nColumns_psf + j] = pow(1.0 + r2/4.0, -2.5);
+      }
+    for (long z = 0; z < nPixels; z++) {
+      image[z] = 1.0 + (double)((z*37) % 11) + ((z % 13) == 0 ? 50.0 : 0.0);
+      convolved[z] = image[z];
+    }
+    psfCopy = psf;
+
+    Convolver  psfConvolver;
+    psfConvolver.SetupPSF(&psf[0], nColumns_psf, nRows_psf, true, tolerance);
+    psfConvolver.SetupImage(nColumns, nRows);
+    TS_ASSERT_EQUALS( psfConvolver.DoFullSetup(), 0 );
+    TS_ASSERT_EQUALS( psfConvolver.GetConvolutionMethod(), CONVOLUTION_SEPARABLE );
+    TS_ASSERT( (psfConvolver.GetSeparableRank() >= 1) && (psfConvolver.GetSeparableRank() <= 4) );
+    TS_ASSERT( psfConvolver.GetSeparableApproximationError() <= tolerance );
+    psfConvolver.ConvolveImage(&convolved[0]);
+
+    // psf has been normalized in place
+    DirectConvolution(&image[0], nColumns, nRows, &psf[0], nColumns_psf, nRows_psf,
+    					&reference[0]);
+    for (long z = 0; z < nPixels; z++)
+      maxValue = fmax(maxValue, fabs(reference[z]));
+    for (long z = 0; z < nPixels; z++)
+      TS_ASSERT_DELTA( convolved[z], reference[z], tolerance*maxValue );
+
+    // with a tolerance it can't meet cheaply, the Convolver uses the exact PSF
+    Convolver  psfConvolver2;
+    psfConvolver2.SetupPSF(&psfCopy[0], nColumns_psf, nRows_psf, true, 1.0e-14);
+    psfConvolver2.SetupImage(nColumns, nRows);
+    TS_ASSERT_EQUALS( psfConvolver2.DoFullSetup(), 0 );
+    TS_ASSERT_EQUALS( psfConvolver2.GetSeparableRank(), 0 );
+    TS_ASSERT_DIFFERS( psfConvolver2.GetConvolutionMethod(), CONVOLUTION_SEPARABLE );
+  }
+};
+
+
+class TestPsfTransformCache : public CxxTest::TestSuite
+{
+public:
+
+  Convolver * MakeConvolver( double *psf, int nColumns, int nRows, bool singlePrecision=false )
+  {
+    Convolver  *psfConvolver = new Convolver();
+    psfConvolver->SetupPSF(psf, 5, 5, true);
+    psfConvolver->SetupImage(nColumns, nRows);
+    psfConvolver->SetConvolutionMethod(CONVOLUTION_FFT);
+    if (singlePrecision)
+      psfConvolver->UseSinglePrecision();
+    psfConvolver->DoFullSetup();
+    return psfConvolver;
+  }
+
+  // Convolvers with the same PSF and image size share one cache entry,
+  // and give the same results as a Convolver with its own entry; entries are
+  // removed when the last Convolver using them is deleted
+  void testSharedTransforms( void )
+  {
+    double  psf1[25], psf2[25], psf3[25], psf4[25];
+    int  nCached = NumberOfCachedPsfTransforms();
+    vector<double>  image1(20*15), image2(20*15);
+
+    for (int i = 0; i < 25; i++) {
+      psf1[i] = exp(-0.5*((i/5 - 2)*(i/5 - 2) + (i%5 - 2.3)*(i%5 - 2.3)));
+      psf2[i] = psf1[i];
+      psf3[i] = psf1[i];
+      psf4[i] = psf1[i];
+    }
+    psf4[7] += 0.1;
+    for (int z = 0; z < 300; z++)
+      image1[z] = image2[z] = 1.0 + (z % 7) + ((z % 29) == 0 ? 40.0 : 0.0);
+
+    Convolver  *convolver1 = MakeConvolver(psf1, 20, 15);
+    TS_ASSERT_EQUALS( NumberOfCachedPsfTransforms(), nCached + 1 );
+    Convolver  *convolver2 = MakeConvolver(psf2, 20, 15);
+    TS_ASSERT_EQUALS( NumberOfCachedPsfTransforms(), nCached + 1 );
+    // different image size, different PSF, different precision: new entries
+    Convolver  *convolver3 = MakeConvolver(psf3, 30, 15);
+    TS_ASSERT_EQUALS( NumberOfCachedPsfTransforms(), nCached + 2 );
+    Convolver  *convolver4 = MakeConvolver(psf4, 20, 15);
+    TS_ASSERT_EQUALS( NumberOfCachedPsfTransforms(), nCached + 3 );
+    Convolver  *convolver5 = MakeConvolver(psf3, 20, 15, true);
+#ifdef NO_FFTW_FLOAT
+    // (without single-precision FFTW, convolver5 uses double precision, and so
+    // shares convolver1's entry)
+    int  nEntries = nCached + 3;
+#else
+    int  nEntries = nCached + 4;
+#endif
+    TS_ASSERT_EQUALS( NumberOfCachedPsfTransforms(), nEntries );
+
+    convolver1->ConvolveImage(&image1[0]);
+    delete convolver1;
+    // entry still in use by convolver2
+    TS_ASSERT_EQUALS( NumberOfCachedPsfTransforms(), nEntries );
+    convolver2->ConvolveImage(&image2[0]);
+    for (int z = 0; z < 300; z++)
+      TS_ASSERT_EQUALS( image2[z], image1[z] );
+
+    delete convolver2;
+    delete convolver3;
+    delete convolver4;
+    delete convolver5;
+    TS_ASSERT_EQUALS( NumberOfCachedPsfTransforms(), nCached );
+  }
+};
@@ -9,7 +9,9 @@
 #include <cxxtest/TestSuite.h>
 
 #include <math.h>
+#include <stdio.h>
 #include <string>
+#include <vector>
 
 using namespace std;
 
@@ -199,3 +201,134 @@ public:
   }
   
 };
+
+
+// Straightforward (scalar) weighted block-averaging, for comparison with DownsampleImage
+void ReferenceDownsample( const double *inputImage, int nColumns_in, int x0_in, int y0_in,
+						double *outputImage, int nColumns_out, int x0_out, int y0_out,
+						int nBlockColumns, int nBlockRows, int scale, const double *weights )
+{
+  for (int i = 0; i < nBlockRows; i++) {
+    for (int j = 0; j < nBlockColumns; j++) {
+      double  sum = 0.0, weightSum = 0.0;
+      for (int ii = 0; ii < scale; ii++) {
+        for (int jj = 0; jj < scale; jj++) {
+          double  w = (weights == NULL) ? 1.0 : weights[ii]*weights[jj];
+          sum += w*inputImage[(y0_in + i*scale + ii)*nColumns_in + x0_in + j*scale + jj];
+          weightSum += w;
+        }
+      }
+      outputImage[(y0_out + i)*nColumns_out + x0_out + j] = sum/weightSum;
+    }
+  }
+}
+
+
+class TestDownsampleImage : public CxxTest::TestSuite 
+{
+public:
+
+  void FillImage( vector<double>& image )
+  {
+    for (size_t k = 0; k < image.size(); k++)
+      image[k] = 1.0 + (double)((k*37) % 101) + 0.01*(double)(k % 7);
+  }
+
+  void testMakeDownsampleWeights( void )
+  {
+    double  weights[4];
+    
+    TS_ASSERT_EQUALS( MakeDownsampleWeights(DOWNSAMPLE_BOX, 3, weights), 0 );
+    for (int k = 0; k < 3; k++)
+      TS_ASSERT_EQUALS( weights[k], 1.0 );
+    TS_ASSERT_EQUALS( MakeDownsampleWeights(DOWNSAMPLE_TRIANGLE, 3, weights), 0 );
+    TS_ASSERT_EQUALS( weights[0], 1.0 );
+    TS_ASSERT_EQUALS( weights[1], 3.0 );
+    TS_ASSERT_EQUALS( weights[2], 1.0 );
+    TS_ASSERT_EQUALS( MakeDownsampleWeights(DOWNSAMPLE_TRIANGLE, 4, weights), 0 );
+    TS_ASSERT_EQUALS( weights[0], 1.0 );
+    TS_ASSERT_EQUALS( weights[1], 3.0 );
+    TS_ASSERT_EQUALS( weights[2], 3.0 );
+    TS_ASSERT_EQUALS( weights[3], 1.0 );
+    TS_ASSERT_EQUALS( MakeDownsampleWeights(99, 3, weights), -1 );
+  }
+
+  // region which is wider than it is tall (and vice versa), copied into the
+  // main image with PSF padding in both images; pixels outside the region are
+  // left alone
+  void testNonSquareRegion( void )
+  {
+    int  nColsOsamp = 2*2 + 5*3, nRowsOsamp = 2*2 + 2*3;
+    vector<double>  osampImage(nColsOsamp*nRowsOsamp);
+    vector<double>  mainImage(12*10, -1.0), refMainImage(12*10, -1.0);
+    
+    FillImage(osampImage);
+    // 5 x 2 region, starting at x,y = 3,4 in data image (main image has 1-pixel padding)
+    DownsampleAndReplace(&osampImage[0], nColsOsamp,nRowsOsamp,2,2, &mainImage[0], 12,10,1,1,
+    					3,4, 3, 0);
+    ReferenceDownsample(&osampImage[0], nColsOsamp, 2, 2, &refMainImage[0], 12, 3, 4, 
+    					5, 2, 3, NULL);
+    for (int k = 0; k < 12*10; k++)
+      TS_ASSERT_DELTA(mainImage[k], refMainImage[k], DELTA);
+
+    // 2 x 5 region
+    nColsOsamp = 2*2 + 2*3;
+    nRowsOsamp = 2*2 + 5*3;
+    osampImage.resize(nColsOsamp*nRowsOsamp);
+    FillImage(osampImage);
+    mainImage.assign(12*10, -1.0);
+    refMainImage.assign(12*10, -1.0);
+    DownsampleAndReplace(&osampImage[0], nColsOsamp,nRowsOsamp,2,2, &mainImage[0], 12,10,1,1,
+    					3,4, 3, 0);
+    ReferenceDownsample(&osampImage[0], nColsOsamp, 2, 2, &refMainImage[0], 12, 3, 4, 
+    					2, 5, 3, NULL);
+    for (int k = 0; k < 12*10; k++)
+      TS_ASSERT_DELTA(mainImage[k], refMainImage[k], DELTA);
+  }
+
+  void testWeightedKernel( void )
+  {
+    vector<double>  inputImage(20*16), outputImage(5*4), refOutputImage(5*4);
+    double  weights[4];
+    
+    FillImage(inputImage);
+    MakeDownsampleWeights(DOWNSAMPLE_TRIANGLE, 4, weights);
+    DownsampleImage(&inputImage[0], 20, 0, 0, &outputImage[0], 5, 0, 0, 5, 4, 4, weights);
+    ReferenceDownsample(&inputImage[0], 20, 0, 0, &refOutputImage[0], 5, 0, 0, 5, 4, 4, weights);
+    for (int k = 0; k < 5*4; k++)
+      TS_ASSERT_DELTA(outputImage[k], refOutputImage[k], DELTA);
+
+    // constant image stays constant, whatever the weights
+    inputImage.assign(20*16, 2.5);
+    DownsampleImage(&inputImage[0], 20, 0, 0, &outputImage[0], 5, 0, 0, 5, 4, 4, weights);
+    for (int k = 0; k < 5*4; k++)
+      TS_ASSERT_DELTA(outputImage[k], 2.5, DELTA);
+  }
+
+  // DownsampleImage has special cases for oversampleScale = 2--5; check those and
+  // the general case, with box and triangle weights
+  void testAllScales( void )
+  {
+    double  weights[7];
+    
+    for (int scale = 1; scale <= 7; scale++) {
+      int  nColsIn = 7*scale + 2, nRowsIn = 5*scale + 2;   // (+ 1-pixel padding)
+      vector<double>  inputImage(nColsIn*nRowsIn), outputImage(7*5), refOutputImage(7*5);
+      FillImage(inputImage);
+      DownsampleImage(&inputImage[0], nColsIn, 1, 1, &outputImage[0], 7, 0, 0, 7, 5, 
+      				scale, NULL);
+      ReferenceDownsample(&inputImage[0], nColsIn, 1, 1, &refOutputImage[0], 7, 0, 0, 7, 5,
+      				scale, NULL);
+      for (int k = 0; k < 7*5; k++)
+        TS_ASSERT_DELTA(outputImage[k], refOutputImage[k], DELTA);
+
+      MakeDownsampleWeights(DOWNSAMPLE_TRIANGLE, scale, weights);
+      DownsampleImage(&inputImage[0], nColsIn, 1, 1, &outputImage[0], 7, 0, 0, 7, 5, 
+      				scale, weights);
+      ReferenceDownsample(&inputImage[0], nColsIn, 1, 1, &refOutputImage[0], 7, 0, 0, 7, 5,
+      				scale, weights);
+      for (int k = 0; k < 7*5; k++)
+        TS_ASSERT_DELTA(outputImage[k], refOutputImage[k], DELTA);
+    }
+  }
+};
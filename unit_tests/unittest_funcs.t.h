@@ -30,6 +30,9 @@ using namespace std;
 #include "function_objects/func_broken-exp2d.h"
 #include "function_objects/func_edge-on-disk.h"
 #include "function_objects/func_double-broken-exp.h"
+#include "function_objects/radial_profile_table.h"
+#include "function_objects/pixel_integration.h"
+#include "function_objects/simd_kernels.h"
 //#include "function_objects/func_spline-profile.h"
 
 const double  DELTA = 1.0e-9;
@@ -271,6 +274,29 @@ public:
 
   }
 
+  void testTabulatedProfile( void )
+  {
+    // tabulated profile (including subsampled pixels near the center) should
+    // match direct calculation to within the table's relative tolerance
+    double  x0 = 10.0;
+    double  y0 = 10.0;
+    double  params[4] = {20.0, 0.3, 1.0, 3.0};
+    
+    Exponential  *directFunc = new Exponential();
+    Exponential  *tabulatedFunc = new Exponential();
+    tabulatedFunc->SetProfileTabulation(true);
+    directFunc->Setup(params, 0, x0, y0);
+    tabulatedFunc->Setup(params, 0, x0, y0);
+    for (int i = 0; i < 100; i++) {
+      double  x = x0 - 3.0 + 0.5*i;
+      double  y = y0 + 0.25*i;
+      double  correctVal = directFunc->GetValue(x, y);
+      TS_ASSERT_DELTA( tabulatedFunc->GetValue(x, y), correctVal, 1.0e-7*correctVal );
+    }
+    delete directFunc;
+    delete tabulatedFunc;
+  }
+
   void testCanCalculateTotalFlux( void )
   {
     bool result = thisFunc->CanCalculateTotalFlux();
@@ -376,6 +402,94 @@ public:
 
   }
 
+  void testGetValues( void )
+  {
+    // batch evaluation of a row should match pixel-by-pixel evaluation,
+    // including subsampled pixels near the center (exactly, if the scalar
+    // kernels are used)
+    double  x0 = 10.0;
+    double  y0 = 10.0;
+    double  params[5] = {30.0, 0.4, 2.0, 1.0, 5.0};
+    double  xVals[20], yVals[20], outVals[20];
+    SimdLevel  originalLevel = GetSimdLevel();
+    
+    Sersic  *subsampledFunc = new Sersic();
+    subsampledFunc->Setup(params, 0, x0, y0);
+    for (int i = 0; i < 20; i++) {
+      xVals[i] = 1.0 + i;
+      yVals[i] = 11.0;
+    }
+    SetSimdLevel(SIMD_SCALAR);
+    subsampledFunc->GetValues(xVals, yVals, outVals, 20);
+    for (int i = 0; i < 20; i++)
+      TS_ASSERT_EQUALS( outVals[i], subsampledFunc->GetValue(xVals[i], yVals[i]) );
+
+    // vectorized kernels (if available) should agree to within a few ulp
+    SetSimdLevel(DetectSimdLevel());
+    subsampledFunc->GetValues(xVals, yVals, outVals, 20);
+    for (int i = 0; i < 20; i++) {
+      double  correctVal = subsampledFunc->GetValue(xVals[i], yVals[i]);
+      TS_ASSERT_DELTA( outVals[i], correctVal, 1.0e-14*correctVal );
+    }
+    SetSimdLevel(originalLevel);
+    delete subsampledFunc;
+  }
+
+  void testTabulatedProfile( void )
+  {
+    // values from tabulated profile should match direct calculation to within
+    // the table's relative tolerance (1e-7), for a range of n values
+    double  x0 = 10.0;
+    double  y0 = 10.0;
+    double  nVals[4] = {0.5, 1.0, 4.0, 10.0};
+    
+    Sersic  *tabulatedFunc = new Sersic();
+    tabulatedFunc->SetSubsampling(false);
+    tabulatedFunc->SetProfileTabulation(true);
+    for (int k = 0; k < 4; k++) {
+      double  params[5] = {30.0, 0.4, nVals[k], 1.0, 5.0};
+      thisFunc->Setup(params, 0, x0, y0);
+      tabulatedFunc->Setup(params, 0, x0, y0);
+      for (int i = 0; i < 200; i++) {
+        double  x = x0 + 0.01 + 0.37*i;
+        double  y = y0 - 0.23*i;
+        double  correctVal = thisFunc->GetValue(x, y);
+        TS_ASSERT_DELTA( tabulatedFunc->GetValue(x, y), correctVal, 1.0e-7*correctVal );
+      }
+    }
+    delete tabulatedFunc;
+  }
+
+  void testAdaptiveSubsampling( void )
+  {
+    // adaptive integration of central pixels should match brute-force averaging
+    // over a fine (1000x1000) grid of points within each pixel
+    double  x0 = 10.3;
+    double  y0 = 9.8;
+    double  params[5] = {30.0, 0.4, 2.0, 1.0, 0.8};
+    int  nSub = 1000;
+    
+    Sersic  *adaptiveFunc = new Sersic();
+    adaptiveFunc->SetAdaptiveSubsampling(true);
+    adaptiveFunc->Setup(params, 0, x0, y0);
+    thisFunc->SetSubsampling(false);
+    thisFunc->Setup(params, 0, x0, y0);
+    for (int k = 0; k < 2; k++) {
+      double  x = 10.0 + k;
+      double  y = 10.0;
+      double  bruteSum = 0.0;
+      for (int i = 0; i < nSub; i++) {
+        double  yy = y - 0.5 + (i + 0.5)/nSub;
+        for (int j = 0; j < nSub; j++)
+          bruteSum += thisFunc->GetValue(x - 0.5 + (j + 0.5)/nSub, yy);
+      }
+      double  correctVal = bruteSum/(nSub*nSub);
+      TS_ASSERT_DELTA( adaptiveFunc->GetValue(x, y), correctVal, 1.0e-5*correctVal );
+    }
+    thisFunc->SetSubsampling(true);
+    delete adaptiveFunc;
+  }
+
   void testCanCalculateTotalFlux( void )
   {
     bool result = thisFunc->CanCalculateTotalFlux();
@@ -437,6 +551,107 @@ public:
 
 
 
+// Adaptive pixel integration
+
+double QuadraticSurface( double x, double y, void *unused )
+{
+  return 1.0 + 2.0*x + 3.0*x*y + 0.5*y*y;
+}
+
+double ConeSurface( double x, double y, void *unused )
+{
+  return 10.0 - sqrt(x*x + y*y);
+}
+
+class TestPixelIntegration : public CxxTest::TestSuite 
+{
+public:
+  void testSmoothFunction( void )
+  {
+    // low-order polynomials are integrated exactly by Gauss-Legendre quadrature
+    // mean over pixel centered at (1,2): 1 + 2*1 + 3*1*2 + 0.5*(4 + 1/12)
+    double  correctVal = 9.0 + 0.5*(4.0 + 1.0/12.0);
+    TS_ASSERT_DELTA( IntegratePixel(QuadraticSurface, NULL, 1.0, 2.0, 1.0, 2.0), 
+    				correctVal, 1.0e-12 );
+    TS_ASSERT_DELTA( IntegratePixel(QuadraticSurface, NULL, 1.0, 2.0, 5.0, 5.0), 
+    				correctVal, 1.0e-12 );
+  }
+
+  void testCusp( void )
+  {
+    // function with cusp at pixel center: mean of r over unit square is
+    // (sqrt(2) + asinh(1))/6
+    double  correctVal = 10.0 - (sqrt(2.0) + asinh(1.0))/6.0;
+    TS_ASSERT_DELTA( IntegratePixel(ConeSurface, NULL, 0.0, 0.0, 0.0, 0.0), 
+    				correctVal, 1.0e-7 );
+  }
+};
+
+
+
+// Lookup tables for radial profiles
+
+double ExpProfile( double r, void *scaleLength )
+{
+  return 100.0*exp(-r/(*(double *)scaleLength));
+}
+
+class TestRadialProfileTable : public CxxTest::TestSuite 
+{
+public:
+  void testBuildAndLookup( void )
+  {
+    RadialProfileTable  table;
+    double  h = 2.0;
+    double  rMin, rMax, value;
+    
+    int  nOctaves = table.Build(ExpProfile, &h, h);
+    TS_ASSERT( nOctaves > 0 );
+    table.GetRange(rMin, rMax);
+    TS_ASSERT_DELTA( rMin, 1.0e-3*h, 1.0e-15 );
+    TS_ASSERT_DELTA( rMax, rMin*ldexp(1.0, nOctaves), 1.0e-9 );
+    
+    // outside the table
+    TS_ASSERT_EQUALS( table.Lookup(0.5*rMin, &value), false );
+    TS_ASSERT_EQUALS( table.Lookup(0.0, &value), false );
+    TS_ASSERT_EQUALS( table.Lookup(rMax, &value), false );
+    
+    // inside the table, including octave boundaries
+    for (int i = 0; i < 1000; i++) {
+      double  r = rMin*pow(rMax/rMin, i/1000.0);
+      double  correctVal = ExpProfile(r, &h);
+      TS_ASSERT_EQUALS( table.Lookup(r, &value), true );
+      TS_ASSERT_DELTA( value, correctVal, 1.0e-7*correctVal );
+    }
+  }
+
+  void testRebuild( void )
+  {
+    RadialProfileTable  table;
+    double  h1 = 2.0;
+    double  h2 = 20.0;
+    double  value;
+    
+    table.Build(ExpProfile, &h1, h1);
+    table.Build(ExpProfile, &h2, h2);
+    TS_ASSERT_EQUALS( table.Lookup(30.0, &value), true );
+    TS_ASSERT_DELTA( value, ExpProfile(30.0, &h2), 1.0e-7*ExpProfile(30.0, &h2) );
+  }
+
+  void testBadProfile( void )
+  {
+    // an invalid scale (e.g., r_e = 0) should produce an empty table
+    RadialProfileTable  table;
+    double  h = 2.0;
+    double  value;
+    
+    TS_ASSERT_EQUALS( table.Build(ExpProfile, &h, 0.0), 0 );
+    TS_ASSERT_EQUALS( table.Lookup(1.0, &value), false );
+  }
+};
+
+
+
 class TestGaussian : public CxxTest::TestSuite 
 {
   FunctionObject  *thisFunc, *thisFunc_subsampled;
@@ -1286,6 +1501,73 @@ public:
     TS_ASSERT_EQUALS( thisFunc->IsPointSource(), true );
   }
 
+  void testGetFootprint( void )
+  {
+    // 3x5 PSF image --> nonzero for |x - x0| <= 1, |y - y0| <= 2
+    double  psfPixels[15] = {0.0, 0.0, 0.0,  0.0, 0.5, 0.0,  0.5, 1.0, 0.5,
+    						0.0, 0.5, 0.0,  0.0, 0.0, 0.0};
+    double  params[1] = {1.0};
+    double  xMin, xMax, yMin, yMax;
+    PsfInterpolator  *psfInterp = new PsfInterpolator_bicubic(psfPixels, 3, 5);
+    
+    // base class has no footprint
+    FunctionObject  *flatSky = new FlatSky();
+    TS_ASSERT_EQUALS( flatSky->GetFootprint(xMin, xMax, yMin, yMax), false );
+    delete flatSky;
+    
+    thisFunc->AddPsfInterpolator(psfInterp);
+    thisFunc->Setup(params, 0, 10.5, 20.0);
+    TS_ASSERT_EQUALS( thisFunc->GetFootprint(xMin, xMax, yMin, yMax), true );
+    TS_ASSERT_DELTA( xMin, 9.5, DELTA );
+    TS_ASSERT_DELTA( xMax, 11.5, DELTA );
+    TS_ASSERT_DELTA( yMin, 18.0, DELTA );
+    TS_ASSERT_DELTA( yMax, 22.0, DELTA );
+    // function is zero just outside the footprint
+    TS_ASSERT_EQUALS( thisFunc->GetValue(xMin - 0.01, 20.0), 0.0 );
+    TS_ASSERT_EQUALS( thisFunc->GetValue(10.5, yMax + 0.01), 0.0 );
+    delete psfInterp;
+  }
+
+  // GetValues uses a precomputed shifted PSF stamp for integer pixel coordinates
+  // (when the interpolator supports it); results should match GetValue
+  void testGetValues_shiftedStamp( void )
+  {
+    double  psfPixels[25] = {0.0, 0.1, 0.2, 0.1, 0.0,  0.1, 0.4, 0.7, 0.4, 0.1,
+    						0.2, 0.7, 1.0, 0.7, 0.2,  0.1, 0.4, 0.7, 0.4, 0.1,
+    						0.0, 0.1, 0.2, 0.1, 0.0};
+    double  params[1] = {2.5};
+    double  xVals[12], yVals[12], outVals[12];
+    PsfInterpolator  *psfInterp = new PsfInterpolator_lanczos2(psfPixels, 5, 5);
+    PsfInterpolator  *psfInterp2 = new PsfInterpolator_bicubic(psfPixels, 5, 5);
+    
+    thisFunc->AddPsfInterpolator(psfInterp);
+    thisFunc->Setup(params, 0, 10.3, 20.6);
+    for (int i = 15; i <= 26; i++) {
+      double  y = (double)i;
+      for (int j = 0; j < 12; j++) {
+        xVals[j] = (double)(j + 5);
+        yVals[j] = y;
+      }
+      // one non-integer position, which must be interpolated directly
+      xVals[11] = 10.75;
+      thisFunc->GetValues(xVals, yVals, outVals, 12);
+      for (int j = 0; j < 12; j++)
+        TS_ASSERT_DELTA( outVals[j], thisFunc->GetValue(xVals[j], yVals[j]), 1.0e-12 );
+    }
+    
+    // switching to an interpolator without stamp support
+    thisFunc->AddPsfInterpolator(psfInterp2);
+    for (int j = 0; j < 12; j++) {
+      xVals[j] = (double)(j + 5);
+      yVals[j] = 21.0;
+    }
+    thisFunc->GetValues(xVals, yVals, outVals, 12);
+    for (int j = 0; j < 12; j++)
+      TS_ASSERT_DELTA( outVals[j], thisFunc->GetValue(xVals[j], yVals[j]), 1.0e-12 );
+    delete psfInterp;
+    delete psfInterp2;
+  }
+
   void testCanCalculateTotalFlux( void )
   {
     bool result = thisFunc->CanCalculateTotalFlux();
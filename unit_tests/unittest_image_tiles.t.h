@@ -0,0 +1,227 @@
+// Unit tests for tiled computation of model images (image_tiles.cpp)
+//
+
+// See run_unittest_image_tiles.sh for how to compile and run these tests.
+
+
+#include <cxxtest/TestSuite.h>
+
+#include <math.h>
+#include <vector>
+using namespace std;
+
+#include "image_tiles.h"
+#include "function_objects/function_object.h"
+#include "function_objects/func_gaussian.h"
+#include "function_objects/func_sersic.h"
+#include "function_objects/func_flatsky.h"
+
+
+class TestImageTiles : public CxxTest::TestSuite
+{
+  vector<FunctionObject *>  functionObjects;
+
+public:
+  // Sersic (centered at x,y = 150.2,40.7) + Gaussian + FlatSky
+  void setUp()
+  {
+    double  params[] = {10.0, 0.3, 2.5, 50.0, 8.0,   40.0, 0.1, 100.0, 5.0,   2.0};
+    functionObjects.push_back(new Sersic());
+    functionObjects.push_back(new Gaussian());
+    functionObjects.push_back(new FlatSky());
+    for (int n = 0; n < 3; n++)
+      functionObjects[n]->SetSubsampling(true);
+    functionObjects[0]->Setup(params, 0, 150.2, 40.7);
+    functionObjects[1]->Setup(params, 5, 150.2, 40.7);
+    functionObjects[2]->Setup(params, 9, 150.2, 40.7);
+  }
+
+  void tearDown()
+  {
+    for (int n = 0; n < 3; n++)
+      delete functionObjects[n];
+    functionObjects.clear();
+  }
+
+  void SetupCoordinates( int nColumns, int nRows, vector<double>& xVals, vector<double>& yVals )
+  {
+    xVals.resize(nColumns);
+    yVals.resize(nRows);
+    for (int j = 0; j < nColumns; j++)
+      xVals[j] = (double)(j + 1);
+    for (int i = 0; i < nRows; i++)
+      yVals[i] = (double)(i + 1);
+  }
+
+  // Reference image: one GetValues() call per function and row, Kahan summation
+  void ComputeRowByRow( int nColumns, int nRows, vector<double>& xVals,
+  						vector<double>& yVals, vector<double>& image )
+  {
+    vector<double>  yRow(nColumns), newVals(nColumns), storedErrors(nColumns);
+    double  adjVal, tempSum;
+    double  *imageRow;
+
+    image.assign((long)nColumns*nRows, 0.0);
+    for (int i = 0; i < nRows; i++) {
+      imageRow = &image[(long)i*nColumns];
+      for (int j = 0; j < nColumns; j++) {
+        yRow[j] = yVals[i];
+        storedErrors[j] = 0.0;
+      }
+      for (int n = 0; n < 3; n++) {
+        functionObjects[n]->GetValues(&xVals[0], &yRow[0], &newVals[0], nColumns);
+        for (int j = 0; j < nColumns; j++) {
+          adjVal = newVals[j] - storedErrors[j];
+          tempSum = imageRow[j] + adjVal;
+          storedErrors[j] = (tempSum - imageRow[j]) - adjVal;
+          imageRow[j] = tempSum;
+        }
+      }
+    }
+  }
+
+
+  void testTilesCoverImage( void )
+  {
+    int  nColumns = 700, nRows = 301;
+    vector<ImageTile>  tiles;
+    vector<int>  timesCovered((long)nColumns*nRows, 0);
+
+    MakeImageTiles(nColumns, nRows, tiles);
+    TS_ASSERT( tiles.size() > 1 );
+    for (int k = 0; k < (int)tiles.size(); k++) {
+      TS_ASSERT( tiles[k].col2 - tiles[k].col1 <= 256 );
+      for (int i = tiles[k].row1; i < tiles[k].row2; i++)
+        for (int j = tiles[k].col1; j < tiles[k].col2; j++)
+          timesCovered[(long)i*nColumns + j] += 1;
+    }
+    for (long z = 0; z < (long)nColumns*nRows; z++)
+      TS_ASSERT_EQUALS( timesCovered[z], 1 );
+  }
+
+  void testTilesOrderedByCost( void )
+  {
+    int  nColumns = 700, nRows = 301;
+    vector<ImageTile>  tiles;
+    vector<int>  tileOrder;
+    vector<double>  xVals, yVals;
+
+    SetupCoordinates(nColumns, nRows, xVals, yVals);
+    MakeImageTiles(nColumns, nRows, tiles);
+    OrderTilesByCost(tiles, &xVals[0], &yVals[0], functionObjects, 3, tileOrder);
+    TS_ASSERT_EQUALS( tileOrder.size(), tiles.size() );
+    // most expensive tile is the one containing the Sersic center (subsampling)
+    const ImageTile&  firstTile = tiles[tileOrder[0]];
+    TS_ASSERT( (xVals[firstTile.col1] <= 150.2) && (xVals[firstTile.col2 - 1] >= 150.2) );
+    TS_ASSERT( (yVals[firstTile.row1] <= 40.7) && (yVals[firstTile.row2 - 1] >= 40.7) );
+  }
+
+  void testTiledImageMatchesRowByRow( void )
+  {
+    int  nColumns = 700, nRows = 81;
+    vector<ImageTile>  tiles;
+    vector<int>  tileOrder;
+    vector<double>  xVals, yVals, image_ref;
+    vector<double>  image((long)nColumns*nRows, -1.0);
+
+    SetupCoordinates(nColumns, nRows, xVals, yVals);
+    ComputeRowByRow(nColumns, nRows, xVals, yVals, image_ref);
+    MakeImageTiles(nColumns, nRows, tiles);
+    OrderTilesByCost(tiles, &xVals[0], &yVals[0], functionObjects, 3, tileOrder);
+    ComputeTiledImage(&image[0], nColumns, tiles, tileOrder, &xVals[0], &yVals[0],
+    					functionObjects, 3);
+    for (long z = 0; z < (long)nColumns*nRows; z++)
+      TS_ASSERT_EQUALS( image[z], image_ref[z] );
+  }
+
+  void testTiledImageWithSpans( void )
+  {
+    int  nColumns = 700, nRows = 81;
+    vector<ImageTile>  tiles;
+    vector<int>  tileOrder;
+    vector<double>  xVals, yVals, image_ref;
+    vector<double>  image((long)nColumns*nRows, -1.0);
+    vector<long>  spanRowIndex(nRows + 1);
+    vector<int>  spanStartCols, spanEndCols;
+    vector<bool>  active((long)nColumns*nRows, false);
+
+    // two runs of pixels per row, one of which crosses tile boundaries
+    for (int i = 0; i < nRows; i++) {
+      spanRowIndex[i] = (long)spanStartCols.size();
+      spanStartCols.push_back(i);
+      spanEndCols.push_back(i + 10);
+      spanStartCols.push_back(200 + i);
+      spanEndCols.push_back(600 - i);
+      for (int j = i; j < i + 10; j++)
+        active[(long)i*nColumns + j] = true;
+      for (int j = 200 + i; j < 600 - i; j++)
+        active[(long)i*nColumns + j] = true;
+    }
+    spanRowIndex[nRows] = (long)spanStartCols.size();
+
+    SetupCoordinates(nColumns, nRows, xVals, yVals);
+    ComputeRowByRow(nColumns, nRows, xVals, yVals, image_ref);
+    MakeImageTiles(nColumns, nRows, tiles);
+    OrderTilesByCost(tiles, &xVals[0], &yVals[0], functionObjects, 3, tileOrder);
+    ComputeTiledImage(&image[0], nColumns, tiles, tileOrder, &xVals[0], &yVals[0],
+    					functionObjects, 3, &spanRowIndex[0], &spanStartCols[0], &spanEndCols[0]);
+    for (long z = 0; z < (long)nColumns*nRows; z++) {
+      if (active[z])
+        TS_ASSERT_EQUALS( image[z], image_ref[z] );
+      else
+        TS_ASSERT_EQUALS( image[z], 0.0 );
+    }
+  }
+
+  void testSumTiledFunction( void )
+  {
+    int  nColumns = 300, nRows = 120;
+    vector<ImageTile>  tiles;
+    vector<int>  tileOrder;
+    vector<double>  xVals, yVals, yRow(nColumns), newVals(nColumns);
+    double  directSum = 0.0;
+
+    SetupCoordinates(nColumns, nRows, xVals, yVals);
+    for (int i = 0; i < nRows; i++) {
+      for (int j = 0; j < nColumns; j++)
+        yRow[j] = yVals[i];
+      functionObjects[1]->GetValues(&xVals[0], &yRow[0], &newVals[0], nColumns);
+      for (int j = 0; j < nColumns; j++)
+        directSum += newVals[j];
+    }
+    MakeImageTiles(nColumns, nRows, tiles);
+    OrderTilesByCost(tiles, &xVals[0], &yVals[0], functionObjects, 3, tileOrder);
+    double  tiledSum = SumTiledFunction(tiles, tileOrder, &xVals[0], &yVals[0], functionObjects[1]);
+    TS_ASSERT_DELTA( tiledSum, directSum, 1.0e-12*directSum );
+  }
+
+  void testScheduleWorkItems( void )
+  {
+    double  costValues[6] = {10.0, 400.0, 30.0, 10.0, 50.0, 20.0};
+    vector<double>  costs(costValues, costValues + 6);
+    vector<int>  largeItems, smallItems;
+
+    // total = 520: with 4 threads, only item 1 (>= 130) is large; the rest are
+    // sorted by decreasing cost (equal costs in original order)
+    ScheduleWorkItems(costs, 4, largeItems, smallItems);
+    TS_ASSERT_EQUALS( largeItems.size(), 1 );
+    TS_ASSERT_EQUALS( largeItems[0], 1 );
+    TS_ASSERT_EQUALS( smallItems.size(), 5 );
+    int  expectedOrder[5] = {4, 2, 5, 0, 3};
+    for (int k = 0; k < 5; k++)
+      TS_ASSERT_EQUALS( smallItems[k], expectedOrder[k] );
+
+    // one thread: everything is done one at a time, in the original order
+    ScheduleWorkItems(costs, 1, largeItems, smallItems);
+    TS_ASSERT_EQUALS( largeItems.size(), 6 );
+    TS_ASSERT_EQUALS( smallItems.size(), 0 );
+    for (int k = 0; k < 6; k++)
+      TS_ASSERT_EQUALS( largeItems[k], k );
+
+    // equal costs: all small
+    vector<double>  equalCosts(8, 1.0);
+    ScheduleWorkItems(equalCosts, 4, largeItems, smallItems);
+    TS_ASSERT_EQUALS( largeItems.size(), 0 );
+    TS_ASSERT_EQUALS( smallItems.size(), 8 );
+  }
+};
@@ -19,6 +19,10 @@
 #include <vector>
 #include <stdlib.h>
 #include <math.h>
+#include <strings.h>
+#include <float.h>
+#include <stdint.h>
+#include <unistd.h>
 using namespace std;
 #include "definitions.h"
 #include "function_objects/function_object.h"
@@ -26,6 +30,9 @@ using namespace std;
 #include "add_functions.h"
 #include "config_file_parser.h"
 #include "param_struct.h"
+#include "image_io.h"
+#include "mpfit.h"
+#include "fftw_wisdom.h"
 
 
 #define SIMPLE_CONFIG_FILE "tests/imfit_reference/config_imfit_flatsky.dat"
@@ -39,6 +46,119 @@ const string CONFIG_FILE_2BLOCKS("tests/config_imfit_2blocks.dat");
 const string  headerLine_correct = "# X0_1		Y0_1		PA_1	ell_1	I_0_1	h_1	I_sky_2	";
 
 
+// Parameters for the Gaussian + Exponential, FlatSky test model (see MakeTestModel):
+// X0, Y0, Gaussian (PA, ell, I_0, sigma), Exponential (PA, ell, I_0, h),
+// X0, Y0, FlatSky (I_sky)
+double  testParams_GaussExp[13] = {10.2, 7.6, 20.0, 0.2, 100.0, 2.0, 50.0, 0.4, 30.0, 4.0,
+									1.0, 1.0, 5.0};
+// Same, for the Gaussian + PointSource, FlatSky test model:
+// X0, Y0, Gaussian (PA, ell, I_0, sigma), PointSource (I_tot), X0, Y0, FlatSky (I_sky)
+double  testParams_GaussPointSource[10] = {10.2, 7.6, 20.0, 0.2, 100.0, 2.0, 500.0, 1.0, 1.0, 5.0};
+
+
+// Options for MakeTestModel; the defaults give a Gaussian + Exponential, FlatSky
+// model image with no PSF
+class TestModelOptions
+{
+  public:
+    TestModelOptions( )
+    {
+      withPointSource = false;
+      psfPixels = NULL;
+      nColumns_psf = nRows_psf = 0;
+      dataPixels = NULL;
+      maskPixels = NULL;
+      osampleInfo = NULL;
+      singlePrecision = false;
+      componentCache = false;
+      wisdomFile = "";
+      convolutionMethod = CONVOLUTION_AUTO;
+      croppedConvolution = true;
+      fftTileSize = 0;
+    };
+
+    bool  withPointSource;   // Gaussian + PointSource instead of Gaussian + Exponential
+    double  *psfPixels;   // PSF image (nColumns_psf x nRows_psf); NULL = no PSF
+    int  nColumns_psf, nRows_psf;
+    double  *dataPixels;   // 20x15 data image for fitting; NULL = model image only
+    double  *maskPixels;   // 20x15 mask image (used only with dataPixels); NULL = no mask
+    PsfOversamplingInfo  *osampleInfo;   // NULL = no oversampled region
+    bool  singlePrecision;
+    bool  componentCache;
+    string  wisdomFile;   // "" = no FFTW wisdom file
+    int  convolutionMethod;
+    bool  croppedConvolution;
+    int  fftTileSize;
+};
+
+
+// Sets up a 20x15 model with two function blocks (Gaussian + Exponential or
+// PointSource, FlatSky), as specified by options
+ModelObject * MakeTestModel( const TestModelOptions& options )
+{
+  vector<string>  functionList;
+  vector<int>  functionBlockIndices;
+  
+  functionList.push_back("Gaussian");
+  if (options.withPointSource)
+    functionList.push_back("PointSource");
+  else
+    functionList.push_back("Exponential");
+  functionList.push_back("FlatSky");
+  functionBlockIndices.push_back(0);
+  functionBlockIndices.push_back(2);
+
+  ModelObject *theModel = new ModelObject();
+  if (options.wisdomFile.size() > 0)
+    theModel->SetFFTWWisdomFile(options.wisdomFile);
+  theModel->SetConvolutionMethod(options.convolutionMethod);
+  theModel->SetCroppedConvolution(options.croppedConvolution);
+  theModel->SetFFTTileSize(options.fftTileSize);
+  if (options.singlePrecision)
+    theModel->SetSinglePrecision(true);
+  // (PointSource functions need the PSF before they're added)
+  if (options.psfPixels != NULL)
+    theModel->AddPSFVector(options.nColumns_psf*options.nRows_psf, options.nColumns_psf, 
+    						options.nRows_psf, options.psfPixels);
+  AddFunctions(theModel, functionList, functionBlockIndices, true, -1);
+  if (options.dataPixels != NULL) {
+    theModel->AddImageDataVector(options.dataPixels, 20, 15);
+    if (options.osampleInfo != NULL)
+      theModel->AddOversampledPsfInfo(options.osampleInfo);
+    if (options.maskPixels != NULL)
+      theModel->AddMaskVector(20*15, 20, 15, options.maskPixels, MASK_ZERO_IS_GOOD);
+    theModel->FinalSetupForFitting();
+  }
+  else {
+    theModel->SetupModelImage(20, 15);
+    if (options.osampleInfo != NULL)
+      theModel->AddOversampledPsfInfo(options.osampleInfo);
+  }
+  if (options.componentCache)
+    theModel->UseComponentCache();
+  return theModel;
+}
+
+// 5x5 Gaussian PSF (sigma = 1 pixel)
+void MakeGaussianPSF( double *psfPixels )
+{
+  for (int i = 0; i < 25; i++)
+    psfPixels[i] = exp(-0.5*((i/5 - 2)*(i/5 - 2) + (i%5 - 2)*(i%5 - 2)));
+}
+
+// Oversampled region (3x; by default covering the point source of the Gaussian +
+// PointSource model), using a copy of the 5x5 psfPixels
+PsfOversamplingInfo * MakeOversamplingInfo( const double *psfPixels,
+											const char *region="8:13,5:10" )
+{
+  double *psfPixels_osamp = (double *)malloc(25*sizeof(double));   // freed by PsfOversamplingInfo
+  for (int i = 0; i < 25; i++)
+    psfPixels_osamp[i] = psfPixels[i];
+  return new PsfOversamplingInfo(psfPixels_osamp, 5, 5, 3, region);
+}
+
+
+
 class NewTestSuite : public CxxTest::TestSuite
 {
 public:
@@ -319,6 +439,27 @@ public:
   }
 
 
+   void testRepeatedSetupMemoryUse( void )
+  {
+    // Setting up the model image a second time should reuse (not leak) memory
+    double params[3] = {26.0, 26.0, 100.0};   // X0, Y0, I_sky
+    int  nCols = 300, nRows = 200;
+    long  nBytesModel = (long)nCols*nRows*sizeof(double);
+
+    modelObj3c->SetupModelImage(nCols, nRows);
+    long  nBytes1 = modelObj3c->GetMemoryUse();
+    TS_ASSERT( nBytes1 >= nBytesModel );
+    modelObj3c->SetupModelImage(nCols, nRows);
+    TS_ASSERT_EQUALS( modelObj3c->GetMemoryUse(), nBytes1 );
+
+    modelObj3c->CreateModelImage(params);
+    double *outputModelVect = modelObj3c->GetModelImageVector();
+    TS_ASSERT_EQUALS( (uintptr_t)outputModelVect % ARENA_ALIGNMENT, (uintptr_t)0 );
+    for (long z = 0; z < (long)nCols*nRows; z++)
+      TS_ASSERT_EQUALS(outputModelVect[z], 100.0);
+  }
+
+
    void testResidualImageGeneration( void )
   {
     // Simple model image: 4x4 pixels, FlatSky function with I_sky = 100.0
@@ -1019,4 +1160,646 @@ public:
     delete osampleInfo_ptr;
   }
 };
-  
+
+
+class TestComponentCache : public CxxTest::TestSuite
+{
+public:
+
+  void CompareModels( bool usePSF, int convolutionMethod=CONVOLUTION_AUTO )
+  {
+    double  psfPixels[9] = {0.0, 0.5, 0.0, 0.5, 1.0, 0.5, 0.0, 0.5, 0.0};
+    double  *params = testParams_GaussExp;
+    double  newParams[13];
+    double  *model_ref, *model_cached;
+    TestModelOptions  options;
+    options.convolutionMethod = convolutionMethod;
+    if (usePSF) {
+      options.psfPixels = psfPixels;
+      options.nColumns_psf = options.nRows_psf = 3;
+    }
+    ModelObject *modelObj_ref = MakeTestModel(options);
+    options.componentCache = true;
+    ModelObject *modelObj_cached = MakeTestModel(options);
+    long  nPixels = modelObj_ref->GetNDataValues();
+
+    // initial model, then perturb each parameter in turn (as for a Jacobian),
+    // then go back to the original parameters
+    for (int k = -1; k <= 13; k++) {
+      for (int i = 0; i < 13; i++)
+        newParams[i] = params[i];
+      if ((k >= 0) && (k < 13))
+        newParams[k] += 0.01;
+      modelObj_ref->CreateModelImage(newParams);
+      modelObj_cached->CreateModelImage(newParams);
+      model_ref = modelObj_ref->GetModelImageVector();
+      model_cached = modelObj_cached->GetModelImageVector();
+      for (long z = 0; z < nPixels; z++)
+        TS_ASSERT_DELTA(model_cached[z], model_ref[z], 1.0e-10*fabs(model_ref[z]));
+    }
+    delete modelObj_ref;
+    delete modelObj_cached;
+  }
+
+  void testCachedModel_noPSF( void )
+  {
+    CompareModels(false);
+  }
+
+  void testCachedModel_withPSF( void )
+  {
+    CompareModels(true);
+  }
+
+  // with FFT convolution, component images which change together are convolved
+  // with batched FFTs (Convolver::ConvolveImages)
+  void testCachedModel_withFFTPSF( void )
+  {
+    CompareModels(true, CONVOLUTION_FFT);
+  }
+
+  // turning the cache on after a single-precision model image has been computed:
+  // cached model images (including PointSource images) are double-precision
+  void testCachedModel_afterSinglePrecision( void )
+  {
+    double  psfPixels[25];
+    double  *params = testParams_GaussPointSource;
+    TestModelOptions  options;
+    MakeGaussianPSF(psfPixels);
+    options.withPointSource = true;
+    options.psfPixels = psfPixels;
+    options.nColumns_psf = options.nRows_psf = 5;
+    ModelObject *modelObj_ref = MakeTestModel(options);
+    options.singlePrecision = true;
+    ModelObject *modelObj_cached = MakeTestModel(options);
+    long  nPixels = modelObj_ref->GetNDataValues();
+
+    modelObj_cached->CreateModelImage(params);
+    modelObj_cached->UseComponentCache();
+    modelObj_cached->CreateModelImage(params);
+    modelObj_ref->CreateModelImage(params);
+    double  *model_ref = modelObj_ref->GetModelImageVector();
+    double  *model_cached = modelObj_cached->GetModelImageVector();
+    for (long z = 0; z < nPixels; z++)
+      TS_ASSERT_DELTA(model_cached[z], model_ref[z], 1.0e-10*fabs(model_ref[z]));
+    delete modelObj_ref;
+    delete modelObj_cached;
+  }
+};
+
+
+class TestMaskedPixels : public CxxTest::TestSuite
+{
+public:
+
+  // Gaussian + Exponential, FlatSky, on a 20x15 data image (no PSF), with
+  // maskPixels applied if useMask is true
+  ModelObject * MakeModel( double *dataPixels, double *maskPixels, bool useMask )
+  {
+    TestModelOptions  options;
+    options.dataPixels = dataPixels;
+    if (useMask)
+      options.maskPixels = maskPixels;
+    return MakeTestModel(options);
+  }
+
+  void testMaskedPixelsSkipped( void )
+  {
+    double  dataPixels[300], maskPixels[300], badPixel[300];
+    double  deviates_ref[300], deviates_masked[300];
+    double  *params = testParams_GaussExp;
+    double  *model_ref, *model_masked, *resid_masked;
+    long  z;
+    
+    for (z = 0; z < 300; z++) {
+      dataPixels[z] = 10.0 + (double)(z % 7);
+      // mask rows 4--8 in columns 3--12, plus all of columns 0 and 19
+      int  i = z / 20, j = z % 20;
+      if ( ((i >= 4) && (i <= 8) && (j >= 3) && (j <= 12)) || (j == 0) || (j == 19) )
+        maskPixels[z] = 1.0;
+      else
+        maskPixels[z] = 0.0;
+      badPixel[z] = maskPixels[z];
+    }
+    ModelObject *modelObj_ref = MakeModel(dataPixels, maskPixels, false);
+    ModelObject *modelObj_masked = MakeModel(dataPixels, maskPixels, true);
+
+    // input mask is not modified (ModelObject stores its own copy)
+    for (z = 0; z < 300; z++)
+      TS_ASSERT_EQUALS(maskPixels[z], badPixel[z]);
+
+    // deviates and chi^2 for unmasked pixels are unchanged; masked pixels have
+    // deviates = 0
+    modelObj_ref->ComputeDeviates(deviates_ref, params);
+    modelObj_masked->ComputeDeviates(deviates_masked, params);
+    double  chi2_ref = 0.0;
+    for (z = 0; z < 300; z++) {
+      if (badPixel[z] > 0.0)
+        TS_ASSERT_EQUALS(deviates_masked[z], 0.0);
+      else {
+        TS_ASSERT_EQUALS(deviates_masked[z], deviates_ref[z]);
+        chi2_ref += deviates_ref[z]*deviates_ref[z];
+      }
+    }
+    TS_ASSERT_DELTA(modelObj_masked->ChiSquared(params), chi2_ref, 1.0e-12*chi2_ref);
+
+    // output model and residual images are still complete
+    modelObj_ref->CreateModelImage(params);
+    model_ref = modelObj_ref->GetModelImageVector();
+    model_masked = modelObj_masked->GetModelImageVector();
+    resid_masked = modelObj_masked->GetResidualImageVector();
+    for (z = 0; z < 300; z++) {
+      TS_ASSERT_EQUALS(model_masked[z], model_ref[z]);
+      TS_ASSERT_EQUALS(resid_masked[z], dataPixels[z] - model_ref[z]);
+    }
+
+    delete modelObj_ref;
+    delete modelObj_masked;
+  }
+
+  void testWeightImageThenChiSquared( void )
+  {
+    double  dataPixels[300], maskPixels[300];
+    double  *params = testParams_GaussExp;
+    long  z;
+    
+    for (z = 0; z < 300; z++) {
+      dataPixels[z] = 10.0 + (double)(z % 7);
+      maskPixels[z] = ((z % 20) == 0) ? 1.0 : 0.0;
+    }
+    ModelObject *modelObj = MakeModel(dataPixels, maskPixels, true);
+
+    double  chi2_before = modelObj->ChiSquared(params);
+    // weight image = 1/sigma^2 (data-based errors, gain = 1, no read noise),
+    // with masked pixels = 0
+    double *weights = modelObj->GetWeightImageVector();
+    for (z = 0; z < 300; z++) {
+      if (maskPixels[z] > 0.0)
+        TS_ASSERT_EQUALS(weights[z], 0.0);
+      else
+        TS_ASSERT_DELTA(weights[z], 1.0/dataPixels[z], 1.0e-15);
+    }
+    // weights are converted back to internal form for subsequent fit statistics
+    TS_ASSERT_EQUALS(modelObj->ChiSquared(params), chi2_before);
+
+    delete modelObj;
+  }
+};
+
+
+class TestSinglePrecision : public CxxTest::TestSuite
+{
+public:
+
+  void CompareModels( bool usePSF )
+  {
+    double  psfPixels[9] = {0.0, 0.5, 0.0, 0.5, 1.0, 0.5, 0.0, 0.5, 0.0};
+    double  *params = testParams_GaussExp;
+    double  *model_double, *model_float;
+    double  maxVal = 0.0;
+    TestModelOptions  options;
+    if (usePSF) {
+      options.psfPixels = psfPixels;
+      options.nColumns_psf = options.nRows_psf = 3;
+    }
+    ModelObject *modelObj_double = MakeTestModel(options);
+    options.singlePrecision = true;
+    ModelObject *modelObj_float = MakeTestModel(options);
+    long  nPixels = modelObj_double->GetNDataValues();
+
+    modelObj_double->CreateModelImage(params);
+    modelObj_float->CreateModelImage(params);
+    model_double = modelObj_double->GetModelImageVector();
+    model_float = modelObj_float->GetModelImageVector();
+    for (long z = 0; z < nPixels; z++)
+      maxVal = fmax(maxVal, fabs(model_double[z]));
+    for (long z = 0; z < nPixels; z++)
+      TS_ASSERT_DELTA(model_float[z], model_double[z], 1.0e-6*maxVal);
+    delete modelObj_double;
+    delete modelObj_float;
+  }
+
+  void testSinglePrecisionModel_noPSF( void )
+  {
+    CompareModels(false);
+  }
+
+  void testSinglePrecisionModel_withPSF( void )
+  {
+    CompareModels(true);
+  }
+
+  // Fit IC 3478 (64x64 cutout) with the reference config used by do_imfit_tests
+  // (GAIN, etc. as in the config file), using double- and single-precision
+  // models; best-fit parameters and chi^2 should agree closely
+  void testSinglePrecisionBestFit( void )
+  {
+    int  nColumns, nRows, status;
+    vector<string>  functionList;
+    vector<double>  paramsVect;
+    vector<mp_par>  paramLimits;
+    vector<int>  functionBlockIndices;
+    bool  paramLimitsExist;
+    configOptions  userConfigOptions;
+    double  bestfitChi2[2];
+    double  *bestfitParams[2];
+
+    status = ReadConfigFile("tests/imfit_reference/imfit_config_ic3478_64x64b.dat", true, functionList, 
+    						paramsVect, paramLimits, functionBlockIndices, paramLimitsExist,
+    						userConfigOptions);
+    TS_ASSERT_EQUALS(status, 0);
+    double *dataPixels = ReadImageAsVector("tests/ic3478rss_64x64.fits", &nColumns, &nRows);
+    TS_ASSERT( dataPixels != NULL );
+    int  nParams = (int)paramsVect.size();
+
+    for (int k = 0; k < 2; k++) {
+      ModelObject *theModel = new ModelObject();
+      AddFunctions(theModel, functionList, functionBlockIndices, true, -1);
+      if (k == 1)
+        theModel->SetSinglePrecision(true);
+      theModel->AddImageDataVector(dataPixels, nColumns, nRows);
+      theModel->AddImageCharacteristics(4.725, 4.3, 1.0, 1, 130.1);
+      theModel->FinalSetupForFitting();
+
+      bestfitParams[k] = (double *)calloc(nParams, sizeof(double));
+      for (int i = 0; i < nParams; i++)
+        bestfitParams[k][i] = paramsVect[i];
+      mp_par  *mpfitLimits = (mp_par *)calloc(nParams, sizeof(mp_par));
+      for (int i = 0; i < nParams; i++)
+        mpfitLimits[i] = paramLimits[i];
+      mp_result  mpfitResult;
+      mp_config  mpConfig;
+      bzero(&mpfitResult, sizeof(mpfitResult));
+      bzero(&mpConfig, sizeof(mpConfig));
+      mpConfig.maxiter = 1000;
+      mpConfig.ftol = 1.0e-8;
+      if (theModel->UsesSinglePrecision())   // as in LevMarFit
+        mpConfig.epsfcn = FLT_EPSILON;
+      status = mpfit(ComputeDeviatesForFit, (int)theModel->GetNDataValues(), nParams, 
+      				bestfitParams[k], mpfitLimits, &mpConfig, theModel, &mpfitResult);
+      TS_ASSERT( status > 0 );
+      bestfitChi2[k] = mpfitResult.bestnorm;
+      free(mpfitLimits);
+      delete theModel;
+    }
+
+    // reference values from tests/imfit_reference/imfit_textout3
+    TS_ASSERT_DELTA(bestfitParams[0][0], 32.9439, 1.0e-4);
+    TS_ASSERT_DELTA(bestfitParams[0][6], 60.7612, 1.0e-4);
+    TS_ASSERT_DELTA(bestfitChi2[1], bestfitChi2[0], 1.0e-5*bestfitChi2[0]);
+    for (int i = 0; i < nParams; i++)
+      TS_ASSERT_DELTA(bestfitParams[1][i], bestfitParams[0][i], 
+      				1.0e-3*fabs(bestfitParams[0][i]) + 1.0e-4);
+    free(bestfitParams[0]);
+    free(bestfitParams[1]);
+    free(dataPixels);
+  }
+
+  static int ComputeDeviatesForFit( int nDataVals, int nParams, double *params, 
+  									double *deviates, double **derivatives, ModelObject *theModel )
+  {
+    theModel->ComputeDeviates(deviates, params);
+    return 0;
+  }
+};
+
+
+class TestModelClone : public CxxTest::TestSuite
+{
+public:
+
+  // Gaussian + PointSource, FlatSky, on a 20x15 (masked) data image, with 5x5 PSF
+  // and (optionally) an oversampled region
+  ModelObject * MakeModel( double *dataPixels, double *maskPixels, double *psfPixels,
+  							PsfOversamplingInfo *osampleInfo )
+  {
+    TestModelOptions  options;
+    options.withPointSource = true;
+    options.psfPixels = psfPixels;
+    options.nColumns_psf = options.nRows_psf = 5;
+    options.dataPixels = dataPixels;
+    options.maskPixels = maskPixels;
+    options.osampleInfo = osampleInfo;
+    return MakeTestModel(options);
+  }
+
+  void MakeImages( double *dataPixels, double *maskPixels, double *psfPixels )
+  {
+    MakeGaussianPSF(psfPixels);
+    for (long z = 0; z < 300; z++) {
+      dataPixels[z] = 10.0 + (double)(z % 7);
+      maskPixels[z] = ((z % 20) == 3) ? 1.0 : 0.0;
+    }
+  }
+
+  // clones compute the same fit statistic as the original, without sharing
+  // any per-evaluation state
+  void testCloneChiSquared( void )
+  {
+    double  dataPixels[300], maskPixels[300], psfPixels[25];
+    double  *params1 = testParams_GaussPointSource;
+    double  params2[10] = {11.7, 6.1, 60.0, 0.5, 50.0, 3.5, 200.0, 1.0, 1.0, 8.0};
+    double  deviates1[300], deviates2[300];
+
+    MakeImages(dataPixels, maskPixels, psfPixels);
+    ModelObject *modelObj = MakeModel(dataPixels, maskPixels, psfPixels, NULL);
+    double  chi2_1 = modelObj->ChiSquared(params1);
+    double  chi2_2 = modelObj->ChiSquared(params2);
+    TS_ASSERT( chi2_1 != chi2_2 );
+
+    ModelObject *modelClone = modelObj->Clone();
+    TS_ASSERT( modelClone != NULL );
+    TS_ASSERT_EQUALS( modelClone->GetNParams(), modelObj->GetNParams() );
+    TS_ASSERT_EQUALS( modelClone->GetNValidPixels(), modelObj->GetNValidPixels() );
+
+    // interleaved evaluations with different parameters
+    modelObj->ComputeDeviates(deviates1, params1);
+    modelClone->ComputeDeviates(deviates2, params2);
+    TS_ASSERT_EQUALS( modelObj->ChiSquared(params1), chi2_1 );
+    TS_ASSERT_EQUALS( modelClone->ChiSquared(params2), chi2_2 );
+    TS_ASSERT_EQUALS( modelClone->ChiSquared(params1), chi2_1 );
+    
+    // clone's output images don't affect the original (and vice versa)
+    double  *weights = modelClone->GetWeightImageVector();
+    TS_ASSERT( weights != NULL );
+    TS_ASSERT_EQUALS( modelObj->ChiSquared(params2), chi2_2 );
+    modelObj->GetWeightImageVector();
+    TS_ASSERT_EQUALS( modelClone->ChiSquared(params1), chi2_1 );
+
+    double  *model_orig = modelObj->GetModelImageVector();
+    modelClone->CreateModelImage(params2);
+    double  *model_clone = modelClone->GetModelImageVector();
+    TS_ASSERT( model_clone != model_orig );
+    modelObj->CreateModelImage(params2);
+    model_orig = modelObj->GetModelImageVector();
+    for (long z = 0; z < 300; z++)
+      TS_ASSERT_EQUALS(model_clone[z], model_orig[z]);
+
+    delete modelClone;
+    delete modelObj;
+  }
+
+  // several clones (including oversampled PSF regions) evaluated at the same time
+  // give the same model images as the original evaluated serially
+  void testConcurrentClones( void )
+  {
+    double  dataPixels[300], maskPixels[300], psfPixels[25], psfPixels_ref[25];
+    double  params[3][10] = { {10.2, 7.6, 20.0, 0.2, 100.0, 2.0, 500.0, 1.0, 1.0, 5.0},
+    						{11.7, 6.1, 60.0, 0.5, 50.0, 3.5, 200.0, 1.0, 1.0, 8.0},
+    						{9.4, 8.3, 120.0, 0.1, 80.0, 1.5, 900.0, 1.0, 1.0, 2.0} };
+    ModelObject  *models[3];
+    double  *modelImages[3];
+
+    // (PSF images are normalized in place, so each model gets its own copies)
+    MakeImages(dataPixels, maskPixels, psfPixels);
+    PsfOversamplingInfo *osampleInfo = MakeOversamplingInfo(psfPixels);
+    ModelObject *modelObj = MakeModel(dataPixels, maskPixels, psfPixels, osampleInfo);
+    models[0] = modelObj;
+    models[1] = modelObj->Clone();
+    models[2] = modelObj->Clone();
+    TS_ASSERT( (models[1] != NULL) && (models[2] != NULL) );
+    TS_ASSERT_EQUALS( models[1]->HasOversampledPSF(), true );
+
+#pragma omp parallel for schedule (static, 1)
+    for (int k = 0; k < 3; k++) {
+      models[k]->CreateModelImage(params[k]);
+      modelImages[k] = models[k]->GetModelImageVector();
+    }
+    
+    MakeImages(dataPixels, maskPixels, psfPixels_ref);
+    PsfOversamplingInfo *osampleInfo_ref = MakeOversamplingInfo(psfPixels_ref);
+    ModelObject *modelObj_ref = MakeModel(dataPixels, maskPixels, psfPixels_ref, osampleInfo_ref);
+    for (int k = 0; k < 3; k++) {
+      modelObj_ref->CreateModelImage(params[k]);
+      double  *model_ref = modelObj_ref->GetModelImageVector();
+      for (long z = 0; z < 300; z++)
+        TS_ASSERT_EQUALS(modelImages[k][z], model_ref[z]);
+    }
+
+    delete models[2];
+    delete models[1];
+    delete modelObj;
+    delete modelObj_ref;
+    delete osampleInfo;
+    delete osampleInfo_ref;
+  }
+
+  // several oversampled regions (two of them overlapping) are computed in parallel
+  // when more than one thread is available, with the same result as computing
+  // them serially
+  void testParallelOversampledRegions( void )
+  {
+    double  dataPixels[300], maskPixels[300], psfPixels[25], psfPixels_ref[25];
+    double  *params = testParams_GaussPointSource;
+    double  modelImage_parallel[300];
+    const char  *regions[3] = {"8:13,5:10", "11:16,7:12", "1:5,1:4"};
+    PsfOversamplingInfo  *osampleInfo[3], *osampleInfo_ref[3];
+
+    MakeImages(dataPixels, maskPixels, psfPixels);
+    for (int i = 0; i < 25; i++)
+      psfPixels_ref[i] = psfPixels[i];
+    ModelObject *modelObj = MakeModel(dataPixels, maskPixels, psfPixels, NULL);
+    ModelObject *modelObj_ref = MakeModel(dataPixels, maskPixels, psfPixels_ref, NULL);
+    for (int k = 0; k < 3; k++) {
+      osampleInfo[k] = MakeOversamplingInfo(psfPixels, regions[k]);
+      osampleInfo_ref[k] = MakeOversamplingInfo(psfPixels, regions[k]);
+      modelObj->AddOversampledPsfInfo(osampleInfo[k]);
+      modelObj_ref->AddOversampledPsfInfo(osampleInfo_ref[k]);
+    }
+
+    // (SetMaxThreads sets the number of OpenMP threads for all models)
+    modelObj->SetMaxThreads(4);
+    modelObj->CreateModelImage(params);
+    double  *modelImage = modelObj->GetModelImageVector();
+    for (long z = 0; z < 300; z++)
+      modelImage_parallel[z] = modelImage[z];
+    // (a second evaluation reuses the regions' function lists)
+    modelObj->CreateModelImage(params);
+    modelImage = modelObj->GetModelImageVector();
+    for (long z = 0; z < 300; z++)
+      TS_ASSERT_EQUALS(modelImage[z], modelImage_parallel[z]);
+
+    modelObj_ref->SetMaxThreads(1);
+    modelObj_ref->CreateModelImage(params);
+    double  *model_ref = modelObj_ref->GetModelImageVector();
+    for (long z = 0; z < 300; z++)
+      TS_ASSERT_EQUALS(modelImage_parallel[z], model_ref[z]);
+
+    delete modelObj;
+    delete modelObj_ref;
+    for (int k = 0; k < 3; k++) {
+      delete osampleInfo[k];
+      delete osampleInfo_ref[k];
+    }
+  }
+};
+
+
+class TestFFTWWisdom : public CxxTest::TestSuite
+{
+public:
+
+  // Gaussian + PointSource, FlatSky model image (20x15) with 5x5 PSF and an
+  // oversampled region; uses (and updates) wisdomFile if it's not empty. (FFT
+  // convolution is the default here, since the wisdom is only used for FFTs.)
+  ModelObject * MakeModel( double *psfPixels, PsfOversamplingInfo *osampleInfo,
+  							const string& wisdomFile, int method=CONVOLUTION_FFT,
+  							bool cropped=true, int tileSize=0 )
+  {
+    TestModelOptions  options;
+    options.withPointSource = true;
+    options.psfPixels = psfPixels;
+    options.nColumns_psf = options.nRows_psf = 5;
+    options.osampleInfo = osampleInfo;
+    options.wisdomFile = wisdomFile;
+    options.convolutionMethod = method;
+    options.croppedConvolution = cropped;
+    options.fftTileSize = tileSize;
+    return MakeTestModel(options);
+  }
+
+  PsfOversamplingInfo * MakePSFs( double *psfPixels )
+  {
+    MakeGaussianPSF(psfPixels);
+    return MakeOversamplingInfo(psfPixels);
+  }
+
+  void RemoveWisdomFiles( const string& wisdomFile )
+  {
+    unlink(wisdomFile.c_str());
+    unlink((wisdomFile + ".lock").c_str());
+  }
+
+  // the first model creates the wisdom file; later models read it (and have
+  // nothing new to add); all models give the same image as one without wisdom
+  void testWisdomFileCreatedAndReused( void )
+  {
+    string  wisdomFile = "/tmp/imfit_unittest_fftw_wisdom";
+    double  psfPixels[3][25];
+    double  *params = testParams_GaussPointSource;
+    PsfOversamplingInfo  *osampleInfo[3];
+    ModelObject  *models[3];
+
+    RemoveWisdomFiles(wisdomFile);
+    TS_ASSERT( access(wisdomFile.c_str(), F_OK) != 0 );
+    for (int k = 0; k < 3; k++)
+      osampleInfo[k] = MakePSFs(psfPixels[k]);
+
+    models[0] = MakeModel(psfPixels[0], osampleInfo[0], "");
+    TS_ASSERT( access(wisdomFile.c_str(), F_OK) != 0 );
+    models[1] = MakeModel(psfPixels[1], osampleInfo[1], wisdomFile);
+    TS_ASSERT( access(wisdomFile.c_str(), R_OK) == 0 );
+    TS_ASSERT_EQUALS( ExportFFTWWisdom(wisdomFile), 0 );
+    models[2] = MakeModel(psfPixels[2], osampleInfo[2], wisdomFile);
+    TS_ASSERT_EQUALS( ImportFFTWWisdom(wisdomFile), 1 );
+
+    models[0]->CreateModelImage(params);
+    double  *model_ref = models[0]->GetModelImageVector();
+    for (int k = 1; k < 3; k++) {
+      models[k]->CreateModelImage(params);
+      double  *model_wisdom = models[k]->GetModelImageVector();
+      for (long z = 0; z < 300; z++)
+        TS_ASSERT_DELTA(model_wisdom[z], model_ref[z], 1.0e-12);
+    }
+
+    for (int k = 0; k < 3; k++) {
+      delete models[k];
+      delete osampleInfo[k];
+    }
+    RemoveWisdomFiles(wisdomFile);
+  }
+
+  // direct convolution (of the main image and the oversampled region) gives the
+  // same model image as FFT convolution
+  void testDirectConvolution( void )
+  {
+    double  psfPixels[2][25];
+    double  *params = testParams_GaussPointSource;
+    PsfOversamplingInfo  *osampleInfo[2];
+    ModelObject  *models[2];
+    int  methods[2] = {CONVOLUTION_FFT, CONVOLUTION_DIRECT};
+
+    for (int k = 0; k < 2; k++) {
+      osampleInfo[k] = MakePSFs(psfPixels[k]);
+      models[k] = MakeModel(psfPixels[k], osampleInfo[k], "", methods[k]);
+      models[k]->CreateModelImage(params);
+    }
+    double  *model_fft = models[0]->GetModelImageVector();
+    double  *model_direct = models[1]->GetModelImageVector();
+    for (long z = 0; z < 300; z++)
+      TS_ASSERT_DELTA(model_direct[z], model_fft[z], 1.0e-10);
+
+    for (int k = 0; k < 2; k++) {
+      delete models[k];
+      delete osampleInfo[k];
+    }
+  }
+
+  // cropped convolution (smaller model image, only the data region convolved)
+  // gives the same model image as convolving the full-size model image
+  void testCroppedConvolution( void )
+  {
+    double  psfPixels[2][25];
+    double  *params = testParams_GaussPointSource;
+    PsfOversamplingInfo  *osampleInfo[2];
+    ModelObject  *models[2];
+
+    for (int k = 0; k < 2; k++) {
+      osampleInfo[k] = MakePSFs(psfPixels[k]);
+      models[k] = MakeModel(psfPixels[k], osampleInfo[k], "", CONVOLUTION_FFT, (k == 1));
+      models[k]->CreateModelImage(params);
+    }
+    double  *model_full = models[0]->GetModelImageVector();
+    double  *model_cropped = models[1]->GetModelImageVector();
+    for (long z = 0; z < 300; z++)
+      TS_ASSERT_DELTA(model_cropped[z], model_full[z], 1.0e-10);
+
+    for (int k = 0; k < 2; k++) {
+      delete models[k];
+      delete osampleInfo[k];
+    }
+  }
+
+  // tiled convolution of the main model image (9 x 9 FFTs, 5 x 5 tiles) gives
+  // the same model image as convolving all of it at once, and so does a clone
+  void testTiledConvolution( void )
+  {
+    double  psfPixels[2][25];
+    double  *params = testParams_GaussPointSource;
+    PsfOversamplingInfo  *osampleInfo[2];
+    ModelObject  *models[2];
+
+    for (int k = 0; k < 2; k++) {
+      osampleInfo[k] = MakePSFs(psfPixels[k]);
+      models[k] = MakeModel(psfPixels[k], osampleInfo[k], "", CONVOLUTION_FFT, true, 
+      						(k == 1) ? 9 : 0);
+      models[k]->CreateModelImage(params);
+    }
+    double  *model_whole = models[0]->GetModelImageVector();
+    double  *model_tiled = models[1]->GetModelImageVector();
+    for (long z = 0; z < 300; z++)
+      TS_ASSERT_DELTA(model_tiled[z], model_whole[z], 1.0e-10);
+
+    ModelObject  *theClone = models[1]->Clone();
+    theClone->CreateModelImage(params);
+    double  *model_clone = theClone->GetModelImageVector();
+    for (long z = 0; z < 300; z++)
+      TS_ASSERT_DELTA(model_clone[z], model_tiled[z], 1.0e-12);
+    delete theClone;
+
+    for (int k = 0; k < 2; k++) {
+      delete models[k];
+      delete osampleInfo[k];
+    }
+  }
+
+  // a missing wisdom file is not an error
+  void testMissingWisdomFile( void )
+  {
+    string  wisdomFile = "/tmp/imfit_unittest_fftw_wisdom_missing";
+
+    RemoveWisdomFiles(wisdomFile);
+    TS_ASSERT_EQUALS( ImportFFTWWisdom(wisdomFile), 0 );
+    RemoveWisdomFiles(wisdomFile);
+  }
+};
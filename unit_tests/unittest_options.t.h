@@ -87,9 +87,17 @@ public:
     TS_ASSERT_EQUALS( imfitOptions_ptr->useModelForErrors, false );
     TS_ASSERT_EQUALS( imfitOptions_ptr->useCashStatistic, false );
     TS_ASSERT_EQUALS( imfitOptions_ptr->usePoissonMLR, false );
+    TS_ASSERT_EQUALS( imfitOptions_ptr->useComponentCache, false );
 
     TS_ASSERT_EQUALS( imfitOptions_ptr->noParamLimits, true );
     TS_ASSERT_EQUALS( imfitOptions_ptr->subsamplingFlag, true );
+    TS_ASSERT_EQUALS( imfitOptions_ptr->tabulateProfiles, false );
+    TS_ASSERT_EQUALS( imfitOptions_ptr->adaptiveSubsampling, false );
+    TS_ASSERT_EQUALS( imfitOptions_ptr->singlePrecision, false );
+    TS_ASSERT_EQUALS( imfitOptions_ptr->fftwWisdomFile, "" );
+    TS_ASSERT_EQUALS( imfitOptions_ptr->separablePSFTolerance, 0.0 );
+    TS_ASSERT_EQUALS( imfitOptions_ptr->croppedConvolution, true );
+    TS_ASSERT_EQUALS( imfitOptions_ptr->fftTileSize, 0 );
 
     TS_ASSERT_EQUALS( imfitOptions_ptr->doBootstrap, false );
     TS_ASSERT_EQUALS( imfitOptions_ptr->bootstrapIterations, 0 );
@@ -128,6 +136,13 @@ public:
 
     TS_ASSERT_EQUALS( mcmcOptions_ptr->noParamLimits, true );
     TS_ASSERT_EQUALS( mcmcOptions_ptr->subsamplingFlag, true );
+    TS_ASSERT_EQUALS( mcmcOptions_ptr->tabulateProfiles, false );
+    TS_ASSERT_EQUALS( mcmcOptions_ptr->adaptiveSubsampling, false );
+    TS_ASSERT_EQUALS( mcmcOptions_ptr->singlePrecision, false );
+    TS_ASSERT_EQUALS( mcmcOptions_ptr->fftwWisdomFile, "" );
+    TS_ASSERT_EQUALS( mcmcOptions_ptr->separablePSFTolerance, 0.0 );
+    TS_ASSERT_EQUALS( mcmcOptions_ptr->croppedConvolution, true );
+    TS_ASSERT_EQUALS( mcmcOptions_ptr->fftTileSize, 0 );
 
     TS_ASSERT_EQUALS( mcmcOptions_ptr->appendToOutput, false );
     TS_ASSERT_EQUALS( mcmcOptions_ptr->outputFileRoot, "mcmc_out" );
@@ -85,6 +85,22 @@ public:
     returnVal1 = psfInterp->GetValue(0.0,1.5);
     TS_ASSERT_DELTA( returnVal1, 0.01243073, DELTA );
   }
+
+  // values on the outer edges of the PSF should match the PSF pixels;
+  // values outside should be zero
+  void testGetValues_edges( void )
+  {
+    double  xEdge = (nColsPsf - 1) / 2.0;
+    double  yEdge = (nRowsPsf - 1) / 2.0;
+    long  nPixTot = (long)nColsPsf*nRowsPsf;
+    
+    TS_ASSERT_DELTA( psfInterp->GetValue(xEdge, yEdge), psfPixels[nPixTot - 1], DELTA );
+    TS_ASSERT_DELTA( psfInterp->GetValue(-xEdge, -yEdge), psfPixels[0], DELTA );
+    TS_ASSERT_DELTA( psfInterp->GetValue(xEdge, 0.0), 
+    				psfPixels[(nRowsPsf/2)*nColsPsf + nColsPsf - 1], DELTA );
+    TS_ASSERT_EQUALS( psfInterp->GetValue(xEdge + 0.01, 0.0), 0.0 );
+    TS_ASSERT_EQUALS( psfInterp->GetValue(0.0, -yEdge - 0.01), 0.0 );
+  }
 };
 
 
@@ -186,6 +202,100 @@ public:
     TS_ASSERT_DELTA( returnVal1, 0.0002065470426474115, DELTA );
   }
 
+  void testMakeShiftedStamp( void )
+  {
+    int  nStampCols = 4;
+    int  nStampRows = 4;
+    double  xStart = -1.7;
+    double  yStart = -1.4;
+    double  stampPixels[20];
+    
+    TS_ASSERT( psfInterp->CanMakeShiftedStamp() );
+    psfInterp->MakeShiftedStamp(xStart, yStart, nStampCols, nStampRows, stampPixels);
+    for (int r = 0; r < nStampRows; r++) {
+      for (int c = 0; c < nStampCols; c++) {
+        double  correctVal = psfInterp->GetValue(xStart + c, yStart + r);
+        TS_ASSERT_DELTA( stampPixels[r*nStampCols + c], correctVal, DELTA );
+      }
+    }
+  }
+
+  // stamp points beyond the edge of the PSF image should get zero contributions
+  // from the missing pixels, as in GetValue
+  void testMakeShiftedStamp_edges( void )
+  {
+    int  nStampCols = 4;
+    int  nStampRows = 5;
+    double  xStart = -1.25;
+    double  yStart = -2.0;
+    double  stampPixels[20];
+    
+    psfInterp->MakeShiftedStamp(xStart, yStart, nStampCols, nStampRows, stampPixels);
+    for (int r = 0; r < nStampRows; r++) {
+      for (int c = 0; c < nStampCols; c++) {
+        double  correctVal = psfInterp->GetValue(xStart + c, yStart + r);
+        TS_ASSERT_DELTA( stampPixels[r*nStampCols + c], correctVal, DELTA );
+      }
+    }
+  }
+};
+
+
+class TestPsfInterpolator_lanczos3 : public CxxTest::TestSuite 
+{
+  // data members
+  int  nColsPsf, nRowsPsf;
+  double  *psfPixels;
+  PsfInterpolator *psfInterp;
+  
+public:
+  void setUp()
+  {
+    psfPixels = ReadImageAsVector(psfImage_filename, &nColsPsf, &nRowsPsf);
+    psfInterp = new PsfInterpolator_lanczos3(psfPixels, nColsPsf, nRowsPsf);
+  }
+
+  void tearDown()
+  {
+    delete psfInterp;
+    free(psfPixels);
+  }
+
+
+  void testGetInterpolatorType( void )
+  {
+    int returnVal = psfInterp->GetInterpolatorType();
+    TS_ASSERT_EQUALS( returnVal, kInterpolator_lanczos3 );
+  }
+
+  // with no shift, interpolation should return original pixel values
+  void testGetValues_noshift( void )
+  {
+    double returnVal0, returnVal1;
+    
+    returnVal0 = psfInterp->GetValue(0.0,0.0);
+    TS_ASSERT_DELTA( returnVal0, 0.73212016, DELTA );
+    returnVal1 = psfInterp->GetValue(1.0,0.0);
+    TS_ASSERT_DELTA( returnVal1, 0.16868566, DELTA );
+  }
+
+  void testMakeShiftedStamp( void )
+  {
+    int  nStampCols = 4;
+    int  nStampRows = 4;
+    double  xStart = -1.7;
+    double  yStart = -1.4;
+    double  stampPixels[20];
+    
+    TS_ASSERT( psfInterp->CanMakeShiftedStamp() );
+    psfInterp->MakeShiftedStamp(xStart, yStart, nStampCols, nStampRows, stampPixels);
+    for (int r = 0; r < nStampRows; r++) {
+      for (int c = 0; c < nStampCols; c++) {
+        double  correctVal = psfInterp->GetValue(xStart + c, yStart + r);
+        TS_ASSERT_DELTA( stampPixels[r*nStampCols + c], correctVal, DELTA );
+      }
+    }
+  }
 };
 
 
@@ -0,0 +1,229 @@
+// Unit tests for vectorized (SIMD) kernels
+//
+
+// See run_unittest_simd_kernels.sh for how to compile and run these tests.
+
+// Each test is run for every instruction set the CPU supports (scalar, AVX2,
+// AVX-512), comparing results with the standard math library.
+
+
+#include <cxxtest/TestSuite.h>
+
+#include <math.h>
+#include <string>
+#include <vector>
+using namespace std;
+
+#include "function_objects/simd_kernels.h"
+
+
+// maximum relative errors for exp and log (see simd_kernels.h)
+#define EXP_TOL  2.5e-16
+#define LOG_TOL  5.0e-16
+
+
+class TestSimdKernels : public CxxTest::TestSuite 
+{
+  SimdLevel  originalLevel;
+  int  nLevels;
+  
+public:
+  void setUp()
+  {
+    originalLevel = GetSimdLevel();
+    nLevels = (int)DetectSimdLevel() + 1;
+  }
+
+  void tearDown()
+  {
+    SetSimdLevel(originalLevel);
+  }
+
+
+  void testSetSimdLevel( void )
+  {
+    TS_ASSERT_EQUALS( SetSimdLevel(SIMD_SCALAR), SIMD_SCALAR );
+    TS_ASSERT_EQUALS( GetSimdLevel(), SIMD_SCALAR );
+    // requests for unsupported levels are reduced to best supported level
+    TS_ASSERT_EQUALS( SetSimdLevel(SIMD_AVX512), DetectSimdLevel() );
+    TS_ASSERT_EQUALS( string(SimdLevelName(SIMD_SCALAR)), string("scalar") );
+  }
+
+  void testExp( void )
+  {
+    int  nVals = 20001;
+    vector<double>  inVals(nVals), outVals(nVals);
+    for (int i = 0; i < nVals; i++)
+      inVals[i] = -700.0 + 1400.0*i/(nVals - 1);
+    
+    for (int level = 0; level < nLevels; level++) {
+      SetSimdLevel((SimdLevel)level);
+      VectorExp(&inVals[0], &outVals[0], nVals);
+      for (int i = 0; i < nVals; i++) {
+        double  correctVal = exp(inVals[i]);
+        TS_ASSERT_DELTA( outVals[i], correctVal, EXP_TOL*correctVal );
+      }
+    }
+  }
+
+  void testExp_specialValues( void )
+  {
+    double  inVals[5] = {0.0, -HUGE_VAL, -1000.0, 1000.0, HUGE_VAL};
+    double  outVals[5];
+    
+    for (int level = 0; level < nLevels; level++) {
+      SetSimdLevel((SimdLevel)level);
+      VectorExp(inVals, outVals, 5);
+      TS_ASSERT_EQUALS( outVals[0], 1.0 );
+      TS_ASSERT_EQUALS( outVals[1], 0.0 );
+      TS_ASSERT_EQUALS( outVals[2], 0.0 );
+      TS_ASSERT_EQUALS( outVals[3], HUGE_VAL );
+      TS_ASSERT_EQUALS( outVals[4], HUGE_VAL );
+    }
+  }
+
+  void testLog( void )
+  {
+    int  nVals = 20001;
+    vector<double>  inVals(nVals), outVals(nVals);
+    // logarithmically spaced values from 1e-300 to 1e300, plus values near 1
+    for (int i = 0; i < nVals; i++) {
+      if (i % 2 == 0)
+        inVals[i] = pow(10.0, -300.0 + 600.0*i/(nVals - 1));
+      else
+        inVals[i] = 1.0 + 1.0e-6*(i - nVals/2);
+    }
+    
+    for (int level = 0; level < nLevels; level++) {
+      SetSimdLevel((SimdLevel)level);
+      VectorLog(&inVals[0], &outVals[0], nVals);
+      for (int i = 0; i < nVals; i++) {
+        double  correctVal = log(inVals[i]);
+        TS_ASSERT_DELTA( outVals[i], correctVal, LOG_TOL*fabs(correctVal) );
+      }
+    }
+  }
+
+  void testLog_specialValues( void )
+  {
+    double  inVals[4] = {1.0, 0.0, HUGE_VAL, -1.0};
+    double  outVals[4];
+    
+    for (int level = 0; level < nLevels; level++) {
+      SetSimdLevel((SimdLevel)level);
+      VectorLog(inVals, outVals, 4);
+      TS_ASSERT_EQUALS( outVals[0], 0.0 );
+      TS_ASSERT_EQUALS( outVals[1], -HUGE_VAL );
+      TS_ASSERT_EQUALS( outVals[2], HUGE_VAL );
+      TS_ASSERT( isnan(outVals[3]) );
+    }
+  }
+
+  void testPow( void )
+  {
+    // includes zero (0^y = 0 for y > 0) and tail lengths < vector size
+    double  inVals[7] = {0.0, 0.5, 1.0, 2.0, 3.7, 100.0, 1.0e5};
+    double  exponents[3] = {0.25, 2.0, 4.5};
+    double  outVals[7];
+    
+    for (int level = 0; level < nLevels; level++) {
+      SetSimdLevel((SimdLevel)level);
+      for (int k = 0; k < 3; k++) {
+        VectorPow(inVals, exponents[k], outVals, 7);
+        for (int i = 0; i < 7; i++) {
+          double  correctVal = pow(inVals[i], exponents[k]);
+          double  tol = EXP_TOL + LOG_TOL*fabs(exponents[k]*log(inVals[i]));
+          if (inVals[i] == 0.0)
+            TS_ASSERT_EQUALS( outVals[i], 0.0 );
+          else
+            TS_ASSERT_DELTA( outVals[i], correctVal, 2.0*tol*correctVal );
+        }
+      }
+    }
+  }
+
+  void testEllipticalRadii( void )
+  {
+    // radii should be *identical* for all implementations, for all lengths
+    // (including partial vectors)
+    double  cosPA = cos(1.1);
+    double  sinPA = sin(1.1);
+    double  q = 0.6;
+    
+    for (int nVals = 1; nVals <= 21; nVals++) {
+      vector<double>  xVals(nVals), yVals(nVals), correctVals(nVals), rVals(nVals);
+      for (int i = 0; i < nVals; i++) {
+        xVals[i] = 1.0 + i;
+        yVals[i] = 5.3 + 0.1*i;
+      }
+      SetSimdLevel(SIMD_SCALAR);
+      EllipticalRadii(&xVals[0], &yVals[0], nVals, 10.2, 3.1, cosPA, sinPA, q, &correctVals[0]);
+      for (int level = 1; level < nLevels; level++) {
+        SetSimdLevel((SimdLevel)level);
+        EllipticalRadii(&xVals[0], &yVals[0], nVals, 10.2, 3.1, cosPA, sinPA, q, &rVals[0]);
+        for (int i = 0; i < nVals; i++)
+          TS_ASSERT_EQUALS( rVals[i], correctVals[i] );
+      }
+    }
+  }
+
+  void testGeneralizedEllipticalRadii( void )
+  {
+    int  nVals = 13;
+    double  xVals[13], yVals[13], rVals[13];
+    double  cosPA = cos(0.3);
+    double  sinPA = sin(0.3);
+    double  q = 0.5;
+    double  ellExp = 2.5;   // c0 = 0.5 (boxy)
+    
+    for (int i = 0; i < nVals; i++) {
+      xVals[i] = i;
+      yVals[i] = 4.0;
+    }
+    for (int level = 0; level < nLevels; level++) {
+      SetSimdLevel((SimdLevel)level);
+      GeneralizedEllipticalRadii(xVals, yVals, nVals, 6.0, 4.0, cosPA, sinPA, q, 
+      							ellExp, 1.0/ellExp, rVals);
+      for (int i = 0; i < nVals; i++) {
+        double  xp = fabs((xVals[i] - 6.0)*cosPA);
+        double  yp_scaled = fabs(-(xVals[i] - 6.0)*sinPA/q);
+        double  correctVal = pow(pow(xp, ellExp) + pow(yp_scaled, ellExp), 1.0/ellExp);
+        TS_ASSERT_DELTA( rVals[i], correctVal, 1.0e-14*correctVal );
+      }
+    }
+  }
+
+  void testProfiles( void )
+  {
+    // profiles computed in place (outVals = rVals), including r = 0
+    int  nVals = 37;
+    vector<double>  rVals(nVals), outVals(nVals);
+    double  I_0 = 3.0;
+    
+    for (int level = 0; level < nLevels; level++) {
+      SetSimdLevel((SimdLevel)level);
+      for (int i = 0; i < nVals; i++)
+        rVals[i] = outVals[i] = 0.75*i;
+      SersicProfile(&outVals[0], nVals, I_0, 5.0, 7.669, 0.25, &outVals[0]);
+      for (int i = 0; i < nVals; i++) {
+        double  correctVal = I_0*exp(-7.669*(pow(rVals[i]/5.0, 0.25) - 1.0));
+        TS_ASSERT_DELTA( outVals[i], correctVal, 1.0e-14*correctVal );
+      }
+      ExponentialProfile(&rVals[0], nVals, I_0, 4.0, &outVals[0]);
+      for (int i = 0; i < nVals; i++) {
+        double  correctVal = I_0*exp(-rVals[i]/4.0);
+        TS_ASSERT_DELTA( outVals[i], correctVal, 1.0e-14*correctVal );
+      }
+      GaussianProfile(&rVals[0], nVals, I_0, 18.0, &outVals[0]);
+      for (int i = 0; i < nVals; i++) {
+        double  correctVal = I_0*exp(-rVals[i]*rVals[i]/18.0);
+        TS_ASSERT_DELTA( outVals[i], correctVal, 1.0e-14*correctVal );
+      }
+      MoffatProfile(&rVals[0], nVals, I_0, 2.5, 3.5, &outVals[0]);
+      for (int i = 0; i < nVals; i++) {
+        double  correctVal = I_0/pow(1.0 + (rVals[i]/2.5)*(rVals[i]/2.5), 3.5);
+        TS_ASSERT_DELTA( outVals[i], correctVal, 1.0e-14*correctVal );
+      }
+    }
+  }
+};